@@ -0,0 +1,370 @@
+#include "Application.h"
+#include "core/SwapChain.h"
+#include "core/VulkanContext.h"
+#include "renderer/GraphicsPipeline.h"
+#include "renderer/Renderer.h"
+#include "utils/Trace.h"
+#include <cstdlib>
+#include <iostream>
+#include <stdexcept>
+#include <thread>
+
+
+namespace
+{
+    // a zero sized swap chain can't be created
+    bool isMinimized(GLFWwindow* window)
+    {
+        int width = 0;
+        int height = 0;
+        glfwGetFramebufferSize(window, &width, &height);
+        return width == 0 || height == 0;
+    }
+}
+
+
+std::string toString(FrameLoopMode mode)
+{
+    switch (mode)
+    {
+    case FrameLoopMode::eCapped: return "capped";
+    case FrameLoopMode::eOnDemand: return "on_demand";
+    case FrameLoopMode::eContinuous:
+    default: return "continuous";
+    }
+}
+
+
+FrameLoopSettings getFrameLoopSettingsFromEnvironment()
+{
+    FrameLoopSettings settings;
+    const char* env_value = std::getenv(FRAME_LOOP_ENV);
+    if (env_value == nullptr || *env_value == '\0') return settings;
+
+    // capped takes an optional rate, capped:144
+    std::string mode_name = env_value;
+    std::string frame_rate;
+    if (size_t separator = mode_name.find(':'); separator != std::string::npos)
+    {
+        frame_rate = mode_name.substr(separator + 1);
+        mode_name = mode_name.substr(0, separator);
+    }
+
+    for (FrameLoopMode mode : {FrameLoopMode::eContinuous, FrameLoopMode::eCapped, FrameLoopMode::eOnDemand})
+    {
+        if (mode_name != toString(mode)) continue;
+
+        settings.mode = mode;
+        if (!frame_rate.empty()) settings.maxFrameRate = std::stod(frame_rate);
+        return settings;
+    }
+
+    std::cerr << FRAME_LOOP_ENV << "=" << env_value << " is not a known frame loop, using " << toString(settings.mode) << "\n";
+    return settings;
+}
+
+
+FrameLoop::FrameLoop(const FrameLoopSettings& settings)
+    : settings_(settings)
+{
+    if (settings_.mode != FrameLoopMode::eCapped) return;
+
+    if (settings_.maxFrameRate <= 0.0)
+    {
+        throw std::runtime_error("a capped frame loop needs a frame rate above 0");
+    }
+    framePeriod_ = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(1.0 / settings_.maxFrameRate));
+}
+
+
+void FrameLoop::waitForFrame()
+{
+    TRACE_SCOPE("waitForFrame");
+    switch (settings_.mode)
+    {
+    case FrameLoopMode::eCapped:
+        sleepUntil(nextFrameTime_);
+        return;
+    case FrameLoopMode::eOnDemand:
+        // any event, or the empty one markDirty() posts, ends the wait early
+        if (!isDirty_.load(std::memory_order_acquire) && !isAnimating_) glfwWaitEventsTimeout(settings_.idleTimeoutSeconds);
+        return;
+    case FrameLoopMode::eContinuous:
+    default:
+        return;
+    }
+}
+
+
+bool FrameLoop::beginFrame()
+{
+    if (settings_.mode == FrameLoopMode::eOnDemand)
+    {
+        bool was_dirty = isDirty_.exchange(false, std::memory_order_acq_rel);
+        if (!was_dirty && !isAnimating_)
+        {
+            idleWakeCount_++;
+            return false;
+        }
+    }
+
+    if (settings_.mode == FrameLoopMode::eCapped)
+    {
+        // a steady cadence, a frame that ran late starts the next period from now instead of catching up
+        Clock::time_point now = Clock::now();
+        nextFrameTime_ = now - nextFrameTime_ > framePeriod_ ? now + framePeriod_ : nextFrameTime_ + framePeriod_;
+    }
+
+    frameCount_++;
+    return true;
+}
+
+
+void FrameLoop::markDirty()
+{
+    // one wake up per frame, however many events or workers mark it
+    if (!isDirty_.exchange(true, std::memory_order_acq_rel)) glfwPostEmptyEvent();
+}
+
+
+void FrameLoop::setAnimating(bool is_animating)
+{
+    isAnimating_ = is_animating;
+}
+
+
+void FrameLoop::sleepUntil(Clock::time_point deadline) const
+{
+    // the sleep happens in the event wait, so input is still handled while the frame isn't due
+    while (true)
+    {
+        Clock::duration remaining = deadline - Clock::now();
+        if (remaining <= SPIN_THRESHOLD) break;
+        glfwWaitEventsTimeout(std::chrono::duration<double>(remaining - SPIN_THRESHOLD).count());
+    }
+
+    while (Clock::now() < deadline)
+    {
+        std::this_thread::yield();
+    }
+}
+
+
+void FrameLoop::printStatistics() const
+{
+    std::cout << "frame loop: " << toString(settings_.mode) << ", " << frameCount_ << " frames";
+    if (settings_.mode == FrameLoopMode::eCapped) std::cout << " capped at " << settings_.maxFrameRate << " fps";
+    if (settings_.mode == FrameLoopMode::eOnDemand) std::cout << ", " << idleWakeCount_ << " idle wake ups";
+    std::cout << "\n";
+}
+
+
+Application::Application(
+    const VulkanContext& context,
+    Renderer& renderer,
+    GraphicsPipeline& pipeline,
+    GLFWwindow* window,
+    SwapChain& swap_chain,
+    const FrameLoopSettings& settings
+)
+    : context_(context), renderer_(renderer), pipeline_(pipeline), window_(window), swapChain_(swap_chain), frameLoop_(settings)
+{
+    watchWindow(window_);
+}
+
+
+Application::~Application()
+{
+    closeViewports(false);
+}
+
+
+void Application::openViewport(const std::string& title, int width, int height)
+{
+    GLFWwindow* window = glfwCreateWindow(width, height, title.c_str(), nullptr, nullptr);
+    if (!window)
+    {
+        throw std::runtime_error("failed to create viewport window");
+    }
+
+    try
+    {
+        auto swap_chain = std::make_unique<SwapChain>(context_, context_.createWindowSurface(window), window, swapChain_.getPresentProfile());
+        if (swap_chain->getFormat() != swapChain_.getFormat())
+        {
+            throw std::runtime_error("viewport surfaces with a different format need a pipeline of their own");
+        }
+        viewports_.push_back({.window = window, .swapChain = std::move(swap_chain)});
+    }
+    catch (...)
+    {
+        glfwDestroyWindow(window);
+        throw;
+    }
+
+    watchWindow(window);
+    frameLoop_.markDirty();
+}
+
+
+void Application::run(const std::function<void()>& update, const std::function<void()>& frame_drawn)
+{
+    while (!glfwWindowShouldClose(window_))
+    {
+        frameLoop_.waitForFrame();
+        renderer_.waitForInputSample(swapChain_);
+        glfwPollEvents();
+        if (update) update();
+        closeViewports(true);
+
+        if (isMinimized(window_))
+        {
+            glfwWaitEvents();  // restoring it resizes the framebuffer, that marks the next frame dirty
+            continue;
+        }
+        if (!frameLoop_.beginFrame()) continue;
+
+        recreateResizedSwapChains();
+        drawFrame();
+        if (frame_drawn) frame_drawn();
+    }
+
+    closeViewports(false);
+}
+
+
+void Application::drawFrame()
+{
+    if (viewports_.empty())
+    {
+        if (renderer_.drawFrame(swapChain_, pipeline_))
+        {
+            renderer_.retireSwapChain(swapChain_.recreate());  // no device idle, the old one dies once its presents are done
+            frameLoop_.markDirty();  // an out of date acquire presented nothing, the window still shows the old frame
+        }
+        return;
+    }
+
+    // minimized viewports sit the frame out, the first window is never minimized here
+    std::vector<WindowViewport> viewports = {{.swapChain = &swapChain_, .pipeline = &pipeline_}};
+    for (const Viewport& viewport : viewports_)
+    {
+        if (!isMinimized(viewport.window)) viewports.push_back({.swapChain = viewport.swapChain.get(), .pipeline = &pipeline_});
+    }
+    for (SwapChain* swap_chain : renderer_.drawFrame(viewports))
+    {
+        renderer_.retireSwapChain(swap_chain->recreate());
+        frameLoop_.markDirty();
+    }
+}
+
+
+void Application::recreateResizedSwapChains()
+{
+    // the callback beats the present's out of date report by a frame, and some platforms never send one
+    std::erase_if(resizedWindows_, [this](GLFWwindow* window)
+    {
+        if (isMinimized(window)) return false;  // recreated once it has a size again
+
+        SwapChain* swap_chain = findSwapChain(window);
+        if (!swap_chain) return true;
+
+        int width = 0;
+        int height = 0;
+        glfwGetFramebufferSize(window, &width, &height);
+        vk::Extent2D extent = swap_chain->getExtent();
+        if (extent.width != static_cast<uint32_t>(width) || extent.height != static_cast<uint32_t>(height))
+        {
+            renderer_.retireSwapChain(swap_chain->recreate());
+        }
+        return true;
+    });
+}
+
+
+void Application::closeViewports(bool closed_only)
+{
+    // the context stays, only the window's surface and swap chain go
+    std::erase_if(viewports_, [this, closed_only](Viewport& viewport)
+    {
+        if (closed_only && !glfwWindowShouldClose(viewport.window)) return false;
+
+        renderer_.removeSwapChain(*viewport.swapChain);
+        resizedWindows_.erase(viewport.window);
+        viewport.swapChain.reset();
+        glfwDestroyWindow(viewport.window);
+        return true;
+    });
+}
+
+
+void Application::watchWindow(GLFWwindow* window)
+{
+    glfwSetWindowUserPointer(window, this);
+
+    glfwSetFramebufferSizeCallback(window, [](GLFWwindow* glfw_window, int, int)
+    {
+        Application& application = fromWindow(glfw_window);
+        application.resizedWindows_.insert(glfw_window);
+        application.frameLoop_.markDirty();
+    });
+
+    // everything that can change what the window shows
+    glfwSetWindowRefreshCallback(window, [](GLFWwindow* glfw_window) { fromWindow(glfw_window).frameLoop_.markDirty(); });
+    glfwSetWindowCloseCallback(window, [](GLFWwindow* glfw_window) { fromWindow(glfw_window).frameLoop_.markDirty(); });
+    glfwSetWindowFocusCallback(window, [](GLFWwindow* glfw_window, int) { fromWindow(glfw_window).frameLoop_.markDirty(); });
+    glfwSetKeyCallback(window, [](GLFWwindow* glfw_window, int, int, int, int) { fromWindow(glfw_window).frameLoop_.markDirty(); });
+    glfwSetCharCallback(window, [](GLFWwindow* glfw_window, unsigned int) { fromWindow(glfw_window).frameLoop_.markDirty(); });
+    glfwSetMouseButtonCallback(window, [](GLFWwindow* glfw_window, int, int, int) { fromWindow(glfw_window).frameLoop_.markDirty(); });
+    glfwSetCursorPosCallback(window, [](GLFWwindow* glfw_window, double, double) { fromWindow(glfw_window).frameLoop_.markDirty(); });
+    glfwSetScrollCallback(window, [](GLFWwindow* glfw_window, double, double) { fromWindow(glfw_window).frameLoop_.markDirty(); });
+}
+
+
+SwapChain* Application::findSwapChain(GLFWwindow* window)
+{
+    if (window == window_) return &swapChain_;
+
+    for (const Viewport& viewport : viewports_)
+    {
+        if (viewport.window == window) return viewport.swapChain.get();
+    }
+    return nullptr;
+}
+
+
+Application& Application::fromWindow(GLFWwindow* window)
+{
+    return *static_cast<Application*>(glfwGetWindowUserPointer(window));
+}
+
+
+// Accessor functions
+const FrameLoopSettings& FrameLoop::getSettings() const
+{
+    return settings_;
+}
+
+
+uint64_t FrameLoop::getFrameCount() const
+{
+    return frameCount_;
+}
+
+
+uint64_t FrameLoop::getIdleWakeCount() const
+{
+    return idleWakeCount_;
+}
+
+
+FrameLoop& Application::getFrameLoop()
+{
+    return frameLoop_;
+}
+
+
+uint32_t Application::getViewportCount() const
+{
+    return static_cast<uint32_t>(viewports_.size()) + 1;
+}
@@ -0,0 +1,147 @@
+#pragma once
+
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+// forward declaring classes
+class VulkanContext;
+class Renderer;
+class GraphicsPipeline;
+class SwapChain;
+
+// How FrameLoop paces frames
+enum class FrameLoopMode
+{
+    eContinuous,  // back to back, only the present mode paces
+    eCapped,      // at most maxFrameRate frames per second, the loop sleeps in between
+    eOnDemand     // only frames something marked dirty, the loop sleeps in glfwWaitEventsTimeout otherwise
+};
+
+struct FrameLoopSettings
+{
+    FrameLoopMode mode = FrameLoopMode::eContinuous;
+    double maxFrameRate = 60.0;        // eCapped
+    double idleTimeoutSeconds = 0.25;  // eOnDemand, an idle loop still wakes up this often to poll
+};
+
+auto toString(FrameLoopMode mode) -> std::string;
+
+// Reads FRAME_LOOP_ENV: continuous, capped, capped:<fps> or on_demand. Continuous when unset or unknown
+inline constexpr const char* FRAME_LOOP_ENV = "VK_TUTORIAL_FRAME_LOOP";
+auto getFrameLoopSettingsFromEnvironment() -> FrameLoopSettings;
+
+
+// Decides when the next frame starts, instead of spinning on glfwPollEvents(). Capped frames sleep in
+// glfwWaitEventsTimeout() until shortly before their deadline, so input still wakes the loop, and spin
+// the rest because OS sleeps overshoot. On demand the loop blocks until an event or markDirty() and only
+// renders dirty frames: input, resizes, streaming completions or a running animation (setAnimating()).
+// Not thread safe, except markDirty().
+class FrameLoop
+{
+public:
+    explicit FrameLoop(const FrameLoopSettings& settings);
+
+    // blocks until the mode lets the next frame start, window events are processed meanwhile. On demand it
+    // also returns after idleTimeoutSeconds without anything to draw, so the caller gets to poll
+    void waitForFrame();
+
+    // true when a frame should render now, consumes the dirty flag. Always true unless on demand
+    bool beginFrame();
+
+    void markDirty();  // thread safe, wakes a waiting loop through glfwPostEmptyEvent()
+    void setAnimating(bool is_animating);  // on demand renders every frame while set
+    void printStatistics() const;
+
+    // accessor functions
+    auto getSettings() const -> const FrameLoopSettings&;
+    uint64_t getFrameCount() const;
+    uint64_t getIdleWakeCount() const;  // on demand wake ups that rendered nothing
+
+    // sleeps overshoot by up to a scheduler tick, the last stretch before a capped deadline is spun
+    static constexpr std::chrono::microseconds SPIN_THRESHOLD{2000};
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    void sleepUntil(Clock::time_point deadline) const;
+
+    FrameLoopSettings settings_;
+    Clock::duration framePeriod_ = {};
+    Clock::time_point nextFrameTime_;  // eCapped
+    std::atomic<bool> isDirty_ = true;  // the first frame always renders
+    bool isAnimating_ = false;
+    uint64_t frameCount_ = 0;
+    uint64_t idleWakeCount_ = 0;
+};
+
+
+// The windowed frame loop: draws the first window, plus the viewports opened next to it, through the
+// Renderer whenever the FrameLoop lets it. Every window's input, refresh and close callbacks mark the
+// frame dirty, and its framebuffer size callback recreates the swap chain (SwapChain::recreate()) before
+// the next frame instead of waiting for a present to report it out of date.
+// The windows keep this as their GLFW user pointer while it exists.
+// Not thread safe, except getFrameLoop().markDirty().
+class Application
+{
+public:
+    Application(
+        const VulkanContext& context,
+        Renderer& renderer,
+        GraphicsPipeline& pipeline,
+        GLFWwindow* window,
+        SwapChain& swap_chain,
+        const FrameLoopSettings& settings
+    );
+    ~Application();  // closes the viewports run() didn't
+
+    // deleting copy constructors
+    Application(const Application&) = delete;
+    Application& operator=(const Application&) = delete;
+
+    // another window with a surface and swap chain of its own on the same device, drawn in the same submit
+    // and presented in the same vkQueuePresentKHR as the first one. Closing it removes the viewport.
+    // throws std::runtime_error when its surface format differs, the pipeline is built for the first window's
+    void openViewport(const std::string& title, int width, int height);
+
+    // runs until the first window closes, then closes the viewports. update runs once per loop iteration
+    // after the events were processed, frame_drawn after every drawn frame
+    void run(const std::function<void()>& update = {}, const std::function<void()>& frame_drawn = {});
+
+    // accessor functions
+    auto getFrameLoop() -> FrameLoop&;  // markDirty() when streamed assets become ready, setAnimating() for animations
+    uint32_t getViewportCount() const;  // windows, the first one included
+
+private:
+    // a window next to the first one, owned by the Application
+    struct Viewport
+    {
+        GLFWwindow* window = nullptr;
+        std::unique_ptr<SwapChain> swapChain;
+    };
+
+    // private member functions
+    void watchWindow(GLFWwindow* window);
+    void closeViewports(bool closed_only);
+    void recreateResizedSwapChains();
+    void drawFrame();
+    auto findSwapChain(GLFWwindow* window) -> SwapChain*;
+    static auto fromWindow(GLFWwindow* window) -> Application&;
+
+    // private member variables
+    const VulkanContext& context_;
+    Renderer& renderer_;
+    GraphicsPipeline& pipeline_;
+    GLFWwindow* window_;
+    SwapChain& swapChain_;
+    FrameLoop frameLoop_;
+    std::vector<Viewport> viewports_;
+    std::unordered_set<GLFWwindow*> resizedWindows_;  // framebuffer size changed, recreated before the next frame
+};
@@ -0,0 +1,303 @@
+// benchmark: scripted scenarios, reported as JSON so results can be diffed between releases
+//     VulkanBenchmark [--output benchmark.json] [--frames 1000] [--recreates 50] [--startups 5] [--upload-mib 256]
+// frames and upload run headless, recreate needs a display and is skipped without one
+
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "core/VulkanContext.h"
+#include "core/OffscreenTarget.h"
+#include "core/SwapChain.h"
+#include "renderer/GraphicsPipeline.h"
+#include "renderer/PipelineStateCache.h"
+#include "renderer/Renderer.h"
+#include "renderer/UploadEngine.h"
+#include "utils/Trace.h"
+
+using Clock = std::chrono::steady_clock;
+
+struct BenchmarkOptions
+{
+    std::string outputPath = "benchmark.json";
+    uint32_t frameCount = 1000;
+    uint32_t recreateCount = 50;
+    uint32_t startupCount = 5;
+    uint32_t uploadMib = 256;
+};
+
+// percentiles use the nearest rank, no interpolation
+struct Summary
+{
+    uint32_t count = 0;
+    double mean = 0.0;
+    double median = 0.0;
+    double p99 = 0.0;
+    double max = 0.0;
+};
+
+static constexpr vk::Extent2D BENCHMARK_EXTENT = {1920, 1080};
+static constexpr uint32_t WARMUP_FRAME_COUNT = 60;
+static constexpr vk::DeviceSize UPLOAD_CHUNK_SIZE = 4ull << 20;  // 4 MiB, well below the staging ring
+static constexpr uint32_t UPLOAD_REPETITIONS = 5;
+
+
+static double millisecondsSince(Clock::time_point start_time)
+{
+    return std::chrono::duration<double, std::milli>(Clock::now() - start_time).count();
+}
+
+
+static Summary summarize(std::vector<double> samples)
+{
+    Summary summary{.count = static_cast<uint32_t>(samples.size())};
+    if (samples.empty()) return summary;
+
+    std::ranges::sort(samples);
+    auto rank = [&samples](double percentile)
+    {
+        size_t index = static_cast<size_t>(std::ceil(percentile * samples.size()));
+        return samples[std::clamp<size_t>(index, 1, samples.size()) - 1];
+    };
+
+    double total = 0.0;
+    for (double sample : samples) total += sample;
+
+    summary.mean = total / samples.size();
+    summary.median = rank(0.5);
+    summary.p99 = rank(0.99);
+    summary.max = samples.back();
+    return summary;
+}
+
+
+static void writeSummary(std::ostream& out, const Summary& summary)
+{
+    out << "{\"count\": " << summary.count << ", \"mean\": " << summary.mean << ", \"median\": " << summary.median
+        << ", \"p99\": " << summary.p99 << ", \"max\": " << summary.max << "}";
+}
+
+
+static BenchmarkOptions parseOptions(int argc, char** argv)
+{
+    BenchmarkOptions options;
+    for (int i = 1; i + 1 < argc; i += 2)
+    {
+        std::string name = argv[i];
+        std::string value = argv[i + 1];
+        if (name == "--output") options.outputPath = value;
+        else if (name == "--frames") options.frameCount = static_cast<uint32_t>(std::stoul(value));
+        else if (name == "--recreates") options.recreateCount = static_cast<uint32_t>(std::stoul(value));
+        else if (name == "--startups") options.startupCount = static_cast<uint32_t>(std::stoul(value));
+        else if (name == "--upload-mib") options.uploadMib = static_cast<uint32_t>(std::stoul(value));
+        else throw std::runtime_error("unknown option " + name);
+    }
+    return options;
+}
+
+
+// context creation plus one pipeline build, with and without the pipeline cache blob on disk.
+// Driver side shader caches are outside our control, cold is only cold as far as we're concerned.
+static void runStartup(const BenchmarkOptions& options, std::ostream& out)
+{
+    TRACE_FUNCTION();
+    std::vector<double> cold_samples;
+    std::vector<double> warm_samples;
+
+    for (uint32_t i = 0; i < options.startupCount; i++)
+    {
+        for (bool is_cold : {true, false})
+        {
+            if (is_cold) std::filesystem::remove(VulkanContext::PIPELINE_CACHE_FILE);
+
+            auto start_time = Clock::now();
+            VulkanContext context = VulkanContext(nullptr);
+            PipelineCompiler pipeline_compiler = PipelineCompiler(context);
+            PipelineStateCache pipeline_state_cache = PipelineStateCache(context, pipeline_compiler);
+            GraphicsPipeline pipeline = GraphicsPipeline(context, pipeline_state_cache, OffscreenTarget::DEFAULT_FORMAT);
+            pipeline_compiler.waitIdle();
+            (is_cold ? cold_samples : warm_samples).push_back(millisecondsSince(start_time));
+        }  // the context saves the cache here, the warm run reads it back
+    }
+
+    out << "  \"startup\": {\"cold_ms\": ";
+    writeSummary(out, summarize(cold_samples));
+    out << ", \"warm_ms\": ";
+    writeSummary(out, summarize(warm_samples));
+    out << "},\n";
+}
+
+
+static void runFrames(const VulkanContext& context, const BenchmarkOptions& options, std::ostream& out)
+{
+    TRACE_FUNCTION();
+    OffscreenTarget target = OffscreenTarget(context, BENCHMARK_EXTENT);
+    PipelineCompiler pipeline_compiler = PipelineCompiler(context);
+    PipelineStateCache pipeline_state_cache = PipelineStateCache(context, pipeline_compiler);
+    GraphicsPipeline pipeline = GraphicsPipeline(context, pipeline_state_cache, target.getFormat());
+    pipeline_compiler.waitIdle();  // every measured frame draws
+    Renderer renderer = Renderer(context);
+
+    for (uint32_t i = 0; i < WARMUP_FRAME_COUNT; i++)
+    {
+        renderer.drawFrame(target, pipeline);
+    }
+
+    std::vector<double> cpu_samples;
+    cpu_samples.reserve(options.frameCount);
+    auto start_time = Clock::now();
+    for (uint32_t i = 0; i < options.frameCount; i++)
+    {
+        auto frame_start_time = Clock::now();
+        renderer.drawFrame(target, pipeline);
+        cpu_samples.push_back(millisecondsSince(frame_start_time));
+    }
+    renderer.getFrameScheduler().waitIdle();
+    double total_ms = millisecondsSince(start_time);
+
+    // the profiler keeps a rolling window, read back one frame late, so only the newest measured frames
+    std::vector<double> gpu_samples = renderer.getGpuProfiler().getPassHistory("frame");
+    size_t measured_count = std::min<size_t>(gpu_samples.size(), options.frameCount);
+    gpu_samples.erase(gpu_samples.begin(), gpu_samples.end() - measured_count);
+
+    out << "  \"frames\": {\"extent\": [" << BENCHMARK_EXTENT.width << ", " << BENCHMARK_EXTENT.height << "]"
+        << ", \"fps\": " << options.frameCount / (total_ms / 1000.0) << ", \"cpu_ms\": ";
+    writeSummary(out, summarize(cpu_samples));
+    out << ", \"gpu_ms\": ";
+    writeSummary(out, summarize(gpu_samples));
+    out << "},\n";
+}
+
+
+static void runUpload(const VulkanContext& context, const BenchmarkOptions& options, std::ostream& out)
+{
+    TRACE_FUNCTION();
+    UploadEngine upload_engine = UploadEngine(context);
+    vk::DeviceSize total_size = static_cast<vk::DeviceSize>(options.uploadMib) << 20;
+
+    std::vector<uint32_t> queue_families = upload_engine.getConcurrentQueueFamilies();
+    vk::BufferCreateInfo buffer_create_info{
+        .size = total_size,
+        .usage = vk::BufferUsageFlagBits::eTransferDst | vk::BufferUsageFlagBits::eStorageBuffer,
+        .sharingMode = queue_families.empty() ? vk::SharingMode::eExclusive : vk::SharingMode::eConcurrent,
+        .queueFamilyIndexCount = static_cast<uint32_t>(queue_families.size()),
+        .pQueueFamilyIndices = queue_families.data()
+    };
+    vk::raii::Buffer buffer = vk::raii::Buffer(context.getLogicalDevice(), buffer_create_info);
+    Allocation allocation = context.getMemoryAllocator().allocateForBuffer(buffer, MemoryUsage::eGpuOnly);
+
+    std::vector<uint8_t> chunk(UPLOAD_CHUNK_SIZE, 0xAB);
+    std::vector<double> samples;
+    for (uint32_t i = 0; i < UPLOAD_REPETITIONS; i++)
+    {
+        auto start_time = Clock::now();
+        for (vk::DeviceSize offset = 0; offset < total_size; offset += UPLOAD_CHUNK_SIZE)
+        {
+            upload_engine.uploadBuffer(*buffer, offset, chunk.data(), std::min(UPLOAD_CHUNK_SIZE, total_size - offset));
+        }
+        upload_engine.wait(upload_engine.flush());
+        samples.push_back(millisecondsSince(start_time));
+    }
+
+    Summary summary = summarize(samples);
+    out << "  \"upload\": {\"mib\": " << options.uploadMib
+        << ", \"mib_per_s\": " << options.uploadMib / (summary.median / 1000.0) << ", \"ms\": ";
+    writeSummary(out, summary);
+    out << "},\n";
+
+    context.getMemoryAllocator().free(allocation);
+}
+
+
+// swap chain recreation while frames are in flight, on a hidden window
+static void runRecreate(const BenchmarkOptions& options, std::ostream& out)
+{
+    TRACE_FUNCTION();
+    if (!glfwInit() || !glfwVulkanSupported())
+    {
+        std::cout << "recreate: skipped, no display\n";
+        out << "  \"recreate\": {\"skipped\": \"no display\"}\n";
+        return;
+    }
+
+    glfwWindowHint(GLFW_CLIENT_API, GLFW_NO_API);
+    glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+    GLFWwindow* window = glfwCreateWindow(800, 600, "Vulkan Benchmark", nullptr, nullptr);
+    if (!window)
+    {
+        glfwTerminate();
+        std::cout << "recreate: skipped, no window\n";
+        out << "  \"recreate\": {\"skipped\": \"no window\"}\n";
+        return;
+    }
+
+    std::vector<double> samples;
+    {
+        VulkanContext context = VulkanContext(window);
+        SwapChain swap_chain = SwapChain(context, window);
+        PipelineCompiler pipeline_compiler = PipelineCompiler(context);
+        PipelineStateCache pipeline_state_cache = PipelineStateCache(context, pipeline_compiler);
+        GraphicsPipeline pipeline = GraphicsPipeline(context, pipeline_state_cache, swap_chain.getFormat());
+        pipeline_compiler.waitIdle();
+        Renderer renderer = Renderer(context);
+
+        for (uint32_t i = 0; i < options.recreateCount; i++)
+        {
+            renderer.drawFrame(swap_chain, pipeline);
+
+            auto start_time = Clock::now();
+            renderer.retireSwapChain(swap_chain.recreate());
+            samples.push_back(millisecondsSince(start_time));
+        }
+        context.getLogicalDevice().waitIdle();
+    }
+
+    glfwDestroyWindow(window);
+    glfwTerminate();
+
+    out << "  \"recreate\": {\"ms\": ";
+    writeSummary(out, summarize(samples));
+    out << "}\n";
+}
+
+
+int main(int argc, char** argv)
+{
+    TRACE_THREAD_NAME("main");
+    BenchmarkOptions options = parseOptions(argc, argv);
+
+    std::ofstream out(options.outputPath, std::ios::trunc);
+    if (!out.is_open())
+    {
+        std::cerr << "benchmark: failed to open " << options.outputPath << " for writing\n";
+        return EXIT_FAILURE;
+    }
+
+    out << "{\n";
+    runStartup(options, out);
+    {
+        VulkanContext context = VulkanContext(nullptr);
+        out << "  \"device\": \"" << context.getPhysicalDevice().getProperties().deviceName << "\",\n";
+        runFrames(context, options, out);
+        runUpload(context, options, out);
+    }
+    runRecreate(options, out);
+    out << "}\n";
+
+    std::cout << "benchmark report written to " << options.outputPath << "\n";
+    if (const char* trace_path = std::getenv("VK_TUTORIAL_TRACE"); Tracer::ENABLED && trace_path)
+    {
+        Tracer::get().writeChromeTrace(trace_path);
+    }
+
+    return out ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,271 @@
+#include "BindlessHeap.h"
+#include <algorithm>
+#include <stdexcept>
+#include <string>
+
+
+BindlessHeap::BindlessHeap(const vk::raii::Device& device, const vk::raii::PhysicalDevice& physical_device)
+    : device_(device)
+{
+    computeCapacities(physical_device);
+    createSetLayout();
+    createPool();
+    allocateSet();
+}
+
+
+void BindlessHeap::computeCapacities(const vk::raii::PhysicalDevice& physical_device)
+{
+    auto properties = physical_device.getProperties2<vk::PhysicalDeviceProperties2, vk::PhysicalDeviceVulkan12Properties>();
+    const auto& vulkan12_properties = properties.get<vk::PhysicalDeviceVulkan12Properties>();
+
+    // a binding is visible to every stage, so the per stage limit applies as well as the per set one
+    slots_[static_cast<size_t>(BindlessType::eSampledImage)].capacity = std::min({
+        MAX_SAMPLED_IMAGES,
+        vulkan12_properties.maxDescriptorSetUpdateAfterBindSampledImages,
+        vulkan12_properties.maxPerStageDescriptorUpdateAfterBindSampledImages
+    });
+    slots_[static_cast<size_t>(BindlessType::eSampler)].capacity = std::min({
+        MAX_SAMPLERS,
+        vulkan12_properties.maxDescriptorSetUpdateAfterBindSamplers,
+        vulkan12_properties.maxPerStageDescriptorUpdateAfterBindSamplers
+    });
+    slots_[static_cast<size_t>(BindlessType::eStorageBuffer)].capacity = std::min({
+        MAX_STORAGE_BUFFERS,
+        vulkan12_properties.maxDescriptorSetUpdateAfterBindStorageBuffers,
+        vulkan12_properties.maxPerStageDescriptorUpdateAfterBindStorageBuffers
+    });
+
+    // all bindings together must also fit the per stage resource limit, shrinking the big ones evenly
+    uint32_t total_capacity = 0;
+    for (const auto& slots : slots_) total_capacity += slots.capacity;
+    if (total_capacity > vulkan12_properties.maxPerStageUpdateAfterBindResources)
+    {
+        double scale = static_cast<double>(vulkan12_properties.maxPerStageUpdateAfterBindResources) / total_capacity;
+        for (auto& slots : slots_)
+        {
+            slots.capacity = std::max(1u, static_cast<uint32_t>(slots.capacity * scale));
+        }
+    }
+}
+
+
+void BindlessHeap::createSetLayout()
+{
+    constexpr vk::DescriptorType DESCRIPTOR_TYPES[BINDLESS_TYPE_COUNT] = {
+        vk::DescriptorType::eSampledImage,
+        vk::DescriptorType::eSampler,
+        vk::DescriptorType::eStorageBuffer
+    };
+
+    std::array<vk::DescriptorSetLayoutBinding, BINDLESS_TYPE_COUNT> bindings;
+    std::array<vk::DescriptorBindingFlags, BINDLESS_TYPE_COUNT> binding_flags;
+    for (uint32_t i = 0; i < BINDLESS_TYPE_COUNT; i++)
+    {
+        bindings[i] = vk::DescriptorSetLayoutBinding{
+            .binding = i,
+            .descriptorType = DESCRIPTOR_TYPES[i],
+            .descriptorCount = slots_[i].capacity,
+            .stageFlags = vk::ShaderStageFlagBits::eAll
+        };
+
+        // slots that no in flight draw uses may be written while the set is bound, unwritten ones are never read
+        binding_flags[i] = vk::DescriptorBindingFlagBits::ePartiallyBound |
+                           vk::DescriptorBindingFlagBits::eUpdateAfterBind |
+                           vk::DescriptorBindingFlagBits::eUpdateUnusedWhilePending;
+    }
+
+    vk::DescriptorSetLayoutBindingFlagsCreateInfo binding_flags_create_info{
+        .bindingCount = static_cast<uint32_t>(binding_flags.size()),
+        .pBindingFlags = binding_flags.data()
+    };
+
+    vk::DescriptorSetLayoutCreateInfo set_layout_create_info{
+        .pNext = &binding_flags_create_info,
+        .flags = vk::DescriptorSetLayoutCreateFlagBits::eUpdateAfterBindPool,
+        .bindingCount = static_cast<uint32_t>(bindings.size()),
+        .pBindings = bindings.data()
+    };
+
+    setLayout_ = vk::raii::DescriptorSetLayout(device_, set_layout_create_info);
+}
+
+
+void BindlessHeap::createPool()
+{
+    std::array<vk::DescriptorPoolSize, BINDLESS_TYPE_COUNT> pool_sizes = {
+        vk::DescriptorPoolSize{.type = vk::DescriptorType::eSampledImage, .descriptorCount = slots_[0].capacity},
+        vk::DescriptorPoolSize{.type = vk::DescriptorType::eSampler, .descriptorCount = slots_[1].capacity},
+        vk::DescriptorPoolSize{.type = vk::DescriptorType::eStorageBuffer, .descriptorCount = slots_[2].capacity}
+    };
+
+    // free descriptor set because the raii set frees itself on destruction
+    vk::DescriptorPoolCreateInfo pool_create_info{
+        .flags = vk::DescriptorPoolCreateFlagBits::eUpdateAfterBind | vk::DescriptorPoolCreateFlagBits::eFreeDescriptorSet,
+        .maxSets = 1,
+        .poolSizeCount = static_cast<uint32_t>(pool_sizes.size()),
+        .pPoolSizes = pool_sizes.data()
+    };
+
+    pool_ = vk::raii::DescriptorPool(device_, pool_create_info);
+}
+
+
+void BindlessHeap::allocateSet()
+{
+    vk::DescriptorSetAllocateInfo set_allocate_info{
+        .descriptorPool = *pool_,
+        .descriptorSetCount = 1,
+        .pSetLayouts = &*setLayout_
+    };
+
+    set_ = std::move(device_.allocateDescriptorSets(set_allocate_info).front());
+}
+
+
+uint32_t BindlessHeap::allocateHandle(BindlessType type)
+{
+    Slots& slots = slots_[static_cast<size_t>(type)];
+
+    if (!slots.freeHandles.empty())
+    {
+        uint32_t handle = slots.freeHandles.back();
+        slots.freeHandles.pop_back();
+        return handle;
+    }
+
+    if (slots.highWater == slots.capacity)
+    {
+        throw std::runtime_error("bindless heap binding " + std::to_string(static_cast<uint32_t>(type)) +
+                                 " is full (" + std::to_string(slots.capacity) + " descriptors)");
+    }
+
+    return slots.highWater++;
+}
+
+
+uint32_t BindlessHeap::registerSampledImage(vk::ImageView image_view, vk::ImageLayout image_layout)
+{
+    std::lock_guard lock(mutex_);
+    uint32_t handle = allocateHandle(BindlessType::eSampledImage);
+
+    vk::DescriptorImageInfo image_info{
+        .imageView = image_view,
+        .imageLayout = image_layout
+    };
+
+    vk::WriteDescriptorSet descriptor_write{
+        .dstSet = *set_,
+        .dstBinding = static_cast<uint32_t>(BindlessType::eSampledImage),
+        .dstArrayElement = handle,
+        .descriptorCount = 1,
+        .descriptorType = vk::DescriptorType::eSampledImage,
+        .pImageInfo = &image_info
+    };
+    device_.updateDescriptorSets(descriptor_write, nullptr);
+
+    return handle;
+}
+
+
+uint32_t BindlessHeap::registerSampler(vk::Sampler sampler)
+{
+    std::lock_guard lock(mutex_);
+    uint32_t handle = allocateHandle(BindlessType::eSampler);
+
+    vk::DescriptorImageInfo image_info{
+        .sampler = sampler
+    };
+
+    vk::WriteDescriptorSet descriptor_write{
+        .dstSet = *set_,
+        .dstBinding = static_cast<uint32_t>(BindlessType::eSampler),
+        .dstArrayElement = handle,
+        .descriptorCount = 1,
+        .descriptorType = vk::DescriptorType::eSampler,
+        .pImageInfo = &image_info
+    };
+    device_.updateDescriptorSets(descriptor_write, nullptr);
+
+    return handle;
+}
+
+
+uint32_t BindlessHeap::registerStorageBuffer(vk::Buffer buffer, vk::DeviceSize offset, vk::DeviceSize range)
+{
+    std::lock_guard lock(mutex_);
+    uint32_t handle = allocateHandle(BindlessType::eStorageBuffer);
+
+    vk::DescriptorBufferInfo buffer_info{
+        .buffer = buffer,
+        .offset = offset,
+        .range = range
+    };
+
+    vk::WriteDescriptorSet descriptor_write{
+        .dstSet = *set_,
+        .dstBinding = static_cast<uint32_t>(BindlessType::eStorageBuffer),
+        .dstArrayElement = handle,
+        .descriptorCount = 1,
+        .descriptorType = vk::DescriptorType::eStorageBuffer,
+        .pBufferInfo = &buffer_info
+    };
+    device_.updateDescriptorSets(descriptor_write, nullptr);
+
+    return handle;
+}
+
+
+void BindlessHeap::release(BindlessType type, uint32_t handle, uint64_t timeline_value)
+{
+    if (handle == INVALID_HANDLE) return;
+
+    std::lock_guard lock(mutex_);
+    slots_[static_cast<size_t>(type)].pendingReleases.push_back({.handle = handle, .timelineValue = timeline_value});
+}
+
+
+void BindlessHeap::collect(uint64_t completed_value)
+{
+    std::lock_guard lock(mutex_);
+    for (auto& slots : slots_)
+    {
+        // owners release with the value of their own last use, a later release can complete first
+        std::erase_if(slots.pendingReleases, [&](const PendingRelease& pending)
+        {
+            if (pending.timelineValue > completed_value) return false;
+
+            slots.freeHandles.push_back(pending.handle);
+            return true;
+        });
+    }
+}
+
+
+void BindlessHeap::bind(vk::CommandBuffer command_buffer, vk::PipelineBindPoint bind_point, vk::PipelineLayout layout) const
+{
+    command_buffer.bindDescriptorSets(bind_point, layout, SET_INDEX, *set_, nullptr);
+}
+
+
+// Accessor functions
+const vk::raii::DescriptorSetLayout& BindlessHeap::getSetLayout() const
+{
+    return setLayout_;
+}
+
+
+vk::PushConstantRange BindlessHeap::getPushConstantRange() const
+{
+    return vk::PushConstantRange{
+        .stageFlags = vk::ShaderStageFlagBits::eAll,
+        .offset = 0,
+        .size = PUSH_CONSTANT_SIZE
+    };
+}
+
+
+uint32_t BindlessHeap::getCapacity(BindlessType type) const
+{
+    return slots_[static_cast<size_t>(type)].capacity;
+}
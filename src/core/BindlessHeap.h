@@ -0,0 +1,92 @@
+#pragma once
+
+#include <vulkan/vulkan_raii.hpp>
+#include <array>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+// Descriptor types the heap holds, the value is the binding in the heap's set
+enum class BindlessType
+{
+    eSampledImage,
+    eSampler,
+    eStorageBuffer
+};
+
+
+// One global update-after-bind descriptor set holding every sampled image, sampler and storage buffer.
+// It's bound once per command buffer and shaders index it with handles passed in push constants
+// (see shaders/bindless.slang), so materials never need their own descriptor sets.
+// Released handles stay reserved until the graphics timeline value of the last submit that used them
+// completed, then they're reused.
+// Thread safe.
+class BindlessHeap
+{
+public:
+    BindlessHeap(const vk::raii::Device& device, const vk::raii::PhysicalDevice& physical_device);
+
+    // deleting copy and move semantics, the VulkanContext owns the only instance
+    BindlessHeap(const BindlessHeap&) = delete;
+    BindlessHeap& operator=(const BindlessHeap&) = delete;
+    BindlessHeap(BindlessHeap&&) = delete;
+    BindlessHeap& operator=(BindlessHeap&&) = delete;
+
+    // write the descriptor and return the handle shaders index with, throws when the binding is full
+    uint32_t registerSampledImage(vk::ImageView image_view, vk::ImageLayout image_layout = vk::ImageLayout::eShaderReadOnlyOptimal);
+    uint32_t registerSampler(vk::Sampler sampler);
+    uint32_t registerStorageBuffer(vk::Buffer buffer, vk::DeviceSize offset = 0, vk::DeviceSize range = vk::WholeSize);
+
+    // the handle becomes reusable once collect() sees timeline_value completed. timeline_value is the
+    // graphics timeline value (Renderer::getFrameScheduler()) of the last submit that used the handle
+    void release(BindlessType type, uint32_t handle, uint64_t timeline_value);
+    void collect(uint64_t completed_value);
+
+    void bind(vk::CommandBuffer command_buffer, vk::PipelineBindPoint bind_point, vk::PipelineLayout layout) const;
+
+    // accessor functions
+    auto getSetLayout() const -> const vk::raii::DescriptorSetLayout&;
+    auto getPushConstantRange() const -> vk::PushConstantRange;  // every pipeline using the heap shares this range
+    uint32_t getCapacity(BindlessType type) const;
+
+    static constexpr uint32_t SET_INDEX = 0;
+    static constexpr uint32_t PUSH_CONSTANT_SIZE = 128;  // the guaranteed minimum, enough for a handful of handles and a matrix
+    static constexpr uint32_t INVALID_HANDLE = UINT32_MAX;
+
+    // upper bounds, clamped to the device's update-after-bind limits
+    static constexpr uint32_t MAX_SAMPLED_IMAGES = 16384;
+    static constexpr uint32_t MAX_SAMPLERS = 256;
+    static constexpr uint32_t MAX_STORAGE_BUFFERS = 16384;
+
+private:
+    struct PendingRelease
+    {
+        uint32_t handle = 0;
+        uint64_t timelineValue = 0;
+    };
+
+    struct Slots
+    {
+        uint32_t capacity = 0;
+        uint32_t highWater = 0;               // handles below this were handed out at least once
+        std::vector<uint32_t> freeHandles;
+        std::vector<PendingRelease> pendingReleases;  // in release order, their values aren't sorted
+    };
+
+    void computeCapacities(const vk::raii::PhysicalDevice& physical_device);
+    void createSetLayout();
+    void createPool();
+    void allocateSet();
+    auto allocateHandle(BindlessType type) -> uint32_t;  // expects mutex_ to be held
+
+    static constexpr size_t BINDLESS_TYPE_COUNT = 3;
+
+    const vk::raii::Device& device_;
+
+    vk::raii::DescriptorSetLayout setLayout_ = nullptr;
+    vk::raii::DescriptorPool pool_ = nullptr;
+    vk::raii::DescriptorSet set_ = nullptr;
+
+    mutable std::mutex mutex_;
+    std::array<Slots, BINDLESS_TYPE_COUNT> slots_;
+};
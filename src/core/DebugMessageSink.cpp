@@ -0,0 +1,324 @@
+#include "DebugMessageSink.h"
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <sstream>
+
+
+namespace
+{
+    // copies a C string into a fixed buffer, always terminated
+    template <size_t N>
+    void copyTruncated(std::array<char, N>& destination, const char* source)
+    {
+        if (!source)
+        {
+            destination[0] = '\0';
+            return;
+        }
+        size_t length = std::min(std::strlen(source), N - 1);
+        std::memcpy(destination.data(), source, length);
+        destination[length] = '\0';
+    }
+
+    const char* getSeverityName(vk::DebugUtilsMessageSeverityFlagBitsEXT severity)
+    {
+        switch (severity)
+        {
+            case vk::DebugUtilsMessageSeverityFlagBitsEXT::eError: return "error";
+            case vk::DebugUtilsMessageSeverityFlagBitsEXT::eWarning: return "warning";
+            case vk::DebugUtilsMessageSeverityFlagBitsEXT::eInfo: return "info";
+            case vk::DebugUtilsMessageSeverityFlagBitsEXT::eVerbose:
+            default: return "verbose";
+        }
+    }
+}
+
+
+std::string ValidationSettings::toString() const
+{
+    if (!isEnabled) return "off";
+
+    std::string result = "on";
+    if (isGpuAssisted) result += ", gpu assisted";
+    if (isSynchronization) result += ", synchronization";
+    if (isBestPractices) result += ", best practices";
+    return result;
+}
+
+
+ValidationSettings getValidationSettingsFromEnvironment()
+{
+    ValidationSettings settings{};
+#ifndef NDEBUG
+    settings.isEnabled = true;
+#endif
+
+    const char* env_value = std::getenv(VALIDATION_ENV);
+    if (env_value == nullptr || *env_value == '\0') return settings;
+
+    settings = ValidationSettings{};
+    std::stringstream options(env_value);
+    std::string option;
+    while (std::getline(options, option, ','))
+    {
+        if (option == "on") settings.isEnabled = true;
+        else if (option == "gpu") settings.isEnabled = settings.isGpuAssisted = true;
+        else if (option == "sync") settings.isEnabled = settings.isSynchronization = true;
+        else if (option == "best") settings.isEnabled = settings.isBestPractices = true;
+        else if (option != "off")
+        {
+            std::cerr << "unknown " << VALIDATION_ENV << " option '" << option << "', expected off, on, gpu, sync or best\n";
+        }
+    }
+
+    return settings;
+}
+
+
+DebugMessageSink::DebugMessageSink()
+    : slots_(std::make_unique<std::array<Slot, QUEUE_CAPACITY>>()),
+      idCounters_(std::make_unique<std::array<IdCounter, ID_COUNTER_CAPACITY>>())
+{
+    // a slot is free for the push at position p when its sequence is p
+    for (size_t i = 0; i < QUEUE_CAPACITY; i++)
+    {
+        (*slots_)[i].sequence.store(i, std::memory_order_relaxed);
+    }
+
+    writer_ = std::jthread([this]() { writerLoop(); });
+}
+
+
+DebugMessageSink::~DebugMessageSink()
+{
+    isStopping_.store(true, std::memory_order_release);
+    wakeCount_.fetch_add(1, std::memory_order_release);
+    wakeCount_.notify_one();
+    writer_.join();  // drains what's left first
+
+    printSummary();
+}
+
+
+void DebugMessageSink::push(
+    vk::DebugUtilsMessageSeverityFlagBitsEXT message_severity,
+    vk::DebugUtilsMessageTypeFlagsEXT message_type,
+    const vk::DebugUtilsMessengerCallbackDataEXT& callback_data
+)
+{
+    messageCount_.fetch_add(1, std::memory_order_relaxed);
+    if (message_severity == vk::DebugUtilsMessageSeverityFlagBitsEXT::eError)
+    {
+        errorCount_.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    // repeats of an id are only counted, a burst of the same warning costs an atomic add each
+    uint64_t occurrence = countMessage(callback_data.messageIdNumber);
+    if (occurrence > MAX_REPORTS_PER_ID) return;
+
+    Message message{
+        .severity = message_severity,
+        .type = message_type,
+        .messageId = callback_data.messageIdNumber,
+        .occurrence = static_cast<uint32_t>(occurrence)
+    };
+    copyTruncated(message.name, callback_data.pMessageIdName);
+    copyTruncated(message.text, callback_data.pMessage);
+
+    if (!tryPush(message))
+    {
+        droppedCount_.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+
+    queuedCount_.fetch_add(1, std::memory_order_release);
+    wakeCount_.fetch_add(1, std::memory_order_release);
+    wakeCount_.notify_one();
+}
+
+
+void DebugMessageSink::flush()
+{
+    uint64_t queued_count = queuedCount_.load(std::memory_order_acquire);
+    uint64_t written_count = writtenCount_.load(std::memory_order_acquire);
+    while (written_count < queued_count)
+    {
+        writtenCount_.wait(written_count, std::memory_order_acquire);
+        written_count = writtenCount_.load(std::memory_order_acquire);
+    }
+}
+
+
+uint64_t DebugMessageSink::countMessage(int32_t message_id)
+{
+    // linear probing from the id's hash, claiming the first empty entry with a compare exchange
+    size_t index = (static_cast<uint32_t>(message_id) * 2654435761u) & (ID_COUNTER_CAPACITY - 1);
+    for (size_t probe = 0; probe < ID_COUNTER_CAPACITY; probe++)
+    {
+        IdCounter& counter = (*idCounters_)[(index + probe) & (ID_COUNTER_CAPACITY - 1)];
+        int64_t stored_id = counter.messageId.load(std::memory_order_acquire);
+        if (stored_id == EMPTY_ID)
+        {
+            int64_t expected = EMPTY_ID;
+            if (counter.messageId.compare_exchange_strong(expected, message_id, std::memory_order_acq_rel))
+            {
+                stored_id = message_id;
+            }
+            else
+            {
+                stored_id = expected;  // someone else claimed it, maybe for the same id
+            }
+        }
+        if (stored_id == message_id)
+        {
+            return counter.count.fetch_add(1, std::memory_order_relaxed) + 1;
+        }
+    }
+
+    // table full, these are reported without a limit rather than lost
+    overflowCount_.fetch_add(1, std::memory_order_relaxed);
+    return 1;
+}
+
+
+bool DebugMessageSink::tryPush(const Message& message)
+{
+    uint64_t position = enqueuePosition_.load(std::memory_order_relaxed);
+    while (true)
+    {
+        Slot& slot = (*slots_)[position & (QUEUE_CAPACITY - 1)];
+        uint64_t sequence = slot.sequence.load(std::memory_order_acquire);
+        int64_t difference = static_cast<int64_t>(sequence) - static_cast<int64_t>(position);
+
+        if (difference == 0)
+        {
+            // the slot is free for this position, claim the position
+            if (enqueuePosition_.compare_exchange_weak(position, position + 1, std::memory_order_relaxed))
+            {
+                slot.message = message;
+                slot.sequence.store(position + 1, std::memory_order_release);
+                return true;
+            }
+        }
+        else if (difference < 0)
+        {
+            return false;  // the writer hasn't freed the slot a full lap ago, the queue is full
+        }
+        else
+        {
+            position = enqueuePosition_.load(std::memory_order_relaxed);  // another producer took it
+        }
+    }
+}
+
+
+bool DebugMessageSink::tryPop(Message& message)
+{
+    Slot& slot = (*slots_)[dequeuePosition_ & (QUEUE_CAPACITY - 1)];
+    if (slot.sequence.load(std::memory_order_acquire) != dequeuePosition_ + 1) return false;
+
+    message = slot.message;
+    slot.sequence.store(dequeuePosition_ + QUEUE_CAPACITY, std::memory_order_release);  // free for the next lap
+    dequeuePosition_++;
+    return true;
+}
+
+
+void DebugMessageSink::writerLoop()
+{
+    Message message;
+    while (true)
+    {
+        uint64_t wake_count = wakeCount_.load(std::memory_order_acquire);
+        while (tryPop(message))
+        {
+            write(message);
+            writtenCount_.fetch_add(1, std::memory_order_release);
+            writtenCount_.notify_all();
+        }
+
+        // the messenger is gone by then, nothing is pushed after the stop
+        if (isStopping_.load(std::memory_order_acquire)) return;
+        wakeCount_.wait(wake_count, std::memory_order_acquire);
+    }
+}
+
+
+void DebugMessageSink::write(const Message& message)
+{
+    {
+        std::lock_guard lock(namesMutex_);
+        names_.try_emplace(message.messageId, message.name.data());
+    }
+
+    std::cerr << "validation " << getSeverityName(message.severity) << ": " << vk::to_string(message.type)
+              << " " << message.name.data() << " (0x" << std::hex << static_cast<uint32_t>(message.messageId) << std::dec << ")\n"
+              << "    " << message.text.data() << "\n";
+    if (message.occurrence == MAX_REPORTS_PER_ID)
+    {
+        std::cerr << "    (reported " << MAX_REPORTS_PER_ID << " times, further messages with this id are only counted)\n";
+    }
+}
+
+
+void DebugMessageSink::printSummary() const
+{
+    uint64_t message_count = getMessageCount();
+    if (message_count == 0) return;
+
+    std::cerr << "validation summary: " << message_count << " messages, " << getErrorCount() << " errors";
+    if (uint64_t dropped_count = getDroppedCount()) std::cerr << ", " << dropped_count << " dropped";
+    std::cerr << "\n";
+
+    for (const MessageCount& message_count_entry : getMessageCounts())
+    {
+        if (message_count_entry.count <= MAX_REPORTS_PER_ID) continue;
+        std::cerr << "    " << message_count_entry.count << "x " << message_count_entry.name
+                  << " (0x" << std::hex << static_cast<uint32_t>(message_count_entry.messageId) << std::dec << ")\n";
+    }
+}
+
+
+// Accessor functions
+std::vector<DebugMessageSink::MessageCount> DebugMessageSink::getMessageCounts() const
+{
+    std::vector<MessageCount> message_counts;
+    {
+        std::lock_guard lock(namesMutex_);
+        for (const IdCounter& counter : *idCounters_)
+        {
+            int64_t message_id = counter.messageId.load(std::memory_order_acquire);
+            if (message_id == EMPTY_ID) continue;
+
+            auto name = names_.find(static_cast<int32_t>(message_id));
+            message_counts.push_back(MessageCount{
+                .messageId = static_cast<int32_t>(message_id),
+                .name = name != names_.end() ? name->second : std::string(),
+                .count = counter.count.load(std::memory_order_relaxed)
+            });
+        }
+    }
+
+    std::ranges::sort(message_counts, [](const MessageCount& a, const MessageCount& b) { return a.count > b.count; });
+    return message_counts;
+}
+
+
+uint64_t DebugMessageSink::getMessageCount() const
+{
+    return messageCount_.load(std::memory_order_relaxed);
+}
+
+
+uint64_t DebugMessageSink::getDroppedCount() const
+{
+    return droppedCount_.load(std::memory_order_relaxed);
+}
+
+
+uint64_t DebugMessageSink::getErrorCount() const
+{
+    return errorCount_.load(std::memory_order_relaxed);
+}
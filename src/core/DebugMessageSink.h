@@ -0,0 +1,128 @@
+#pragma once
+
+#include <vulkan/vulkan_raii.hpp>
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+// Which validation the context runs with, picked at startup instead of at compile time. The layer is
+// configured through VK_EXT_layer_settings, so no vk_layer_settings.txt or vkconfig is needed.
+struct ValidationSettings
+{
+    bool isEnabled = false;          // VK_LAYER_KHRONOS_validation and the debug messenger
+    bool isGpuAssisted = false;      // GPU-AV: instruments shaders, catches out of bounds descriptor and buffer accesses
+    bool isSynchronization = false;  // synchronization validation, hazards between commands and queues
+    bool isBestPractices = false;    // performance warnings, mostly vendor specific
+
+    auto toString() const -> std::string;
+};
+
+
+// Reads VALIDATION_ENV: a comma separated list of "off", "on", "gpu", "sync" and "best" ("gpu", "sync"
+// and "best" imply "on"). Falls back to validation in debug builds and none in release builds.
+inline constexpr const char* VALIDATION_ENV = "VK_TUTORIAL_VALIDATION";
+auto getValidationSettingsFromEnvironment() -> ValidationSettings;
+
+
+// Receives the debug messenger callbacks. The callback runs on whichever thread the driver or layer
+// reports from, often in the middle of a submit, so it never blocks and never touches an iostream:
+// messages are counted per messageIdNumber, the first MAX_REPORTS_PER_ID of each id are copied into
+// a fixed size lock free queue, and a background thread drains it to std::cerr. Everything past the
+// limit is only counted and shows up in the summary printed on destruction.
+// Thread safe.
+class DebugMessageSink
+{
+public:
+    DebugMessageSink();
+    ~DebugMessageSink();  // drains the queue and prints the summary, the messenger must be destroyed first
+
+    // deleting copy constructors
+    DebugMessageSink(const DebugMessageSink&) = delete;
+    DebugMessageSink& operator=(const DebugMessageSink&) = delete;
+
+    // never blocks, never allocates
+    void push(
+        vk::DebugUtilsMessageSeverityFlagBitsEXT message_severity,
+        vk::DebugUtilsMessageTypeFlagsEXT message_type,
+        const vk::DebugUtilsMessengerCallbackDataEXT& callback_data
+    );
+
+    void flush();  // blocks until everything pushed so far is printed
+
+    struct MessageCount
+    {
+        int32_t messageId = 0;
+        std::string name;  // empty when the message was never printed
+        uint64_t count = 0;
+    };
+
+    // accessor functions
+    auto getMessageCounts() const -> std::vector<MessageCount>;  // most frequent first
+    uint64_t getMessageCount() const;   // everything pushed
+    uint64_t getDroppedCount() const;   // under the limit, but the queue was full
+    uint64_t getErrorCount() const;
+
+    static constexpr uint32_t MAX_REPORTS_PER_ID = 5;
+
+private:
+    struct Message
+    {
+        vk::DebugUtilsMessageSeverityFlagBitsEXT severity = vk::DebugUtilsMessageSeverityFlagBitsEXT::eVerbose;
+        vk::DebugUtilsMessageTypeFlagsEXT type;
+        int32_t messageId = 0;
+        uint32_t occurrence = 0;  // 1 for the first message of its id
+        std::array<char, 64> name = {};
+        std::array<char, 2048> text = {};  // truncated, the long ones are object lists
+    };
+
+    // bounded multi producer queue over a ring of sequence numbered slots (Vyukov), the writer thread is
+    // the only consumer
+    struct Slot
+    {
+        std::atomic<uint64_t> sequence = 0;
+        Message message;
+    };
+
+    // open addressing, an id claims its entry once and is never removed
+    struct IdCounter
+    {
+        std::atomic<int64_t> messageId = EMPTY_ID;
+        std::atomic<uint64_t> count = 0;
+    };
+
+    auto countMessage(int32_t message_id) -> uint64_t;  // returns the count including this one
+    bool tryPush(const Message& message);
+    bool tryPop(Message& message);
+    void writerLoop();
+    void write(const Message& message);
+    void printSummary() const;
+
+    static constexpr size_t QUEUE_CAPACITY = 256;       // power of two
+    static constexpr size_t ID_COUNTER_CAPACITY = 1024;  // power of two, more distinct ids land in overflowCount_
+    static constexpr int64_t EMPTY_ID = INT64_MIN;
+
+    std::unique_ptr<std::array<Slot, QUEUE_CAPACITY>> slots_;
+    std::unique_ptr<std::array<IdCounter, ID_COUNTER_CAPACITY>> idCounters_;
+    std::atomic<uint64_t> enqueuePosition_ = 0;
+    uint64_t dequeuePosition_ = 0;  // writer thread only
+
+    std::atomic<uint64_t> wakeCount_ = 0;     // the writer waits on it, bumped by pushes and the destructor
+    std::atomic<uint64_t> queuedCount_ = 0;
+    std::atomic<uint64_t> writtenCount_ = 0;  // flush() waits on it
+    std::atomic<uint64_t> messageCount_ = 0;
+    std::atomic<uint64_t> droppedCount_ = 0;
+    std::atomic<uint64_t> errorCount_ = 0;
+    std::atomic<uint64_t> overflowCount_ = 0;
+    std::atomic<bool> isStopping_ = false;
+
+    mutable std::mutex namesMutex_;  // never taken by push()
+    std::unordered_map<int32_t, std::string> names_;
+
+    std::jthread writer_;  // declared last so it stops before the queue is destroyed
+};
@@ -0,0 +1,144 @@
+#include "DeviceSelectionCache.h"
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+
+
+namespace
+{
+    constexpr const char* FILE_MAGIC = "vk_tutorial_device_cache";
+
+    const char* getModeName(bool is_headless)
+    {
+        return is_headless ? "headless" : "windowed";
+    }
+
+    // "-" stands for a family the device doesn't have
+    std::string formatFamily(const std::optional<uint32_t>& family_index)
+    {
+        return family_index ? std::to_string(*family_index) : "-";
+    }
+
+    std::optional<uint32_t> parseFamily(const std::string& text)
+    {
+        if (text == "-") return std::nullopt;
+        return static_cast<uint32_t>(std::stoul(text));
+    }
+
+    // 64 bit FNV-1a over the value's bytes
+    template <typename T>
+    void hashBytes(uint64_t& hash, const T& value)
+    {
+        const auto* bytes = reinterpret_cast<const uint8_t*>(&value);
+        for (size_t i = 0; i < sizeof(T); i++)
+        {
+            hash ^= bytes[i];
+            hash *= 1099511628211ull;
+        }
+    }
+}
+
+
+DeviceSelectionCache::DeviceSelectionCache(std::filesystem::path file_path): filePath_(std::move(file_path))
+{
+}
+
+
+std::optional<DeviceSelection> DeviceSelectionCache::load(uint64_t device_fingerprint, bool is_headless) const
+{
+    for (const Entry& entry : readEntries())
+    {
+        if (entry.mode == getModeName(is_headless) && entry.deviceFingerprint == device_fingerprint)
+        {
+            return entry.selection;
+        }
+    }
+    return std::nullopt;
+}
+
+
+void DeviceSelectionCache::save(uint64_t device_fingerprint, bool is_headless, const DeviceSelection& selection) const
+{
+    std::vector<Entry> entries = readEntries();
+    std::erase_if(entries, [is_headless](const Entry& entry) { return entry.mode == getModeName(is_headless); });
+    entries.push_back(Entry{.mode = getModeName(is_headless), .deviceFingerprint = device_fingerprint, .selection = selection});
+
+    // same temporary file and rename as the pipeline cache, a crash mid write leaves the old file
+    std::filesystem::path temporary_path = filePath_;
+    temporary_path += ".tmp";
+
+    {
+        std::ofstream file(temporary_path, std::ios::trunc);
+        if (!file.is_open())
+        {
+            throw std::runtime_error("failed to open " + temporary_path.string() + " for writing");
+        }
+
+        file << FILE_MAGIC << " " << FORMAT_VERSION << "\n";
+        for (const Entry& entry : entries)
+        {
+            file << entry.mode << " " << std::hex << entry.deviceFingerprint << std::dec << " " << entry.selection.deviceUuid
+                 << " " << entry.selection.queueFamilyIndex
+                 << " " << formatFamily(entry.selection.transferQueueFamilyIndex)
+                 << " " << formatFamily(entry.selection.computeQueueFamilyIndex) << "\n";
+        }
+        if (!file)
+        {
+            throw std::runtime_error("failed to write " + temporary_path.string());
+        }
+    }  // closing the file before renaming it
+
+    std::filesystem::rename(temporary_path, filePath_);
+}
+
+
+uint64_t DeviceSelectionCache::computeFingerprint(const std::vector<vk::raii::PhysicalDevice>& physical_devices)
+{
+    uint64_t hash = 14695981039346656037ull;
+    hashBytes(hash, FORMAT_VERSION);
+    for (const vk::raii::PhysicalDevice& physical_device : physical_devices)
+    {
+        auto properties = physical_device.getProperties2<vk::PhysicalDeviceProperties2, vk::PhysicalDeviceIDProperties>();
+        const vk::PhysicalDeviceProperties& device_properties = properties.get<vk::PhysicalDeviceProperties2>().properties;
+        hashBytes(hash, properties.get<vk::PhysicalDeviceIDProperties>().deviceUUID);
+        hashBytes(hash, device_properties.driverVersion);
+        hashBytes(hash, device_properties.apiVersion);
+    }
+    return hash;
+}
+
+
+std::vector<DeviceSelectionCache::Entry> DeviceSelectionCache::readEntries() const
+{
+    std::ifstream file(filePath_);
+    if (!file.is_open()) return {};  // first run, nothing cached yet
+
+    std::string magic;
+    uint32_t format_version = 0;
+    if (!(file >> magic >> format_version) || magic != FILE_MAGIC || format_version != FORMAT_VERSION) return {};
+
+    std::vector<Entry> entries;
+    std::string line;
+    while (std::getline(file, line))
+    {
+        std::istringstream fields(line);
+        Entry entry;
+        std::string transfer_family;
+        std::string compute_family;
+        fields >> entry.mode >> std::hex >> entry.deviceFingerprint >> std::dec >> entry.selection.deviceUuid
+               >> entry.selection.queueFamilyIndex >> transfer_family >> compute_family;
+        if (!fields) continue;  // the empty rest of the header line, or a damaged entry
+
+        try
+        {
+            entry.selection.transferQueueFamilyIndex = parseFamily(transfer_family);
+            entry.selection.computeQueueFamilyIndex = parseFamily(compute_family);
+        }
+        catch (const std::exception&)
+        {
+            continue;
+        }
+        entries.push_back(std::move(entry));
+    }
+    return entries;
+}
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <vulkan/vulkan_raii.hpp>
+#include <cstdint>
+#include <filesystem>
+#include <optional>
+#include <string>
+#include <vector>
+
+// What pickPhysicalDevice() settled on, enough to open the device without ranking again
+struct DeviceSelection
+{
+    std::string deviceUuid;  // as formatted by VulkanContext, lowercase hex without dashes
+    uint32_t queueFamilyIndex = 0;
+    std::optional<uint32_t> transferQueueFamilyIndex;
+    std::optional<uint32_t> computeQueueFamilyIndex;
+};
+
+
+// Remembers the last device selection between runs, one entry for windowed and one for headless
+// contexts (they may pick different queue families). An entry is keyed by a fingerprint of every
+// physical device's UUID, driver version and API version, so a driver update, a new GPU or a removed
+// one ranks the devices again. A missing or unreadable file is the same as an empty one.
+// Not thread safe.
+class DeviceSelectionCache
+{
+public:
+    explicit DeviceSelectionCache(std::filesystem::path file_path);
+
+    auto load(uint64_t device_fingerprint, bool is_headless) const -> std::optional<DeviceSelection>;
+
+    // keeps the entry of the other mode, throws std::runtime_error when the file can't be written
+    void save(uint64_t device_fingerprint, bool is_headless, const DeviceSelection& selection) const;
+
+    // computed from the enumerated devices, the properties query is far cheaper than ranking them
+    static uint64_t computeFingerprint(const std::vector<vk::raii::PhysicalDevice>& physical_devices);
+
+private:
+    struct Entry
+    {
+        std::string mode;  // "windowed" or "headless"
+        uint64_t deviceFingerprint = 0;
+        DeviceSelection selection;
+    };
+
+    auto readEntries() const -> std::vector<Entry>;
+
+    // bumped whenever isDeviceSuitable() or the ranking changes, older files are ignored
+    static constexpr uint32_t FORMAT_VERSION = 1;
+
+    std::filesystem::path filePath_;
+};
@@ -0,0 +1,641 @@
+#include "MemoryAllocator.h"
+#include <algorithm>
+#include <bit>
+#include <cassert>
+#include <iostream>
+#include <optional>
+#include <stdexcept>
+#include <string>
+
+
+namespace
+{
+    vk::DeviceSize alignUp(vk::DeviceSize value, vk::DeviceSize alignment)
+    {
+        return (value + alignment - 1) & ~(alignment - 1);
+    }
+
+    struct MemoryTypePreference
+    {
+        vk::MemoryPropertyFlags required;
+        vk::MemoryPropertyFlags preferred;
+        vk::MemoryPropertyFlags notPreferred;
+    };
+
+    MemoryTypePreference getPreference(MemoryUsage usage)
+    {
+        switch (usage)
+        {
+            case MemoryUsage::eUpload:
+                // staging stays out of the small device local BAR heap when we have a choice
+                return {
+                    .required = vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent,
+                    .preferred = {},
+                    .notPreferred = vk::MemoryPropertyFlagBits::eDeviceLocal | vk::MemoryPropertyFlagBits::eHostCached
+                };
+            case MemoryUsage::eDynamic:
+                return {
+                    .required = vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent,
+                    .preferred = vk::MemoryPropertyFlagBits::eDeviceLocal,
+                    .notPreferred = vk::MemoryPropertyFlagBits::eHostCached
+                };
+            case MemoryUsage::eReadback:
+                return {
+                    .required = vk::MemoryPropertyFlagBits::eHostVisible,
+                    .preferred = vk::MemoryPropertyFlagBits::eHostCached | vk::MemoryPropertyFlagBits::eHostCoherent,
+                    .notPreferred = {}
+                };
+            case MemoryUsage::eTransient:
+                // tiled GPUs back lazily allocated memory only if the attachment really spills out of tile memory
+                return {
+                    .required = vk::MemoryPropertyFlagBits::eDeviceLocal,
+                    .preferred = vk::MemoryPropertyFlagBits::eLazilyAllocated,
+                    .notPreferred = vk::MemoryPropertyFlagBits::eHostVisible
+                };
+            case MemoryUsage::eGpuOnly:
+            default:
+                return {
+                    .required = vk::MemoryPropertyFlagBits::eDeviceLocal,
+                    .preferred = {},
+                    .notPreferred = vk::MemoryPropertyFlagBits::eHostVisible
+                };
+        }
+    }
+}
+
+
+// MemoryBlock
+MemoryBlock::MemoryBlock(const vk::raii::Device& device, uint32_t memory_type_index, vk::DeviceSize size, bool host_visible)
+    : memoryTypeIndex_(memory_type_index), size_(size)
+{
+    assert(std::has_single_bit(size) && size >= MIN_ALLOCATION_SIZE);
+
+    vk::MemoryAllocateInfo memory_allocate_info{
+        .allocationSize = size,
+        .memoryTypeIndex = memory_type_index
+    };
+    memory_ = vk::raii::DeviceMemory(device, memory_allocate_info);
+
+    // host visible blocks stay mapped for their whole lifetime
+    if (host_visible)
+    {
+        mappedData_ = memory_.mapMemory(0, vk::WholeSize);
+    }
+
+    maxOrder_ = static_cast<uint32_t>(std::countr_zero(size / MIN_ALLOCATION_SIZE));
+    freeLists_.resize(maxOrder_ + 1);
+    freeLists_[maxOrder_].insert(0);  // the whole block starts free
+}
+
+
+Allocation MemoryBlock::allocate(vk::DeviceSize size, vk::DeviceSize alignment)
+{
+    // buddies are aligned to their own size, rounding up to the alignment covers the alignment too
+    vk::DeviceSize rounded_size = std::bit_ceil(std::max({size, alignment, MIN_ALLOCATION_SIZE}));
+    uint32_t order = static_cast<uint32_t>(std::countr_zero(rounded_size / MIN_ALLOCATION_SIZE));
+    if (order > maxOrder_) return {};
+
+    uint32_t free_order = order;
+    while (free_order <= maxOrder_ && freeLists_[free_order].empty())
+    {
+        free_order++;
+    }
+    if (free_order > maxOrder_) return {};
+
+    vk::DeviceSize offset = *freeLists_[free_order].begin();
+    freeLists_[free_order].erase(freeLists_[free_order].begin());
+
+    // splitting down, the upper half of every split goes back to the free list
+    while (free_order > order)
+    {
+        free_order--;
+        freeLists_[free_order].insert(offset + (MIN_ALLOCATION_SIZE << free_order));
+    }
+
+    usedSize_ += rounded_size;
+    allocationCount_++;
+
+    return Allocation{
+        .memory = *memory_,
+        .offset = offset,
+        .size = size,
+        .mappedData = mappedData_ ? static_cast<char*>(mappedData_) + offset : nullptr,
+        .memoryTypeIndex = memoryTypeIndex_,
+        .block = this,
+        .order = order
+    };
+}
+
+
+void MemoryBlock::free(const Allocation& allocation)
+{
+    vk::DeviceSize offset = allocation.offset;
+    uint32_t order = allocation.order;
+
+    usedSize_ -= MIN_ALLOCATION_SIZE << order;
+    allocationCount_--;
+
+    // merging with the buddy for as long as it is free as well
+    while (order < maxOrder_)
+    {
+        vk::DeviceSize buddy_offset = offset ^ (MIN_ALLOCATION_SIZE << order);
+        auto buddy = freeLists_[order].find(buddy_offset);
+        if (buddy == freeLists_[order].end()) break;
+
+        freeLists_[order].erase(buddy);
+        offset = std::min(offset, buddy_offset);
+        order++;
+    }
+
+    freeLists_[order].insert(offset);
+}
+
+
+bool MemoryBlock::isEmpty() const
+{
+    return allocationCount_ == 0;
+}
+
+
+vk::DeviceSize MemoryBlock::getSize() const
+{
+    return size_;
+}
+
+
+vk::DeviceSize MemoryBlock::getUsedSize() const
+{
+    return usedSize_;
+}
+
+
+uint32_t MemoryBlock::getAllocationCount() const
+{
+    return allocationCount_;
+}
+
+
+// LinearArena
+LinearArena::LinearArena(
+    MemoryAllocator& allocator,
+    const vk::raii::Device& device,
+    uint32_t memory_type_index,
+    vk::DeviceSize size_per_frame,
+    uint32_t frame_count,
+    bool host_visible
+): allocator_(allocator),
+   memoryTypeIndex_(memory_type_index),
+   sizePerFrame_(size_per_frame),
+   frameCount_(frame_count),
+   regionUsedSizes_(frame_count, 0),
+   regionAllocationCounts_(frame_count, 0)
+{
+    vk::MemoryAllocateInfo memory_allocate_info{
+        .allocationSize = size_per_frame * frame_count,
+        .memoryTypeIndex = memory_type_index
+    };
+    memory_ = vk::raii::DeviceMemory(device, memory_allocate_info);
+
+    if (host_visible)
+    {
+        mappedData_ = memory_.mapMemory(0, vk::WholeSize);
+    }
+}
+
+
+LinearArena::~LinearArena()
+{
+    allocator_.releaseLinearArena(*this);
+}
+
+
+Allocation LinearArena::allocate(vk::DeviceSize size, vk::DeviceSize alignment)
+{
+    // frame regions start at multiples of sizePerFrame_, so alignment is relative to the whole memory object
+    vk::DeviceSize region_offset = static_cast<vk::DeviceSize>(currentFrame_) * sizePerFrame_;
+    vk::DeviceSize offset = alignUp(region_offset + head_, std::max<vk::DeviceSize>(alignment, 1));
+
+    if (offset + size > region_offset + sizePerFrame_)
+    {
+        throw std::runtime_error("linear arena out of memory for frame " + std::to_string(currentFrame_));
+    }
+
+    vk::DeviceSize new_head = offset + size - region_offset;
+    totalUsedSize_.fetch_add(new_head - head_, std::memory_order_relaxed);
+    allocationCount_.fetch_add(1, std::memory_order_relaxed);
+    head_ = new_head;
+    regionUsedSizes_[currentFrame_] = head_;
+    regionAllocationCounts_[currentFrame_]++;
+
+    return Allocation{
+        .memory = *memory_,
+        .offset = offset,
+        .size = size,
+        .mappedData = mappedData_ ? static_cast<char*>(mappedData_) + offset : nullptr,
+        .memoryTypeIndex = memoryTypeIndex_
+    };
+}
+
+
+void LinearArena::reset(uint32_t frame_index)
+{
+    assert(frame_index < frameCount_);
+    currentFrame_ = frame_index;
+    head_ = 0;
+
+    // everything the region handed out is released at once
+    totalUsedSize_.fetch_sub(regionUsedSizes_[frame_index], std::memory_order_relaxed);
+    allocationCount_.fetch_sub(regionAllocationCounts_[frame_index], std::memory_order_relaxed);
+    regionUsedSizes_[frame_index] = 0;
+    regionAllocationCounts_[frame_index] = 0;
+}
+
+
+vk::DeviceSize LinearArena::getSizePerFrame() const
+{
+    return sizePerFrame_;
+}
+
+
+vk::DeviceSize LinearArena::getUsedSize() const
+{
+    return head_;
+}
+
+
+vk::DeviceSize LinearArena::getBlockSize() const
+{
+    return sizePerFrame_ * frameCount_;
+}
+
+
+vk::DeviceSize LinearArena::getTotalUsedSize() const
+{
+    return totalUsedSize_.load(std::memory_order_relaxed);
+}
+
+
+uint32_t LinearArena::getAllocationCount() const
+{
+    return allocationCount_.load(std::memory_order_relaxed);
+}
+
+
+uint32_t LinearArena::getMemoryTypeIndex() const
+{
+    return memoryTypeIndex_;
+}
+
+
+// MemoryAllocator
+MemoryAllocator::MemoryAllocator(
+    const vk::raii::Device& device,
+    const vk::raii::PhysicalDevice& physical_device,
+    bool memory_budget_enabled
+): device_(device), physicalDevice_(physical_device), memoryBudgetEnabled_(memory_budget_enabled)
+{
+    memoryProperties_ = physicalDevice_.getMemoryProperties();
+    maxMemoryAllocationCount_ = physicalDevice_.getProperties().limits.maxMemoryAllocationCount;
+
+    pools_.resize(memoryProperties_.memoryTypeCount * RESOURCE_KIND_COUNT);
+    dedicatedBytesPerHeap_.resize(memoryProperties_.memoryHeapCount, 0);
+    dedicatedCountPerHeap_.resize(memoryProperties_.memoryHeapCount, 0);
+}
+
+
+uint32_t MemoryAllocator::findMemoryType(uint32_t memory_type_bits, MemoryUsage usage) const
+{
+    MemoryTypePreference preference = getPreference(usage);
+
+    // lowest cost wins, one point per preferred flag missing and per unwanted flag present
+    std::optional<uint32_t> best_type;
+    int best_cost = 0;
+    for (uint32_t i = 0; i < memoryProperties_.memoryTypeCount; i++)
+    {
+        if (!(memory_type_bits & (1u << i))) continue;
+
+        vk::MemoryPropertyFlags flags = memoryProperties_.memoryTypes[i].propertyFlags;
+        if ((flags & preference.required) != preference.required) continue;
+        bool is_lazily_allocated = !!(flags & vk::MemoryPropertyFlagBits::eLazilyAllocated);
+        if (is_lazily_allocated && usage != MemoryUsage::eTransient) continue;  // only usable for transient attachments
+
+        int cost = std::popcount(static_cast<uint32_t>(preference.preferred & ~flags)) +
+                   std::popcount(static_cast<uint32_t>(preference.notPreferred & flags));
+        if (!best_type || cost < best_cost)
+        {
+            best_type = i;
+            best_cost = cost;
+        }
+    }
+
+    if (!best_type)
+    {
+        throw std::runtime_error("failed to find a suitable memory type");
+    }
+
+    return *best_type;
+}
+
+
+bool MemoryAllocator::isHostVisible(uint32_t memory_type_index) const
+{
+    return !!(memoryProperties_.memoryTypes[memory_type_index].propertyFlags & vk::MemoryPropertyFlagBits::eHostVisible);
+}
+
+
+vk::DeviceSize MemoryAllocator::getBlockSize(uint32_t memory_type_index) const
+{
+    // small heaps (a 256 MiB BAR for example) get smaller blocks so one block can't take a big share of them
+    vk::DeviceSize heap_size = memoryProperties_.memoryHeaps[memoryProperties_.memoryTypes[memory_type_index].heapIndex].size;
+    vk::DeviceSize block_size = std::min(DEFAULT_BLOCK_SIZE, std::bit_floor(heap_size / 8));
+
+    return std::max(block_size, MemoryBlock::MIN_ALLOCATION_SIZE);
+}
+
+
+void MemoryAllocator::trackVulkanAllocation()
+{
+    if (vulkanAllocationCount_ >= maxMemoryAllocationCount_)
+    {
+        throw std::runtime_error("maxMemoryAllocationCount (" + std::to_string(maxMemoryAllocationCount_) + ") reached");
+    }
+    vulkanAllocationCount_++;
+}
+
+
+Allocation MemoryAllocator::allocate(const vk::MemoryRequirements& requirements, MemoryUsage usage, ResourceKind kind)
+{
+    uint32_t memory_type_index = findMemoryType(requirements.memoryTypeBits, usage);
+    vk::DeviceSize block_size = getBlockSize(memory_type_index);
+
+    // anything that would take a big share of a block gets its own allocation instead, and lazily allocated
+    // memory is committed per memory object
+    bool use_dedicated = usage == MemoryUsage::eTransient ||
+                         requirements.size >= DEDICATED_ALLOCATION_THRESHOLD ||
+                         requirements.size > block_size / 2;
+    if (use_dedicated)
+    {
+        return allocateDedicated(requirements, usage, nullptr, nullptr);
+    }
+
+    std::lock_guard lock(mutex_);
+    auto& pool = pools_[memory_type_index * RESOURCE_KIND_COUNT + static_cast<size_t>(kind)];
+
+    for (auto& block : pool)
+    {
+        Allocation allocation = block->allocate(requirements.size, requirements.alignment);
+        if (allocation) return allocation;
+    }
+
+    trackVulkanAllocation();
+    pool.push_back(std::make_unique<MemoryBlock>(device_, memory_type_index, block_size, isHostVisible(memory_type_index)));
+
+    return pool.back()->allocate(requirements.size, requirements.alignment);
+}
+
+
+Allocation MemoryAllocator::allocateDedicated(
+    const vk::MemoryRequirements& requirements,
+    MemoryUsage usage,
+    vk::Buffer buffer,
+    vk::Image image
+)
+{
+    uint32_t memory_type_index = findMemoryType(requirements.memoryTypeBits, usage);
+
+    // telling the driver which resource the memory is for lets it pick the optimal placement
+    vk::MemoryDedicatedAllocateInfo memory_dedicated_allocate_info{
+        .image = image,
+        .buffer = buffer
+    };
+
+    vk::MemoryAllocateInfo memory_allocate_info{
+        .pNext = (buffer || image) ? &memory_dedicated_allocate_info : nullptr,
+        .allocationSize = requirements.size,
+        .memoryTypeIndex = memory_type_index
+    };
+
+    std::lock_guard lock(mutex_);
+    trackVulkanAllocation();
+
+    vk::raii::DeviceMemory memory(device_, memory_allocate_info);
+    void* mapped_data = isHostVisible(memory_type_index) ? memory.mapMemory(0, vk::WholeSize) : nullptr;
+
+    Allocation allocation{
+        .memory = *memory,
+        .offset = 0,
+        .size = requirements.size,
+        .mappedData = mapped_data,
+        .memoryTypeIndex = memory_type_index,
+        .dedicated = true
+    };
+
+    uint32_t heap_index = memoryProperties_.memoryTypes[memory_type_index].heapIndex;
+    dedicatedBytesPerHeap_[heap_index] += requirements.size;
+    dedicatedCountPerHeap_[heap_index]++;
+    dedicatedAllocations_.emplace(static_cast<VkDeviceMemory>(*memory), std::move(memory));
+
+    return allocation;
+}
+
+
+Allocation MemoryAllocator::allocateForBuffer(const vk::raii::Buffer& buffer, MemoryUsage usage)
+{
+    auto memory_requirements = device_.getBufferMemoryRequirements2<vk::MemoryRequirements2, vk::MemoryDedicatedRequirements>(
+        vk::BufferMemoryRequirementsInfo2{.buffer = *buffer}
+    );
+    const vk::MemoryRequirements& requirements = memory_requirements.get<vk::MemoryRequirements2>().memoryRequirements;
+    const auto& dedicated_requirements = memory_requirements.get<vk::MemoryDedicatedRequirements>();
+
+    Allocation allocation = (dedicated_requirements.requiresDedicatedAllocation || dedicated_requirements.prefersDedicatedAllocation)
+        ? allocateDedicated(requirements, usage, *buffer, nullptr)
+        : allocate(requirements, usage, ResourceKind::eLinear);
+
+    buffer.bindMemory(allocation.memory, allocation.offset);
+    return allocation;
+}
+
+
+Allocation MemoryAllocator::allocateForImage(const vk::raii::Image& image, MemoryUsage usage, ResourceKind kind)
+{
+    auto memory_requirements = device_.getImageMemoryRequirements2<vk::MemoryRequirements2, vk::MemoryDedicatedRequirements>(
+        vk::ImageMemoryRequirementsInfo2{.image = *image}
+    );
+    const vk::MemoryRequirements& requirements = memory_requirements.get<vk::MemoryRequirements2>().memoryRequirements;
+    const auto& dedicated_requirements = memory_requirements.get<vk::MemoryDedicatedRequirements>();
+
+    // large images (render targets, big textures) always go dedicated, it's what drivers are tuned for.
+    // So do transient attachments, lazily allocated memory is committed per memory object
+    bool use_dedicated = usage == MemoryUsage::eTransient ||
+                         dedicated_requirements.requiresDedicatedAllocation ||
+                         dedicated_requirements.prefersDedicatedAllocation ||
+                         requirements.size >= DEDICATED_ALLOCATION_THRESHOLD;
+
+    Allocation allocation = use_dedicated
+        ? allocateDedicated(requirements, usage, nullptr, *image)
+        : allocate(requirements, usage, kind);
+
+    image.bindMemory(allocation.memory, allocation.offset);
+    return allocation;
+}
+
+
+void MemoryAllocator::free(Allocation& allocation)
+{
+    if (!allocation) return;
+
+    std::lock_guard lock(mutex_);
+
+    if (allocation.dedicated)
+    {
+        uint32_t heap_index = memoryProperties_.memoryTypes[allocation.memoryTypeIndex].heapIndex;
+        dedicatedBytesPerHeap_[heap_index] -= allocation.size;
+        dedicatedCountPerHeap_[heap_index]--;
+        dedicatedAllocations_.erase(static_cast<VkDeviceMemory>(allocation.memory));  // RAII frees the memory
+        vulkanAllocationCount_--;
+    }
+    else if (allocation.block)
+    {
+        MemoryBlock* block = allocation.block;
+        block->free(allocation);
+
+        // empty blocks are released, except the last one of a pool to avoid allocate/free churn
+        auto& pool = pools_[allocation.memoryTypeIndex * RESOURCE_KIND_COUNT];
+        auto& other_pool = pools_[allocation.memoryTypeIndex * RESOURCE_KIND_COUNT + 1];
+        for (auto* candidate_pool : {&pool, &other_pool})
+        {
+            auto it = std::ranges::find_if(*candidate_pool, [block](const auto& pooled) { return pooled.get() == block; });
+            if (it != candidate_pool->end())
+            {
+                if (block->isEmpty() && candidate_pool->size() > 1)
+                {
+                    candidate_pool->erase(it);
+                    vulkanAllocationCount_--;
+                }
+                break;
+            }
+        }
+    }
+
+    allocation = {};
+}
+
+
+std::unique_ptr<LinearArena> MemoryAllocator::createLinearArena(
+    uint32_t memory_type_bits,
+    MemoryUsage usage,
+    vk::DeviceSize size_per_frame,
+    uint32_t frame_count
+)
+{
+    uint32_t memory_type_index = findMemoryType(memory_type_bits, usage);
+
+    {
+        std::lock_guard lock(mutex_);
+        trackVulkanAllocation();
+    }
+
+    // outside the lock, a destroyed arena takes it to unregister itself
+    std::unique_ptr<LinearArena> arena;
+    try
+    {
+        arena = std::make_unique<LinearArena>(*this, device_, memory_type_index, size_per_frame, frame_count, isHostVisible(memory_type_index));
+    }
+    catch (...)
+    {
+        std::lock_guard lock(mutex_);
+        vulkanAllocationCount_--;
+        throw;
+    }
+
+    std::lock_guard lock(mutex_);
+    linearArenas_.push_back(arena.get());
+    return arena;
+}
+
+
+void MemoryAllocator::releaseLinearArena(const LinearArena& arena)
+{
+    std::lock_guard lock(mutex_);
+    std::erase(linearArenas_, &arena);
+    vulkanAllocationCount_--;  // the RAII memory is freed right after
+}
+
+
+std::vector<HeapStatistics> MemoryAllocator::getHeapStatistics() const
+{
+    std::vector<HeapStatistics> statistics(memoryProperties_.memoryHeapCount);
+
+    for (uint32_t i = 0; i < memoryProperties_.memoryHeapCount; i++)
+    {
+        statistics[i].heapSize = memoryProperties_.memoryHeaps[i].size;
+        statistics[i].deviceLocal = !!(memoryProperties_.memoryHeaps[i].flags & vk::MemoryHeapFlagBits::eDeviceLocal);
+    }
+
+    {
+        std::lock_guard lock(mutex_);
+        for (size_t pool_index = 0; pool_index < pools_.size(); pool_index++)
+        {
+            uint32_t memory_type_index = static_cast<uint32_t>(pool_index / RESOURCE_KIND_COUNT);
+            HeapStatistics& heap = statistics[memoryProperties_.memoryTypes[memory_type_index].heapIndex];
+            for (const auto& block : pools_[pool_index])
+            {
+                heap.blockBytes += block->getSize();
+                heap.allocatedBytes += block->getUsedSize();
+                heap.blockCount++;
+                heap.allocationCount += block->getAllocationCount();
+            }
+        }
+
+        for (uint32_t i = 0; i < memoryProperties_.memoryHeapCount; i++)
+        {
+            statistics[i].blockBytes += dedicatedBytesPerHeap_[i];
+            statistics[i].allocatedBytes += dedicatedBytesPerHeap_[i];
+            statistics[i].blockCount += dedicatedCountPerHeap_[i];
+            statistics[i].allocationCount += dedicatedCountPerHeap_[i];
+        }
+
+        // an arena is one block, its live allocations are whatever its frame regions haven't been reset from
+        for (const LinearArena* arena : linearArenas_)
+        {
+            HeapStatistics& heap = statistics[memoryProperties_.memoryTypes[arena->getMemoryTypeIndex()].heapIndex];
+            heap.blockBytes += arena->getBlockSize();
+            heap.allocatedBytes += arena->getTotalUsedSize();
+            heap.blockCount++;
+            heap.allocationCount += arena->getAllocationCount();
+        }
+    }
+
+    // the budget changes at runtime (other processes, OS paging), so it is queried fresh every time
+    if (memoryBudgetEnabled_)
+    {
+        auto memory_properties = physicalDevice_.getMemoryProperties2<vk::PhysicalDeviceMemoryProperties2, vk::PhysicalDeviceMemoryBudgetPropertiesEXT>();
+        const auto& budget_properties = memory_properties.get<vk::PhysicalDeviceMemoryBudgetPropertiesEXT>();
+        for (uint32_t i = 0; i < memoryProperties_.memoryHeapCount; i++)
+        {
+            statistics[i].budget = budget_properties.heapBudget[i];
+            statistics[i].usage = budget_properties.heapUsage[i];
+        }
+    }
+
+    return statistics;
+}
+
+
+void MemoryAllocator::printStatistics() const
+{
+    std::vector<HeapStatistics> statistics = getHeapStatistics();
+
+    for (size_t i = 0; i < statistics.size(); i++)
+    {
+        const HeapStatistics& heap = statistics[i];
+        std::cout << "memory heap " << i << (heap.deviceLocal ? " (device local)" : "") << ": "
+                  << (heap.allocatedBytes >> 20) << " / " << (heap.blockBytes >> 20) << " MiB in "
+                  << heap.allocationCount << " allocations, " << heap.blockCount << " blocks";
+        if (memoryBudgetEnabled_)
+        {
+            std::cout << ", process usage " << (heap.usage >> 20) << " / " << (heap.budget >> 20) << " MiB budget";
+        }
+        std::cout << ", heap size " << (heap.heapSize >> 20) << " MiB\n";
+    }
+}
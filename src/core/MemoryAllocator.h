@@ -0,0 +1,224 @@
+#pragma once
+
+#include <vulkan/vulkan_raii.hpp>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <unordered_map>
+#include <vector>
+
+// What the memory is used for, drives the memory type selection.
+enum class MemoryUsage
+{
+    eGpuOnly,   // device local, never mapped (vertex buffers, textures, attachments)
+    eUpload,    // host visible and coherent, persistently mapped (staging)
+    eDynamic,   // host visible, device local when available (ReBAR), written by the CPU every frame
+    eReadback,  // host visible and cached, read by the CPU (query results, screenshots)
+    eTransient  // device local, lazily allocated when available: attachments that never leave tile memory
+};
+
+
+// Buffers and linear images never share a pool with optimal tiling images, so neighbours can never
+// violate bufferImageGranularity no matter how the sub-allocations end up packed.
+enum class ResourceKind
+{
+    eLinear,   // buffers and linear tiling images
+    eOptimal   // optimal tiling images
+};
+
+
+class MemoryBlock;
+class MemoryAllocator;
+
+// A range of device memory handed out by the MemoryAllocator. Plain data, freed through MemoryAllocator::free().
+struct Allocation
+{
+    vk::DeviceMemory memory = nullptr;
+    vk::DeviceSize offset = 0;
+    vk::DeviceSize size = 0;
+    void* mappedData = nullptr;  // offset already applied, null when the memory is not host visible
+    uint32_t memoryTypeIndex = 0;
+
+    // bookkeeping for free()
+    MemoryBlock* block = nullptr;  // null for dedicated and arena allocations
+    uint32_t order = 0;            // buddy order inside the block
+    bool dedicated = false;
+
+    explicit operator bool() const { return memory != nullptr; }
+};
+
+
+// Power of two buddy allocator over one vkAllocateMemory block.
+// Every sub-allocation is aligned to its own (power of two) size, which covers any alignment request up to that size.
+class MemoryBlock
+{
+public:
+    MemoryBlock(const vk::raii::Device& device, uint32_t memory_type_index, vk::DeviceSize size, bool host_visible);
+
+    // deleting copy and move semantics, allocations point back to their block
+    MemoryBlock(const MemoryBlock&) = delete;
+    MemoryBlock& operator=(const MemoryBlock&) = delete;
+    MemoryBlock(MemoryBlock&&) = delete;
+    MemoryBlock& operator=(MemoryBlock&&) = delete;
+
+    auto allocate(vk::DeviceSize size, vk::DeviceSize alignment) -> Allocation;  // empty allocation when the block is full
+    void free(const Allocation& allocation);
+
+    bool isEmpty() const;
+    vk::DeviceSize getSize() const;
+    vk::DeviceSize getUsedSize() const;
+    uint32_t getAllocationCount() const;
+
+    static constexpr vk::DeviceSize MIN_ALLOCATION_SIZE = 256;
+
+private:
+    vk::raii::DeviceMemory memory_ = nullptr;
+    void* mappedData_ = nullptr;
+    uint32_t memoryTypeIndex_ = 0;
+    vk::DeviceSize size_ = 0;
+    vk::DeviceSize usedSize_ = 0;
+    uint32_t allocationCount_ = 0;
+    uint32_t maxOrder_ = 0;
+    std::vector<std::set<vk::DeviceSize>> freeLists_;  // free offsets per order, order 0 is MIN_ALLOCATION_SIZE
+};
+
+
+// Bump allocator over one block split into one region per frame in flight.
+// Nothing is freed individually, reset(frame_index) drops the whole region once that frame retired.
+// Created by MemoryAllocator::createLinearArena(), its block and live allocations show up in the
+// allocator's statistics until the arena is destroyed.
+// Not thread safe and meant for one resource kind, give each recording thread its own arena.
+// The usage totals may be read from any thread.
+class LinearArena
+{
+public:
+    LinearArena(
+        MemoryAllocator& allocator,
+        const vk::raii::Device& device,
+        uint32_t memory_type_index,
+        vk::DeviceSize size_per_frame,
+        uint32_t frame_count,
+        bool host_visible
+    );
+    ~LinearArena();  // gives the block back to the allocator's bookkeeping
+
+    // deleting copy constructors
+    LinearArena(const LinearArena&) = delete;
+    LinearArena& operator=(const LinearArena&) = delete;
+
+    auto allocate(vk::DeviceSize size, vk::DeviceSize alignment) -> Allocation;  // throws when the frame region is full
+    void reset(uint32_t frame_index);  // also makes frame_index the region allocate() hands out from
+
+    vk::DeviceSize getSizePerFrame() const;
+    vk::DeviceSize getUsedSize() const;  // of the current frame region
+    vk::DeviceSize getBlockSize() const;
+    vk::DeviceSize getTotalUsedSize() const;  // of every frame region, thread safe
+    uint32_t getAllocationCount() const;  // live allocations of every frame region, thread safe
+    uint32_t getMemoryTypeIndex() const;
+
+private:
+    MemoryAllocator& allocator_;
+    vk::raii::DeviceMemory memory_ = nullptr;
+    void* mappedData_ = nullptr;
+    uint32_t memoryTypeIndex_ = 0;
+    vk::DeviceSize sizePerFrame_ = 0;
+    uint32_t frameCount_ = 0;
+    uint32_t currentFrame_ = 0;
+    vk::DeviceSize head_ = 0;  // relative to the current frame region
+
+    // per frame region, what reset() takes back out of the totals
+    std::vector<vk::DeviceSize> regionUsedSizes_;
+    std::vector<uint32_t> regionAllocationCounts_;
+    std::atomic<vk::DeviceSize> totalUsedSize_ = 0;
+    std::atomic<uint32_t> allocationCount_ = 0;
+};
+
+
+// Per heap usage, budget and usage come from VK_EXT_memory_budget when it's enabled (0 otherwise)
+struct HeapStatistics
+{
+    vk::DeviceSize heapSize = 0;
+    vk::DeviceSize blockBytes = 0;       // everything this allocator got from vkAllocateMemory
+    vk::DeviceSize allocatedBytes = 0;   // sub-allocated out of those blocks, plus dedicated allocations and arena regions in use
+    uint32_t blockCount = 0;
+    uint32_t allocationCount = 0;
+    vk::DeviceSize budget = 0;           // how much the process may use before the OS starts paging
+    vk::DeviceSize usage = 0;            // process wide usage as reported by the driver
+    bool deviceLocal = false;
+};
+
+
+// Sub-allocates buffers and images out of large blocks so we stay far below maxMemoryAllocationCount.
+// Long lived resources go to buddy pools (one per memory type and resource kind), per-frame data to
+// linear arenas, big images and anything the driver prefers dedicated gets its own allocation.
+// Thread safe.
+class MemoryAllocator
+{
+public:
+    MemoryAllocator(const vk::raii::Device& device, const vk::raii::PhysicalDevice& physical_device, bool memory_budget_enabled);
+
+    // deleting copy and move semantics, the VulkanContext owns the only instance
+    MemoryAllocator(const MemoryAllocator&) = delete;
+    MemoryAllocator& operator=(const MemoryAllocator&) = delete;
+    MemoryAllocator(MemoryAllocator&&) = delete;
+    MemoryAllocator& operator=(MemoryAllocator&&) = delete;
+
+    // allocate and bind in one step, the allocation must be freed before the resource is destroyed
+    auto allocateForBuffer(const vk::raii::Buffer& buffer, MemoryUsage usage) -> Allocation;
+    auto allocateForImage(const vk::raii::Image& image, MemoryUsage usage, ResourceKind kind = ResourceKind::eOptimal) -> Allocation;
+
+    // raw allocation out of the pools, the caller binds it
+    auto allocate(const vk::MemoryRequirements& requirements, MemoryUsage usage, ResourceKind kind) -> Allocation;
+    void free(Allocation& allocation);  // resets the allocation to empty
+
+    // the arena must be destroyed before the allocator
+    auto createLinearArena(
+        uint32_t memory_type_bits,
+        MemoryUsage usage,
+        vk::DeviceSize size_per_frame,
+        uint32_t frame_count
+    ) -> std::unique_ptr<LinearArena>;
+
+    auto findMemoryType(uint32_t memory_type_bits, MemoryUsage usage) const -> uint32_t;
+    bool isHostVisible(uint32_t memory_type_index) const;
+
+    auto getHeapStatistics() const -> std::vector<HeapStatistics>;
+    void printStatistics() const;
+
+    // allocations at least this big skip the pools
+    static constexpr vk::DeviceSize DEDICATED_ALLOCATION_THRESHOLD = 32ull << 20;  // 32 MiB
+    static constexpr vk::DeviceSize DEFAULT_BLOCK_SIZE = 64ull << 20;              // 64 MiB
+
+private:
+    friend class LinearArena;
+
+    void releaseLinearArena(const LinearArena& arena);  // from the arena's destructor
+
+    auto allocateDedicated(
+        const vk::MemoryRequirements& requirements,
+        MemoryUsage usage,
+        vk::Buffer buffer,
+        vk::Image image
+    ) -> Allocation;
+    auto getBlockSize(uint32_t memory_type_index) const -> vk::DeviceSize;
+    void trackVulkanAllocation();  // throws before we exceed maxMemoryAllocationCount
+
+    static constexpr size_t RESOURCE_KIND_COUNT = 2;
+
+    const vk::raii::Device& device_;
+    const vk::raii::PhysicalDevice& physicalDevice_;
+    vk::PhysicalDeviceMemoryProperties memoryProperties_;
+    uint32_t maxMemoryAllocationCount_ = 0;
+    bool memoryBudgetEnabled_ = false;
+
+    mutable std::mutex mutex_;
+    uint32_t vulkanAllocationCount_ = 0;
+    // pools_[memory type index * RESOURCE_KIND_COUNT + kind]
+    std::vector<std::vector<std::unique_ptr<MemoryBlock>>> pools_;
+    std::unordered_map<VkDeviceMemory, vk::raii::DeviceMemory> dedicatedAllocations_;
+    std::vector<vk::DeviceSize> dedicatedBytesPerHeap_;
+    std::vector<uint32_t> dedicatedCountPerHeap_;
+    std::vector<const LinearArena*> linearArenas_;  // live arenas, for the statistics
+};
@@ -0,0 +1,127 @@
+#include "OffscreenTarget.h"
+#include "VulkanContext.h"
+#include "utils/Trace.h"
+#include <stdexcept>
+
+
+OffscreenTarget::OffscreenTarget(const VulkanContext& context, vk::Extent2D extent, vk::Format format, uint32_t image_count)
+    : context_(context), extent_(extent), format_(format)
+{
+    if (extent_.width == 0 || extent_.height == 0 || image_count == 0)
+    {
+        throw std::runtime_error("offscreen target needs a non zero extent and image count");
+    }
+
+    createImages(image_count);
+}
+
+
+OffscreenTarget::~OffscreenTarget()
+{
+    // views and images go before the memory they're bound to
+    imageViews_.clear();
+    images_.clear();
+    for (auto& allocation : allocations_)
+    {
+        context_.getMemoryAllocator().free(allocation);
+    }
+}
+
+
+void OffscreenTarget::createImages(uint32_t image_count)
+{
+    TRACE_SCOPE("OffscreenTarget::createImages");
+
+    vk::ImageCreateInfo image_create_info{
+        .imageType = vk::ImageType::e2D,
+        .format = format_,
+        .extent = {extent_.width, extent_.height, 1},
+        .mipLevels = 1,
+        .arrayLayers = 1,
+        .samples = vk::SampleCountFlagBits::e1,
+        .tiling = vk::ImageTiling::eOptimal,
+        .usage = getImageUsage(),
+        .sharingMode = vk::SharingMode::eExclusive,
+        .initialLayout = vk::ImageLayout::eUndefined
+    };
+
+    vk::ImageViewCreateInfo image_view_create_info{
+        .viewType = vk::ImageViewType::e2D,
+        .format = format_,
+        .subresourceRange = {
+            .aspectMask = vk::ImageAspectFlagBits::eColor,
+            .baseMipLevel = 0,
+            .levelCount = 1,
+            .baseArrayLayer = 0,
+            .layerCount = 1
+        }
+    };
+
+    for (uint32_t i = 0; i < image_count; i++)
+    {
+        images_.emplace_back(context_.getLogicalDevice(), image_create_info);
+        allocations_.push_back(context_.getMemoryAllocator().allocateForImage(images_.back(), MemoryUsage::eGpuOnly));
+        imageHandles_.push_back(*images_.back());
+
+        image_view_create_info.image = *images_.back();
+        imageViews_.emplace_back(context_.getLogicalDevice(), image_view_create_info);
+    }
+}
+
+
+std::optional<uint32_t> OffscreenTarget::acquireNextImage(vk::Semaphore)
+{
+    // nothing to wait for, the frame's timeline wait already covers the image's previous use
+    uint32_t image_index = nextImage_;
+    nextImage_ = (nextImage_ + 1) % static_cast<uint32_t>(images_.size());
+    return image_index;
+}
+
+
+SwapChain* OffscreenTarget::asSwapChain()
+{
+    return nullptr;
+}
+
+
+vk::ImageLayout OffscreenTarget::getFinalLayout() const
+{
+    return vk::ImageLayout::eTransferSrcOptimal;
+}
+
+
+// Accessor functions
+vk::Format OffscreenTarget::getFormat() const
+{
+    return format_;
+}
+
+
+vk::Extent2D OffscreenTarget::getExtent() const
+{
+    return extent_;
+}
+
+
+uint32_t OffscreenTarget::getImageCount() const
+{
+    return static_cast<uint32_t>(images_.size());
+}
+
+
+vk::ImageUsageFlags OffscreenTarget::getImageUsage() const
+{
+    return vk::ImageUsageFlagBits::eColorAttachment | vk::ImageUsageFlagBits::eTransferSrc | vk::ImageUsageFlagBits::eTransferDst;
+}
+
+
+const std::vector<vk::Image>& OffscreenTarget::getImages() const
+{
+    return imageHandles_;
+}
+
+
+const std::vector<vk::raii::ImageView>& OffscreenTarget::getImageViews() const
+{
+    return imageViews_;
+}
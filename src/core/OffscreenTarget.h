@@ -0,0 +1,62 @@
+#pragma once
+
+#include <vulkan/vulkan_raii.hpp>
+#include <cstdint>
+#include <optional>
+#include <vector>
+
+#include "MemoryAllocator.h"
+#include "RenderTarget.h"
+
+// forward declaring classes
+class VulkanContext;
+
+// Headless render target: device local color images handed out round robin, never presented, so frames
+// only wait on the GPU and never on vsync or a compositor. Frames end with the image in transfer source
+// layout for readbacks, the images are transfer destinations too so post processing can copy into them. Works with windowed and headless contexts alike.
+// Not thread safe.
+class OffscreenTarget : public RenderTarget
+{
+public:
+    // image_count must be at least the number of frames in flight, the renderer reuses an image as soon
+    // as the frame that rendered into it count images ago completed
+    OffscreenTarget(
+        const VulkanContext& context,
+        vk::Extent2D extent,
+        vk::Format format = DEFAULT_FORMAT,
+        uint32_t image_count = DEFAULT_IMAGE_COUNT
+    );
+    ~OffscreenTarget() override;  // the GPU must be done with the images
+
+    // deleting copy constructors
+    OffscreenTarget(const OffscreenTarget&) = delete;
+    OffscreenTarget& operator=(const OffscreenTarget&) = delete;
+
+    // RenderTarget
+    auto acquireNextImage(vk::Semaphore image_available) -> std::optional<uint32_t> override;  // never out of date
+    auto asSwapChain() -> SwapChain* override;  // always null
+    auto getFinalLayout() const -> vk::ImageLayout override;  // transfer source
+
+    // accessor functions
+    vk::Format getFormat() const override;
+    vk::Extent2D getExtent() const override;
+    uint32_t getImageCount() const override;
+    vk::ImageUsageFlags getImageUsage() const override;
+    auto getImages() const -> const std::vector<vk::Image>& override;
+    auto getImageViews() const -> const std::vector<vk::raii::ImageView>& override;
+
+    static constexpr vk::Format DEFAULT_FORMAT = vk::Format::eB8G8R8A8Srgb;  // what most swap chains pick
+    static constexpr uint32_t DEFAULT_IMAGE_COUNT = 2;  // Renderer::MAX_FRAMES_IN_FLIGHT
+
+private:
+    void createImages(uint32_t image_count);
+
+    const VulkanContext& context_;
+    vk::Extent2D extent_;
+    vk::Format format_;
+    std::vector<vk::raii::Image> images_;
+    std::vector<vk::Image> imageHandles_;  // what getImages() hands out, same order as images_
+    std::vector<vk::raii::ImageView> imageViews_;
+    std::vector<Allocation> allocations_;
+    uint32_t nextImage_ = 0;
+};
@@ -0,0 +1,168 @@
+#include "PipelineCache.h"
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+
+
+PipelineCache::PipelineCache(
+    const vk::raii::Device& device,
+    const vk::raii::PhysicalDevice& physical_device,
+    std::filesystem::path file_path
+): deviceProperties_(physical_device.getProperties()), filePath_(std::move(file_path))
+{
+    std::vector<uint8_t> initial_data = loadInitialData();
+    loadedFromDisk_ = !initial_data.empty();
+
+    vk::PipelineCacheCreateInfo pipeline_cache_create_info{
+        .initialDataSize = initial_data.size(),
+        .pInitialData = initial_data.data()
+    };
+
+    cache_ = vk::raii::PipelineCache(device, pipeline_cache_create_info);
+
+    std::cout << "pipeline cache: " << (loadedFromDisk_ ? "warm, " : "cold, ")
+              << initial_data.size() << " bytes loaded from " << filePath_.string() << "\n";
+}
+
+
+PipelineCache::~PipelineCache()
+{
+    std::cout << "pipeline cache: " << getHitCount() << " hits, " << getMissCount() << " misses, "
+              << static_cast<double>(getCreationTimeNs()) / 1.0e6 << " ms spent creating pipelines\n";
+
+    // destructors must not throw, a failed save only costs us a cold start next time
+    try
+    {
+        save();
+    }
+    catch (const std::exception& e)
+    {
+        std::cerr << "pipeline cache: failed to save " << filePath_.string() << ": " << e.what() << "\n";
+    }
+}
+
+
+std::vector<uint8_t> PipelineCache::loadInitialData() const
+{
+    std::ifstream file(filePath_, std::ios::binary | std::ios::ate);
+    if (!file.is_open())
+    {
+        return {};  // first run, nothing cached yet
+    }
+
+    const std::streamsize file_size = file.tellg();
+    std::vector<uint8_t> data(static_cast<size_t>(file_size));
+    file.seekg(0);
+    file.read(reinterpret_cast<char*>(data.data()), file_size);
+
+    if (!isHeaderCompatible(data))
+    {
+        std::cout << "pipeline cache: " << filePath_.string() << " is corrupt or was created by another device or driver, discarding\n";
+        return {};
+    }
+
+    return data;
+}
+
+
+bool PipelineCache::isHeaderCompatible(const std::vector<uint8_t>& data) const
+{
+    if (data.size() < sizeof(VkPipelineCacheHeaderVersionOne)) return false;
+
+    // the blob is not guaranteed to be aligned, copying the header out instead of casting
+    VkPipelineCacheHeaderVersionOne header{};
+    std::memcpy(&header, data.data(), sizeof(header));
+
+    // a truncated or corrupt file must never reach the driver
+    if (header.headerSize < sizeof(VkPipelineCacheHeaderVersionOne) || header.headerSize > data.size()) return false;
+    if (header.headerVersion != VK_PIPELINE_CACHE_HEADER_VERSION_ONE) return false;
+    if (header.vendorID != deviceProperties_.vendorID) return false;
+    if (header.deviceID != deviceProperties_.deviceID) return false;
+    if (std::memcmp(header.pipelineCacheUUID, deviceProperties_.pipelineCacheUUID.data(), VK_UUID_SIZE) != 0) return false;
+
+    return true;
+}
+
+
+void PipelineCache::save() const
+{
+    std::vector<uint8_t> data = cache_.getData();
+
+    std::filesystem::path temporary_path = filePath_;
+    temporary_path += ".tmp";
+
+    {
+        std::ofstream file(temporary_path, std::ios::binary | std::ios::trunc);
+        if (!file.is_open())
+        {
+            throw std::runtime_error("failed to open " + temporary_path.string() + " for writing");
+        }
+
+        file.write(reinterpret_cast<const char*>(data.data()), static_cast<std::streamsize>(data.size()));
+        if (!file)
+        {
+            throw std::runtime_error("failed to write " + temporary_path.string());
+        }
+    }  // closing the file before renaming it
+
+    // rename replaces the destination in one step on both POSIX and Windows
+    std::filesystem::rename(temporary_path, filePath_);
+}
+
+
+void PipelineCache::recordFeedback(const vk::PipelineCreationFeedback& feedback)
+{
+    if (!(feedback.flags & vk::PipelineCreationFeedbackFlagBits::eValid))
+    {
+        return;  // the driver did not fill the feedback in, nothing to count
+    }
+
+    if (!!(feedback.flags & vk::PipelineCreationFeedbackFlagBits::eApplicationPipelineCacheHit))
+    {
+        hitCount_++;
+    }
+    else
+    {
+        missCount_++;
+    }
+
+    creationTimeNs_ += feedback.duration;
+}
+
+
+// Accessor functions
+const vk::raii::PipelineCache& PipelineCache::get() const
+{
+    return cache_;
+}
+
+
+const std::filesystem::path& PipelineCache::getFilePath() const
+{
+    return filePath_;
+}
+
+
+bool PipelineCache::wasLoadedFromDisk() const
+{
+    return loadedFromDisk_;
+}
+
+
+uint32_t PipelineCache::getHitCount() const
+{
+    return hitCount_.load();
+}
+
+
+uint32_t PipelineCache::getMissCount() const
+{
+    return missCount_.load();
+}
+
+
+uint64_t PipelineCache::getCreationTimeNs() const
+{
+    return creationTimeNs_.load();
+}
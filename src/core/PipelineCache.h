@@ -0,0 +1,58 @@
+#pragma once
+
+#include <vulkan/vulkan_raii.hpp>
+#include <atomic>
+#include <cstdint>
+#include <filesystem>
+#include <vector>
+
+// Wraps a vk::raii::PipelineCache that is persisted to disk between runs.
+// The cache blob is only reused when its VkPipelineCacheHeaderVersionOne matches the
+// physical device (vendorID, deviceID and pipelineCacheUUID), otherwise we start cold.
+// Hit/miss counts come from VK_EXT_pipeline_creation_feedback (core in 1.3) reported by
+// every pipeline creation through recordFeedback().
+class PipelineCache
+{
+public:
+    PipelineCache(
+        const vk::raii::Device& device,
+        const vk::raii::PhysicalDevice& physical_device,
+        std::filesystem::path file_path
+    );
+    ~PipelineCache();  // serializes the cache back to disk
+
+    // deleting copy and move semantics, the VulkanContext owns the only instance
+    PipelineCache(const PipelineCache&) = delete;
+    PipelineCache& operator=(const PipelineCache&) = delete;
+    PipelineCache(PipelineCache&&) = delete;
+    PipelineCache& operator=(PipelineCache&&) = delete;
+
+    // writes to a temporary file first and renames it over the old one, so a crash
+    // mid write never leaves a truncated cache behind.
+    void save() const;
+
+    // called after each pipeline creation with the feedback chained into its create info.
+    // thread safe, pipelines may be created from worker threads.
+    void recordFeedback(const vk::PipelineCreationFeedback& feedback);
+
+    // Accessors
+    auto get() const -> const vk::raii::PipelineCache&;
+    auto getFilePath() const -> const std::filesystem::path&;
+    bool wasLoadedFromDisk() const;
+    uint32_t getHitCount() const;
+    uint32_t getMissCount() const;
+    uint64_t getCreationTimeNs() const;  // sum of the reported pipeline creation durations
+
+private:
+    auto loadInitialData() const -> std::vector<uint8_t>;
+    bool isHeaderCompatible(const std::vector<uint8_t>& data) const;
+
+    vk::PhysicalDeviceProperties deviceProperties_;
+    std::filesystem::path filePath_;
+    vk::raii::PipelineCache cache_ = nullptr;
+    bool loadedFromDisk_ = false;
+
+    std::atomic<uint32_t> hitCount_ = 0;
+    std::atomic<uint32_t> missCount_ = 0;
+    std::atomic<uint64_t> creationTimeNs_ = 0;
+};
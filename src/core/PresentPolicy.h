@@ -0,0 +1,70 @@
+#pragma once
+
+#include <vulkan/vulkan_raii.hpp>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+
+// What the swap chain and the frame pacing optimize for.
+enum class PresentProfile
+{
+    eThroughput,   // as many frames as the GPU can render, no tearing when mailbox exists
+    eLowLatency,   // tearing allowed, the CPU waits for the previous present before sampling input
+    ePowerSaving   // vsync, at most one frame queued so the GPU idles between frames
+};
+
+
+// Present modes in order of preference, the first one the surface supports wins.
+// eFifo is last in every list since it's the only mode the spec guarantees.
+inline auto getPresentModePreference(PresentProfile profile) -> std::vector<vk::PresentModeKHR>
+{
+    switch (profile)
+    {
+    case PresentProfile::eLowLatency:
+        return {vk::PresentModeKHR::eImmediate, vk::PresentModeKHR::eMailbox, vk::PresentModeKHR::eFifoRelaxed, vk::PresentModeKHR::eFifo};
+    case PresentProfile::ePowerSaving:
+        return {vk::PresentModeKHR::eFifo};
+    case PresentProfile::eThroughput:
+    default:
+        return {vk::PresentModeKHR::eMailbox, vk::PresentModeKHR::eImmediate, vk::PresentModeKHR::eFifoRelaxed, vk::PresentModeKHR::eFifo};
+    }
+}
+
+
+// true when the CPU should block on the previous present (VK_KHR_present_wait) before starting a frame
+inline bool shouldWaitForPreviousPresent(PresentProfile profile)
+{
+    return profile != PresentProfile::eThroughput;
+}
+
+
+inline auto toString(PresentProfile profile) -> std::string
+{
+    switch (profile)
+    {
+    case PresentProfile::eLowLatency: return "low_latency";
+    case PresentProfile::ePowerSaving: return "power_saving";
+    case PresentProfile::eThroughput:
+    default: return "throughput";
+    }
+}
+
+
+// Reads PRESENT_PROFILE_ENV, falls back to fallback_profile when unset or unknown.
+inline constexpr const char* PRESENT_PROFILE_ENV = "VK_TUTORIAL_PRESENT";
+
+inline auto getPresentProfileFromEnvironment(PresentProfile fallback_profile) -> PresentProfile
+{
+    const char* env_value = std::getenv(PRESENT_PROFILE_ENV);
+    if (env_value == nullptr || *env_value == '\0') return fallback_profile;
+
+    std::string profile_name = env_value;
+    for (PresentProfile profile : {PresentProfile::eThroughput, PresentProfile::eLowLatency, PresentProfile::ePowerSaving})
+    {
+        if (profile_name == toString(profile)) return profile;
+    }
+
+    std::cerr << PRESENT_PROFILE_ENV << "=" << profile_name << " is not a known profile, using " << toString(fallback_profile) << "\n";
+    return fallback_profile;
+}
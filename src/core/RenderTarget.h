@@ -0,0 +1,33 @@
+#pragma once
+
+#include <vulkan/vulkan_raii.hpp>
+#include <cstdint>
+#include <optional>
+#include <vector>
+
+// forward declaring classes
+class SwapChain;
+
+// The images Renderer::drawFrame() renders into: a SwapChain when there's a window, an OffscreenTarget
+// when headless. The frame code only sees this interface, presentation is the one step that needs the
+// swap chain itself (asSwapChain()).
+// Not thread safe.
+class RenderTarget
+{
+public:
+    virtual ~RenderTarget() = default;
+
+    // index of the next image to render into, a swap chain signals image_available once the image can be
+    // written, targets without presentation leave it untouched. nullopt: out of date, recreate the target
+    virtual auto acquireNextImage(vk::Semaphore image_available) -> std::optional<uint32_t> = 0;
+
+    virtual auto asSwapChain() -> SwapChain* = 0;  // null when the frame isn't presented
+    virtual auto getFinalLayout() const -> vk::ImageLayout = 0;  // the layout the frame leaves the image in
+
+    virtual vk::Format getFormat() const = 0;
+    virtual vk::Extent2D getExtent() const = 0;
+    virtual uint32_t getImageCount() const = 0;
+    virtual vk::ImageUsageFlags getImageUsage() const = 0;  // always includes color attachment
+    virtual auto getImages() const -> const std::vector<vk::Image>& = 0;
+    virtual auto getImageViews() const -> const std::vector<vk::raii::ImageView>& = 0;
+};
@@ -0,0 +1,102 @@
+#include "ShaderModuleCache.h"
+#include "utils/FileUtils.h"
+#include <algorithm>
+#include <system_error>
+
+
+ShaderModuleCache::ShaderModuleCache(const vk::raii::Device& device): device_(device)
+{
+}
+
+
+ShaderModuleCache::ShaderModulePtr ShaderModuleCache::getModule(const std::string& spirv_path)
+{
+    std::error_code error;
+    std::filesystem::file_time_type write_time = std::filesystem::last_write_time(spirv_path, error);
+
+    {
+        // same file, unchanged since we last hashed it: nothing to read at all
+        std::lock_guard lock(mutex_);
+        auto path_it = paths_.find(spirv_path);
+        if (!error && path_it != paths_.end() && path_it->second.writeTime == write_time)
+        {
+            if (ShaderModulePtr shader_module = path_it->second.module.lock())
+            {
+                hitCount_++;
+                return shader_module;
+            }
+        }
+    }
+
+    // mapping and hashing happen outside the lock, other threads keep getting their modules meanwhile
+    MappedFile file = mapSpirv(spirv_path);
+    const uint32_t* words = file.as<uint32_t>();
+    size_t word_count = file.size() / sizeof(uint32_t);
+    uint64_t content_hash = hashWords(words, word_count);
+
+    std::lock_guard lock(mutex_);
+    auto [first, last] = modules_.equal_range(content_hash);
+    for (auto module_it = first; module_it != last; module_it++)
+    {
+        const std::vector<uint32_t>& module_words = module_it->second.words;
+        if (std::equal(words, words + word_count, module_words.begin(), module_words.end()))
+        {
+            hitCount_++;  // another path (or an earlier write) with identical content
+            paths_[spirv_path] = PathEntry{.writeTime = write_time, .module = module_it->second.module};
+            return module_it->second.module;
+        }
+    }
+
+    vk::ShaderModuleCreateInfo shader_module_create_info{
+        .codeSize = file.size(),  // size in bytes, not in words
+        .pCode = words            // the mapped pages, no copy
+    };
+
+    auto shader_module = std::make_shared<vk::raii::ShaderModule>(device_, shader_module_create_info);
+    modules_.emplace(content_hash, ModuleEntry{.words = std::vector<uint32_t>(words, words + word_count), .module = shader_module});
+    paths_[spirv_path] = PathEntry{.writeTime = write_time, .module = shader_module};
+    missCount_++;
+
+    return shader_module;
+}
+
+
+void ShaderModuleCache::trim()
+{
+    std::lock_guard lock(mutex_);
+    std::erase_if(modules_, [](const auto& entry) { return entry.second.module.use_count() == 1; });
+}
+
+
+uint64_t ShaderModuleCache::hashWords(const uint32_t* words, size_t word_count)
+{
+    // a word at a time instead of bytewise, SPIR-V is always whole words
+    uint64_t hash = 14695981039346656037ull;
+    for (size_t i = 0; i < word_count; i++)
+    {
+        hash ^= words[i];
+        hash *= 1099511628211ull;
+    }
+    hash ^= word_count;  // so a truncated module can't collide with its prefix
+
+    return hash;
+}
+
+
+uint32_t ShaderModuleCache::getModuleCount() const
+{
+    std::lock_guard lock(mutex_);
+    return static_cast<uint32_t>(modules_.size());
+}
+
+
+uint32_t ShaderModuleCache::getHitCount() const
+{
+    return hitCount_.load();
+}
+
+
+uint32_t ShaderModuleCache::getMissCount() const
+{
+    return missCount_.load();
+}
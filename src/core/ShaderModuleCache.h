@@ -0,0 +1,63 @@
+#pragma once
+
+#include <vulkan/vulkan_raii.hpp>
+#include <atomic>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Shader modules created straight from memory mapped SPIR-V and shared by content, so identical
+// variants (and the same file used by many pipelines) only ever cost one vkCreateShaderModule.
+// The hash only finds the candidates, a module is reused once its SPIR-V compares equal.
+// A file is only mapped again when its write time changed, which is also what picks up hot reloads.
+// Thread safe.
+class ShaderModuleCache
+{
+public:
+    using ShaderModulePtr = std::shared_ptr<const vk::raii::ShaderModule>;
+
+    explicit ShaderModuleCache(const vk::raii::Device& device);
+
+    // deleting copy and move semantics, the VulkanContext owns the only instance
+    ShaderModuleCache(const ShaderModuleCache&) = delete;
+    ShaderModuleCache& operator=(const ShaderModuleCache&) = delete;
+    ShaderModuleCache(ShaderModuleCache&&) = delete;
+    ShaderModuleCache& operator=(ShaderModuleCache&&) = delete;
+
+    // throws std::runtime_error if the file cannot be mapped or the module cannot be created
+    auto getModule(const std::string& spirv_path) -> ShaderModulePtr;
+
+    void trim();  // drops every module no pipeline build is holding right now
+
+    uint32_t getModuleCount() const;
+    uint32_t getHitCount() const;   // served without creating a module
+    uint32_t getMissCount() const;
+
+private:
+    struct PathEntry
+    {
+        std::filesystem::file_time_type writeTime;
+        std::weak_ptr<const vk::raii::ShaderModule> module;  // expired once trim() dropped it
+    };
+
+    struct ModuleEntry
+    {
+        std::vector<uint32_t> words;  // compared on a hash hit, a collision must not share the module
+        std::shared_ptr<vk::raii::ShaderModule> module;
+    };
+
+    static uint64_t hashWords(const uint32_t* words, size_t word_count);  // 64 bit FNV-1a
+
+    const vk::raii::Device& device_;
+
+    mutable std::mutex mutex_;
+    std::unordered_map<std::string, PathEntry> paths_;
+    std::unordered_multimap<uint64_t, ModuleEntry> modules_;  // keyed by content hash
+
+    std::atomic<uint32_t> hitCount_ = 0;
+    std::atomic<uint32_t> missCount_ = 0;
+};
@@ -1,48 +1,116 @@
 #include "SwapChain.h"
 #include "VulkanContext.h"
+#include "utils/Trace.h"
+#include <iostream>
 
-SwapChain::SwapChain(const VulkanContext& context, GLFWwindow* window): context_(context), window_(window)
+SwapChain::SwapChain(const VulkanContext& context, GLFWwindow* window, PresentProfile present_profile)
+    : context_(context), window_(window), surface_(*context.getSurface()), presentProfile_(present_profile)
 {
     create();
     createImageViews();
 }
 
 
-void SwapChain::create()
+SwapChain::SwapChain(const VulkanContext& context, vk::raii::SurfaceKHR&& surface, GLFWwindow* window, PresentProfile present_profile)
+    : context_(context), window_(window), ownedSurface_(std::move(surface)), surface_(*ownedSurface_), presentProfile_(present_profile)
 {
-    vk::SurfaceCapabilitiesKHR surface_capabilities = context_.getPhysicalDevice().getSurfaceCapabilitiesKHR(context_.getSurface());
-    std::vector<vk::SurfaceFormatKHR> available_formats = context_.getPhysicalDevice().getSurfaceFormatsKHR(context_.getSurface());
-    std::vector<vk::PresentModeKHR> available_present_modes = context_.getPhysicalDevice().getSurfacePresentModesKHR(context_.getSurface());
+    create();
+    createImageViews();
+}
+
+
+vk::Format SwapChain::querySurfaceFormat(const VulkanContext& context)
+{
+    return querySurfaceFormat(context, context.getSurface());
+}
+
+
+vk::Format SwapChain::querySurfaceFormat(const VulkanContext& context, const vk::raii::SurfaceKHR& surface)
+{
+    return chooseSurfaceFormat(context.getPhysicalDevice().getSurfaceFormatsKHR(*surface)).format;
+}
+
+
+void SwapChain::create(vk::SwapchainKHR old_swap_chain)
+{
+    TRACE_SCOPE("SwapChain::create");
+    vk::SurfaceCapabilitiesKHR surface_capabilities = context_.getPhysicalDevice().getSurfaceCapabilitiesKHR(surface_);
+    std::vector<vk::SurfaceFormatKHR> available_formats = context_.getPhysicalDevice().getSurfaceFormatsKHR(surface_);
+    std::vector<vk::PresentModeKHR> available_present_modes = context_.getPhysicalDevice().getSurfacePresentModesKHR(surface_);
 
     extent_ = chooseExtent(surface_capabilities);
     uint32_t image_count = getImageCountFrom(surface_capabilities);
     surfaceFormat_ = chooseSurfaceFormat(available_formats);
-    vk::PresentModeKHR present_mode = choosePresentMode(available_present_modes);
+    presentMode_ = choosePresentMode(available_present_modes);
+    imageUsage_ = vk::ImageUsageFlagBits::eColorAttachment | (surface_capabilities.supportedUsageFlags & vk::ImageUsageFlagBits::eTransferDst);
+    std::cout << "present profile: " << toString(presentProfile_) << " mode: " << vk::to_string(presentMode_) << "\n";
     
     vk::SwapchainCreateInfoKHR swap_chain_create_info{
-        .surface = *context_.getSurface(), // '*' is an overloaded operator of vk::raii::surface for geting the wrapped vk::SurfaceKHR handle
+        .surface = surface_,
         .minImageCount = image_count,
         .imageFormat = surfaceFormat_.format,
         .imageColorSpace = surfaceFormat_.colorSpace,
         .imageExtent = extent_,
         .imageArrayLayers = 1,
-        .imageUsage = vk::ImageUsageFlagBits::eColorAttachment,
+        .imageUsage = imageUsage_,  // post processing copies its result in
         .imageSharingMode = vk::SharingMode::eExclusive,
         .preTransform = surface_capabilities.currentTransform,
         .compositeAlpha = vk::CompositeAlphaFlagBitsKHR::eOpaque,
-        .presentMode = present_mode,
-        .clipped = true
+        .presentMode = presentMode_,
+        .clipped = true,
+        .oldSwapchain = old_swap_chain  // lets the driver hand over images while the old one is still presenting
     };
 
     swapChain_ = vk::raii::SwapchainKHR(context_.getLogicalDevice(), swap_chain_create_info);
     images_ = swapChain_.getImages();
 }
 
-void SwapChain::recreate()
+RetiredSwapChain SwapChain::recreate()
 {
-    cleanup();
-    create();
+    RetiredSwapChain retired{
+        .swapChain = std::move(swapChain_),
+        .imageViews = std::move(imageViews_)
+    };
+    swapChain_ = nullptr;
+    imageViews_.clear();
+
+    create(*retired.swapChain);
     createImageViews();
+
+    return retired;
+}
+
+
+void SwapChain::setPresentProfile(PresentProfile present_profile)
+{
+    presentProfile_ = present_profile;
+}
+
+
+std::optional<uint32_t> SwapChain::acquireNextImage(vk::Semaphore image_available)
+{
+    try
+    {
+        auto [result, image_index] = swapChain_.acquireNextImage(UINT64_MAX, image_available, nullptr);
+        if (result == vk::Result::eErrorOutOfDateKHR) return std::nullopt;
+        return image_index;  // suboptimal still renders, the present reports it
+    }
+    catch (const vk::OutOfDateKHRError&)
+    {
+        return std::nullopt;  // nothing was signaled, the semaphore can be used again
+    }
+}
+
+
+SwapChain* SwapChain::asSwapChain()
+{
+    return this;
+}
+
+
+vk::ImageLayout SwapChain::getFinalLayout() const
+{
+    return vk::ImageLayout::ePresentSrcKHR;
 }
 
 
@@ -80,7 +148,7 @@ uint32_t SwapChain::getImageCountFrom(const vk::SurfaceCapabilitiesKHR& capabili
 }
 
 
-vk::SurfaceFormatKHR SwapChain::chooseSurfaceFormat(const std::vector<vk::SurfaceFormatKHR>& formats) const
+vk::SurfaceFormatKHR SwapChain::chooseSurfaceFormat(const std::vector<vk::SurfaceFormatKHR>& formats)
 {
     assert(!formats.empty());
     
@@ -111,15 +179,11 @@ vk::PresentModeKHR SwapChain::choosePresentMode(const std::vector<vk::PresentMod
     );
 
 
-    bool is_mailbox_available = std::ranges::any_of( // is any of the elements mailbox(true)
-        modes,
-        [](const auto present_mode)
-        {
-            return present_mode == vk::PresentModeKHR::eMailbox;
-        }
-    );
-    
-    if (is_mailbox_available) return vk::PresentModeKHR::eMailbox;
+    // first supported mode of the profile's preference list
+    for (const auto preferred_mode : getPresentModePreference(presentProfile_))
+    {
+        if (std::ranges::find(modes, preferred_mode) != modes.end()) return preferred_mode;
+    }
 
     return vk::PresentModeKHR::eFifo;
 }
@@ -155,13 +219,6 @@ void SwapChain::createImageViews()
 }
 
 
-void SwapChain::cleanup()
-{
-    imageViews_.clear();
-    swapChain_.clear();
-}
-
-
 vk::Format SwapChain::getFormat() const
 {
     return surfaceFormat_.format;
@@ -179,10 +236,39 @@ uint32_t SwapChain::getImageCount() const
     return static_cast<uint32_t>(images_.size());
 }
 
+
+vk::ImageUsageFlags SwapChain::getImageUsage() const
+{
+    return imageUsage_;
+}
+
+vk::PresentModeKHR SwapChain::getPresentMode() const
+{
+    return presentMode_;
+}
+
+
+PresentProfile SwapChain::getPresentProfile() const
+{
+    return presentProfile_;
+}
+
 const vk::raii::SwapchainKHR& SwapChain::get() const 
 {
     return swapChain_;
 }
+vk::SurfaceKHR SwapChain::getSurface() const
+{
+    return surface_;
+}
+GLFWwindow* SwapChain::getWindow() const
+{
+    return window_;
+}
+const std::vector<vk::Image>& SwapChain::getImages() const
+{
+    return images_;
+}
 const std::vector<vk::raii::ImageView>& SwapChain::getImageViews() const
 {
     return imageViews_;
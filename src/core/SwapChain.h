@@ -4,39 +4,72 @@
 
 #include <GLFW/glfw3.h>
 #include <vulkan/vulkan_raii.hpp>
+#include <optional>
 #include <vector>
 
+#include "PresentPolicy.h"
+#include "RenderTarget.h"
+
 // forward declaring classes
 class VulkanContext;
 
-class SwapChain
+// What recreate() replaced. The presentation engine may still be reading these, so whoever presents
+// keeps them alive until the old presents are known to be done (see Renderer::retireSwapChain()).
+struct RetiredSwapChain
+{
+    vk::raii::SwapchainKHR swapChain = nullptr;
+    std::vector<vk::raii::ImageView> imageViews;
+};
+
+class SwapChain : public RenderTarget
 {
 public:
-    SwapChain(const VulkanContext& context, GLFWwindow* window);
+    // presents to the context's surface, the window the context was created for
+    SwapChain(const VulkanContext& context, GLFWwindow* window, PresentProfile present_profile = PresentProfile::eThroughput);
+
+    // presents to another window from VulkanContext::createWindowSurface(), the swap chain owns the surface.
+    // Renderer::removeSwapChain() before destroying one that frames were presented to
+    SwapChain(const VulkanContext& context, vk::raii::SurfaceKHR&& surface, GLFWwindow* window, PresentProfile present_profile = PresentProfile::eThroughput);
+
+    // the format the swap chain will be created with, lets pipelines compile while it's being created
+    static vk::Format querySurfaceFormat(const VulkanContext& context);
+    static vk::Format querySurfaceFormat(const VulkanContext& context, const vk::raii::SurfaceKHR& surface);
 
     // deleting copy constructures
     SwapChain(const SwapChain&) = delete;
     SwapChain& operator=(const SwapChain&) = delete;
 
     // public member functions
-    void recreate();
+    // creates the new swap chain with oldSwapchain set, no device idle needed
+    [[nodiscard]] auto recreate() -> RetiredSwapChain;
+    void setPresentProfile(PresentProfile present_profile);  // applied on the next recreate()
+
+    // RenderTarget
+    auto acquireNextImage(vk::Semaphore image_available) -> std::optional<uint32_t> override;
+    auto asSwapChain() -> SwapChain* override;
+    auto getFinalLayout() const -> vk::ImageLayout override;  // present source
     
     // accessor functions
-    vk::Format getFormat() const;
-    vk::Extent2D getExtent() const;
-    uint32_t getImageCount() const;
+    vk::Format getFormat() const override;
+    vk::Extent2D getExtent() const override;
+    uint32_t getImageCount() const override;
+    vk::ImageUsageFlags getImageUsage() const override;  // transfer destination too where the surface allows it
+    vk::PresentModeKHR getPresentMode() const;
+    PresentProfile getPresentProfile() const;
 
     auto get() const -> const vk::raii::SwapchainKHR&;
-    auto getImageViews() const -> const std::vector<vk::raii::ImageView>&;
+    vk::SurfaceKHR getSurface() const;
+    GLFWwindow* getWindow() const;
+    auto getImages() const -> const std::vector<vk::Image>& override;
+    auto getImageViews() const -> const std::vector<vk::raii::ImageView>& override;
 
 private:
     // private member functions
-    void create();
+    void create(vk::SwapchainKHR old_swap_chain = nullptr);
     void createImageViews();
-    void cleanup();
 
     // swap chain create helper functions
-    auto chooseSurfaceFormat(const std::vector<vk::SurfaceFormatKHR>& formats) const -> vk::SurfaceFormatKHR;
+    static auto chooseSurfaceFormat(const std::vector<vk::SurfaceFormatKHR>& formats) -> vk::SurfaceFormatKHR;
     auto choosePresentMode(const std::vector<vk::PresentModeKHR>& modes) const -> vk::PresentModeKHR;
     auto chooseExtent(const vk::SurfaceCapabilitiesKHR& capabilities) const -> vk::Extent2D;
     uint32_t getImageCountFrom(const vk::SurfaceCapabilitiesKHR& capabilities) const;
@@ -44,10 +77,15 @@ private:
     // private member variables
     const VulkanContext& context_;
     GLFWwindow* window_;
+    vk::raii::SurfaceKHR ownedSurface_ = nullptr;  // null when presenting to the context's surface
+    vk::SurfaceKHR surface_ = nullptr;
 
-    vk::raii::SwapchainKHR swapChain_ = nullptr;
+    vk::raii::SwapchainKHR swapChain_ = nullptr;  // declared after the surface so it's destroyed first
     std::vector<vk::Image> images_;
     std::vector<vk::raii::ImageView> imageViews_;
     vk::SurfaceFormatKHR surfaceFormat_ = {};
     vk::Extent2D extent_ = {};
+    vk::ImageUsageFlags imageUsage_ = vk::ImageUsageFlagBits::eColorAttachment;
+    PresentProfile presentProfile_ = PresentProfile::eThroughput;
+    vk::PresentModeKHR presentMode_ = vk::PresentModeKHR::eFifo;
 };
\ No newline at end of file
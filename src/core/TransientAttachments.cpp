@@ -0,0 +1,134 @@
+#include "TransientAttachments.h"
+#include "VulkanContext.h"
+#include <array>
+#include <stdexcept>
+
+
+namespace
+{
+    // best first, D16 is the only one every device must support
+    constexpr std::array<vk::Format, 4> DEPTH_FORMAT_CANDIDATES = {
+        vk::Format::eD32Sfloat,
+        vk::Format::eD32SfloatS8Uint,
+        vk::Format::eD24UnormS8Uint,
+        vk::Format::eD16Unorm
+    };
+
+    constexpr std::array<vk::SampleCountFlagBits, 7> SAMPLE_COUNTS = {
+        vk::SampleCountFlagBits::e64,
+        vk::SampleCountFlagBits::e32,
+        vk::SampleCountFlagBits::e16,
+        vk::SampleCountFlagBits::e8,
+        vk::SampleCountFlagBits::e4,
+        vk::SampleCountFlagBits::e2,
+        vk::SampleCountFlagBits::e1
+    };
+}
+
+
+TransientAttachments::TransientAttachments(const TransientAttachmentDesc& desc, vk::ImageView color_view, vk::ImageView depth_view)
+    : desc_(desc), colorView_(color_view), depthView_(depth_view)
+{
+}
+
+
+TransientAttachmentDesc TransientAttachments::selectDesc(
+    const VulkanContext& context,
+    vk::SampleCountFlagBits max_sample_count,
+    bool has_depth
+)
+{
+    const vk::raii::PhysicalDevice& physical_device = context.getPhysicalDevice();
+    TransientAttachmentDesc desc{};
+
+    if (has_depth)
+    {
+        for (vk::Format format : DEPTH_FORMAT_CANDIDATES)
+        {
+            vk::FormatFeatureFlags features = physical_device.getFormatProperties(format).optimalTilingFeatures;
+            if (features & vk::FormatFeatureFlagBits::eDepthStencilAttachment)
+            {
+                desc.depthFormat = format;
+                break;
+            }
+        }
+        if (desc.depthFormat == vk::Format::eUndefined)
+        {
+            throw std::runtime_error("no supported depth attachment format");
+        }
+    }
+
+    // the MSAA color and depth images are rendered together, both must support the count
+    const vk::PhysicalDeviceLimits& limits = physical_device.getProperties().limits;
+    vk::SampleCountFlags supported = limits.framebufferColorSampleCounts;
+    if (has_depth) supported &= limits.framebufferDepthSampleCounts;
+
+    for (vk::SampleCountFlagBits sample_count : SAMPLE_COUNTS)
+    {
+        if (static_cast<uint32_t>(sample_count) <= static_cast<uint32_t>(max_sample_count) && (supported & sample_count))
+        {
+            desc.sampleCount = sample_count;
+            break;
+        }
+    }
+
+    return desc;
+}
+
+
+vk::RenderingAttachmentInfo TransientAttachments::getColorAttachmentInfo(vk::ImageView target_view, vk::ClearColorValue clear_color) const
+{
+    if (!isMultisampled())
+    {
+        return vk::RenderingAttachmentInfo{
+            .imageView = target_view,
+            .imageLayout = vk::ImageLayout::eColorAttachmentOptimal,
+            .loadOp = vk::AttachmentLoadOp::eClear,
+            .storeOp = vk::AttachmentStoreOp::eStore,
+            .clearValue = {.color = clear_color}
+        };
+    }
+
+    // the samples never leave tile memory, only the resolved image is written out
+    return vk::RenderingAttachmentInfo{
+        .imageView = colorView_,
+        .imageLayout = vk::ImageLayout::eColorAttachmentOptimal,
+        .resolveMode = vk::ResolveModeFlagBits::eAverage,
+        .resolveImageView = target_view,
+        .resolveImageLayout = vk::ImageLayout::eColorAttachmentOptimal,
+        .loadOp = vk::AttachmentLoadOp::eClear,
+        .storeOp = vk::AttachmentStoreOp::eDontCare,
+        .clearValue = {.color = clear_color}
+    };
+}
+
+
+vk::RenderingAttachmentInfo TransientAttachments::getDepthAttachmentInfo() const
+{
+    return vk::RenderingAttachmentInfo{
+        .imageView = depthView_,
+        .imageLayout = vk::ImageLayout::eDepthStencilAttachmentOptimal,
+        .loadOp = vk::AttachmentLoadOp::eClear,
+        .storeOp = vk::AttachmentStoreOp::eDontCare,
+        .clearValue = {.depthStencil = {.depth = DEPTH_CLEAR_VALUE, .stencil = 0}}
+    };
+}
+
+
+// Accessor functions
+const TransientAttachmentDesc& TransientAttachments::getDesc() const
+{
+    return desc_;
+}
+
+
+bool TransientAttachments::hasDepth() const
+{
+    return desc_.depthFormat != vk::Format::eUndefined;
+}
+
+
+bool TransientAttachments::isMultisampled() const
+{
+    return desc_.sampleCount != vk::SampleCountFlagBits::e1;
+}
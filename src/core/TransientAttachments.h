@@ -0,0 +1,57 @@
+#pragma once
+
+#include <vulkan/vulkan_raii.hpp>
+#include <cstdint>
+
+// forward declaring classes
+class VulkanContext;
+
+// What the transient attachments look like. Pipelines rendering with them must be built for the same
+// sample count and depth format (GraphicsPipeline takes the desc too).
+struct TransientAttachmentDesc
+{
+    vk::SampleCountFlagBits sampleCount = vk::SampleCountFlagBits::e1;  // e1: no MSAA image, color goes straight to the target
+    vk::Format depthFormat = vk::Format::eUndefined;                    // eUndefined: no depth attachment
+
+    bool isEnabled() const { return sampleCount != vk::SampleCountFlagBits::e1 || depthFormat != vk::Format::eUndefined; }
+    bool operator==(const TransientAttachmentDesc&) const = default;
+};
+
+
+// Depth and multisampled color attachments that only live for the length of one rendering scope.
+// They're cleared on load and never stored: MSAA color is resolved into the target inside the
+// vk::RenderingAttachmentInfo, depth is dropped.
+//
+// The images are transients of the Renderer's RenderGraph, created for every frame slot and sized to the
+// target. The graph gives images that are only ever attachments eTransientAttachment usage and lazily
+// allocated memory where the device has it, so tiled GPUs keep them in tile memory and never back them
+// with real memory or spend bandwidth on them. A new target extent or format changes the graph's topology,
+// which recompiles it and retires the old images. This only holds the frame's views.
+// Not thread safe.
+class TransientAttachments
+{
+public:
+    // color_view only with MSAA, depth_view only with a depth format, both must stay valid while recording
+    TransientAttachments(const TransientAttachmentDesc& desc, vk::ImageView color_view, vk::ImageView depth_view);
+
+    // highest sample count up to max_sample_count that color and depth both support, and the first
+    // supported depth format when has_depth is set
+    static auto selectDesc(const VulkanContext& context, vk::SampleCountFlagBits max_sample_count, bool has_depth) -> TransientAttachmentDesc;
+
+    // renders into the MSAA image and resolves into target_view on store, or straight into target_view
+    // without MSAA. target_view and the images must be in attachment layout
+    auto getColorAttachmentInfo(vk::ImageView target_view, vk::ClearColorValue clear_color) const -> vk::RenderingAttachmentInfo;
+    auto getDepthAttachmentInfo() const -> vk::RenderingAttachmentInfo;  // only valid with a depth format
+
+    // accessor functions
+    auto getDesc() const -> const TransientAttachmentDesc&;
+    bool hasDepth() const;
+    bool isMultisampled() const;
+
+    static constexpr float DEPTH_CLEAR_VALUE = 1.0f;  // far plane, matches the default eLess depth compare
+
+private:
+    TransientAttachmentDesc desc_;
+    vk::ImageView colorView_;
+    vk::ImageView depthView_;
+};
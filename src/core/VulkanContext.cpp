@@ -1,25 +1,121 @@
 #include "VulkanContext.h"
+#include "DeviceSelectionCache.h"
+#include "utils/StartupTimer.h"
+#include "utils/Trace.h"
+#include <future>
 #include <stdexcept>
 #include <iostream>
 #include <cstring>
+#include <cstdlib>
+#include <cctype>
+#include <limits>
+#include <algorithm>
 
 
 const std::vector<const char*> VulkanContext::REQUIRED_DEVICE_EXTENSIONS = {vk::KHRSwapchainExtensionName};
+const std::vector<const char*> VulkanContext::OPTIONAL_DEVICE_EXTENSIONS = {
+    vk::EXTMemoryBudgetExtensionName,
+    vk::EXTExtendedDynamicState3ExtensionName,
+    vk::EXTGraphicsPipelineLibraryExtensionName,
+    vk::KHRPipelineLibraryExtensionName  // graphics_pipeline_library depends on it
+};
+const std::vector<const char*> VulkanContext::OPTIONAL_PRESENT_DEVICE_EXTENSIONS = {
+    vk::KHRPresentIdExtensionName,
+    vk::KHRPresentWaitExtensionName,
+    vk::EXTSwapchainMaintenance1ExtensionName
+};
+// swapchain_maintenance1 needs surface_maintenance1 on the instance, which needs get_surface_capabilities2
+const std::vector<const char*> VulkanContext::OPTIONAL_INSTANCE_EXTENSIONS = {
+    vk::KHRGetSurfaceCapabilities2ExtensionName,
+    vk::EXTSurfaceMaintenance1ExtensionName
+};
 const std::vector<const char*> VulkanContext::VALIDATION_LAYERS = {"VK_LAYER_KHRONOS_validation"};
 
 
 VulkanContext::VulkanContext(GLFWwindow* window)
+    : isHeadless_(window == nullptr), validationSettings_(getValidationSettingsFromEnvironment())
 {
-    createInstance();
-    setupDebugMessenger();
+    TRACE_SCOPE("VulkanContext");
+    if (validationSettings_.isEnabled)
+    {
+        debugMessageSink_ = std::make_unique<DebugMessageSink>();  // before the instance, it reports creation too
+    }
+    {
+        StartupStage stage("create instance");
+        createInstance();
+        setupDebugMessenger();
+    }
+    createSurface(window);
+    createDevice();
+}
+
+
+VulkanContext::VulkanContext(const std::function<GLFWwindow*()>& create_window)
+    : isHeadless_(false), validationSettings_(getValidationSettingsFromEnvironment())
+{
+    TRACE_SCOPE("VulkanContext");
+    if (validationSettings_.isEnabled)
+    {
+        debugMessageSink_ = std::make_unique<DebugMessageSink>();
+    }
+
+    // loading the driver and layers takes about as long as opening the window, GLFW wants the window on
+    // this thread but the instance can be created anywhere
+    std::future<void> instance_created = std::async(std::launch::async, [this]()
+    {
+        TRACE_THREAD_NAME("instance");
+        StartupStage stage("create instance");
+        createInstance();
+        setupDebugMessenger();
+    });
+
+    GLFWwindow* window = nullptr;
+    {
+        StartupStage stage("create window");
+        window = create_window();
+    }
+    instance_created.get();  // rethrows what createInstance() threw
+    if (!window)
+    {
+        throw std::runtime_error("failed to create window");
+    }
+
     createSurface(window);
-    pickPhysicalDevice();
-    createLogicalDevice();
+    createDevice();
+}
+
+
+void VulkanContext::createDevice()
+{
+    {
+        StartupStage stage("pick physical device");
+        pickPhysicalDevice();
+    }
+    {
+        StartupStage stage("create logical device");
+        createLogicalDevice();
+    }
+
+    // reading and validating the pipeline cache blob is the slow one, it overlaps the other three
+    std::future<void> pipeline_cache_created = std::async(std::launch::async, [this]()
+    {
+        TRACE_THREAD_NAME("pipeline cache");
+        StartupStage stage("load pipeline cache");
+        createPipelineCache();
+    });
+    {
+        StartupStage stage("create device objects");
+        createMemoryAllocator();
+        createBindlessHeap();
+        createShaderModuleCache();
+    }
+    pipeline_cache_created.get();
 }
 
 
 void VulkanContext::createInstance()
 {
+    TRACE_FUNCTION();
     constexpr vk::ApplicationInfo app_info{
         .pApplicationName = "Vulkan Engine",
         .applicationVersion = VK_MAKE_VERSION(1,0,0),
@@ -29,31 +125,107 @@ void VulkanContext::createInstance()
     };
 
     // geting required extesnions
-    const std::vector<const char*> required_extensions = getRequiredInstanceExtensions();  
+    const std::vector<const char*> required_extensions = getRequiredInstanceExtensions(isHeadless_, validationSettings_.isEnabled);
     std::vector<vk::ExtensionProperties> extension_properties = context_.enumerateInstanceExtensionProperties();
 
     std::vector<vk::LayerProperties> layer_properties = context_.enumerateInstanceLayerProperties();
 
     // checking extensions and validation layers support
     checkExtensionSupport(required_extensions, extension_properties);
+
+    // the optional ones are all or nothing, they depend on each other (and are only about surfaces)
+    enabledInstanceExtensions_ = required_extensions;
+    bool optional_extensions_supported = !isHeadless_ && std::ranges::all_of(
+        OPTIONAL_INSTANCE_EXTENSIONS,
+        [&extension_properties](const char* optional_extension)
+        {
+            return std::ranges::any_of(
+                extension_properties,
+                [optional_extension](const vk::ExtensionProperties& extension_property)
+                {
+                    return strcmp(extension_property.extensionName, optional_extension) == 0;
+                }
+            );
+        }
+    );
+    if (optional_extensions_supported)
+    {
+        enabledInstanceExtensions_.insert(enabledInstanceExtensions_.end(), OPTIONAL_INSTANCE_EXTENSIONS.begin(), OPTIONAL_INSTANCE_EXTENSIONS.end());
+    }
     
-    if (ENABLE_VALIDATION_LAYERS)
+    vk::DebugUtilsMessengerCreateInfoEXT debug_messenger_create_info = makeDebugMessengerCreateInfo(debugMessageSink_.get());
+    vk::LayerSettingsCreateInfoEXT layer_settings_create_info{};
+    std::array<vk::LayerSettingEXT, 4> layer_settings;
+    std::array<vk::Bool32, 4> layer_setting_values = {
+        vk::True,
+        validationSettings_.isGpuAssisted ? vk::True : vk::False,
+        validationSettings_.isSynchronization ? vk::True : vk::False,
+        validationSettings_.isBestPractices ? vk::True : vk::False
+    };
+    if (validationSettings_.isEnabled)
     {
         checkValidationLayersSupport(VALIDATION_LAYERS, layer_properties);
+
+        // the layer implements VK_EXT_layer_settings itself, so it's listed under the layer and not the loader
+        const std::string validation_layer_name = VALIDATION_LAYERS[0];
+        std::vector<vk::ExtensionProperties> layer_extension_properties =
+            context_.enumerateInstanceExtensionProperties(validation_layer_name);
+        bool layer_settings_supported = std::ranges::any_of(
+            layer_extension_properties,
+            [](const vk::ExtensionProperties& extension_property)
+            {
+                return strcmp(extension_property.extensionName, vk::EXTLayerSettingsExtensionName) == 0;
+            }
+        );
+
+        if (layer_settings_supported)
+        {
+            constexpr std::array<const char*, 4> setting_names = {
+                "validate_core",
+                "gpuav_enable",
+                "validate_sync",
+                "validate_best_practices"
+            };
+            for (size_t i = 0; i < layer_settings.size(); i++)
+            {
+                layer_settings[i] = vk::LayerSettingEXT{
+                    .pLayerName = VALIDATION_LAYERS[0],
+                    .pSettingName = setting_names[i],
+                    .type = vk::LayerSettingTypeEXT::eBool32,
+                    .valueCount = 1,
+                    .pValues = &layer_setting_values[i]
+                };
+            }
+            layer_settings_create_info.pNext = &debug_messenger_create_info;
+            layer_settings_create_info.settingCount = static_cast<uint32_t>(layer_settings.size());
+            layer_settings_create_info.pSettings = layer_settings.data();
+            enabledInstanceExtensions_.push_back(vk::EXTLayerSettingsExtensionName);
+        }
+        else
+        {
+            std::cerr << "validation layer has no " << vk::EXTLayerSettingsExtensionName << ", using its default settings\n";
+        }
+        std::cout << "validation: " << validationSettings_.toString() << "\n";
     }
-    
+
     vk::InstanceCreateInfo create_info{
         .pApplicationInfo = &app_info,
-        .enabledExtensionCount = static_cast<uint32_t>(required_extensions.size()),
-        .ppEnabledExtensionNames = required_extensions.data()
+        .enabledExtensionCount = static_cast<uint32_t>(enabledInstanceExtensions_.size()),
+        .ppEnabledExtensionNames = enabledInstanceExtensions_.data()
     };
 
-    if (ENABLE_VALIDATION_LAYERS)
+    if (validationSettings_.isEnabled)
     {
         create_info.enabledLayerCount = static_cast<uint32_t>(VALIDATION_LAYERS.size());
         create_info.ppEnabledLayerNames = VALIDATION_LAYERS.data();
-        vk::DebugUtilsMessengerCreateInfoEXT debug_messenger_create_info = makeDebugMessengerCreateInfo();
-        create_info.pNext = &debug_messenger_create_info;
+        if (layer_settings_create_info.settingCount > 0)
+        {
+            create_info.pNext = &layer_settings_create_info;
+        }
+        else
+        {
+            create_info.pNext = &debug_messenger_create_info;
+        }
     }
 
     instance_ = vk::raii::Instance(context_, create_info);
@@ -61,14 +233,18 @@ void VulkanContext::createInstance()
 }
 
 
-std::vector<const char*> VulkanContext::getRequiredInstanceExtensions()
+std::vector<const char*> VulkanContext::getRequiredInstanceExtensions(bool is_headless, bool is_validation_enabled)
 {
-    uint32_t extension_count = 0;
-    const char** extension_array = glfwGetRequiredInstanceExtensions(&extension_count); // const char** is a c style array.
-    // converting const char* array into a vector using constructor std::vector<T>(first, last)
-    std::vector<const char*> extensions(extension_array, extension_array + extension_count); 
+    std::vector<const char*> extensions;
+    if (!is_headless)
+    {
+        uint32_t extension_count = 0;
+        const char** extension_array = glfwGetRequiredInstanceExtensions(&extension_count); // const char** is a c style array.
+        // converting const char* array into a vector using constructor std::vector<T>(first, last)
+        extensions = std::vector<const char*>(extension_array, extension_array + extension_count);
+    }
     
-    if (ENABLE_VALIDATION_LAYERS)
+    if (is_validation_enabled)
     {
         extensions.push_back(vk::EXTDebugUtilsExtensionName);
     }
@@ -134,7 +310,7 @@ bool VulkanContext::checkValidationLayersSupport(
 }
 
 
-vk::DebugUtilsMessengerCreateInfoEXT VulkanContext::makeDebugMessengerCreateInfo()
+vk::DebugUtilsMessengerCreateInfoEXT VulkanContext::makeDebugMessengerCreateInfo(DebugMessageSink* debug_message_sink)
 {
     vk::DebugUtilsMessageSeverityFlagsEXT  severity_flags(
         vk::DebugUtilsMessageSeverityFlagBitsEXT::eWarning | 
@@ -150,7 +326,8 @@ vk::DebugUtilsMessengerCreateInfoEXT VulkanContext::makeDebugMessengerCreateInfo
     vk::DebugUtilsMessengerCreateInfoEXT debug_messenger_create_info{
         .messageSeverity = severity_flags,
         .messageType = message_type_flags,
-        .pfnUserCallback = debugCallback
+        .pfnUserCallback = debugCallback,
+        .pUserData = debug_message_sink
     };
 
     return debug_messenger_create_info;
@@ -164,12 +341,11 @@ VKAPI_ATTR VkBool32 VKAPI_CALL VulkanContext::debugCallback(
     void* user_data
 )
 {
-    if (
-        message_severity == vk::DebugUtilsMessageSeverityFlagBitsEXT::eError || 
-        message_severity == vk::DebugUtilsMessageSeverityFlagBitsEXT::eWarning
-    )
+    // may run on any thread in the middle of a driver call, the sink only copies and counts
+    auto* debug_message_sink = static_cast<DebugMessageSink*>(user_data);
+    if (debug_message_sink && callback_data)
     {
-        std::cerr << "validation layer: type " <<  vk::to_string(message_type) << " msg: " << callback_data->pMessage << "\n";
+        debug_message_sink->push(message_severity, message_type, *callback_data);
     }
 
     return vk::False;
@@ -178,15 +354,44 @@ VKAPI_ATTR VkBool32 VKAPI_CALL VulkanContext::debugCallback(
 
 void VulkanContext::setupDebugMessenger()
 {
-    if constexpr (ENABLE_VALIDATION_LAYERS)
+    TRACE_FUNCTION();
+    if (validationSettings_.isEnabled)
     {
-        vk::DebugUtilsMessengerCreateInfoEXT debug_messenger_create_info = makeDebugMessengerCreateInfo();   
+        vk::DebugUtilsMessengerCreateInfoEXT debug_messenger_create_info = makeDebugMessengerCreateInfo(debugMessageSink_.get());
         debugMessenger_ = instance_.createDebugUtilsMessengerEXT(debug_messenger_create_info);
     }
 }
 
 
 void VulkanContext::createSurface(GLFWwindow* window)
+{
+    TRACE_FUNCTION();
+    if (isHeadless_) return;  // nothing to present to, surface_ stays null
+
+    surface_ = createGlfwSurface(window);
+}
+
+
+vk::raii::SurfaceKHR VulkanContext::createWindowSurface(GLFWwindow* window) const
+{
+    TRACE_FUNCTION();
+    if (isHeadless_)
+    {
+        throw std::runtime_error("a headless context can't present to a window");
+    }
+
+    // the device and its graphics family were picked for the first surface, every other one has to make do
+    vk::raii::SurfaceKHR surface = createGlfwSurface(window);
+    if (!physicalDevice_.getSurfaceSupportKHR(queueFamilyIndex_, *surface))
+    {
+        throw std::runtime_error("the graphics queue family can't present to this window's surface");
+    }
+
+    return surface;
+}
+
+
+vk::raii::SurfaceKHR VulkanContext::createGlfwSurface(GLFWwindow* window) const
 {
     VkSurfaceKHR surface = VK_NULL_HANDLE;
     if (
@@ -201,7 +406,7 @@ void VulkanContext::createSurface(GLFWwindow* window)
         throw std::runtime_error("failed to create window surface");
     }
 
-    surface_ = vk::raii::SurfaceKHR(instance_, surface);
+    return vk::raii::SurfaceKHR(instance_, surface);
 }
 
 
@@ -209,7 +414,7 @@ bool VulkanContext::checkDeviceExtensionSupport(const vk::raii::PhysicalDevice&
 {
     std::vector<vk::ExtensionProperties> available_device_extensions = physical_device.enumerateDeviceExtensionProperties();
 
-    for (auto required_extension : REQUIRED_DEVICE_EXTENSIONS)
+    for (auto required_extension : getRequiredDeviceExtensions())
     {
         bool required_extension_found = false;
         for (auto available_extension : available_device_extensions)
@@ -235,7 +440,42 @@ std::optional<uint32_t> VulkanContext::findQueueFamily(const vk::raii::PhysicalD
 
     for (uint32_t i = 0; i < queue_families.size(); i++ )
     {
-        if (!!(queue_families[i].queueFlags & vk::QueueFlagBits::eGraphics) && physical_device.getSurfaceSupportKHR(i, *surface_))
+        // headless there is no surface, any graphics family will do
+        bool supports_present = isHeadless_ || physical_device.getSurfaceSupportKHR(i, *surface_);
+        if (!!(queue_families[i].queueFlags & vk::QueueFlagBits::eGraphics) && supports_present)
+        {
+            return i;
+        }
+    }
+    return std::nullopt;
+}
+
+std::optional<uint32_t> VulkanContext::findTransferQueueFamily(const vk::raii::PhysicalDevice& physical_device) const
+{
+    std::vector<vk::QueueFamilyProperties> queue_families = physical_device.getQueueFamilyProperties();
+
+    // a family with transfer but neither graphics nor compute is the dedicated copy engine
+    for (uint32_t i = 0; i < queue_families.size(); i++ )
+    {
+        vk::QueueFlags flags = queue_families[i].queueFlags;
+        if (!!(flags & vk::QueueFlagBits::eTransfer) && !(flags & vk::QueueFlagBits::eGraphics) && !(flags & vk::QueueFlagBits::eCompute))
+        {
+            return i;
+        }
+    }
+    return std::nullopt;
+}
+
+
+std::optional<uint32_t> VulkanContext::findComputeQueueFamily(const vk::raii::PhysicalDevice& physical_device) const
+{
+    std::vector<vk::QueueFamilyProperties> queue_families = physical_device.getQueueFamilyProperties();
+
+    // compute without graphics runs next to the graphics queue instead of behind it
+    for (uint32_t i = 0; i < queue_families.size(); i++ )
+    {
+        vk::QueueFlags flags = queue_families[i].queueFlags;
+        if (!!(flags & vk::QueueFlagBits::eCompute) && !(flags & vk::QueueFlagBits::eGraphics))
         {
             return i;
         }
@@ -243,20 +483,40 @@ std::optional<uint32_t> VulkanContext::findQueueFamily(const vk::raii::PhysicalD
     return std::nullopt;
 }
 
+std::vector<const char*> VulkanContext::getRequiredDeviceExtensions() const
+{
+    // the swap chain extension is the only required one, and only when there's a window
+    return isHeadless_ ? std::vector<const char*>{} : REQUIRED_DEVICE_EXTENSIONS;
+}
+
+
 bool VulkanContext::isDeviceSuitable(const vk::raii::PhysicalDevice& physical_device) const
 {
     if (!(physical_device.getProperties().apiVersion >= vk::ApiVersion14)) return false;
 
-    if (!findQueueFamily(physical_device)) return false;
-
     if (!checkDeviceExtensionSupport(physical_device)) return false;
     
     // checking for devise support for required features
     auto features = physical_device.template getFeatures2< vk::PhysicalDeviceFeatures2, 
+                                                           vk::PhysicalDeviceVulkan12Features, 
                                                            vk::PhysicalDeviceVulkan13Features, 
                                                            vk::PhysicalDeviceExtendedDynamicStateFeaturesEXT >();
 
-    bool supports_required_features = features.template get<vk::PhysicalDeviceVulkan13Features>().dynamicRendering &&
+    const auto& vulkan12_features = features.template get<vk::PhysicalDeviceVulkan12Features>();
+    // descriptor indexing subset the BindlessHeap relies on
+    bool supports_bindless = vulkan12_features.descriptorIndexing &&
+                             vulkan12_features.runtimeDescriptorArray &&
+                             vulkan12_features.descriptorBindingPartiallyBound &&
+                             vulkan12_features.descriptorBindingUpdateUnusedWhilePending &&
+                             vulkan12_features.descriptorBindingSampledImageUpdateAfterBind &&
+                             vulkan12_features.descriptorBindingStorageBufferUpdateAfterBind &&
+                             vulkan12_features.shaderSampledImageArrayNonUniformIndexing &&
+                             vulkan12_features.shaderStorageBufferArrayNonUniformIndexing;
+
+    bool supports_required_features = vulkan12_features.timelineSemaphore &&
+                                      supports_bindless &&
+                                      features.template get<vk::PhysicalDeviceVulkan13Features>().synchronization2 &&
+                                      features.template get<vk::PhysicalDeviceVulkan13Features>().dynamicRendering &&
                                       features.template get<vk::PhysicalDeviceExtendedDynamicStateFeaturesEXT>().extendedDynamicState;
     
     if (!supports_required_features) return false;
@@ -265,53 +525,508 @@ bool VulkanContext::isDeviceSuitable(const vk::raii::PhysicalDevice& physical_de
 }
 
 
+std::string VulkanContext::formatDeviceUuid(const vk::raii::PhysicalDevice& physical_device)
+{
+    auto properties = physical_device.getProperties2<vk::PhysicalDeviceProperties2, vk::PhysicalDeviceIDProperties>();
+    const auto& device_uuid = properties.get<vk::PhysicalDeviceIDProperties>().deviceUUID;
+
+    static constexpr char HEX_DIGITS[] = "0123456789abcdef";
+    std::string uuid;
+    for (uint8_t byte : device_uuid)
+    {
+        uuid += HEX_DIGITS[byte >> 4];
+        uuid += HEX_DIGITS[byte & 0x0f];
+    }
+    return uuid;
+}
+
+
+bool VulkanContext::matchesDeviceOverride(const vk::raii::PhysicalDevice& physical_device, const std::string& device_override)
+{
+    // UUIDs are accepted with or without dashes, in any case
+    std::string normalized_override;
+    for (char c : device_override)
+    {
+        if (c != '-') normalized_override += static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+    }
+    if (normalized_override == formatDeviceUuid(physical_device)) return true;
+
+    // otherwise a case sensitive substring of the device name, "RTX" or "Intel" is enough
+    std::string device_name = physical_device.getProperties().deviceName;
+    return device_name.find(device_override) != std::string::npos;
+}
+
+
+VulkanContext::DeviceRating VulkanContext::rateDevice(const vk::raii::PhysicalDevice& physical_device) const
+{
+    DeviceRating rating;
+    vk::PhysicalDeviceProperties properties = physical_device.getProperties();
+
+    // device type dominates the score, an integrated GPU only wins when there is nothing discrete
+    switch (properties.deviceType)
+    {
+        case vk::PhysicalDeviceType::eDiscreteGpu:
+            rating.score += 100000;
+            break;
+        case vk::PhysicalDeviceType::eIntegratedGpu:
+            rating.score += 10000;
+            break;
+        case vk::PhysicalDeviceType::eVirtualGpu:
+            rating.score += 5000;
+            break;
+        case vk::PhysicalDeviceType::eCpu:
+            rating.score += 100;
+            break;
+        default:
+            break;
+    }
+    rating.reasons.push_back(vk::to_string(properties.deviceType));
+
+    // one point per 64 MiB of the largest device local heap (a 8 GiB card adds 128)
+    vk::PhysicalDeviceMemoryProperties memory_properties = physical_device.getMemoryProperties();
+    vk::DeviceSize device_local_heap_size = 0;
+    for (uint32_t i = 0; i < memory_properties.memoryHeapCount; i++)
+    {
+        if (!!(memory_properties.memoryHeaps[i].flags & vk::MemoryHeapFlagBits::eDeviceLocal))
+        {
+            device_local_heap_size = std::max(device_local_heap_size, memory_properties.memoryHeaps[i].size);
+        }
+    }
+    rating.score += static_cast<int64_t>(device_local_heap_size / (64ull << 20));
+    rating.reasons.push_back(std::to_string(device_local_heap_size >> 20) + " MiB VRAM");
+
+    // queue topology, dedicated families let uploads and compute overlap rendering
+    if (findTransferQueueFamily(physical_device))
+    {
+        rating.score += 500;
+        rating.reasons.push_back("dedicated transfer queue");
+    }
+    if (findComputeQueueFamily(physical_device))
+    {
+        rating.score += 500;
+        rating.reasons.push_back("async compute queue");
+    }
+
+    // optional features, nice to have but not required by isDeviceSuitable
+    auto features = physical_device.template getFeatures2< vk::PhysicalDeviceFeatures2,
+                                                           vk::PhysicalDeviceVulkan12Features >();
+    const auto& vulkan12_features = features.template get<vk::PhysicalDeviceVulkan12Features>();
+    if (vulkan12_features.bufferDeviceAddress)
+    {
+        rating.score += 100;
+        rating.reasons.push_back("buffer device address");
+    }
+
+    // required limits, a device below them is ranked but never picked
+    if (properties.limits.maxImageDimension2D < REQUIRED_MAX_IMAGE_DIMENSION_2D)
+    {
+        rating.meetsRequiredLimits = false;
+        rating.reasons.push_back("maxImageDimension2D " + std::to_string(properties.limits.maxImageDimension2D) + " too small");
+    }
+    if (properties.limits.maxPushConstantsSize < REQUIRED_MAX_PUSH_CONSTANTS_SIZE)
+    {
+        rating.meetsRequiredLimits = false;
+        rating.reasons.push_back("maxPushConstantsSize " + std::to_string(properties.limits.maxPushConstantsSize) + " too small");
+    }
+
+    return rating;
+}
+
+
 void VulkanContext::pickPhysicalDevice()
 {
+    TRACE_FUNCTION();
     std::vector<vk::raii::PhysicalDevice> physical_devices = instance_.enumeratePhysicalDevices();
-    for (auto& device : physical_devices)
+
+    const char* device_override_env = std::getenv(DEVICE_OVERRIDE_ENV);
+    std::string device_override = device_override_env ? device_override_env : "";
+
+    // an override always ranks, it's there to pick something other than what the ranking (and so the cache) says
+    DeviceSelectionCache device_selection_cache = DeviceSelectionCache(DEVICE_CACHE_FILE);
+    uint64_t device_fingerprint = DeviceSelectionCache::computeFingerprint(physical_devices);
+    std::optional<DeviceSelection> cached_selection;
+    if (device_override.empty())
     {
-        if (isDeviceSuitable(device))
+        cached_selection = device_selection_cache.load(device_fingerprint, isHeadless_);
+    }
+
+    bool is_cached = cached_selection && selectCachedDevice(physical_devices, *cached_selection);
+    if (!is_cached)
+    {
+        rankPhysicalDevices(physical_devices, device_override);
+        if (device_override.empty())
+        {
+            // a failed save only costs the ranking next time
+            try
+            {
+                device_selection_cache.save(device_fingerprint, isHeadless_, DeviceSelection{
+                    .deviceUuid = formatDeviceUuid(physicalDevice_),
+                    .queueFamilyIndex = queueFamilyIndex_,
+                    .transferQueueFamilyIndex = transferQueueFamilyIndex_,
+                    .computeQueueFamilyIndex = computeQueueFamilyIndex_
+                });
+            }
+            catch (const std::exception& e)
+            {
+                std::cerr << "device cache: failed to save " << DEVICE_CACHE_FILE << ": " << e.what() << "\n";
+            }
+        }
+    }
+
+    std::cout << "Device found" << (is_cached ? " (cached)" : "") << ": " << physicalDevice_.getProperties().deviceName << " index: " << queueFamilyIndex_
+              << " transfer: " << (transferQueueFamilyIndex_ ? std::to_string(*transferQueueFamilyIndex_) : "shared")
+              << " compute: " << (computeQueueFamilyIndex_ ? std::to_string(*computeQueueFamilyIndex_) : "shared") << "\n";
+}
+
+
+bool VulkanContext::selectCachedDevice(
+    const std::vector<vk::raii::PhysicalDevice>& physical_devices,
+    const DeviceSelection& selection
+)
+{
+    for (const vk::raii::PhysicalDevice& device : physical_devices)
+    {
+        if (formatDeviceUuid(device) != selection.deviceUuid) continue;
+
+        // the surface is new every run, the cached family has to present to this one too
+        uint32_t queue_family_count = static_cast<uint32_t>(device.getQueueFamilyProperties().size());
+        if (selection.queueFamilyIndex >= queue_family_count) return false;
+        if (!isHeadless_ && !device.getSurfaceSupportKHR(selection.queueFamilyIndex, *surface_)) return false;
+
+        physicalDevice_ = device;
+        queueFamilyIndex_ = selection.queueFamilyIndex;
+        transferQueueFamilyIndex_ = selection.transferQueueFamilyIndex;
+        computeQueueFamilyIndex_ = selection.computeQueueFamilyIndex;
+        return true;
+    }
+    return false;
+}
+
+
+void VulkanContext::rankPhysicalDevices(
+    const std::vector<vk::raii::PhysicalDevice>& physical_devices,
+    const std::string& device_override
+)
+{
+    std::optional<size_t> best_device_index;
+    std::optional<uint32_t> best_queue_family_index;
+    int64_t best_score = 0;
+    bool override_matched = false;
+
+    for (size_t i = 0; i < physical_devices.size(); i++)
+    {
+        const vk::raii::PhysicalDevice& device = physical_devices[i];
+        std::string device_name = device.getProperties().deviceName;
+
+        // looked up once and kept for the winner
+        std::optional<uint32_t> queue_family_index = findQueueFamily(device);
+        if (!queue_family_index || !isDeviceSuitable(device))
         {
-            physicalDevice_ = device;
-            queueFamilyIndex_ = *findQueueFamily(device);
-            std::cout << "Device found: " << physicalDevice_.getProperties().deviceName << " index: " << queueFamilyIndex_ << "\n";
-            return;
+            std::cout << "Device " << device_name << ": not suitable (API version, queues, extensions or features)\n";
+            continue;
         }
+
+        DeviceRating rating = rateDevice(device);
+        if (!rating.meetsRequiredLimits)
+        {
+            rating.score = 0;
+        }
+
+        // an explicit override beats any score, as long as the device can run us at all
+        if (!device_override.empty() && matchesDeviceOverride(device, device_override))
+        {
+            if (rating.meetsRequiredLimits)
+            {
+                rating.score = std::numeric_limits<int64_t>::max();
+                rating.reasons.push_back(std::string("selected by ") + DEVICE_OVERRIDE_ENV);
+                override_matched = true;
+            }
+            else
+            {
+                std::cerr << DEVICE_OVERRIDE_ENV << "=" << device_override << " ignored for " << device_name
+                          << ", it's below the required limits\n";
+            }
+        }
+
+        std::cout << "Device " << device_name << " (" << formatDeviceUuid(device) << "): score " << rating.score << " [";
+        for (size_t r = 0; r < rating.reasons.size(); r++)
+        {
+            std::cout << (r > 0 ? ", " : "") << rating.reasons[r];
+        }
+        std::cout << "]\n";
+
+        if (rating.score > 0 && (!best_device_index || rating.score > best_score))
+        {
+            best_device_index = i;
+            best_queue_family_index = queue_family_index;
+            best_score = rating.score;
+        }
+    }
+
+    if (!device_override.empty() && !override_matched)
+    {
+        std::cerr << DEVICE_OVERRIDE_ENV << "=" << device_override << " matched no suitable device, using the ranking\n";
+    }
+
+    if (!best_device_index)
+    {
+        throw std::runtime_error("failed to find a suitable GPU");
     }
 
-    throw std::runtime_error("failed to find a suitable GPU");
+    physicalDevice_ = physical_devices[*best_device_index];
+    queueFamilyIndex_ = *best_queue_family_index;
+    transferQueueFamilyIndex_ = findTransferQueueFamily(physicalDevice_);
+    computeQueueFamilyIndex_ = findComputeQueueFamily(physicalDevice_);
 }
 
 void VulkanContext::createLogicalDevice()
 {
+    TRACE_FUNCTION();
     // query for Vulkan 1.4 features
     vk::StructureChain<
                         vk::PhysicalDeviceFeatures2, 
+                        vk::PhysicalDeviceVulkan12Features, 
                         vk::PhysicalDeviceVulkan13Features, 
-                        vk::PhysicalDeviceExtendedDynamicStateFeaturesEXT
+                        vk::PhysicalDeviceExtendedDynamicStateFeaturesEXT,
+                        vk::PhysicalDevicePresentIdFeaturesKHR,
+                        vk::PhysicalDevicePresentWaitFeaturesKHR,
+                        vk::PhysicalDeviceSwapchainMaintenance1FeaturesEXT,
+                        vk::PhysicalDeviceExtendedDynamicState3FeaturesEXT,
+                        vk::PhysicalDeviceGraphicsPipelineLibraryFeaturesEXT
                     > feature_chain = {
 		    {},                                   // vk::PhysicalDeviceFeatures2
-		    {.dynamicRendering = true},           // vk::PhysicalDeviceVulkan13Features
-		    {.extendedDynamicState = true}        // vk::PhysicalDeviceExtendedDynamicStateFeaturesEXT
+		    {                                     // vk::PhysicalDeviceVulkan12Features
+		        .descriptorIndexing = true,
+		        .shaderSampledImageArrayNonUniformIndexing = true,
+		        .shaderStorageBufferArrayNonUniformIndexing = true,
+		        .descriptorBindingSampledImageUpdateAfterBind = true,
+		        .descriptorBindingStorageBufferUpdateAfterBind = true,
+		        .descriptorBindingUpdateUnusedWhilePending = true,
+		        .descriptorBindingPartiallyBound = true,
+		        .runtimeDescriptorArray = true,
+		        .timelineSemaphore = true
+		    },
+		    {.synchronization2 = true, .dynamicRendering = true},  // vk::PhysicalDeviceVulkan13Features
+		    {.extendedDynamicState = true},       // vk::PhysicalDeviceExtendedDynamicStateFeaturesEXT
+		    {.presentId = true},                  // vk::PhysicalDevicePresentIdFeaturesKHR, unlinked when unsupported
+		    {.presentWait = true},                // vk::PhysicalDevicePresentWaitFeaturesKHR, unlinked when unsupported
+		    {.swapchainMaintenance1 = true},      // vk::PhysicalDeviceSwapchainMaintenance1FeaturesEXT, unlinked when unsupported
+		    {},                                   // vk::PhysicalDeviceExtendedDynamicState3FeaturesEXT, filled in below
+		    {.graphicsPipelineLibrary = true}     // vk::PhysicalDeviceGraphicsPipelineLibraryFeaturesEXT, unlinked when unsupported
 		};
     
-    float queue_priority = 1.0f;
-    vk::DeviceQueueCreateInfo logical_device_queue_create_info{
-        .queueFamilyIndex = queueFamilyIndex_,
-        .queueCount = 1,
-        .pQueuePriorities = &queue_priority
+    // one queue per family, the graphics queue gets the higher priority so frames win over background work
+    float graphics_queue_priority = 1.0f;
+    float background_queue_priority = 0.5f;
+    std::vector<vk::DeviceQueueCreateInfo> logical_device_queue_create_infos = {
+        {
+            .queueFamilyIndex = queueFamilyIndex_,
+            .queueCount = 1,
+            .pQueuePriorities = &graphics_queue_priority
+        }
     };
 
+    if (transferQueueFamilyIndex_)
+    {
+        logical_device_queue_create_infos.push_back({
+            .queueFamilyIndex = *transferQueueFamilyIndex_,
+            .queueCount = 1,
+            .pQueuePriorities = &background_queue_priority
+        });
+    }
+
+    if (computeQueueFamilyIndex_)
+    {
+        logical_device_queue_create_infos.push_back({
+            .queueFamilyIndex = *computeQueueFamilyIndex_,
+            .queueCount = 1,
+            .pQueuePriorities = &background_queue_priority
+        });
+    }
+
+    // required extensions plus whichever optional ones the device has
+    std::vector<vk::ExtensionProperties> available_device_extensions = physicalDevice_.enumerateDeviceExtensionProperties();
+    enabledDeviceExtensions_ = getRequiredDeviceExtensions();
+    std::vector<const char*> optional_extensions = OPTIONAL_DEVICE_EXTENSIONS;
+    if (!isHeadless_)
+    {
+        optional_extensions.insert(optional_extensions.end(), OPTIONAL_PRESENT_DEVICE_EXTENSIONS.begin(), OPTIONAL_PRESENT_DEVICE_EXTENSIONS.end());
+    }
+    for (auto optional_extension : optional_extensions)
+    {
+        for (const auto& available_extension : available_device_extensions)
+        {
+            if (strcmp(available_extension.extensionName, optional_extension) == 0)
+            {
+                enabledDeviceExtensions_.push_back(optional_extension);
+                break;
+            }
+        }
+    }
+
+    // present wait needs present id, and both need their feature bits on top of the extensions
+    bool present_wait_supported = false;
+    if (isDeviceExtensionEnabled(vk::KHRPresentIdExtensionName) && isDeviceExtensionEnabled(vk::KHRPresentWaitExtensionName))
+    {
+        auto present_features = physicalDevice_.template getFeatures2< vk::PhysicalDeviceFeatures2,
+                                                                       vk::PhysicalDevicePresentIdFeaturesKHR,
+                                                                       vk::PhysicalDevicePresentWaitFeaturesKHR >();
+        present_wait_supported = present_features.template get<vk::PhysicalDevicePresentIdFeaturesKHR>().presentId &&
+                                 present_features.template get<vk::PhysicalDevicePresentWaitFeaturesKHR>().presentWait;
+    }
+
+    if (!present_wait_supported)
+    {
+        std::erase_if(enabledDeviceExtensions_, [](const char* extension_name)
+        {
+            return strcmp(extension_name, vk::KHRPresentIdExtensionName) == 0 ||
+                   strcmp(extension_name, vk::KHRPresentWaitExtensionName) == 0;
+        });
+        feature_chain.unlink<vk::PhysicalDevicePresentIdFeaturesKHR>();
+        feature_chain.unlink<vk::PhysicalDevicePresentWaitFeaturesKHR>();
+    }
+
+    // present fences need the instance side of the extension and the feature bit
+    bool swapchain_maintenance_supported = false;
+    if (isDeviceExtensionEnabled(vk::EXTSwapchainMaintenance1ExtensionName) && isInstanceExtensionEnabled(vk::EXTSurfaceMaintenance1ExtensionName))
+    {
+        auto maintenance_features = physicalDevice_.template getFeatures2< vk::PhysicalDeviceFeatures2,
+                                                                           vk::PhysicalDeviceSwapchainMaintenance1FeaturesEXT >();
+        swapchain_maintenance_supported = maintenance_features.template get<vk::PhysicalDeviceSwapchainMaintenance1FeaturesEXT>().swapchainMaintenance1;
+    }
+
+    if (!swapchain_maintenance_supported)
+    {
+        std::erase_if(enabledDeviceExtensions_, [](const char* extension_name)
+        {
+            return strcmp(extension_name, vk::EXTSwapchainMaintenance1ExtensionName) == 0;
+        });
+        feature_chain.unlink<vk::PhysicalDeviceSwapchainMaintenance1FeaturesEXT>();
+    }
+
+    // pipeline statistics are only read by the GPU profiler, enabled whenever the device has them
+    pipelineStatisticsEnabled_ = physicalDevice_.getFeatures().pipelineStatisticsQuery;
+    feature_chain.get<vk::PhysicalDeviceFeatures2>().features.pipelineStatisticsQuery = pipelineStatisticsEnabled_;
+
+    // BCn textures, the texture importer falls back to uncompressed mip chains without them
+    textureCompressionBcEnabled_ = physicalDevice_.getFeatures().textureCompressionBC;
+    feature_chain.get<vk::PhysicalDeviceFeatures2>().features.textureCompressionBC = textureCompressionBcEnabled_;
+
+    // GPU driven draws, the culler writes one command per object with the object index as first instance
+    vk::PhysicalDeviceFeatures device_features = physicalDevice_.getFeatures();
+    multiDrawIndirectEnabled_ = device_features.multiDrawIndirect && device_features.drawIndirectFirstInstance;
+    feature_chain.get<vk::PhysicalDeviceFeatures2>().features.multiDrawIndirect = multiDrawIndirectEnabled_;
+    feature_chain.get<vk::PhysicalDeviceFeatures2>().features.drawIndirectFirstInstance = multiDrawIndirectEnabled_;
+
+    // without the count variant culled objects are left in as zero instance draws
+    auto vulkan12_features = physicalDevice_.template getFeatures2< vk::PhysicalDeviceFeatures2,
+                                                                    vk::PhysicalDeviceVulkan12Features >();
+    drawIndirectCountEnabled_ = vulkan12_features.template get<vk::PhysicalDeviceVulkan12Features>().drawIndirectCount;
+    feature_chain.get<vk::PhysicalDeviceVulkan12Features>().drawIndirectCount = drawIndirectCountEnabled_;
+
+    // extended dynamic state 3 is a feature bit per state, only the ones the pipeline compiler uses are enabled
+    if (isDeviceExtensionEnabled(vk::EXTExtendedDynamicState3ExtensionName))
+    {
+        auto dynamic_state_features = physicalDevice_.template getFeatures2< vk::PhysicalDeviceFeatures2,
+                                                                             vk::PhysicalDeviceExtendedDynamicState3FeaturesEXT >();
+        const auto& supported = dynamic_state_features.template get<vk::PhysicalDeviceExtendedDynamicState3FeaturesEXT>();
+        extendedDynamicState3Support_ = ExtendedDynamicState3Support{
+            .isPolygonModeDynamic = !!supported.extendedDynamicState3PolygonMode,
+            .isRasterizationSamplesDynamic = !!supported.extendedDynamicState3RasterizationSamples,
+            .isColorBlendEnableDynamic = !!supported.extendedDynamicState3ColorBlendEnable,
+            .isColorBlendEquationDynamic = !!supported.extendedDynamicState3ColorBlendEquation,
+            .isColorWriteMaskDynamic = !!supported.extendedDynamicState3ColorWriteMask
+        };
+
+        auto& enabled = feature_chain.get<vk::PhysicalDeviceExtendedDynamicState3FeaturesEXT>();
+        enabled.extendedDynamicState3PolygonMode = extendedDynamicState3Support_.isPolygonModeDynamic;
+        enabled.extendedDynamicState3RasterizationSamples = extendedDynamicState3Support_.isRasterizationSamplesDynamic;
+        enabled.extendedDynamicState3ColorBlendEnable = extendedDynamicState3Support_.isColorBlendEnableDynamic;
+        enabled.extendedDynamicState3ColorBlendEquation = extendedDynamicState3Support_.isColorBlendEquationDynamic;
+        enabled.extendedDynamicState3ColorWriteMask = extendedDynamicState3Support_.isColorWriteMaskDynamic;
+    }
+    else
+    {
+        feature_chain.unlink<vk::PhysicalDeviceExtendedDynamicState3FeaturesEXT>();
+    }
+
+    // graphics pipeline libraries, the pipeline state cache links pipelines from precompiled parts with them
+    bool graphics_pipeline_library_supported = false;
+    if (isDeviceExtensionEnabled(vk::EXTGraphicsPipelineLibraryExtensionName) && isDeviceExtensionEnabled(vk::KHRPipelineLibraryExtensionName))
+    {
+        auto library_features = physicalDevice_.template getFeatures2< vk::PhysicalDeviceFeatures2,
+                                                                       vk::PhysicalDeviceGraphicsPipelineLibraryFeaturesEXT >();
+        graphics_pipeline_library_supported = library_features.template get<vk::PhysicalDeviceGraphicsPipelineLibraryFeaturesEXT>().graphicsPipelineLibrary;
+
+        auto library_properties = physicalDevice_.template getProperties2< vk::PhysicalDeviceProperties2,
+                                                                           vk::PhysicalDeviceGraphicsPipelineLibraryPropertiesEXT >();
+        graphicsPipelineFastLinkingSupported_ = graphics_pipeline_library_supported &&
+            library_properties.template get<vk::PhysicalDeviceGraphicsPipelineLibraryPropertiesEXT>().graphicsPipelineLibraryFastLinking;
+    }
+
+    if (!graphics_pipeline_library_supported)
+    {
+        std::erase_if(enabledDeviceExtensions_, [](const char* extension_name)
+        {
+            return strcmp(extension_name, vk::EXTGraphicsPipelineLibraryExtensionName) == 0 ||
+                   strcmp(extension_name, vk::KHRPipelineLibraryExtensionName) == 0;
+        });
+        feature_chain.unlink<vk::PhysicalDeviceGraphicsPipelineLibraryFeaturesEXT>();
+    }
+
     vk::DeviceCreateInfo logical_device_create_info{
         .pNext = &feature_chain.get<vk::PhysicalDeviceFeatures2>(),
-        .queueCreateInfoCount = 1,
-        .pQueueCreateInfos = &logical_device_queue_create_info,
-        .enabledExtensionCount = static_cast<uint32_t>(REQUIRED_DEVICE_EXTENSIONS.size()),
-        .ppEnabledExtensionNames = REQUIRED_DEVICE_EXTENSIONS.data()
+        .queueCreateInfoCount = static_cast<uint32_t>(logical_device_queue_create_infos.size()),
+        .pQueueCreateInfos = logical_device_queue_create_infos.data(),
+        .enabledExtensionCount = static_cast<uint32_t>(enabledDeviceExtensions_.size()),
+        .ppEnabledExtensionNames = enabledDeviceExtensions_.data()
     };
 
     logicalDevice_ = vk::raii::Device(physicalDevice_, logical_device_create_info);
     graphicsQueue_ = vk::raii::Queue(logicalDevice_, queueFamilyIndex_, 0);
+
+    if (transferQueueFamilyIndex_)
+    {
+        transferQueue_ = vk::raii::Queue(logicalDevice_, *transferQueueFamilyIndex_, 0);
+    }
+
+    if (computeQueueFamilyIndex_)
+    {
+        computeQueue_ = vk::raii::Queue(logicalDevice_, *computeQueueFamilyIndex_, 0);
+    }
+}
+
+
+void VulkanContext::createMemoryAllocator()
+{
+    TRACE_FUNCTION();
+    memoryAllocator_ = std::make_unique<MemoryAllocator>(
+        logicalDevice_,
+        physicalDevice_,
+        isDeviceExtensionEnabled(vk::EXTMemoryBudgetExtensionName)
+    );
+}
+
+
+void VulkanContext::createPipelineCache()
+{
+    TRACE_FUNCTION();
+    // validated against the header of the device picked in pickPhysicalDevice(), a stale blob is discarded
+    pipelineCache_ = std::make_unique<PipelineCache>(logicalDevice_, physicalDevice_, PIPELINE_CACHE_FILE);
+}
+
+
+void VulkanContext::createBindlessHeap()
+{
+    TRACE_FUNCTION();
+    bindlessHeap_ = std::make_unique<BindlessHeap>(logicalDevice_, physicalDevice_);
+}
+
+
+void VulkanContext::createShaderModuleCache()
+{
+    TRACE_FUNCTION();
+    shaderModuleCache_ = std::make_unique<ShaderModuleCache>(logicalDevice_);
 }
 
 
@@ -342,3 +1057,151 @@ uint32_t VulkanContext::getQueueFamilyIndex() const
     return queueFamilyIndex_;
 }
 
+const vk::raii::Queue& VulkanContext::getQueue(QueueType queue_type) const
+{
+    switch (queue_type)
+    {
+        case QueueType::eTransfer:
+            return transferQueueFamilyIndex_ ? transferQueue_ : graphicsQueue_;
+        case QueueType::eCompute:
+            return computeQueueFamilyIndex_ ? computeQueue_ : graphicsQueue_;
+        case QueueType::eGraphics:
+        default:
+            return graphicsQueue_;
+    }
+}
+
+uint32_t VulkanContext::getQueueFamilyIndex(QueueType queue_type) const
+{
+    switch (queue_type)
+    {
+        case QueueType::eTransfer:
+            return transferQueueFamilyIndex_.value_or(queueFamilyIndex_);
+        case QueueType::eCompute:
+            return computeQueueFamilyIndex_.value_or(queueFamilyIndex_);
+        case QueueType::eGraphics:
+        default:
+            return queueFamilyIndex_;
+    }
+}
+
+bool VulkanContext::hasDedicatedTransferQueue() const
+{
+    return transferQueueFamilyIndex_.has_value();
+}
+
+bool VulkanContext::hasAsyncComputeQueue() const
+{
+    return computeQueueFamilyIndex_.has_value();
+}
+
+std::unique_lock<std::mutex> VulkanContext::lockQueue(QueueType queue_type) const
+{
+    // a type without its own queue submits to the graphics queue, so it must take the graphics lock
+    bool is_dedicated = (queue_type == QueueType::eTransfer && hasDedicatedTransferQueue()) ||
+                        (queue_type == QueueType::eCompute && hasAsyncComputeQueue());
+    QueueType lock_type = is_dedicated ? queue_type : QueueType::eGraphics;
+
+    return std::unique_lock<std::mutex>(queueMutexes_[static_cast<size_t>(lock_type)]);
+}
+
+bool VulkanContext::isDeviceExtensionEnabled(const char* extension_name) const
+{
+    for (auto enabled_extension : enabledDeviceExtensions_)
+    {
+        if (strcmp(enabled_extension, extension_name) == 0)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool VulkanContext::isInstanceExtensionEnabled(const char* extension_name) const
+{
+    return std::ranges::any_of(
+        enabledInstanceExtensions_,
+        [extension_name](const char* enabled_extension) { return strcmp(enabled_extension, extension_name) == 0; }
+    );
+}
+
+bool VulkanContext::isHeadless() const
+{
+    return isHeadless_;
+}
+
+const DebugMessageSink* VulkanContext::getDebugMessageSink() const
+{
+    return debugMessageSink_.get();
+}
+
+const ValidationSettings& VulkanContext::getValidationSettings() const
+{
+    return validationSettings_;
+}
+
+bool VulkanContext::isPresentFenceEnabled() const
+{
+    return isDeviceExtensionEnabled(vk::EXTSwapchainMaintenance1ExtensionName);
+}
+
+bool VulkanContext::isPipelineStatisticsEnabled() const
+{
+    return pipelineStatisticsEnabled_;
+}
+
+bool VulkanContext::isTextureCompressionBcEnabled() const
+{
+    return textureCompressionBcEnabled_;
+}
+
+bool VulkanContext::isMultiDrawIndirectEnabled() const
+{
+    return multiDrawIndirectEnabled_;
+}
+
+bool VulkanContext::isDrawIndirectCountEnabled() const
+{
+    return drawIndirectCountEnabled_;
+}
+
+const ExtendedDynamicState3Support& VulkanContext::getExtendedDynamicState3Support() const
+{
+    return extendedDynamicState3Support_;
+}
+
+bool VulkanContext::isGraphicsPipelineLibraryEnabled() const
+{
+    return isDeviceExtensionEnabled(vk::EXTGraphicsPipelineLibraryExtensionName);
+}
+
+bool VulkanContext::isGraphicsPipelineFastLinkingSupported() const
+{
+    return graphicsPipelineFastLinkingSupported_;
+}
+
+bool VulkanContext::isPresentWaitEnabled() const
+{
+    return isDeviceExtensionEnabled(vk::KHRPresentWaitExtensionName);
+}
+
+MemoryAllocator& VulkanContext::getMemoryAllocator() const
+{
+    return *memoryAllocator_;
+}
+
+PipelineCache& VulkanContext::getPipelineCache() const
+{
+    return *pipelineCache_;
+}
+
+BindlessHeap& VulkanContext::getBindlessHeap() const
+{
+    return *bindlessHeap_;
+}
+
+ShaderModuleCache& VulkanContext::getShaderModuleCache() const
+{
+    return *shaderModuleCache_;
+}
+
@@ -5,13 +5,54 @@
 #include <vulkan/vulkan_raii.hpp>
 #include <vector>
 #include <string>
+#include <functional>
 #include <optional>
+#include <memory>
+#include <array>
+#include <mutex>
+
+#include "BindlessHeap.h"
+#include "DebugMessageSink.h"
+#include "MemoryAllocator.h"
+#include "PipelineCache.h"
+#include "ShaderModuleCache.h"
+
+// forward declaring classes
+struct DeviceSelection;
+
+// Queues the context exposes, eTransfer and eCompute fall back to the graphics queue when the
+// device has no dedicated family for them.
+enum class QueueType
+{
+    eGraphics,
+    eTransfer,
+    eCompute
+};
+
+
+// Pipeline state VK_EXT_extended_dynamic_state3 lets command buffers set instead of pipelines baking it,
+// one feature bit per state. What extended dynamic state 1 and 2 cover is core in 1.3 and always dynamic.
+struct ExtendedDynamicState3Support
+{
+    bool isPolygonModeDynamic = false;
+    bool isRasterizationSamplesDynamic = false;
+    bool isColorBlendEnableDynamic = false;
+    bool isColorBlendEquationDynamic = false;
+    bool isColorWriteMaskDynamic = false;
+};
+
 
 class VulkanContext
 {
 public:
+    // a null window creates a headless context: no surface, no swap chain extension and any graphics
+    // family, for rendering into an OffscreenTarget without a display
     explicit VulkanContext(GLFWwindow* window);
 
+    // fast start: create_window runs on the calling thread while the instance is created on another,
+    // the window it returns gets the surface. Always a windowed context
+    explicit VulkanContext(const std::function<GLFWwindow*()>& create_window);
+
     // removing class default methods for copying and move semantics
     
     /* VulkanContext(const VulkanContext&) =  delete;  
@@ -37,27 +78,85 @@ public:
     */
     VulkanContext& operator=(VulkanContext&&) = delete;
 
+    // a surface for another window presenting from this device, see SwapChain. The context must outlive it.
+    // throws std::runtime_error on a headless context or when the graphics family can't present to it
+    auto createWindowSurface(GLFWwindow* window) const -> vk::raii::SurfaceKHR;
+
     // Accessors methods
     auto getLogicalDevice() const -> const vk::raii::Device&; // retruns the logical device.
     auto getPhysicalDevice() const -> const vk::raii::PhysicalDevice&;
     auto getQueue() -> vk::raii::Queue&; // this method wont be constat as we plan to edit the queue with submit call later
-    auto getSurface() const -> const vk::raii::SurfaceKHR&;
+    auto getSurface() const -> const vk::raii::SurfaceKHR&;  // the first window's surface, null when headless
     uint32_t getQueueFamilyIndex() const;
 
+    // Multi queue accessors, a queue may be shared by several types when there is no dedicated family
+    auto getQueue(QueueType queue_type) const -> const vk::raii::Queue&;
+    uint32_t getQueueFamilyIndex(QueueType queue_type) const;
+    bool hasDedicatedTransferQueue() const;
+    bool hasAsyncComputeQueue() const;
+    // vkQueueSubmit/vkQueuePresentKHR require external synchronization, hold this lock around them
+    // whenever a queue may be used from more than one thread.
+    auto lockQueue(QueueType queue_type) const -> std::unique_lock<std::mutex>;
+    auto getMemoryAllocator() const -> MemoryAllocator&; // internally synchronized, safe to use through a const context
+    auto getPipelineCache() const -> PipelineCache&; // internally synchronized, safe to use through a const context
+    auto getBindlessHeap() const -> BindlessHeap&; // internally synchronized, safe to use through a const context
+    auto getShaderModuleCache() const -> ShaderModuleCache&; // internally synchronized, safe to use through a const context
+    bool isHeadless() const;
+    auto getDebugMessageSink() const -> const DebugMessageSink*;  // null without validation, flush() it or read the counts
+    auto getValidationSettings() const -> const ValidationSettings&;
+    bool isDeviceExtensionEnabled(const char* extension_name) const;
+    bool isInstanceExtensionEnabled(const char* extension_name) const;
+    bool isPresentWaitEnabled() const;  // VK_KHR_present_id and VK_KHR_present_wait, always enabled together
+    bool isPresentFenceEnabled() const;  // VK_EXT_swapchain_maintenance1, presents can signal a fence
+    bool isPipelineStatisticsEnabled() const;  // pipelineStatisticsQuery, optional
+    bool isTextureCompressionBcEnabled() const;  // textureCompressionBC, optional
+    bool isMultiDrawIndirectEnabled() const;  // multiDrawIndirect and drawIndirectFirstInstance, optional
+    bool isDrawIndirectCountEnabled() const;  // vkCmdDrawIndexedIndirectCount, optional
+    auto getExtendedDynamicState3Support() const -> const ExtendedDynamicState3Support&;  // all false without the extension
+    bool isGraphicsPipelineLibraryEnabled() const;  // VK_EXT_graphics_pipeline_library, optional
+    bool isGraphicsPipelineFastLinkingSupported() const;  // linking libraries without optimization is cheap
+
+    // Pipeline cache blob, relative to the working directory
+    static constexpr const char* PIPELINE_CACHE_FILE = "pipeline_cache.bin";
+    // Device selection of the last run, skips ranking while the devices and drivers are unchanged
+    static constexpr const char* DEVICE_CACHE_FILE = "device_cache.txt";
+
 private:
     void createInstance();
     void setupDebugMessenger();
     void createSurface(GLFWwindow* window);
+    auto createGlfwSurface(GLFWwindow* window) const -> vk::raii::SurfaceKHR;
+    void createDevice();  // everything after the surface
     void pickPhysicalDevice();
     void createLogicalDevice();
+    void createMemoryAllocator();
+    void createPipelineCache();
+    void createBindlessHeap();
+    void createShaderModuleCache();
+
+    // Device ranking, every suitable device is scored and the highest score wins
+    struct DeviceRating
+    {
+        int64_t score = 0;
+        bool meetsRequiredLimits = true;
+        std::vector<std::string> reasons;  // logged next to the score
+    };
+    auto rateDevice(const vk::raii::PhysicalDevice& physical_device) const -> DeviceRating;
+    void rankPhysicalDevices(const std::vector<vk::raii::PhysicalDevice>& physical_devices, const std::string& device_override);
+    bool selectCachedDevice(const std::vector<vk::raii::PhysicalDevice>& physical_devices, const DeviceSelection& selection);
+    static bool matchesDeviceOverride(const vk::raii::PhysicalDevice& physical_device, const std::string& device_override);
+    static auto formatDeviceUuid(const vk::raii::PhysicalDevice& physical_device) -> std::string;
 
     // Device suitability helpers
-    bool isDeviceSuitable(const vk::raii::PhysicalDevice& physical_device) const;
+    bool isDeviceSuitable(const vk::raii::PhysicalDevice& physical_device) const;  // the queue family is checked by the caller
     auto findQueueFamily(const vk::raii::PhysicalDevice& physical_device) const -> std::optional<uint32_t>; // returns uint32_t or an empty value.
+    auto findTransferQueueFamily(const vk::raii::PhysicalDevice& physical_device) const -> std::optional<uint32_t>; // transfer only family (DMA engine).
+    auto findComputeQueueFamily(const vk::raii::PhysicalDevice& physical_device) const -> std::optional<uint32_t>; // compute without graphics.
     bool checkDeviceExtensionSupport(const vk::raii::PhysicalDevice& physical_device) const;
+    auto getRequiredDeviceExtensions() const -> std::vector<const char*>;
 
     // Instance creation helpers
-    static auto getRequiredInstanceExtensions() -> std::vector<const char*>;
+    static auto getRequiredInstanceExtensions(bool is_headless, bool is_validation_enabled) -> std::vector<const char*>;
     static bool checkExtensionSupport(
         const std::vector<const char*>& required_extensions, 
         const std::vector<vk::ExtensionProperties>& extension_properties
@@ -68,7 +167,7 @@ private:
     );
 
     // Debug messenger
-    static auto makeDebugMessengerCreateInfo() -> vk::DebugUtilsMessengerCreateInfoEXT;
+    static auto makeDebugMessengerCreateInfo(DebugMessageSink* debug_message_sink) -> vk::DebugUtilsMessengerCreateInfoEXT;
     static VKAPI_ATTR VkBool32 VKAPI_CALL debugCallback(
         vk::DebugUtilsMessageSeverityFlagBitsEXT message_severity,
         vk::DebugUtilsMessageTypeFlagsEXT message_type,
@@ -78,17 +177,28 @@ private:
 
     // Required device extensions
     static const std::vector<const char*> REQUIRED_DEVICE_EXTENSIONS;
+    // Optional device extensions, enabled when the picked device supports them
+    static const std::vector<const char*> OPTIONAL_DEVICE_EXTENSIONS;
+    // Optional presentation extensions, never enabled on a headless context
+    static const std::vector<const char*> OPTIONAL_PRESENT_DEVICE_EXTENSIONS;
+    // Optional instance extensions, enabled together when the loader supports all of them
+    static const std::vector<const char*> OPTIONAL_INSTANCE_EXTENSIONS;
+
+    // Required device limits, checked while ranking
+    static constexpr uint32_t REQUIRED_MAX_IMAGE_DIMENSION_2D = 4096;
+    static constexpr uint32_t REQUIRED_MAX_PUSH_CONSTANTS_SIZE = 128;
+
+    // Device override, matched against the device UUID or a substring of the device name
+    static constexpr const char* DEVICE_OVERRIDE_ENV = "VK_TUTORIAL_DEVICE";
 
-    // Enabling validation layers only in debug mode
-#ifdef NDEBUG
-    static constexpr bool ENABLE_VALIDATION_LAYERS = false;
-#else
-    static constexpr bool ENABLE_VALIDATION_LAYERS = true;
-#endif
+    // Enabled when validationSettings_ says so, see VALIDATION_ENV
     static const std::vector<const char*> VALIDATION_LAYERS;
 
 
     // Private member variables, order matters as it dictates the order of destruction (in backwards direction)
+    bool isHeadless_ = false;
+    ValidationSettings validationSettings_;
+    std::unique_ptr<DebugMessageSink> debugMessageSink_;  // declared before the instance so it outlives the messenger
     vk::raii::Context context_;
     vk::raii::Instance instance_ = nullptr;
     vk::raii::DebugUtilsMessengerEXT debugMessenger_ = nullptr;
@@ -96,6 +206,23 @@ private:
     vk::raii::PhysicalDevice physicalDevice_ = nullptr;
     vk::raii::Device logicalDevice_ = nullptr;
     vk::raii::Queue graphicsQueue_ = nullptr;
+    vk::raii::Queue transferQueue_ = nullptr;  // stays null without a dedicated transfer family
+    vk::raii::Queue computeQueue_ = nullptr;   // stays null without an async compute family
     uint32_t queueFamilyIndex_ = 0;
+    std::optional<uint32_t> transferQueueFamilyIndex_;
+    std::optional<uint32_t> computeQueueFamilyIndex_;
+    mutable std::array<std::mutex, 3> queueMutexes_;  // indexed by QueueType, shared queues share the graphics mutex
+    std::vector<const char*> enabledInstanceExtensions_;
+    std::vector<const char*> enabledDeviceExtensions_;
+    bool pipelineStatisticsEnabled_ = false;
+    bool textureCompressionBcEnabled_ = false;
+    bool multiDrawIndirectEnabled_ = false;
+    bool drawIndirectCountEnabled_ = false;
+    ExtendedDynamicState3Support extendedDynamicState3Support_;
+    bool graphicsPipelineFastLinkingSupported_ = false;
+    std::unique_ptr<MemoryAllocator> memoryAllocator_;  // declared after the device so it's destroyed first
+    std::unique_ptr<PipelineCache> pipelineCache_;  // declared after the device so it's saved and destroyed first
+    std::unique_ptr<BindlessHeap> bindlessHeap_;  // declared after the device so it's destroyed first
+    std::unique_ptr<ShaderModuleCache> shaderModuleCache_;  // declared after the device so it's destroyed first
 
 };
@@ -2,34 +2,330 @@
 
 #define GLFW_INCLUDE_VULKAN
 #include <GLFW/glfw3.h>
+#include <algorithm>
+#include <bit>
+#include <chrono>
+#include <cstdlib>
+#include <filesystem>
 #include <iostream>
+#include <memory>
+#include <string>
 
+#include "Application.h"
 #include "core/VulkanContext.h"
+#include "core/OffscreenTarget.h"
 #include "core/SwapChain.h"
+#include "core/TransientAttachments.h"
+#include "renderer/GraphicsPipeline.h"
+#include "renderer/PipelineStateCache.h"
+#include "renderer/PostProcessor.h"
+#include "renderer/Renderer.h"
+#include "renderer/ScenePass.h"
+#include "renderer/ShaderWatcher.h"
+#include "renderer/UploadEngine.h"
+#include "resources/AssetStreamer.h"
+#include "utils/StartupTimer.h"
+#include "utils/Trace.h"
+
+static constexpr vk::Extent2D HEADLESS_EXTENT = {1920, 1080};
+
+
+// CPU trace and GPU profile dumps, both opt in through the environment
+static void writeProfiles(const Renderer& renderer)
+{
+    if (const char* trace_path = std::getenv("VK_TUTORIAL_TRACE"); Tracer::ENABLED && trace_path)
+    {
+        try
+        {
+            Tracer::get().writeChromeTrace(trace_path);
+            std::cout << "cpu trace written to " << trace_path << "\n";
+        }
+        catch (const std::exception& e)
+        {
+            std::cerr << "cpu trace: " << e.what() << "\n";
+        }
+    }
+    if (const char* profile_path = std::getenv("VK_TUTORIAL_GPU_PROFILE"))
+    {
+        try
+        {
+            renderer.getGpuProfiler().writeCsv(profile_path);
+            std::cout << "gpu profile written to " << profile_path << "\n";
+        }
+        catch (const std::exception& e)
+        {
+            std::cerr << "gpu profile: " << e.what() << "\n";
+        }
+    }
+}
+
+
+// depth and MSAA through transient attachments, unset renders straight into the target like before
+static TransientAttachmentDesc getTransientAttachmentDescFromEnvironment(const VulkanContext& context)
+{
+    const char* sample_count = std::getenv("VK_TUTORIAL_MSAA");
+    if (!sample_count) return {};
+
+    uint32_t max_sample_count = std::bit_floor(std::max(1u, static_cast<uint32_t>(std::stoul(sample_count))));
+    return TransientAttachments::selectDesc(context, static_cast<vk::SampleCountFlagBits>(max_sample_count), true);
+}
+
+
+// tone mapping, bloom and auto exposure on the async compute queue, unset renders straight into the target
+static bool isPostProcessingEnabled()
+{
+    const char* post_process = std::getenv("VK_TUTORIAL_POST_PROCESS");
+    return post_process && std::string(post_process) != "0";
+}
+
+
+// windows presenting from the one device, unset opens a single window
+static uint32_t getViewportCountFromEnvironment()
+{
+    const char* viewport_count = std::getenv("VK_TUTORIAL_VIEWPORTS");
+    return viewport_count ? std::max(1u, static_cast<uint32_t>(std::stoul(viewport_count))) : 1;
+}
+
+
+// a .mesh, or an .obj the streamer converts next to itself on first use, drawn instead of the triangle.
+// Empty when unset
+static std::filesystem::path getMeshPathFromEnvironment()
+{
+    const char* mesh_path = std::getenv("VK_TUTORIAL_MESH");
+    return mesh_path ? std::filesystem::path(mesh_path) : std::filesystem::path();
+}
+
+
+// copies of the mesh along x and z, unset draws one
+static uint32_t getMeshGridSizeFromEnvironment()
+{
+    const char* grid_size = std::getenv("VK_TUTORIAL_MESH_GRID");
+    return grid_size ? std::max(1u, static_cast<uint32_t>(std::stoul(grid_size))) : 1;
+}
+
+
+// the mesh's albedo, any image TextureImporter reads. BC compressed through the KTX2 cache where the device
+// has BC, unset draws the mesh grey
+static AssetHandle<Texture> requestAlbedoFromEnvironment(AssetStreamer& streamer)
+{
+    const char* texture_path = std::getenv("VK_TUTORIAL_TEXTURE");
+    if (!texture_path) return {};
+    return streamer.requestTexture(texture_path, StreamPriority::eCritical, true);
+}
+
+
+// renders a fixed number of frames into an offscreen target, no window, surface or vsync involved
+static void runHeadless(uint32_t frame_count)
+{
+    VulkanContext context = VulkanContext(nullptr);
+    OffscreenTarget target = OffscreenTarget(context, HEADLESS_EXTENT);
+    TransientAttachmentDesc attachment_desc = getTransientAttachmentDescFromEnvironment(context);
+    bool is_post_processing = isPostProcessingEnabled();
+
+    // the compiler and the state cache must outlive every pipeline built through them
+    PipelineCompiler pipeline_compiler = PipelineCompiler(context);
+    PipelineStateCache pipeline_state_cache = PipelineStateCache(context, pipeline_compiler);
+    vk::Format color_format = is_post_processing ? PostProcessor::SCENE_FORMAT : target.getFormat();
+    GraphicsPipeline pipeline = GraphicsPipeline(context, pipeline_state_cache, color_format, attachment_desc);
+    pipeline_compiler.waitIdle();
+
+    Renderer renderer = Renderer(context);
+    renderer.enableTransientAttachments(attachment_desc);
+    if (is_post_processing) renderer.enablePostProcessing();
+    if (const char* recording_threads = std::getenv("VK_TUTORIAL_RECORDING_THREADS"))
+    {
+        renderer.enableParallelRecording(static_cast<uint32_t>(std::stoul(recording_threads)));
+    }
+
+    // after the renderer, the scene pass waits for its frames before the mesh goes. Headless frames are
+    // compared between runs, so the mesh is loaded before the first one instead of streaming in
+    UploadEngine upload_engine = UploadEngine(context);
+    AssetStreamer streamer = AssetStreamer(context, upload_engine);
+    std::unique_ptr<ScenePass> scene_pass;
+    if (std::filesystem::path mesh_path = getMeshPathFromEnvironment(); !mesh_path.empty())
+    {
+        scene_pass = std::make_unique<ScenePass>(
+            context, upload_engine, pipeline_state_cache, renderer.getFrameScheduler(), Renderer::MAX_FRAMES_IN_FLIGHT, color_format,
+            attachment_desc, streamer.requestMesh(mesh_path, StreamPriority::eCritical), requestAlbedoFromEnvironment(streamer),
+            getMeshGridSizeFromEnvironment()
+        );
+        renderer.setScenePass(scene_pass.get());
+        streamer.waitIdle();
+        pipeline_compiler.waitIdle();
+        if (scene_pass->hasFailed()) std::cerr << "mesh failed to load: " << mesh_path.string() << "\n";
+    }
+
+    auto start_time = std::chrono::steady_clock::now();
+    for (uint32_t i = 0; i < frame_count; i++)
+    {
+        renderer.drawFrame(target, pipeline);
+        if (i == 0) StartupTimer::get().print();
+    }
+    renderer.getFrameScheduler().waitIdle();
+    double elapsed_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start_time).count();
+
+    std::cout << "headless: " << frame_count << " frames at " << target.getExtent().width << "x" << target.getExtent().height
+              << " in " << elapsed_seconds << " s, " << frame_count / elapsed_seconds << " fps\n";
+    renderer.getGpuProfiler().printStatistics();
+    if (const PostProcessor* post_processor = renderer.getPostProcessor()) post_processor->printStatistics(renderer.getGpuProfiler());
+    writeProfiles(renderer);
+}
 
 
 int main()
 {
+    TRACE_THREAD_NAME("main");
+    StartupTimer::get();  // the startup report counts from here
+
+    if (const char* headless_frames = std::getenv("VK_TUTORIAL_HEADLESS"))
+    {
+        runHeadless(static_cast<uint32_t>(std::stoul(headless_frames)));
+        return 0;
+    }
+
     // initialize window
     glfwInit();
     glfwWindowHint(GLFW_CLIENT_API, GLFW_NO_API);
-    glfwWindowHint(GLFW_RESIZABLE, GLFW_FALSE);
+    glfwWindowHint(GLFW_RESIZABLE, GLFW_TRUE);
+
+    // the window opens while the instance is created on another thread
+    GLFWwindow *window = nullptr;
+    VulkanContext context = VulkanContext([&window]()
+    {
+        window = glfwCreateWindow(800, 600, "Vulkan Smoke Test", nullptr, nullptr);
+        return window;
+    });
 
-    GLFWwindow *window = glfwCreateWindow(800, 600, "Vulkan Smoke Test", nullptr, nullptr);
+    TransientAttachmentDesc attachment_desc = getTransientAttachmentDescFromEnvironment(context);
+    bool is_post_processing = isPostProcessingEnabled();
 
-    VulkanContext context = VulkanContext(window);
-    SwapChain swap_chain = SwapChain(context, window);
+    // the compiler and the state cache must outlive every pipeline built through them. The pipeline is
+    // queued before the swap chain exists, its shaders load and compile on the compiler thread while the
+    // swap chain is created
+    uint64_t pipeline_begin_ns = StartupTimer::get().now();
+    PipelineCompiler pipeline_compiler = PipelineCompiler(context);
+    PipelineStateCache pipeline_state_cache = PipelineStateCache(context, pipeline_compiler);
+    vk::Format color_format = is_post_processing ? PostProcessor::SCENE_FORMAT : SwapChain::querySurfaceFormat(context);
+    GraphicsPipeline pipeline = GraphicsPipeline(context, pipeline_state_cache, color_format, attachment_desc);
+
+    uint64_t swap_chain_begin_ns = StartupTimer::get().now();
+    SwapChain swap_chain = SwapChain(context, window, getPresentProfileFromEnvironment(PresentProfile::eThroughput));
+    StartupTimer::get().record("create swap chain", swap_chain_begin_ns, StartupTimer::get().now());
 
     std::cout << "swap chain successfully created: \n" 
               << "\t Format: " << vk::to_string(swap_chain.getFormat()) << "\n"
               << "\t Extent: " << swap_chain.getExtent().width << ", " << swap_chain.getExtent().height << "\n"
               << "\t Image Count: " << swap_chain.getImageCount() << "\n";
 
-    while (!glfwWindowShouldClose(window))
+    if (attachment_desc.isEnabled())
     {
-        glfwPollEvents();
+        std::cout << "transient attachments: " << vk::to_string(attachment_desc.sampleCount) << " samples, depth "
+                  << vk::to_string(attachment_desc.depthFormat) << "\n";
     }
 
+    // linked from pipeline libraries it's ready straight away, the optimized build still compiles
+    std::cout << "graphics pipeline queued, ready: " << std::boolalpha << pipeline.isReady() << "\n";
+    pipeline_compiler.waitIdle();
+    StartupTimer::get().record("compile pipeline", pipeline_begin_ns, StartupTimer::get().now());
+
+    std::cout << "graphics pipeline " << (pipeline.isReady() ? "successfully created" : "failed") << ": \n"
+              << "\t Pipeline cache: " << (context.getPipelineCache().wasLoadedFromDisk() ? "warm" : "cold") << "\n"
+              << "\t Cache hits: " << context.getPipelineCache().getHitCount()
+              << " misses: " << context.getPipelineCache().getMissCount() << "\n"
+              << "\t Shader modules: " << context.getShaderModuleCache().getModuleCount()
+              << " (hits: " << context.getShaderModuleCache().getHitCount() << ")\n"
+              << "\t Pipeline states: " << pipeline_state_cache.getPipelineCount()
+              << " (libraries: " << (pipeline_state_cache.usesPipelineLibraries() ? "yes" : "no") << ")\n";
+
+    context.getMemoryAllocator().printStatistics();
+
+    // development builds rebuild pipelines when their SPIR-V changes on disk
+    ShaderWatcher shader_watcher = ShaderWatcher(pipeline_compiler);
+    if (ShaderWatcher::ENABLED)
+    {
+        shader_watcher.watch(pipeline);
+    }
+
+    Renderer renderer = Renderer(context);
+    renderer.enableTransientAttachments(attachment_desc);
+    if (is_post_processing) renderer.enablePostProcessing();
+    if (const char* recording_threads = std::getenv("VK_TUTORIAL_RECORDING_THREADS"))
+    {
+        renderer.enableParallelRecording(static_cast<uint32_t>(std::stoul(recording_threads)));
+    }
+
+    // after the renderer, the scene pass waits for its frames before the mesh goes. The mesh streams in on
+    // the streamer's workers, the triangle stands in until it and its pipeline are ready
+    UploadEngine upload_engine = UploadEngine(context);
+    AssetStreamer streamer = AssetStreamer(context, upload_engine);
+    std::unique_ptr<ScenePass> scene_pass;
+    std::filesystem::path mesh_path = getMeshPathFromEnvironment();
+    if (!mesh_path.empty())
+    {
+        scene_pass = std::make_unique<ScenePass>(
+            context, upload_engine, pipeline_state_cache, renderer.getFrameScheduler(), Renderer::MAX_FRAMES_IN_FLIGHT, color_format,
+            attachment_desc, streamer.requestMesh(mesh_path, StreamPriority::eCritical), requestAlbedoFromEnvironment(streamer),
+            getMeshGridSizeFromEnvironment()
+        );
+        renderer.setScenePass(scene_pass.get());
+    }
+
+    // the frame loop sleeps between frames unless VK_TUTORIAL_FRAME_LOOP is continuous, every further
+    // window gets a surface and swap chain of its own on the same device
+    Application application = Application(context, renderer, pipeline, window, swap_chain, getFrameLoopSettingsFromEnvironment());
+    uint32_t viewport_count = getViewportCountFromEnvironment();
+    if (viewport_count > 1 && (is_post_processing || attachment_desc.isEnabled()))
+    {
+        std::cout << "VK_TUTORIAL_VIEWPORTS ignored, post processing and MSAA render a single window\n";
+        viewport_count = 1;
+    }
+    for (uint32_t i = 1; i < viewport_count; i++)
+    {
+        application.openViewport("Vulkan Smoke Test " + std::to_string(i + 1), 800, 600);
+    }
+    if (viewport_count > 1)
+    {
+        std::cout << "viewports: " << viewport_count << " windows, one submit and one present per frame\n";
+    }
+
+    uint64_t first_frame_begin_ns = StartupTimer::get().now();
+    bool is_first_frame = true;
+    bool is_scene_shown = false;
+    application.run(
+        [&]()
+        {
+            // an on demand loop only draws dirty frames, a finished reload has to be shown
+            shader_watcher.poll();
+            if (pipeline.isReloadFinished()) application.getFrameLoop().markDirty();
+            if (streamer.update() > 0) application.getFrameLoop().markDirty();
+            if (scene_pass && !is_scene_shown && scene_pass->isReady())
+            {
+                is_scene_shown = true;
+                application.getFrameLoop().markDirty();  // the mesh may have been waiting for its pipeline
+            }
+            if (scene_pass && !is_scene_shown && scene_pass->hasFailed())
+            {
+                is_scene_shown = true;
+                std::cerr << "mesh failed to load: " << mesh_path.string() << "\n";
+            }
+        },
+        [&]()
+        {
+            if (!is_first_frame) return;
+
+            StartupTimer::get().record("first frame", first_frame_begin_ns, StartupTimer::get().now());
+            StartupTimer::get().print();
+            is_first_frame = false;
+        }
+    );  // closes the viewports once the first window closes
+
+    context.getLogicalDevice().waitIdle();
+    renderer.printLatencyStatistics();
+    renderer.getGpuProfiler().printStatistics();
+    if (const PostProcessor* post_processor = renderer.getPostProcessor()) post_processor->printStatistics(renderer.getGpuProfiler());
+    application.getFrameLoop().printStatistics();
+    writeProfiles(renderer);
+
     glfwDestroyWindow(window);
     glfwTerminate();
 
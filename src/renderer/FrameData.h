@@ -0,0 +1,12 @@
+#pragma once
+
+#include <cstdint>
+
+// Per frame in flight state of the Renderer. The command buffers come from the RenderGraph's pools for the
+// frame slot. There is no in-flight fence: the frame's last submit signals timelineValue on the FrameScheduler
+// semaphore, once that value completed everything the slot recorded with can be reused. Acquire and present
+// semaphores belong to the swap chain they're used with, see Renderer::PresentState.
+struct FrameData
+{
+    uint64_t timelineValue = 0;  // 0 until the first submit, waiting on it returns straight away
+};
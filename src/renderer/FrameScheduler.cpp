@@ -0,0 +1,133 @@
+#include "FrameScheduler.h"
+#include "core/VulkanContext.h"
+#include <vector>
+
+
+FrameScheduler::FrameScheduler(const VulkanContext& context): context_(context)
+{
+    createTimelineSemaphore();
+}
+
+
+FrameScheduler::~FrameScheduler()
+{
+    waitIdle();
+
+    // everything is complete now, run the deleters in submission order
+    std::lock_guard lock(deletionMutex_);
+    for (auto& [timeline_value, deleter] : deletions_)
+    {
+        deleter();
+    }
+    deletions_.clear();
+}
+
+
+void FrameScheduler::createTimelineSemaphore()
+{
+    vk::SemaphoreTypeCreateInfo semaphore_type_create_info{
+        .semaphoreType = vk::SemaphoreType::eTimeline,
+        .initialValue = 0
+    };
+
+    vk::SemaphoreCreateInfo semaphore_create_info{
+        .pNext = &semaphore_type_create_info
+    };
+
+    timelineSemaphore_ = vk::raii::Semaphore(context_.getLogicalDevice(), semaphore_create_info);
+}
+
+
+uint64_t FrameScheduler::reserveValue()
+{
+    return lastReservedValue_.fetch_add(1) + 1;
+}
+
+
+uint64_t FrameScheduler::getLastReservedValue() const
+{
+    return lastReservedValue_.load();
+}
+
+
+uint64_t FrameScheduler::getCompletedValue() const
+{
+    return timelineSemaphore_.getCounterValue();
+}
+
+
+bool FrameScheduler::isComplete(uint64_t timeline_value) const
+{
+    return getCompletedValue() >= timeline_value;
+}
+
+
+void FrameScheduler::wait(uint64_t timeline_value) const
+{
+    if (isComplete(timeline_value)) return;  // skips the call in the common case
+
+    vk::SemaphoreWaitInfo semaphore_wait_info{
+        .semaphoreCount = 1,
+        .pSemaphores = &*timelineSemaphore_,
+        .pValues = &timeline_value
+    };
+    (void)context_.getLogicalDevice().waitSemaphores(semaphore_wait_info, UINT64_MAX);
+}
+
+
+void FrameScheduler::waitIdle() const
+{
+    wait(getLastReservedValue());
+}
+
+
+vk::SemaphoreSubmitInfo FrameScheduler::getSignalInfo(uint64_t timeline_value, vk::PipelineStageFlags2 stage_mask) const
+{
+    return vk::SemaphoreSubmitInfo{
+        .semaphore = *timelineSemaphore_,
+        .value = timeline_value,
+        .stageMask = stage_mask
+    };
+}
+
+
+const vk::raii::Semaphore& FrameScheduler::getSemaphore() const
+{
+    return timelineSemaphore_;
+}
+
+
+void FrameScheduler::deferDelete(uint64_t timeline_value, std::function<void()> deleter)
+{
+    if (isComplete(timeline_value))
+    {
+        deleter();
+        return;
+    }
+
+    std::lock_guard lock(deletionMutex_);
+    deletions_.emplace(timeline_value, std::move(deleter));
+}
+
+
+void FrameScheduler::collect()
+{
+    uint64_t completed_value = getCompletedValue();
+
+    // deleters run outside the lock, they may defer more work themselves
+    std::vector<std::function<void()>> ready_deleters;
+    {
+        std::lock_guard lock(deletionMutex_);
+        auto end = deletions_.upper_bound(completed_value);
+        for (auto it = deletions_.begin(); it != end; ++it)
+        {
+            ready_deleters.push_back(std::move(it->second));
+        }
+        deletions_.erase(deletions_.begin(), end);
+    }
+
+    for (auto& deleter : ready_deleters)
+    {
+        deleter();
+    }
+}
@@ -0,0 +1,65 @@
+#pragma once
+
+#include <vulkan/vulkan_raii.hpp>
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+
+// forward declaring classes
+class VulkanContext;
+
+// Paces the graphics queue with one timeline semaphore instead of a fence per frame.
+// Every graphics submission reserves the next value and signals it, so a frame (or any other job)
+// is identified by a single number and CPU waits target exactly the work they depend on.
+// Resources that the GPU may still read are parked with deferDelete()/retire() and released once
+// the semaphore passes their value, collect() does the releasing once per frame.
+// Thread safe.
+class FrameScheduler
+{
+public:
+    explicit FrameScheduler(const VulkanContext& context);
+    ~FrameScheduler();  // waits for every reserved value, then runs the remaining deletions
+
+    // deleting copy constructors
+    FrameScheduler(const FrameScheduler&) = delete;
+    FrameScheduler& operator=(const FrameScheduler&) = delete;
+
+    // the value the next submission signals, it must actually be submitted or waits on it never return
+    uint64_t reserveValue();
+    uint64_t getLastReservedValue() const;
+    uint64_t getCompletedValue() const;
+
+    bool isComplete(uint64_t timeline_value) const;
+    void wait(uint64_t timeline_value) const;
+    void waitIdle() const;  // waits for the last reserved value
+
+    // signal info to chain into a vk::SubmitInfo2
+    auto getSignalInfo(uint64_t timeline_value, vk::PipelineStageFlags2 stage_mask) const -> vk::SemaphoreSubmitInfo;
+    auto getSemaphore() const -> const vk::raii::Semaphore&;
+
+    // runs deleter once the GPU passed timeline_value
+    void deferDelete(uint64_t timeline_value, std::function<void()> deleter);
+
+    // keeps resource alive until everything reserved so far completed
+    template <typename T>
+    void retire(T&& resource)
+    {
+        auto retired = std::make_shared<std::decay_t<T>>(std::forward<T>(resource));
+        deferDelete(getLastReservedValue(), [retired]() mutable { retired.reset(); });
+    }
+
+    void collect();  // runs every deleter whose value completed
+
+private:
+    void createTimelineSemaphore();
+
+    const VulkanContext& context_;
+    vk::raii::Semaphore timelineSemaphore_ = nullptr;
+    std::atomic<uint64_t> lastReservedValue_ = 0;
+
+    std::mutex deletionMutex_;
+    std::multimap<uint64_t, std::function<void()>> deletions_;  // keyed by the value they wait for
+};
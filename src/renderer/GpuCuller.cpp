@@ -0,0 +1,324 @@
+#include "GpuCuller.h"
+#include "FrameScheduler.h"
+#include "UploadEngine.h"
+#include "core/VulkanContext.h"
+#include "utils/Trace.h"
+#include <algorithm>
+#include <stdexcept>
+#include <string>
+
+
+glm::vec4 CullObject::makeBoundingSphere(glm::vec3 bounds_min, glm::vec3 bounds_max)
+{
+    glm::vec3 center = (bounds_min + bounds_max) * 0.5f;
+    return glm::vec4(center, glm::length(bounds_max - center));
+}
+
+
+GpuCuller::GpuCuller(
+    const VulkanContext& context,
+    UploadEngine& upload_engine,
+    const FrameScheduler& scheduler,
+    uint32_t max_object_count,
+    uint32_t frame_count
+)
+    : context_(context), uploadEngine_(upload_engine), scheduler_(scheduler), maxObjectCount_(std::max(1u, max_object_count))
+{
+    if (!context_.isMultiDrawIndirectEnabled())
+    {
+        throw std::runtime_error("gpu culling needs multiDrawIndirect and drawIndirectFirstInstance");
+    }
+    isCompacting_ = context_.isDrawIndirectCountEnabled();
+
+    createPipeline();
+
+    BindlessHeap& bindless_heap = context_.getBindlessHeap();
+    frames_.resize(frame_count);
+    for (auto& frame : frames_)
+    {
+        frame.objectBuffer = createBuffer(
+            sizeof(CullObject) * maxObjectCount_,
+            vk::BufferUsageFlagBits::eStorageBuffer | vk::BufferUsageFlagBits::eTransferDst,
+            true,
+            frame.objectAllocation
+        );
+        frame.commandBuffer = createBuffer(
+            sizeof(vk::DrawIndexedIndirectCommand) * maxObjectCount_,
+            vk::BufferUsageFlagBits::eStorageBuffer | vk::BufferUsageFlagBits::eIndirectBuffer,
+            false,
+            frame.commandAllocation
+        );
+        frame.countBuffer = createBuffer(
+            sizeof(uint32_t),
+            vk::BufferUsageFlagBits::eStorageBuffer | vk::BufferUsageFlagBits::eIndirectBuffer | vk::BufferUsageFlagBits::eTransferDst,
+            false,
+            frame.countAllocation
+        );
+        frame.objectHandle = bindless_heap.registerStorageBuffer(*frame.objectBuffer);
+        frame.commandHandle = bindless_heap.registerStorageBuffer(*frame.commandBuffer);
+        frame.countHandle = bindless_heap.registerStorageBuffer(*frame.countBuffer);
+    }
+}
+
+
+GpuCuller::~GpuCuller()
+{
+    // every cull and draw was submitted by now, the last reserved value covers them all
+    uint64_t release_value = scheduler_.getLastReservedValue();
+    BindlessHeap& bindless_heap = context_.getBindlessHeap();
+    MemoryAllocator& memory_allocator = context_.getMemoryAllocator();
+    for (auto& frame : frames_)
+    {
+        bindless_heap.release(BindlessType::eStorageBuffer, frame.objectHandle, release_value);
+        bindless_heap.release(BindlessType::eStorageBuffer, frame.commandHandle, release_value);
+        bindless_heap.release(BindlessType::eStorageBuffer, frame.countHandle, release_value);
+        frame.objectBuffer.clear();
+        frame.commandBuffer.clear();
+        frame.countBuffer.clear();
+        memory_allocator.free(frame.objectAllocation);
+        memory_allocator.free(frame.commandAllocation);
+        memory_allocator.free(frame.countAllocation);
+    }
+}
+
+
+void GpuCuller::createPipeline()
+{
+    // same layout as every other pipeline, all buffers are reached through bindless handles
+    const BindlessHeap& bindless_heap = context_.getBindlessHeap();
+    vk::DescriptorSetLayout set_layout = *bindless_heap.getSetLayout();
+    vk::PushConstantRange push_constant_range = bindless_heap.getPushConstantRange();
+    static_assert(sizeof(CullConstants) <= BindlessHeap::PUSH_CONSTANT_SIZE);
+
+    vk::PipelineLayoutCreateInfo pipeline_layout_create_info{
+        .setLayoutCount = 1,
+        .pSetLayouts = &set_layout,
+        .pushConstantRangeCount = 1,
+        .pPushConstantRanges = &push_constant_range
+    };
+    layout_ = vk::raii::PipelineLayout(context_.getLogicalDevice(), pipeline_layout_create_info);
+
+    ShaderModuleCache::ShaderModulePtr cull_module = context_.getShaderModuleCache().getModule(CULL_SHADER_PATH);
+
+    vk::ComputePipelineCreateInfo pipeline_create_info{
+        .stage = {
+            .stage = vk::ShaderStageFlagBits::eCompute,
+            .module = **cull_module,
+            .pName = "cullMain"
+        },
+        .layout = *layout_
+    };
+
+    PipelineCache& pipeline_cache = context_.getPipelineCache();
+    pipeline_ = vk::raii::Pipeline(context_.getLogicalDevice(), pipeline_cache.get(), pipeline_create_info);
+}
+
+
+vk::raii::Buffer GpuCuller::createBuffer(vk::DeviceSize size, vk::BufferUsageFlags usage, bool is_uploaded, Allocation& allocation) const
+{
+    // buffers the upload engine writes are shared with its transfer family, the rest never leave the graphics queue
+    std::vector<uint32_t> queue_families = is_uploaded ? uploadEngine_.getConcurrentQueueFamilies() : std::vector<uint32_t>{};
+    bool is_shared = !queue_families.empty();
+
+    vk::BufferCreateInfo buffer_create_info{
+        .size = size,
+        .usage = usage,
+        .sharingMode = is_shared ? vk::SharingMode::eConcurrent : vk::SharingMode::eExclusive,
+        .queueFamilyIndexCount = is_shared ? static_cast<uint32_t>(queue_families.size()) : 0,
+        .pQueueFamilyIndices = is_shared ? queue_families.data() : nullptr
+    };
+
+    vk::raii::Buffer buffer = vk::raii::Buffer(context_.getLogicalDevice(), buffer_create_info);
+    allocation = context_.getMemoryAllocator().allocateForBuffer(buffer, MemoryUsage::eGpuOnly);
+    return buffer;
+}
+
+
+uint64_t GpuCuller::setObjects(uint32_t frame_index, std::span<const CullObject> objects)
+{
+    TRACE_FUNCTION();
+    if (objects.size() > maxObjectCount_)
+    {
+        throw std::runtime_error("gpu culler: " + std::to_string(objects.size()) + " objects, room for " + std::to_string(maxObjectCount_));
+    }
+
+    FrameBuffers& frame = frames_[frame_index];
+    const std::byte* data = reinterpret_cast<const std::byte*>(objects.data());
+    vk::DeviceSize size = objects.size_bytes();
+    uint64_t upload_value = uploadEngine_.getCompletedValue();
+    for (vk::DeviceSize offset = 0; offset < size; offset += UPLOAD_CHUNK_SIZE)
+    {
+        vk::DeviceSize chunk_size = std::min(UPLOAD_CHUNK_SIZE, size - offset);
+        upload_value = uploadEngine_.uploadBuffer(*frame.objectBuffer, offset, data + offset, chunk_size);
+    }
+
+    frame.objectCount = static_cast<uint32_t>(objects.size());
+    return upload_value;
+}
+
+
+void GpuCuller::cull(vk::CommandBuffer command_buffer, uint32_t frame_index, const glm::mat4& view_projection) const
+{
+    const FrameBuffers& frame = frames_[frame_index];
+
+    // the frame's previous draws read the count as indirect parameters, the fill has to wait for them
+    vk::BufferMemoryBarrier2 to_fill_barrier{
+        .srcStageMask = vk::PipelineStageFlagBits2::eDrawIndirect,
+        .srcAccessMask = vk::AccessFlagBits2::eIndirectCommandRead,
+        .dstStageMask = vk::PipelineStageFlagBits2::eAllTransfer,
+        .dstAccessMask = vk::AccessFlagBits2::eTransferWrite,
+        .srcQueueFamilyIndex = vk::QueueFamilyIgnored,
+        .dstQueueFamilyIndex = vk::QueueFamilyIgnored,
+        .buffer = *frame.countBuffer,
+        .offset = 0,
+        .size = vk::WholeSize
+    };
+    command_buffer.pipelineBarrier2({.bufferMemoryBarrierCount = 1, .pBufferMemoryBarriers = &to_fill_barrier});
+    command_buffer.fillBuffer(*frame.countBuffer, 0, vk::WholeSize, 0);
+
+    // the count is incremented by the shader, the commands are fully rewritten
+    std::array<vk::BufferMemoryBarrier2, 2> to_cull_barriers = {{
+        {
+            .srcStageMask = vk::PipelineStageFlagBits2::eAllTransfer,
+            .srcAccessMask = vk::AccessFlagBits2::eTransferWrite,
+            .dstStageMask = vk::PipelineStageFlagBits2::eComputeShader,
+            .dstAccessMask = vk::AccessFlagBits2::eShaderStorageRead | vk::AccessFlagBits2::eShaderStorageWrite,
+            .srcQueueFamilyIndex = vk::QueueFamilyIgnored,
+            .dstQueueFamilyIndex = vk::QueueFamilyIgnored,
+            .buffer = *frame.countBuffer,
+            .offset = 0,
+            .size = vk::WholeSize
+        },
+        {
+            .srcStageMask = vk::PipelineStageFlagBits2::eDrawIndirect,
+            .srcAccessMask = vk::AccessFlagBits2::eIndirectCommandRead,
+            .dstStageMask = vk::PipelineStageFlagBits2::eComputeShader,
+            .dstAccessMask = vk::AccessFlagBits2::eShaderStorageWrite,
+            .srcQueueFamilyIndex = vk::QueueFamilyIgnored,
+            .dstQueueFamilyIndex = vk::QueueFamilyIgnored,
+            .buffer = *frame.commandBuffer,
+            .offset = 0,
+            .size = vk::WholeSize
+        }
+    }};
+    command_buffer.pipelineBarrier2({
+        .bufferMemoryBarrierCount = static_cast<uint32_t>(to_cull_barriers.size()),
+        .pBufferMemoryBarriers = to_cull_barriers.data()
+    });
+
+    if (frame.objectCount > 0)
+    {
+        CullConstants constants{
+            .frustumPlanes = extractFrustumPlanes(view_projection),
+            .objectBufferHandle = frame.objectHandle,
+            .commandBufferHandle = frame.commandHandle,
+            .countBufferHandle = frame.countHandle,
+            .objectCount = frame.objectCount,
+            .isCompacting = isCompacting_ ? 1u : 0u
+        };
+
+        command_buffer.bindPipeline(vk::PipelineBindPoint::eCompute, *pipeline_);
+        context_.getBindlessHeap().bind(command_buffer, vk::PipelineBindPoint::eCompute, *layout_);
+        command_buffer.pushConstants(*layout_, vk::ShaderStageFlagBits::eAll, 0, sizeof(constants), &constants);
+        command_buffer.dispatch((frame.objectCount + WORKGROUP_SIZE - 1) / WORKGROUP_SIZE, 1, 1);
+    }
+
+    // both buffers are read as indirect parameters by draw()
+    std::array<vk::BufferMemoryBarrier2, 2> to_draw_barriers = {{
+        {
+            .srcStageMask = vk::PipelineStageFlagBits2::eComputeShader,
+            .srcAccessMask = vk::AccessFlagBits2::eShaderStorageWrite,
+            .dstStageMask = vk::PipelineStageFlagBits2::eDrawIndirect,
+            .dstAccessMask = vk::AccessFlagBits2::eIndirectCommandRead,
+            .srcQueueFamilyIndex = vk::QueueFamilyIgnored,
+            .dstQueueFamilyIndex = vk::QueueFamilyIgnored,
+            .buffer = *frame.countBuffer,
+            .offset = 0,
+            .size = vk::WholeSize
+        },
+        {
+            .srcStageMask = vk::PipelineStageFlagBits2::eComputeShader,
+            .srcAccessMask = vk::AccessFlagBits2::eShaderStorageWrite,
+            .dstStageMask = vk::PipelineStageFlagBits2::eDrawIndirect,
+            .dstAccessMask = vk::AccessFlagBits2::eIndirectCommandRead,
+            .srcQueueFamilyIndex = vk::QueueFamilyIgnored,
+            .dstQueueFamilyIndex = vk::QueueFamilyIgnored,
+            .buffer = *frame.commandBuffer,
+            .offset = 0,
+            .size = vk::WholeSize
+        }
+    }};
+    command_buffer.pipelineBarrier2({
+        .bufferMemoryBarrierCount = static_cast<uint32_t>(to_draw_barriers.size()),
+        .pBufferMemoryBarriers = to_draw_barriers.data()
+    });
+}
+
+
+void GpuCuller::draw(vk::CommandBuffer command_buffer, uint32_t frame_index) const
+{
+    const FrameBuffers& frame = frames_[frame_index];
+    if (frame.objectCount == 0) return;
+
+    constexpr uint32_t stride = sizeof(vk::DrawIndexedIndirectCommand);
+    if (isCompacting_)
+    {
+        command_buffer.drawIndexedIndirectCount(*frame.commandBuffer, 0, *frame.countBuffer, 0, frame.objectCount, stride);
+    }
+    else
+    {
+        // one slot per object, culled ones were written with zero instances
+        command_buffer.drawIndexedIndirect(*frame.commandBuffer, 0, frame.objectCount, stride);
+    }
+}
+
+
+std::array<glm::vec4, 6> GpuCuller::extractFrustumPlanes(const glm::mat4& view_projection)
+{
+    // Gribb and Hartmann, rows of the matrix combined per clip plane. glm is column major, so rows are gathered
+    auto row = [&view_projection](int i)
+    {
+        return glm::vec4(view_projection[0][i], view_projection[1][i], view_projection[2][i], view_projection[3][i]);
+    };
+
+    std::array<glm::vec4, 6> planes = {
+        row(3) + row(0),  // left
+        row(3) - row(0),  // right
+        row(3) + row(1),  // bottom (top with a flipped y, the pair is symmetric)
+        row(3) - row(1),
+        row(2),           // near, depth is [0, 1]
+        row(3) - row(2)   // far
+    };
+
+    // normalized so the sphere test compares real distances
+    for (glm::vec4& plane : planes)
+    {
+        plane /= glm::length(glm::vec3(plane));
+    }
+    return planes;
+}
+
+
+// Accessor functions
+uint32_t GpuCuller::getObjectCount(uint32_t frame_index) const
+{
+    return frames_[frame_index].objectCount;
+}
+
+
+uint32_t GpuCuller::getMaxObjectCount() const
+{
+    return maxObjectCount_;
+}
+
+
+uint32_t GpuCuller::getObjectBufferHandle(uint32_t frame_index) const
+{
+    return frames_[frame_index].objectHandle;
+}
+
+
+bool GpuCuller::isCompacting() const
+{
+    return isCompacting_;
+}
@@ -0,0 +1,125 @@
+#pragma once
+
+#include <vulkan/vulkan_raii.hpp>
+#include <glm/glm.hpp>
+#include <array>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+#include "core/MemoryAllocator.h"
+
+// forward declaring classes
+class VulkanContext;
+class UploadEngine;
+class FrameScheduler;
+
+// One drawable instance, mirrors CullObject in shaders/cull.slang (96 bytes, tightly packed).
+// The index range refers to whatever index and vertex buffers are bound when the culled draws are issued.
+struct CullObject
+{
+    glm::mat4 transform = glm::mat4(1.0f);      // object to world
+    glm::vec4 boundingSphere = glm::vec4(0.0f);  // object space center in xyz, radius in w
+    uint32_t indexCount = 0;
+    uint32_t firstIndex = 0;
+    int32_t vertexOffset = 0;
+    uint32_t padding = 0;
+
+    static auto makeBoundingSphere(glm::vec3 bounds_min, glm::vec3 bounds_max) -> glm::vec4;  // encloses the box
+};
+static_assert(sizeof(CullObject) == 96, "CullObject must match the shader layout");
+
+
+// GPU driven draws: object transforms and bounds live in device local buffers, a compute pass tests
+// every object against the view frustum and writes the visible ones as vk::DrawIndexedIndirectCommand,
+// and one drawIndexedIndirectCount() draws them. The CPU cost of a frame doesn't grow with the object count.
+// Every draw carries its object index as firstInstance, vertex shaders read the object back through the
+// bindless heap (getObjectBufferHandle(), indexed with SV_VulkanInstanceID).
+// Without drawIndirectCount every object keeps its slot and culled ones get zero instances instead.
+// Object, command and count buffers exist once per frame in flight, so a new object list goes into the
+// slot about to be recorded while the frames in flight keep culling theirs, and the cull of one frame never
+// waits for the draws of the previous one.
+// Not thread safe.
+class GpuCuller
+{
+public:
+    // scheduler is the graphics timeline the culls and draws are submitted on, it must outlive the culler.
+    // throws std::runtime_error when the device has no multiDrawIndirect or drawIndirectFirstInstance
+    GpuCuller(
+        const VulkanContext& context,
+        UploadEngine& upload_engine,
+        const FrameScheduler& scheduler,
+        uint32_t max_object_count,
+        uint32_t frame_count
+    );
+    ~GpuCuller();  // the GPU must be done with every frame that culled or drew
+
+    // deleting copy constructors
+    GpuCuller(const GpuCuller&) = delete;
+    GpuCuller& operator=(const GpuCuller&) = delete;
+
+    // replaces the frame slot's object list, recorded into the upload engine and returns its timeline value
+    // (the cull waits on it through UploadEngine::getWaitInfo()). The slot's previous submit must have
+    // completed, the other slots keep their lists
+    auto setObjects(uint32_t frame_index, std::span<const CullObject> objects) -> uint64_t;
+
+    // outside of rendering: resets the frame's count, dispatches the cull and makes the commands visible to
+    // the indirect stage. view_projection maps to clip space with depth in [0, 1]
+    void cull(vk::CommandBuffer command_buffer, uint32_t frame_index, const glm::mat4& view_projection) const;
+
+    // inside rendering, with the pipeline, index and vertex buffers bound
+    void draw(vk::CommandBuffer command_buffer, uint32_t frame_index) const;
+
+    // accessor functions
+    uint32_t getObjectCount(uint32_t frame_index) const;
+    uint32_t getMaxObjectCount() const;
+    uint32_t getObjectBufferHandle(uint32_t frame_index) const;  // bindless storage buffer of CullObject
+    bool isCompacting() const;  // drawIndirectCount, only visible objects reach the input assembler
+
+    static constexpr uint32_t WORKGROUP_SIZE = 64;  // matches [numthreads] in shaders/cull.slang
+    static constexpr vk::DeviceSize UPLOAD_CHUNK_SIZE = 4ull << 20;  // 4 MiB, big object lists stream through the ring
+
+private:
+    struct FrameBuffers
+    {
+        vk::raii::Buffer objectBuffer = nullptr;   // max_object_count CullObject
+        vk::raii::Buffer commandBuffer = nullptr;  // max_object_count vk::DrawIndexedIndirectCommand
+        vk::raii::Buffer countBuffer = nullptr;    // uint32_t draw count
+        Allocation objectAllocation;
+        Allocation commandAllocation;
+        Allocation countAllocation;
+        uint32_t objectHandle = 0;
+        uint32_t commandHandle = 0;
+        uint32_t countHandle = 0;
+        uint32_t objectCount = 0;
+    };
+
+    // push constants of cullMain, fits the bindless heap's shared range
+    struct CullConstants
+    {
+        std::array<glm::vec4, 6> frustumPlanes{};  // xyz normal pointing inwards, w distance
+        uint32_t objectBufferHandle = 0;
+        uint32_t commandBufferHandle = 0;
+        uint32_t countBufferHandle = 0;
+        uint32_t objectCount = 0;
+        uint32_t isCompacting = 0;
+    };
+
+    void createPipeline();
+    auto createBuffer(vk::DeviceSize size, vk::BufferUsageFlags usage, bool is_uploaded, Allocation& allocation) const -> vk::raii::Buffer;
+    static auto extractFrustumPlanes(const glm::mat4& view_projection) -> std::array<glm::vec4, 6>;
+
+    // shader path, relative to the executable working directory
+    static constexpr const char* CULL_SHADER_PATH = "shaders/cull.comp.spv";
+
+    const VulkanContext& context_;
+    UploadEngine& uploadEngine_;
+    const FrameScheduler& scheduler_;
+    vk::raii::PipelineLayout layout_ = nullptr;
+    vk::raii::Pipeline pipeline_ = nullptr;
+
+    std::vector<FrameBuffers> frames_;
+
+    uint32_t maxObjectCount_ = 0;
+    bool isCompacting_ = false;
+};
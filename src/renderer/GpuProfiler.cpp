@@ -0,0 +1,390 @@
+#include "GpuProfiler.h"
+#include "core/VulkanContext.h"
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+#include <tuple>
+#include <utility>
+
+
+GpuProfiler::GpuProfiler(const VulkanContext& context, uint32_t frame_count, QueueType queue_type): context_(context)
+{
+    const vk::raii::PhysicalDevice& physical_device = context_.getPhysicalDevice();
+    uint32_t queue_family_index = context_.getQueueFamilyIndex(queue_type);
+    uint32_t timestamp_valid_bits = physical_device.getQueueFamilyProperties()[queue_family_index].timestampValidBits;
+
+    // 0 valid bits means the family can't write timestamps at all. The statistics pool counts vertex and
+    // fragment work, compute only families can't begin such a query
+    enabled_ = timestamp_valid_bits > 0;
+    statisticsEnabled_ = enabled_ && queue_type == QueueType::eGraphics && context_.isPipelineStatisticsEnabled();
+    debugLabelsEnabled_ = context_.isInstanceExtensionEnabled(vk::EXTDebugUtilsExtensionName);
+    timestampPeriodNs_ = physical_device.getProperties().limits.timestampPeriod;
+    timestampMask_ = timestamp_valid_bits >= 64 ? ~0ull : (1ull << timestamp_valid_bits) - 1;
+
+    if (!enabled_)
+    {
+        std::cout << "gpu profiler: queue family " << queue_family_index << " has no timestamp support, only labels are recorded\n";
+    }
+
+    createQueryPools(frame_count);
+}
+
+
+void GpuProfiler::createQueryPools(uint32_t frame_count)
+{
+    frames_.resize(frame_count);
+    if (!enabled_) return;
+
+    vk::QueryPoolCreateInfo timestamp_pool_create_info{
+        .queryType = vk::QueryType::eTimestamp,
+        .queryCount = MAX_SCOPES_PER_FRAME * 2  // begin and end of every scope
+    };
+
+    vk::QueryPoolCreateInfo statistics_pool_create_info{
+        .queryType = vk::QueryType::ePipelineStatistics,
+        .queryCount = MAX_SCOPES_PER_FRAME,
+        .pipelineStatistics = vk::QueryPipelineStatisticFlagBits::eInputAssemblyVertices |
+                              vk::QueryPipelineStatisticFlagBits::eInputAssemblyPrimitives |
+                              vk::QueryPipelineStatisticFlagBits::eVertexShaderInvocations |
+                              vk::QueryPipelineStatisticFlagBits::eClippingInvocations |
+                              vk::QueryPipelineStatisticFlagBits::eClippingPrimitives |
+                              vk::QueryPipelineStatisticFlagBits::eFragmentShaderInvocations |
+                              vk::QueryPipelineStatisticFlagBits::eComputeShaderInvocations
+    };
+
+    for (auto& frame : frames_)
+    {
+        frame.timestampPool = vk::raii::QueryPool(context_.getLogicalDevice(), timestamp_pool_create_info);
+        if (statisticsEnabled_)
+        {
+            frame.statisticsPool = vk::raii::QueryPool(context_.getLogicalDevice(), statistics_pool_create_info);
+        }
+    }
+}
+
+
+void GpuProfiler::beginFrame(uint32_t frame_index, vk::CommandBuffer command_buffer)
+{
+    FrameQueries& frame = frames_[frame_index];
+    if (frame.isRecorded)
+    {
+        readBack(frame);
+    }
+
+    frame.scopes.clear();
+    frame.statisticsCount = 0;
+    frame.frameNumber = frameCounter_++;
+    frame.isRecorded = enabled_;
+    currentFrame_ = &frame;
+    openScopes_.clear();
+
+    if (!enabled_) return;
+
+    // reset on the GPU, ordered before the writes of this frame without any host query reset feature
+    command_buffer.resetQueryPool(*frame.timestampPool, 0, MAX_SCOPES_PER_FRAME * 2);
+    if (statisticsEnabled_)
+    {
+        command_buffer.resetQueryPool(*frame.statisticsPool, 0, MAX_SCOPES_PER_FRAME);
+    }
+}
+
+
+void GpuProfiler::readBack(FrameQueries& frame)
+{
+    frame.isRecorded = false;
+    if (frame.scopes.empty()) return;
+
+    // the submit completed, so no wait flag: eNotReady would only mean a scope was never closed
+    uint32_t timestamp_count = static_cast<uint32_t>(frame.scopes.size()) * 2;
+    auto [timestamp_result, timestamps] = frame.timestampPool.getResults<uint64_t>(
+        0,
+        timestamp_count,
+        timestamp_count * sizeof(uint64_t),
+        sizeof(uint64_t),
+        vk::QueryResultFlagBits::e64
+    );
+    if (timestamp_result != vk::Result::eSuccess) return;
+
+    std::vector<uint64_t> statistics;
+    if (frame.statisticsCount > 0)
+    {
+        vk::Result statistics_result;
+        std::tie(statistics_result, statistics) = frame.statisticsPool.getResults<uint64_t>(
+            0,
+            frame.statisticsCount,
+            frame.statisticsCount * STATISTICS_COUNTER_COUNT * sizeof(uint64_t),
+            STATISTICS_COUNTER_COUNT * sizeof(uint64_t),
+            vk::QueryResultFlagBits::e64
+        );
+        if (statistics_result != vk::Result::eSuccess) statistics.clear();
+    }
+
+    ProfiledFrame profiled_frame{.frameNumber = frame.frameNumber};
+    profiled_frame.passes.reserve(frame.scopes.size());
+    uint64_t frame_begin = UINT64_MAX;
+    uint64_t frame_end = 0;
+    for (const auto& scope : frame.scopes)
+    {
+        uint64_t begin = timestamps[scope.timestampQuery];
+        uint64_t end = timestamps[scope.timestampQuery + 1];
+        uint64_t ticks = (end - begin) & timestampMask_;  // wraps correctly within the valid bits
+        if (scope.depth == 0)
+        {
+            frame_begin = std::min(frame_begin, begin & timestampMask_);
+            frame_end = std::max(frame_end, (begin & timestampMask_) + ticks);
+        }
+
+        PassTiming pass{
+            .name = scope.name,
+            .depth = scope.depth,
+            .gpuMs = static_cast<double>(ticks) * timestampPeriodNs_ / 1'000'000.0
+        };
+
+        if (scope.statisticsQuery != UINT32_MAX && !statistics.empty())
+        {
+            const uint64_t* counters = statistics.data() + scope.statisticsQuery * STATISTICS_COUNTER_COUNT;
+            pass.hasStatistics = true;
+            pass.statistics = PipelineStatistics{
+                .inputAssemblyVertices = counters[0],
+                .inputAssemblyPrimitives = counters[1],
+                .vertexShaderInvocations = counters[2],
+                .clippingInvocations = counters[3],
+                .clippingPrimitives = counters[4],
+                .fragmentShaderInvocations = counters[5],
+                .computeShaderInvocations = counters[6]
+            };
+        }
+
+        profiled_frame.passes.push_back(std::move(pass));
+    }
+    profiled_frame.beginMs = static_cast<double>(frame_begin) * timestampPeriodNs_ / 1'000'000.0;
+    profiled_frame.endMs = static_cast<double>(frame_end) * timestampPeriodNs_ / 1'000'000.0;
+
+    history_.push_back(std::move(profiled_frame));
+    while (history_.size() > HISTORY_LENGTH)
+    {
+        history_.pop_front();
+    }
+}
+
+
+void GpuProfiler::beginScope(vk::CommandBuffer command_buffer, const char* name, bool with_statistics)
+{
+    if (debugLabelsEnabled_)
+    {
+        // extension command, dispatched through the device instead of the statically linked loader
+        command_buffer.beginDebugUtilsLabelEXT({.pLabelName = name}, *context_.getLogicalDevice().getDispatcher());
+    }
+
+    OpenScope open_scope;
+    bool has_queries = enabled_ && currentFrame_ && currentFrame_->scopes.size() < MAX_SCOPES_PER_FRAME;
+    if (has_queries)
+    {
+        Scope scope{
+            .name = name,
+            .depth = static_cast<uint32_t>(openScopes_.size()),
+            .timestampQuery = static_cast<uint32_t>(currentFrame_->scopes.size()) * 2
+        };
+        command_buffer.writeTimestamp2(vk::PipelineStageFlagBits2::eTopOfPipe, *currentFrame_->timestampPool, scope.timestampQuery);
+
+        if (statisticsEnabled_ && with_statistics && openScopes_.empty())
+        {
+            scope.statisticsQuery = currentFrame_->statisticsCount++;
+            command_buffer.beginQuery(*currentFrame_->statisticsPool, scope.statisticsQuery, {});
+            open_scope.hasStatistics = true;
+        }
+
+        open_scope.scopeIndex = static_cast<uint32_t>(currentFrame_->scopes.size());
+        currentFrame_->scopes.push_back(std::move(scope));
+    }
+
+    openScopes_.push_back(open_scope);
+}
+
+
+void GpuProfiler::endScope(vk::CommandBuffer command_buffer)
+{
+    if (openScopes_.empty()) return;  // unbalanced, called from destructors so it must not throw
+
+    OpenScope open_scope = openScopes_.back();
+    openScopes_.pop_back();
+
+    if (open_scope.scopeIndex != UINT32_MAX)
+    {
+        const Scope& scope = currentFrame_->scopes[open_scope.scopeIndex];
+        if (open_scope.hasStatistics)
+        {
+            command_buffer.endQuery(*currentFrame_->statisticsPool, scope.statisticsQuery);
+        }
+        command_buffer.writeTimestamp2(vk::PipelineStageFlagBits2::eBottomOfPipe, *currentFrame_->timestampPool, scope.timestampQuery + 1);
+    }
+
+    if (debugLabelsEnabled_)
+    {
+        command_buffer.endDebugUtilsLabelEXT(*context_.getLogicalDevice().getDispatcher());
+    }
+}
+
+
+std::vector<double> GpuProfiler::getPassHistory(std::string_view name) const
+{
+    // a pass recorded several times in one frame counts as their sum
+    std::vector<double> pass_history;
+    pass_history.reserve(history_.size());
+    for (const auto& frame : history_)
+    {
+        double total_ms = 0.0;
+        bool is_found = false;
+        for (const auto& pass : frame.passes)
+        {
+            if (pass.name != name) continue;
+            total_ms += pass.gpuMs;
+            is_found = true;
+        }
+        if (is_found) pass_history.push_back(total_ms);
+    }
+
+    return pass_history;
+}
+
+
+void GpuProfiler::writeCsv(const std::filesystem::path& file_path) const
+{
+    std::ofstream file(file_path, std::ios::trunc);
+    if (!file.is_open())
+    {
+        throw std::runtime_error("failed to open " + file_path.string() + " for writing");
+    }
+
+    file << "frame,pass,depth,gpu_ms,ia_vertices,ia_primitives,vs_invocations,clipping_invocations,"
+            "clipping_primitives,fs_invocations,cs_invocations\n";
+    for (const auto& frame : history_)
+    {
+        for (const auto& pass : frame.passes)
+        {
+            file << frame.frameNumber << "," << pass.name << "," << pass.depth << "," << pass.gpuMs;
+            if (pass.hasStatistics)
+            {
+                const PipelineStatistics& statistics = pass.statistics;
+                file << "," << statistics.inputAssemblyVertices << "," << statistics.inputAssemblyPrimitives
+                     << "," << statistics.vertexShaderInvocations << "," << statistics.clippingInvocations
+                     << "," << statistics.clippingPrimitives << "," << statistics.fragmentShaderInvocations
+                     << "," << statistics.computeShaderInvocations;
+            }
+            else
+            {
+                file << ",,,,,,,";
+            }
+            file << "\n";
+        }
+    }
+
+    if (!file)
+    {
+        throw std::runtime_error("failed to write " + file_path.string());
+    }
+}
+
+
+void GpuProfiler::printStatistics() const
+{
+    std::cout << "gpu profiler over the last " << history_.size() << " frames:\n";
+
+    // passes in the order they first showed up
+    std::vector<std::string> pass_names;
+    for (const auto& frame : history_)
+    {
+        for (const auto& pass : frame.passes)
+        {
+            if (std::ranges::find(pass_names, pass.name) == pass_names.end()) pass_names.push_back(pass.name);
+        }
+    }
+
+    for (const auto& pass_name : pass_names)
+    {
+        std::vector<double> pass_history = getPassHistory(pass_name);
+        double total_ms = 0.0;
+        double max_ms = 0.0;
+        for (double gpu_ms : pass_history)
+        {
+            total_ms += gpu_ms;
+            max_ms = std::max(max_ms, gpu_ms);
+        }
+        std::cout << "\t " << pass_name << ": avg " << total_ms / pass_history.size() << " ms, max " << max_ms << " ms\n";
+    }
+}
+
+
+QueueOverlapStatistics GpuProfiler::measureOverlap(const GpuProfiler& first, const GpuProfiler& second)
+{
+    QueueOverlapStatistics overlap;
+    if (!first.enabled_ || !second.enabled_ || first.history_.empty() || second.history_.empty()) return overlap;
+
+    // only the time both histories cover, the older one reaches further back
+    double window_begin = std::max(first.history_.front().beginMs, second.history_.front().beginMs);
+    double window_end = std::min(first.history_.back().endMs, second.history_.back().endMs);
+    if (window_end <= window_begin) return overlap;
+    overlap.windowMs = window_end - window_begin;
+
+    auto clip = [window_begin, window_end](const ProfiledFrame& frame)
+    {
+        return std::pair<double, double>{std::max(frame.beginMs, window_begin), std::min(frame.endMs, window_end)};
+    };
+
+    // frames of one queue don't overlap each other, so both lists are sorted and one sweep finds every intersection
+    auto first_it = first.history_.begin();
+    for (const auto& second_frame : second.history_)
+    {
+        auto [second_begin, second_end] = clip(second_frame);
+        if (second_end <= second_begin) continue;
+        overlap.frameCount++;
+        overlap.secondBusyMs += second_end - second_begin;
+
+        while (first_it != first.history_.end() && first_it->endMs <= second_begin) first_it++;
+        for (auto it = first_it; it != first.history_.end() && it->beginMs < second_end; it++)
+        {
+            auto [first_begin, first_end] = clip(*it);
+            overlap.overlapMs += std::max(0.0, std::min(first_end, second_end) - std::max(first_begin, second_begin));
+        }
+    }
+    for (const auto& first_frame : first.history_)
+    {
+        auto [first_begin, first_end] = clip(first_frame);
+        overlap.firstBusyMs += std::max(0.0, first_end - first_begin);
+    }
+
+    return overlap;
+}
+
+
+// Accessor functions
+const std::deque<ProfiledFrame>& GpuProfiler::getHistory() const
+{
+    return history_;
+}
+
+
+bool GpuProfiler::isEnabled() const
+{
+    return enabled_;
+}
+
+
+bool GpuProfiler::isPipelineStatisticsEnabled() const
+{
+    return statisticsEnabled_;
+}
+
+
+GpuProfileScope::GpuProfileScope(GpuProfiler& profiler, vk::CommandBuffer command_buffer, const char* name, bool with_statistics)
+    : profiler_(profiler), commandBuffer_(command_buffer)
+{
+    profiler_.beginScope(commandBuffer_, name, with_statistics);
+}
+
+
+GpuProfileScope::~GpuProfileScope()
+{
+    profiler_.endScope(commandBuffer_);
+}
@@ -0,0 +1,152 @@
+#pragma once
+
+#include <vulkan/vulkan_raii.hpp>
+#include <cstdint>
+#include <deque>
+#include <filesystem>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// forward declaring classes
+class VulkanContext;
+enum class QueueType;
+
+// counters of one top level scope, in the order the query pool returns them
+struct PipelineStatistics
+{
+    uint64_t inputAssemblyVertices = 0;
+    uint64_t inputAssemblyPrimitives = 0;
+    uint64_t vertexShaderInvocations = 0;
+    uint64_t clippingInvocations = 0;
+    uint64_t clippingPrimitives = 0;
+    uint64_t fragmentShaderInvocations = 0;
+    uint64_t computeShaderInvocations = 0;
+};
+
+struct PassTiming
+{
+    std::string name;
+    uint32_t depth = 0;  // 0 for top level scopes
+    double gpuMs = 0.0;
+    bool hasStatistics = false;
+    PipelineStatistics statistics;
+};
+
+struct ProfiledFrame
+{
+    uint64_t frameNumber = 0;
+    std::vector<PassTiming> passes;  // in the order the scopes were opened
+    double beginMs = 0.0;  // first top level scope begin and last end, on the device timestamp clock
+    double endMs = 0.0;
+};
+
+
+// How busy two queues were over the time both profilers have history for, and how much of it they spent
+// working at the same time. Busy time is the union of each frame's top level scopes.
+struct QueueOverlapStatistics
+{
+    uint32_t frameCount = 0;  // frames of the second profiler within the window
+    double windowMs = 0.0;
+    double firstBusyMs = 0.0;
+    double secondBusyMs = 0.0;
+    double overlapMs = 0.0;   // both queues busy
+};
+
+// GPU timestamps (and pipeline statistics when the device has them) around named scopes of a frame.
+// Every frame slot owns its own query pools, beginFrame() reads back what the slot recorded last time,
+// which is only called once the FrameScheduler saw that submit complete, so reading never stalls.
+// Scopes also show up as VK_EXT_debug_utils labels in capture tools when the instance has the extension.
+// One profiler covers the command buffers of one queue type, pipeline statistics are graphics only.
+// Not thread safe, scopes are recorded into primaries on the thread calling drawFrame.
+class GpuProfiler
+{
+public:
+    GpuProfiler(const VulkanContext& context, uint32_t frame_count, QueueType queue_type);
+
+    // deleting copy constructors
+    GpuProfiler(const GpuProfiler&) = delete;
+    GpuProfiler& operator=(const GpuProfiler&) = delete;
+
+    // the slot's previous submit must have completed, records the query pool resets into command_buffer
+    void beginFrame(uint32_t frame_index, vk::CommandBuffer command_buffer);
+
+    // scopes nest, pipeline statistics are only gathered for top level scopes (queries of one type can't
+    // be active twice) and only when with_statistics is set, primaries executing secondaries must pass false
+    void beginScope(vk::CommandBuffer command_buffer, const char* name, bool with_statistics = true);
+    void endScope(vk::CommandBuffer command_buffer);
+
+    auto getHistory() const -> const std::deque<ProfiledFrame>&;  // oldest first, at most HISTORY_LENGTH frames
+    auto getPassHistory(std::string_view name) const -> std::vector<double>;  // milliseconds, oldest first
+    void writeCsv(const std::filesystem::path& file_path) const;  // throws std::runtime_error on failure
+    void printStatistics() const;
+
+    // compares absolute timestamps, queues of one device share the timestamp clock in practice but the
+    // spec doesn't promise it. Empty when either profiler is disabled or has no history yet
+    static auto measureOverlap(const GpuProfiler& first, const GpuProfiler& second) -> QueueOverlapStatistics;
+
+    bool isEnabled() const;  // false when the queue's family has no timestamp support
+    bool isPipelineStatisticsEnabled() const;
+
+    static constexpr uint32_t MAX_SCOPES_PER_FRAME = 64;  // further scopes are only labeled, not timed
+    static constexpr uint32_t HISTORY_LENGTH = 512;
+
+private:
+    struct Scope
+    {
+        std::string name;
+        uint32_t depth = 0;
+        uint32_t timestampQuery = 0;  // begin, end is the next query
+        uint32_t statisticsQuery = UINT32_MAX;
+    };
+
+    struct FrameQueries
+    {
+        vk::raii::QueryPool timestampPool = nullptr;
+        vk::raii::QueryPool statisticsPool = nullptr;  // stays null without pipeline statistics
+        std::vector<Scope> scopes;
+        uint32_t statisticsCount = 0;
+        uint64_t frameNumber = 0;
+        bool isRecorded = false;
+    };
+
+    struct OpenScope
+    {
+        uint32_t scopeIndex = UINT32_MAX;  // UINT32_MAX when the frame ran out of queries
+        bool hasStatistics = false;
+    };
+
+    void createQueryPools(uint32_t frame_count);
+    void readBack(FrameQueries& frame);
+
+    static constexpr uint32_t STATISTICS_COUNTER_COUNT = 7;  // members of PipelineStatistics
+
+    const VulkanContext& context_;
+    bool enabled_ = false;
+    bool statisticsEnabled_ = false;
+    bool debugLabelsEnabled_ = false;
+    double timestampPeriodNs_ = 1.0;
+    uint64_t timestampMask_ = ~0ull;
+    std::vector<FrameQueries> frames_;
+    FrameQueries* currentFrame_ = nullptr;
+    std::vector<OpenScope> openScopes_;
+    uint64_t frameCounter_ = 0;
+    std::deque<ProfiledFrame> history_;
+};
+
+
+// RAII helper, ends the scope when it goes out of scope
+class GpuProfileScope
+{
+public:
+    GpuProfileScope(GpuProfiler& profiler, vk::CommandBuffer command_buffer, const char* name, bool with_statistics = true);
+    ~GpuProfileScope();
+
+    // deleting copy constructors
+    GpuProfileScope(const GpuProfileScope&) = delete;
+    GpuProfileScope& operator=(const GpuProfileScope&) = delete;
+
+private:
+    GpuProfiler& profiler_;
+    vk::CommandBuffer commandBuffer_;
+};
@@ -0,0 +1,273 @@
+#include "GraphicsPipeline.h"
+#include "ParallelRecorder.h"
+#include "FrameScheduler.h"
+#include "PipelineStateCache.h"
+#include "ScenePass.h"
+#include "UniformRing.h"
+#include "core/VulkanContext.h"
+#include <algorithm>
+#include <array>
+#include <iostream>
+
+
+GraphicsPipeline::GraphicsPipeline(
+    const VulkanContext& context,
+    PipelineStateCache& state_cache,
+    vk::Format color_format,
+    const TransientAttachmentDesc& attachment_desc
+)
+    : context_(context), stateCache_(state_cache), description_(makeDescription(color_format, attachment_desc))
+{
+    createPipelineLayout();
+    (void)stateCache_.getPipeline(description_, *layout_);  // queued now, the first frame finds it compiling or done
+}
+
+
+GraphicsPipeline::~GraphicsPipeline()
+{
+    reloadHandle_.wait();
+    stateCache_.releaseLayout(*layout_);
+}
+
+
+void GraphicsPipeline::reload(PipelineCompiler& compiler)
+{
+    // a reload still compiling is simply replaced, its handle keeps the state alive until the worker is done
+    reloadHandle_ = compiler.compile(description_, *layout_);
+}
+
+
+bool GraphicsPipeline::applyReload(FrameScheduler& scheduler)
+{
+    if (!reloadHandle_.isValid() || !(reloadHandle_.isReady() || reloadHandle_.hasFailed())) return false;
+
+    if (reloadHandle_.hasFailed())
+    {
+        // the compiler already logged why, we keep drawing with the old pipeline
+        reloadHandle_ = PipelineHandle();
+        return false;
+    }
+
+    // frames in flight may still use the previous reload, the cache's pipeline stays in the cache
+    if (reloadedHandle_.isValid()) scheduler.retire(std::move(reloadedHandle_));
+    reloadedHandle_ = std::move(reloadHandle_);
+    reloadHandle_ = PipelineHandle();
+    std::cout << "graphics pipeline '" << description_.name << "' reloaded\n";
+
+    return true;
+}
+
+
+void GraphicsPipeline::createPipelineLayout()
+{
+    // the bindless heap and the uniform ring, per draw data goes through the shared push constant range
+    // or, when it's bigger, the ring. The ring doesn't exist yet, a compatible copy of its layout does
+    const BindlessHeap& bindless_heap = context_.getBindlessHeap();
+    uniformSetLayout_ = UniformRing::createSetLayout(context_.getLogicalDevice());
+    std::array<vk::DescriptorSetLayout, 2> set_layouts = {*bindless_heap.getSetLayout(), *uniformSetLayout_};
+    vk::PushConstantRange push_constant_range = bindless_heap.getPushConstantRange();
+
+    vk::PipelineLayoutCreateInfo pipeline_layout_create_info{
+        .setLayoutCount = static_cast<uint32_t>(set_layouts.size()),
+        .pSetLayouts = set_layouts.data(),
+        .pushConstantRangeCount = 1,
+        .pPushConstantRanges = &push_constant_range
+    };
+
+    layout_ = vk::raii::PipelineLayout(context_.getLogicalDevice(), pipeline_layout_create_info);
+}
+
+
+GraphicsPipelineDescription GraphicsPipeline::makeDescription(vk::Format color_format, const TransientAttachmentDesc& attachment_desc)
+{
+    return GraphicsPipelineDescription{
+        .name = "triangle",
+        .vertexShaderPath = VERTEX_SHADER_PATH,
+        .fragmentShaderPath = FRAGMENT_SHADER_PATH,
+        .colorFormat = color_format,
+        .depthFormat = attachment_desc.depthFormat,
+        .sampleCount = attachment_desc.sampleCount
+    };
+}
+
+
+void GraphicsPipeline::record(
+    vk::CommandBuffer command_buffer,
+    vk::Extent2D extent,
+    vk::ImageView image_view,
+    UniformRing& uniform_ring,
+    const ScenePass* scene_pass,
+    const TransientAttachments* attachments
+) const
+{
+    beginColorRendering(command_buffer, extent, image_view, attachments, {});
+
+    // fallback while the pipeline is still compiling (or failed): the attachment is only cleared
+    if (scene_pass)
+    {
+        scene_pass->recordDraw(command_buffer, extent, uniform_ring);
+    }
+    else if (vk::Pipeline pipeline = getPipeline())
+    {
+        recordDraw(command_buffer, extent, pipeline, uniform_ring);
+    }
+
+    endColorRendering(command_buffer);
+}
+
+
+void GraphicsPipeline::recordParallel(
+    vk::CommandBuffer command_buffer,
+    vk::Extent2D extent,
+    vk::ImageView image_view,
+    UniformRing& uniform_ring,
+    ParallelRecorder& recorder,
+    uint32_t frame_index,
+    const ScenePass* scene_pass,
+    const TransientAttachments* attachments
+) const
+{
+    // the primary only clears, every draw comes from the recorder's secondaries
+    beginColorRendering(command_buffer, extent, image_view, attachments, vk::RenderingFlagBits::eContentsSecondaryCommandBuffers);
+
+    vk::Pipeline pipeline = getPipeline();
+    if (scene_pass || pipeline)
+    {
+        vk::CommandBufferInheritanceRenderingInfo inheritance_rendering_info{
+            .colorAttachmentCount = 1,
+            .pColorAttachmentFormats = &description_.colorFormat,
+            .depthAttachmentFormat = description_.depthFormat,
+            .rasterizationSamples = description_.sampleCount
+        };
+
+        // the triangle or the scene is a single item, draw lists go through the same path
+        recorder.record(
+            frame_index,
+            command_buffer,
+            inheritance_rendering_info,
+            1,
+            [this, extent, pipeline, scene_pass, &uniform_ring](vk::CommandBuffer secondary_command_buffer, uint32_t, uint32_t)
+            {
+                if (scene_pass) scene_pass->recordDraw(secondary_command_buffer, extent, uniform_ring);
+                else recordDraw(secondary_command_buffer, extent, pipeline, uniform_ring);
+            }
+        );
+    }
+
+    endColorRendering(command_buffer);
+}
+
+
+void GraphicsPipeline::beginColorRendering(
+    vk::CommandBuffer command_buffer,
+    vk::Extent2D extent,
+    vk::ImageView image_view,
+    const TransientAttachments* attachments,
+    vk::RenderingFlags rendering_flags
+) const
+{
+    vk::ClearColorValue clear_color = {.float32 = std::array<float, 4>{0.0f, 0.0f, 0.0f, 1.0f}};  // black
+    vk::RenderingAttachmentInfo color_attachment_info{
+        .imageView = image_view,
+        .imageLayout = vk::ImageLayout::eColorAttachmentOptimal,
+        .loadOp = vk::AttachmentLoadOp::eClear,
+        .storeOp = vk::AttachmentStoreOp::eStore,
+        .clearValue = {.color = clear_color}
+    };
+    vk::RenderingAttachmentInfo depth_attachment_info{};
+
+    // MSAA renders into the transient image and resolves into image_view at the end of rendering
+    if (attachments)
+    {
+        color_attachment_info = attachments->getColorAttachmentInfo(image_view, clear_color);
+        if (attachments->hasDepth()) depth_attachment_info = attachments->getDepthAttachmentInfo();
+    }
+
+    vk::RenderingInfo rendering_info{
+        .flags = rendering_flags,
+        .renderArea = {
+            .offset = {0, 0},
+            .extent = extent
+        },
+        .layerCount = 1,
+        .colorAttachmentCount = 1,
+        .pColorAttachments = &color_attachment_info,
+        .pDepthAttachment = (attachments && attachments->hasDepth()) ? &depth_attachment_info : nullptr
+    };
+
+    command_buffer.beginRendering(rendering_info);
+}
+
+
+void GraphicsPipeline::endColorRendering(vk::CommandBuffer command_buffer) const
+{
+    command_buffer.endRendering();
+}
+
+
+void GraphicsPipeline::recordDraw(vk::CommandBuffer command_buffer, vk::Extent2D extent, vk::Pipeline pipeline, UniformRing& uniform_ring) const
+{
+    // dynamic state and bound sets aren't inherited by secondaries, so they're set together with every bind.
+    // The cache's pipeline may bake other values for the dynamic state, recordDynamicState() sets ours
+    command_buffer.bindPipeline(vk::PipelineBindPoint::eGraphics, pipeline);
+    context_.getBindlessHeap().bind(command_buffer, vk::PipelineBindPoint::eGraphics, *layout_);
+    command_buffer.setViewport(
+        0,
+        vk::Viewport{
+            .x = 0.0f,
+            .y = 0.0f,
+            .width = static_cast<float>(extent.width),
+            .height = static_cast<float>(extent.height),
+            .minDepth = 0.0f,
+            .maxDepth = 1.0f
+        }
+    );
+    command_buffer.setScissor(0, vk::Rect2D{.offset = {0, 0}, .extent = extent});
+    PipelineCompiler::recordDynamicState(command_buffer, context_, description_);
+
+    // the shorter side spans clip space, the longer one is scaled down to match it
+    float min_side = static_cast<float>(std::min(extent.width, extent.height));
+    TriangleDrawData draw_data{
+        .scale = glm::vec2(min_side / static_cast<float>(extent.width), min_side / static_cast<float>(extent.height))
+    };
+    uniform_ring.bindDrawData(command_buffer, vk::PipelineBindPoint::eGraphics, *layout_, draw_data);
+    command_buffer.draw(3, 1, 0, 0);
+}
+
+
+// Accessor functions
+const GraphicsPipelineDescription& GraphicsPipeline::getDescription() const
+{
+    return description_;
+}
+
+
+bool GraphicsPipeline::isReady() const
+{
+    return getPipeline() != nullptr;
+}
+
+
+bool GraphicsPipeline::isReloadFinished() const
+{
+    return reloadHandle_.isValid() && (reloadHandle_.isReady() || reloadHandle_.hasFailed());
+}
+
+
+vk::Pipeline GraphicsPipeline::getPipeline() const
+{
+    if (reloadedHandle_.isReady()) return *reloadedHandle_.getPipeline();
+    return stateCache_.getPipeline(description_, *layout_);  // a hash lookup once it's cached
+}
+
+
+const vk::raii::PipelineLayout& GraphicsPipeline::getLayout() const
+{
+    return layout_;
+}
+
+
+PipelineStateCache& GraphicsPipeline::getStateCache() const
+{
+    return stateCache_;
+}
@@ -0,0 +1,113 @@
+#pragma once
+
+#include <vulkan/vulkan_raii.hpp>
+#include <glm/glm.hpp>
+#include <string>
+
+#include "PipelineCompiler.h"
+#include "core/TransientAttachments.h"
+
+// forward declaring classes
+class VulkanContext;
+class ParallelRecorder;
+class FrameScheduler;
+class PipelineStateCache;
+class UniformRing;
+class ScenePass;
+
+class GraphicsPipeline
+{
+public:
+    // attachment_desc: the transient attachments record() renders with (sample count and depth format),
+    // the default renders straight into the target.
+    // The pipeline comes from state_cache, which must outlive this. Asking for it queues the compile (or
+    // links it from libraries) and returns straight away, record() only clears until it's ready
+    GraphicsPipeline(
+        const VulkanContext& context,
+        PipelineStateCache& state_cache,
+        vk::Format color_format,
+        const TransientAttachmentDesc& attachment_desc = {}
+    );
+    ~GraphicsPipeline();  // drops the cache's pipelines for layout_, the GPU must be done with them
+
+    // hot reload: compiles the same description again from the shader files as they are on disk now.
+    // The cache can't tell SPIR-V versions apart, so the reload bypasses it
+    void reload(PipelineCompiler& compiler);
+    // swaps in a finished reload, the previous one is retired to scheduler until the frames using it completed.
+    // Called by the Renderer before recording, returns true when the pipeline changed.
+    bool applyReload(FrameScheduler& scheduler);
+
+    // deleting copy constructors
+    GraphicsPipeline(const GraphicsPipeline&) = delete;
+    GraphicsPipeline& operator=(const GraphicsPipeline&) = delete;
+
+    // called by the Renderer each frame, skips the draw while the pipeline is still compiling.
+    // The per draw data goes through uniform_ring (Renderer::getUniformRing()), already reset for the frame.
+    // scene_pass is drawn instead of the triangle when it's not null, it must be ready and prepared.
+    // attachments must use the pipeline's attachment desc, null without one.
+    // The image behind image_view and the attachments must be in attachment layout, Renderer::drawFrame
+    // declares the pass in its RenderGraph and the graph places the transitions
+    void record(
+        vk::CommandBuffer command_buffer,
+        vk::Extent2D extent,
+        vk::ImageView image_view,
+        UniformRing& uniform_ring,
+        const ScenePass* scene_pass = nullptr,
+        const TransientAttachments* attachments = nullptr
+    ) const;
+
+    // same as record() but the draws are recorded into secondaries on the recorder's workers
+    void recordParallel(
+        vk::CommandBuffer command_buffer,
+        vk::Extent2D extent,
+        vk::ImageView image_view,
+        UniformRing& uniform_ring,
+        ParallelRecorder& recorder,
+        uint32_t frame_index,
+        const ScenePass* scene_pass = nullptr,
+        const TransientAttachments* attachments = nullptr
+    ) const;
+
+    // accessor functions
+    auto getDescription() const -> const GraphicsPipelineDescription&;
+    bool isReady() const;  // never blocks
+    bool isReloadFinished() const;  // a reload compiled or failed, the next applyReload() takes it
+    vk::Pipeline getPipeline() const;  // the applied reload or the cache's pipeline, null while compiling
+    auto getLayout() const -> const vk::raii::PipelineLayout&;
+    auto getStateCache() const -> PipelineStateCache&;  // Renderer::drawFrame() collects it once per frame
+
+private:
+    // per draw data of the triangle, mirrors TriangleDrawData in shaders/triangle.slang
+    struct TriangleDrawData
+    {
+        glm::vec2 scale = glm::vec2(1.0f);  // keeps the triangle's proportions in any extent
+    };
+
+    // private member functions
+    void createPipelineLayout();
+    static auto makeDescription(vk::Format color_format, const TransientAttachmentDesc& attachment_desc) -> GraphicsPipelineDescription;
+
+    // recording helpers shared by record() and recordParallel()
+    void beginColorRendering(
+        vk::CommandBuffer command_buffer,
+        vk::Extent2D extent,
+        vk::ImageView image_view,
+        const TransientAttachments* attachments,
+        vk::RenderingFlags rendering_flags
+    ) const;
+    void endColorRendering(vk::CommandBuffer command_buffer) const;
+    void recordDraw(vk::CommandBuffer command_buffer, vk::Extent2D extent, vk::Pipeline pipeline, UniformRing& uniform_ring) const;
+
+    // shader paths, relative to the executable working directory
+    static constexpr const char* VERTEX_SHADER_PATH = "shaders/triangle.vert.spv";
+    static constexpr const char* FRAGMENT_SHADER_PATH = "shaders/triangle.frag.spv";
+
+    // private member variables
+    const VulkanContext& context_;
+    PipelineStateCache& stateCache_;
+    GraphicsPipelineDescription description_;
+    vk::raii::DescriptorSetLayout uniformSetLayout_ = nullptr;  // UniformRing::createSetLayout(), set 1
+    vk::raii::PipelineLayout layout_ = nullptr;
+    PipelineHandle reloadedHandle_;  // the applied hot reload, takes over from the cache's pipeline
+    PipelineHandle reloadHandle_;    // valid while a hot reload is compiling
+};
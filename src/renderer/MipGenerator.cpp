@@ -0,0 +1,237 @@
+#include "MipGenerator.h"
+#include "core/VulkanContext.h"
+#include "utils/Trace.h"
+#include <algorithm>
+#include <array>
+#include <bit>
+
+
+MipGenerator::MipGenerator(const VulkanContext& context): context_(context)
+{
+    vk::SemaphoreTypeCreateInfo semaphore_type_create_info{
+        .semaphoreType = vk::SemaphoreType::eTimeline,
+        .initialValue = 0
+    };
+
+    vk::SemaphoreCreateInfo semaphore_create_info{
+        .pNext = &semaphore_type_create_info
+    };
+
+    timelineSemaphore_ = vk::raii::Semaphore(context_.getLogicalDevice(), semaphore_create_info);
+}
+
+
+MipGenerator::~MipGenerator()
+{
+    wait(lastSubmittedValue_);
+}
+
+
+bool MipGenerator::supportsFormat(vk::Format format) const
+{
+    vk::FormatFeatureFlags features = context_.getPhysicalDevice().getFormatProperties(format).optimalTilingFeatures;
+    vk::FormatFeatureFlags required = vk::FormatFeatureFlagBits::eBlitSrc
+                                    | vk::FormatFeatureFlagBits::eBlitDst
+                                    | vk::FormatFeatureFlagBits::eSampledImageFilterLinear;
+    return (features & required) == required;
+}
+
+
+MipGenerator::Submission MipGenerator::beginSubmission()
+{
+    collectLocked();
+
+    Submission submission;
+    if (!freeSubmissions_.empty())
+    {
+        submission = std::move(freeSubmissions_.back());
+        freeSubmissions_.pop_back();
+        submission.commandPool.reset();
+    }
+    else
+    {
+        vk::CommandPoolCreateInfo command_pool_create_info{
+            .flags = vk::CommandPoolCreateFlagBits::eTransient,
+            .queueFamilyIndex = context_.getQueueFamilyIndex(QueueType::eGraphics)
+        };
+        submission.commandPool = vk::raii::CommandPool(context_.getLogicalDevice(), command_pool_create_info);
+
+        vk::CommandBufferAllocateInfo command_buffer_allocate_info{
+            .commandPool = *submission.commandPool,
+            .level = vk::CommandBufferLevel::ePrimary,
+            .commandBufferCount = 1
+        };
+        submission.commandBuffer = std::move(context_.getLogicalDevice().allocateCommandBuffers(command_buffer_allocate_info).front());
+    }
+
+    submission.commandBuffer.begin({.flags = vk::CommandBufferUsageFlagBits::eOneTimeSubmit});
+    return submission;
+}
+
+
+uint64_t MipGenerator::generate(
+    vk::Image image,
+    vk::Extent2D extent,
+    uint32_t mip_level_count,
+    vk::ImageLayout final_layout,
+    const vk::SemaphoreSubmitInfo& wait_info
+)
+{
+    TRACE_FUNCTION();
+    std::lock_guard lock(mutex_);
+    Submission submission = beginSubmission();
+    const vk::raii::CommandBuffer& command_buffer = submission.commandBuffer;
+
+    auto level_range = [](uint32_t base_level, uint32_t level_count)
+    {
+        return vk::ImageSubresourceRange{
+            .aspectMask = vk::ImageAspectFlagBits::eColor,
+            .baseMipLevel = base_level,
+            .levelCount = level_count,
+            .baseArrayLayer = 0,
+            .layerCount = 1
+        };
+    };
+
+    // level by level, each one is the blit source of the next as soon as it's written
+    int32_t source_width = static_cast<int32_t>(extent.width);
+    int32_t source_height = static_cast<int32_t>(extent.height);
+    for (uint32_t level = 1; level < mip_level_count; level++)
+    {
+        int32_t width = std::max(1, source_width / 2);
+        int32_t height = std::max(1, source_height / 2);
+
+        vk::ImageMemoryBarrier2 to_transfer_dst_barrier{
+            .srcStageMask = vk::PipelineStageFlagBits2::eNone,
+            .srcAccessMask = {},
+            .dstStageMask = vk::PipelineStageFlagBits2::eBlit,
+            .dstAccessMask = vk::AccessFlagBits2::eTransferWrite,
+            .oldLayout = vk::ImageLayout::eUndefined,
+            .newLayout = vk::ImageLayout::eTransferDstOptimal,
+            .srcQueueFamilyIndex = vk::QueueFamilyIgnored,
+            .dstQueueFamilyIndex = vk::QueueFamilyIgnored,
+            .image = image,
+            .subresourceRange = level_range(level, 1)
+        };
+        command_buffer.pipelineBarrier2({.imageMemoryBarrierCount = 1, .pImageMemoryBarriers = &to_transfer_dst_barrier});
+
+        vk::ImageBlit2 blit_region{
+            .srcSubresource = {.aspectMask = vk::ImageAspectFlagBits::eColor, .mipLevel = level - 1, .baseArrayLayer = 0, .layerCount = 1},
+            .srcOffsets = std::array<vk::Offset3D, 2>{vk::Offset3D{0, 0, 0}, vk::Offset3D{source_width, source_height, 1}},
+            .dstSubresource = {.aspectMask = vk::ImageAspectFlagBits::eColor, .mipLevel = level, .baseArrayLayer = 0, .layerCount = 1},
+            .dstOffsets = std::array<vk::Offset3D, 2>{vk::Offset3D{0, 0, 0}, vk::Offset3D{width, height, 1}}
+        };
+        command_buffer.blitImage2({
+            .srcImage = image,
+            .srcImageLayout = vk::ImageLayout::eTransferSrcOptimal,
+            .dstImage = image,
+            .dstImageLayout = vk::ImageLayout::eTransferDstOptimal,
+            .regionCount = 1,
+            .pRegions = &blit_region,
+            .filter = vk::Filter::eLinear
+        });
+
+        vk::ImageMemoryBarrier2 to_transfer_src_barrier{
+            .srcStageMask = vk::PipelineStageFlagBits2::eBlit,
+            .srcAccessMask = vk::AccessFlagBits2::eTransferWrite,
+            .dstStageMask = vk::PipelineStageFlagBits2::eBlit,
+            .dstAccessMask = vk::AccessFlagBits2::eTransferRead,
+            .oldLayout = vk::ImageLayout::eTransferDstOptimal,
+            .newLayout = vk::ImageLayout::eTransferSrcOptimal,
+            .srcQueueFamilyIndex = vk::QueueFamilyIgnored,
+            .dstQueueFamilyIndex = vk::QueueFamilyIgnored,
+            .image = image,
+            .subresourceRange = level_range(level, 1)
+        };
+        command_buffer.pipelineBarrier2({.imageMemoryBarrierCount = 1, .pImageMemoryBarriers = &to_transfer_src_barrier});
+
+        source_width = width;
+        source_height = height;
+    }
+
+    // shader reads of later submits on this queue are ordered after the blits by the barrier itself
+    vk::ImageMemoryBarrier2 to_final_barrier{
+        .srcStageMask = vk::PipelineStageFlagBits2::eBlit,
+        .srcAccessMask = vk::AccessFlagBits2::eTransferWrite | vk::AccessFlagBits2::eTransferRead,
+        .dstStageMask = vk::PipelineStageFlagBits2::eFragmentShader | vk::PipelineStageFlagBits2::eComputeShader,
+        .dstAccessMask = vk::AccessFlagBits2::eShaderSampledRead,
+        .oldLayout = vk::ImageLayout::eTransferSrcOptimal,
+        .newLayout = final_layout,
+        .srcQueueFamilyIndex = vk::QueueFamilyIgnored,
+        .dstQueueFamilyIndex = vk::QueueFamilyIgnored,
+        .image = image,
+        .subresourceRange = level_range(0, mip_level_count)
+    };
+    command_buffer.pipelineBarrier2({.imageMemoryBarrierCount = 1, .pImageMemoryBarriers = &to_final_barrier});
+    command_buffer.end();
+
+    submission.timelineValue = ++lastSubmittedValue_;
+
+    vk::CommandBufferSubmitInfo command_buffer_submit_info{
+        .commandBuffer = *command_buffer
+    };
+
+    vk::SemaphoreSubmitInfo signal_semaphore_info{
+        .semaphore = *timelineSemaphore_,
+        .value = submission.timelineValue,
+        .stageMask = vk::PipelineStageFlagBits2::eAllCommands
+    };
+
+    vk::SubmitInfo2 submit_info{
+        .waitSemaphoreInfoCount = 1,
+        .pWaitSemaphoreInfos = &wait_info,
+        .commandBufferInfoCount = 1,
+        .pCommandBufferInfos = &command_buffer_submit_info,
+        .signalSemaphoreInfoCount = 1,
+        .pSignalSemaphoreInfos = &signal_semaphore_info
+    };
+
+    {
+        auto queue_lock = context_.lockQueue(QueueType::eGraphics);
+        context_.getQueue(QueueType::eGraphics).submit2(submit_info);
+    }
+
+    inFlight_.push_back(std::move(submission));
+    return lastSubmittedValue_;
+}
+
+
+void MipGenerator::collectLocked()
+{
+    uint64_t completed_value = timelineSemaphore_.getCounterValue();
+
+    while (!inFlight_.empty() && inFlight_.front().timelineValue <= completed_value)
+    {
+        freeSubmissions_.push_back(std::move(inFlight_.front()));
+        inFlight_.pop_front();
+    }
+}
+
+
+bool MipGenerator::isComplete(uint64_t timeline_value) const
+{
+    return timelineSemaphore_.getCounterValue() >= timeline_value;
+}
+
+
+void MipGenerator::wait(uint64_t timeline_value) const
+{
+    vk::SemaphoreWaitInfo semaphore_wait_info{
+        .semaphoreCount = 1,
+        .pSemaphores = &*timelineSemaphore_,
+        .pValues = &timeline_value
+    };
+    (void)context_.getLogicalDevice().waitSemaphores(semaphore_wait_info, UINT64_MAX);
+}
+
+
+const vk::raii::Semaphore& MipGenerator::getSemaphore() const
+{
+    return timelineSemaphore_;
+}
+
+
+uint32_t MipGenerator::getMipLevelCount(vk::Extent2D extent)
+{
+    return std::bit_width(std::max(extent.width, extent.height));
+}
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <vulkan/vulkan_raii.hpp>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <vector>
+
+// forward declaring classes
+class VulkanContext;
+
+// Fills a mip chain from level 0 with linear filtered blits. Blits need a graphics queue, so every chain
+// is its own small submit to the graphics queue, ordered after the upload of level 0 through a semaphore
+// wait, and signals the generator's timeline semaphore when done.
+// Images must be usable on the graphics family (eConcurrent sharing with a dedicated transfer family).
+// Thread safe.
+class MipGenerator
+{
+public:
+    explicit MipGenerator(const VulkanContext& context);
+    ~MipGenerator();  // waits for every submitted chain, the command buffers can't go away under the GPU
+
+    // deleting copy constructors
+    MipGenerator(const MipGenerator&) = delete;
+    MipGenerator& operator=(const MipGenerator&) = delete;
+
+    // optimal tiling blit source, blit destination and linear filtering, checked against the device
+    bool supportsFormat(vk::Format format) const;
+
+    // level 0 must be in eTransferSrcOptimal once wait_info is satisfied (UploadEngine::getWaitInfo()),
+    // every level ends up in final_layout. Returns the timeline value the chain completes at
+    auto generate(
+        vk::Image image,
+        vk::Extent2D extent,
+        uint32_t mip_level_count,
+        vk::ImageLayout final_layout,
+        const vk::SemaphoreSubmitInfo& wait_info
+    ) -> uint64_t;
+
+    bool isComplete(uint64_t timeline_value) const;
+    void wait(uint64_t timeline_value) const;
+    auto getSemaphore() const -> const vk::raii::Semaphore&;
+
+    static uint32_t getMipLevelCount(vk::Extent2D extent);  // full chain down to 1x1
+
+private:
+    struct Submission
+    {
+        vk::raii::CommandPool commandPool = nullptr;
+        vk::raii::CommandBuffer commandBuffer = nullptr;
+        uint64_t timelineValue = 0;
+    };
+
+    auto beginSubmission() -> Submission;  // expects mutex_ to be held, recycles a retired submission when possible
+    void collectLocked();
+
+    const VulkanContext& context_;
+    vk::raii::Semaphore timelineSemaphore_ = nullptr;
+
+    mutable std::mutex mutex_;
+    std::deque<Submission> inFlight_;         // oldest first
+    std::vector<Submission> freeSubmissions_;
+    uint64_t lastSubmittedValue_ = 0;
+};
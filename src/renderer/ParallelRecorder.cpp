@@ -0,0 +1,124 @@
+#include "ParallelRecorder.h"
+#include "core/VulkanContext.h"
+#include "utils/Trace.h"
+#include <algorithm>
+#include <exception>
+
+
+ParallelRecorder::ParallelRecorder(const VulkanContext& context, uint32_t frame_count, uint32_t worker_count)
+    : context_(context), workers_(worker_count)
+{
+    vk::CommandPoolCreateInfo command_pool_create_info{
+        .flags = vk::CommandPoolCreateFlagBits::eTransient,
+        .queueFamilyIndex = context_.getQueueFamilyIndex(QueueType::eGraphics)
+    };
+
+    slots_.resize(frame_count);
+    for (auto& frame_slots : slots_)
+    {
+        frame_slots.resize(workers_.getWorkerCount());
+        for (auto& slot : frame_slots)
+        {
+            slot.commandPool = vk::raii::CommandPool(context_.getLogicalDevice(), command_pool_create_info);
+        }
+    }
+}
+
+
+vk::CommandBuffer ParallelRecorder::acquireCommandBuffer(uint32_t frame_index, uint32_t slot_index)
+{
+    ChunkSlot& slot = slots_[frame_index][slot_index];
+    if (slot.usedCount == slot.commandBuffers.size())
+    {
+        vk::CommandBufferAllocateInfo command_buffer_allocate_info{
+            .commandPool = *slot.commandPool,
+            .level = vk::CommandBufferLevel::eSecondary,
+            .commandBufferCount = 1
+        };
+        slot.commandBuffers.push_back(std::move(context_.getLogicalDevice().allocateCommandBuffers(command_buffer_allocate_info).front()));
+    }
+
+    return *slot.commandBuffers[slot.usedCount++];
+}
+
+
+void ParallelRecorder::record(
+    uint32_t frame_index,
+    vk::CommandBuffer primary_command_buffer,
+    const vk::CommandBufferInheritanceRenderingInfo& inheritance_rendering_info,
+    uint32_t item_count,
+    const RecordFunction& record_function
+)
+{
+    if (item_count == 0) return;
+
+    uint32_t max_chunk_count = (item_count + MIN_ITEMS_PER_CHUNK - 1) / MIN_ITEMS_PER_CHUNK;
+    uint32_t chunk_count = std::clamp(max_chunk_count, 1u, workers_.getWorkerCount());
+    uint32_t chunk_size = (item_count + chunk_count - 1) / chunk_count;
+    chunk_count = (item_count + chunk_size - 1) / chunk_size;  // rounding up the size may leave a chunk empty
+
+    // allocating up front on this thread, a pool must not be used while a worker records from it
+    std::vector<vk::CommandBuffer> command_buffers(chunk_count);
+    for (uint32_t i = 0; i < chunk_count; i++)
+    {
+        command_buffers[i] = acquireCommandBuffer(frame_index, i);
+    }
+
+    // the secondaries continue the rendering the primary already began
+    vk::CommandBufferInheritanceInfo inheritance_info{
+        .pNext = &inheritance_rendering_info
+    };
+
+    std::vector<std::exception_ptr> errors(chunk_count);
+    for (uint32_t i = 0; i < chunk_count; i++)
+    {
+        uint32_t first_item = i * chunk_size;
+        uint32_t chunk_item_count = std::min(chunk_size, item_count - first_item);
+
+        // exceptions can't cross the worker thread boundary, they are rethrown once every chunk finished
+        workers_.submit(
+            [&, i, first_item, chunk_item_count]()
+            {
+                TRACE_SCOPE("record chunk");
+                try
+                {
+                    command_buffers[i].begin({
+                        .flags = vk::CommandBufferUsageFlagBits::eOneTimeSubmit | vk::CommandBufferUsageFlagBits::eRenderPassContinue,
+                        .pInheritanceInfo = &inheritance_info
+                    });
+                    record_function(command_buffers[i], first_item, chunk_item_count);
+                    command_buffers[i].end();
+                }
+                catch (...)
+                {
+                    errors[i] = std::current_exception();
+                }
+            }
+        );
+    }
+
+    workers_.waitIdle();
+
+    for (const auto& error : errors)
+    {
+        if (error) std::rethrow_exception(error);
+    }
+
+    primary_command_buffer.executeCommands(command_buffers);
+}
+
+
+void ParallelRecorder::resetFrame(uint32_t frame_index)
+{
+    for (auto& slot : slots_[frame_index])
+    {
+        slot.commandPool.reset();
+        slot.usedCount = 0;
+    }
+}
+
+
+uint32_t ParallelRecorder::getWorkerCount() const
+{
+    return workers_.getWorkerCount();
+}
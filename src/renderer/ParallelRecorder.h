@@ -0,0 +1,61 @@
+#pragma once
+
+#include <vulkan/vulkan_raii.hpp>
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+#include "utils/ThreadPool.h"
+
+// forward declaring classes
+class VulkanContext;
+
+// Splits a draw list across worker threads, every chunk is recorded into its own secondary command
+// buffer and executed into the primary in draw list order. Each chunk slot owns one command pool per
+// frame in flight, a pool is only ever touched by one job at a time and is reset in bulk by
+// resetFrame() once the frame's timeline value completed.
+// Not thread safe, record() is called from the thread that owns the primary command buffer.
+class ParallelRecorder
+{
+public:
+    // records items [first_item, first_item + item_count) into command_buffer, runs on a worker thread
+    using RecordFunction = std::function<void(vk::CommandBuffer command_buffer, uint32_t first_item, uint32_t item_count)>;
+
+    ParallelRecorder(const VulkanContext& context, uint32_t frame_count, uint32_t worker_count = 0);
+
+    // deleting copy constructors
+    ParallelRecorder(const ParallelRecorder&) = delete;
+    ParallelRecorder& operator=(const ParallelRecorder&) = delete;
+
+    // must be called inside a rendering begun with vk::RenderingFlagBits::eContentsSecondaryCommandBuffers,
+    // the rendering info describes those attachments. Blocks until every chunk is recorded and rethrows
+    // the first exception a chunk threw.
+    void record(
+        uint32_t frame_index,
+        vk::CommandBuffer primary_command_buffer,
+        const vk::CommandBufferInheritanceRenderingInfo& inheritance_rendering_info,
+        uint32_t item_count,
+        const RecordFunction& record_function
+    );
+
+    void resetFrame(uint32_t frame_index);  // only once the GPU is done with everything recorded for frame_index
+
+    uint32_t getWorkerCount() const;
+
+    // smaller chunks cost more in secondary buffer overhead than they win in parallelism
+    static constexpr uint32_t MIN_ITEMS_PER_CHUNK = 64;
+
+private:
+    struct ChunkSlot
+    {
+        vk::raii::CommandPool commandPool = nullptr;
+        std::vector<vk::raii::CommandBuffer> commandBuffers;  // kept across resets, the pool reset recycles them
+        uint32_t usedCount = 0;
+    };
+
+    auto acquireCommandBuffer(uint32_t frame_index, uint32_t slot_index) -> vk::CommandBuffer;
+
+    const VulkanContext& context_;
+    ThreadPool workers_;
+    std::vector<std::vector<ChunkSlot>> slots_;  // slots_[frame index][chunk slot], one slot per worker
+};
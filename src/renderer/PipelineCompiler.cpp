@@ -0,0 +1,358 @@
+#include "PipelineCompiler.h"
+#include "core/VulkanContext.h"
+#include "utils/Trace.h"
+#include <array>
+#include <cassert>
+#include <iostream>
+
+
+namespace
+{
+    // alpha blending, the only equation descriptions can enable
+    constexpr vk::ColorBlendEquationEXT BLEND_EQUATION{
+        .srcColorBlendFactor = vk::BlendFactor::eSrcAlpha,
+        .dstColorBlendFactor = vk::BlendFactor::eOneMinusSrcAlpha,
+        .colorBlendOp = vk::BlendOp::eAdd,
+        .srcAlphaBlendFactor = vk::BlendFactor::eOne,
+        .dstAlphaBlendFactor = vk::BlendFactor::eZero,
+        .alphaBlendOp = vk::BlendOp::eAdd
+    };
+
+    constexpr vk::ColorComponentFlags COLOR_WRITE_MASK = vk::ColorComponentFlagBits::eR | vk::ColorComponentFlagBits::eG |
+                                                         vk::ColorComponentFlagBits::eB | vk::ColorComponentFlagBits::eA;
+}
+
+
+// GraphicsPipelineStateInfo
+GraphicsPipelineStateInfo::GraphicsPipelineStateInfo(const VulkanContext& context, const GraphicsPipelineDescription& description)
+{
+    // vertex data is hardcoded in the shader
+    vertexInputState = vk::PipelineVertexInputStateCreateInfo{};
+
+    // with dynamic topology only the class (points, lines, triangles) is baked
+    inputAssemblyState = vk::PipelineInputAssemblyStateCreateInfo{
+        .topology = description.topology,
+        .primitiveRestartEnable = false
+    };
+
+    // viewport and scissor are dynamic, only the counts are baked
+    viewportState = vk::PipelineViewportStateCreateInfo{
+        .viewportCount = 1,
+        .scissorCount = 1
+    };
+
+    // the values of dynamic states are ignored here, they're baked only where the device can't set them
+    rasterizationState = vk::PipelineRasterizationStateCreateInfo{
+        .depthClampEnable = false,
+        .rasterizerDiscardEnable = false,
+        .polygonMode = description.polygonMode,
+        .cullMode = description.cullMode,
+        .frontFace = description.frontFace,
+        .depthBiasEnable = false,
+        .lineWidth = 1.0f
+    };
+
+    multisampleState = vk::PipelineMultisampleStateCreateInfo{
+        .rasterizationSamples = description.sampleCount,
+        .sampleShadingEnable = false
+    };
+
+    // ignored without a depth attachment
+    bool has_depth = description.depthFormat != vk::Format::eUndefined;
+    depthStencilState = vk::PipelineDepthStencilStateCreateInfo{
+        .depthTestEnable = has_depth,
+        .depthWriteEnable = has_depth,
+        .depthCompareOp = description.depthCompareOp,
+        .depthBoundsTestEnable = false,
+        .stencilTestEnable = false
+    };
+
+    colorBlendAttachment = vk::PipelineColorBlendAttachmentState{
+        .blendEnable = description.blendEnable,
+        .srcColorBlendFactor = BLEND_EQUATION.srcColorBlendFactor,
+        .dstColorBlendFactor = BLEND_EQUATION.dstColorBlendFactor,
+        .colorBlendOp = BLEND_EQUATION.colorBlendOp,
+        .srcAlphaBlendFactor = BLEND_EQUATION.srcAlphaBlendFactor,
+        .dstAlphaBlendFactor = BLEND_EQUATION.dstAlphaBlendFactor,
+        .alphaBlendOp = BLEND_EQUATION.alphaBlendOp,
+        .colorWriteMask = COLOR_WRITE_MASK
+    };
+
+    colorBlendState = vk::PipelineColorBlendStateCreateInfo{
+        .logicOpEnable = false,
+        .logicOp = vk::LogicOp::eCopy,
+        .attachmentCount = 1,
+        .pAttachments = &colorBlendAttachment
+    };
+
+    dynamicStates = PipelineCompiler::getDynamicStates(context);
+    dynamicState = vk::PipelineDynamicStateCreateInfo{
+        .dynamicStateCount = static_cast<uint32_t>(dynamicStates.size()),
+        .pDynamicStates = dynamicStates.data()
+    };
+
+    // dynamic rendering, the attachment formats replace the render pass
+    renderingCreateInfo = vk::PipelineRenderingCreateInfo{
+        .colorAttachmentCount = 1,
+        .pColorAttachmentFormats = &description.colorFormat,
+        .depthAttachmentFormat = description.depthFormat
+    };
+}
+
+
+// PipelineHandle
+PipelineHandle::PipelineHandle(std::shared_ptr<State> state): state_(std::move(state))
+{
+}
+
+
+bool PipelineHandle::isValid() const
+{
+    return state_ != nullptr;
+}
+
+
+bool PipelineHandle::isReady() const
+{
+    // acquire pairs with the release store on the worker, the pipeline is visible once this reads eReady
+    return state_ && state_->status.load(std::memory_order_acquire) == PipelineStatus::eReady;
+}
+
+
+bool PipelineHandle::hasFailed() const
+{
+    return state_ && state_->status.load(std::memory_order_acquire) == PipelineStatus::eFailed;
+}
+
+
+void PipelineHandle::wait() const
+{
+    if (state_)
+    {
+        state_->status.wait(PipelineStatus::ePending, std::memory_order_acquire);
+    }
+}
+
+
+const std::string& PipelineHandle::getName() const
+{
+    assert(state_);
+    return state_->name;
+}
+
+
+const vk::raii::Pipeline& PipelineHandle::getPipeline() const
+{
+    assert(isReady());
+    return state_->pipeline;
+}
+
+
+// PipelineCompiler
+PipelineCompiler::PipelineCompiler(const VulkanContext& context, uint32_t worker_count)
+    : context_(context), workers_(worker_count)
+{
+}
+
+
+PipelineHandle PipelineCompiler::compile(
+    GraphicsPipelineDescription description,
+    vk::PipelineLayout layout,
+    ReadyCallback on_ready
+)
+{
+    auto state = std::make_shared<PipelineHandle::State>();
+    state->name = description.name;
+
+    // the job keeps its own reference to the state, dropping the handle early is safe
+    workers_.submit(
+        [&context = context_, state, description = std::move(description), layout, on_ready = std::move(on_ready)]()
+        {
+            compileInto(context, description, layout, *state);
+            if (on_ready)
+            {
+                on_ready(PipelineHandle(state));
+            }
+        }
+    );
+
+    return PipelineHandle(state);
+}
+
+
+PipelineHandle PipelineCompiler::compileNow(
+    const VulkanContext& context,
+    const GraphicsPipelineDescription& description,
+    vk::PipelineLayout layout
+)
+{
+    auto state = std::make_shared<PipelineHandle::State>();
+    state->name = description.name;
+    compileInto(context, description, layout, *state);
+
+    return PipelineHandle(state);
+}
+
+
+void PipelineCompiler::compileInto(
+    const VulkanContext& context,
+    const GraphicsPipelineDescription& description,
+    vk::PipelineLayout layout,
+    PipelineHandle::State& state
+)
+{
+    // exceptions can't cross the worker thread boundary, failures are reported through the status instead
+    try
+    {
+        state.pipeline = build(context, description, layout);
+        state.status.store(PipelineStatus::eReady, std::memory_order_release);
+    }
+    catch (const std::exception& e)
+    {
+        std::cerr << "pipeline compiler: failed to build '" << description.name << "': " << e.what() << "\n";
+        state.status.store(PipelineStatus::eFailed, std::memory_order_release);
+    }
+
+    state.status.notify_all();
+}
+
+
+vk::raii::Pipeline PipelineCompiler::build(
+    const VulkanContext& context,
+    const GraphicsPipelineDescription& description,
+    vk::PipelineLayout layout
+)
+{
+    TRACE_SCOPE("PipelineCompiler::build");
+
+    // shared through the cache, every variant using the same SPIR-V reuses one module
+    ShaderModuleCache& shader_module_cache = context.getShaderModuleCache();
+    ShaderModuleCache::ShaderModulePtr vertex_shader_module = shader_module_cache.getModule(description.vertexShaderPath);
+    ShaderModuleCache::ShaderModulePtr fragment_shader_module = shader_module_cache.getModule(description.fragmentShaderPath);
+
+    std::array<vk::PipelineShaderStageCreateInfo, 2> shader_stages = {{
+        {
+            .stage = vk::ShaderStageFlagBits::eVertex,
+            .module = **vertex_shader_module,
+            .pName = description.vertexEntryPoint.c_str()
+        },
+        {
+            .stage = vk::ShaderStageFlagBits::eFragment,
+            .module = **fragment_shader_module,
+            .pName = description.fragmentEntryPoint.c_str()
+        }
+    }};
+
+    GraphicsPipelineStateInfo state_info(context, description);
+
+    // the driver reports whether the pipeline came out of the cache through this struct
+    vk::PipelineCreationFeedback pipeline_creation_feedback{};
+    vk::PipelineCreationFeedbackCreateInfo pipeline_creation_feedback_info{
+        .pPipelineCreationFeedback = &pipeline_creation_feedback
+    };
+    state_info.renderingCreateInfo.pNext = &pipeline_creation_feedback_info;
+
+    vk::GraphicsPipelineCreateInfo pipeline_create_info{
+        .pNext = &state_info.renderingCreateInfo,
+        .stageCount = static_cast<uint32_t>(shader_stages.size()),
+        .pStages = shader_stages.data(),
+        .pVertexInputState = &state_info.vertexInputState,
+        .pInputAssemblyState = &state_info.inputAssemblyState,
+        .pViewportState = &state_info.viewportState,
+        .pRasterizationState = &state_info.rasterizationState,
+        .pMultisampleState = &state_info.multisampleState,
+        .pDepthStencilState = &state_info.depthStencilState,
+        .pColorBlendState = &state_info.colorBlendState,
+        .pDynamicState = &state_info.dynamicState,
+        .layout = layout,
+        .renderPass = nullptr
+    };
+
+    PipelineCache& pipeline_cache = context.getPipelineCache();
+    vk::raii::Pipeline pipeline(context.getLogicalDevice(), pipeline_cache.get(), pipeline_create_info);
+    pipeline_cache.recordFeedback(pipeline_creation_feedback);
+
+    return pipeline;
+}
+
+
+std::vector<vk::DynamicState> PipelineCompiler::getDynamicStates(const VulkanContext& context)
+{
+    // core since 1.3 (extended dynamic state 1 and 2), no feature bits involved
+    std::vector<vk::DynamicState> dynamic_states = {
+        vk::DynamicState::eViewport,
+        vk::DynamicState::eScissor,
+        vk::DynamicState::eCullMode,
+        vk::DynamicState::eFrontFace,
+        vk::DynamicState::ePrimitiveTopology,
+        vk::DynamicState::ePrimitiveRestartEnable,
+        vk::DynamicState::eDepthTestEnable,
+        vk::DynamicState::eDepthWriteEnable,
+        vk::DynamicState::eDepthCompareOp,
+        vk::DynamicState::eDepthBiasEnable
+    };
+
+    const ExtendedDynamicState3Support& support = context.getExtendedDynamicState3Support();
+    if (support.isPolygonModeDynamic) dynamic_states.push_back(vk::DynamicState::ePolygonModeEXT);
+    if (support.isRasterizationSamplesDynamic) dynamic_states.push_back(vk::DynamicState::eRasterizationSamplesEXT);
+    if (support.isColorBlendEnableDynamic) dynamic_states.push_back(vk::DynamicState::eColorBlendEnableEXT);
+    if (support.isColorBlendEquationDynamic) dynamic_states.push_back(vk::DynamicState::eColorBlendEquationEXT);
+    if (support.isColorWriteMaskDynamic) dynamic_states.push_back(vk::DynamicState::eColorWriteMaskEXT);
+
+    return dynamic_states;
+}
+
+
+void PipelineCompiler::recordDynamicState(
+    vk::CommandBuffer command_buffer,
+    const VulkanContext& context,
+    const GraphicsPipelineDescription& description
+)
+{
+    bool has_depth = description.depthFormat != vk::Format::eUndefined;
+    command_buffer.setCullMode(description.cullMode);
+    command_buffer.setFrontFace(description.frontFace);
+    command_buffer.setPrimitiveTopology(description.topology);
+    command_buffer.setPrimitiveRestartEnable(false);
+    command_buffer.setDepthTestEnable(has_depth);
+    command_buffer.setDepthWriteEnable(has_depth);
+    command_buffer.setDepthCompareOp(description.depthCompareOp);
+    command_buffer.setDepthBiasEnable(false);
+
+    // the extension entry points aren't exported by the loader, they go through the device dispatcher
+    const ExtendedDynamicState3Support& support = context.getExtendedDynamicState3Support();
+    const auto& dispatcher = *context.getLogicalDevice().getDispatcher();
+    if (support.isPolygonModeDynamic)
+    {
+        command_buffer.setPolygonModeEXT(description.polygonMode, dispatcher);
+    }
+    if (support.isRasterizationSamplesDynamic)
+    {
+        command_buffer.setRasterizationSamplesEXT(description.sampleCount, dispatcher);
+    }
+    if (support.isColorBlendEnableDynamic)
+    {
+        vk::Bool32 blend_enable = description.blendEnable ? vk::True : vk::False;
+        command_buffer.setColorBlendEnableEXT(0, blend_enable, dispatcher);
+    }
+    if (support.isColorBlendEquationDynamic)
+    {
+        command_buffer.setColorBlendEquationEXT(0, BLEND_EQUATION, dispatcher);
+    }
+    if (support.isColorWriteMaskDynamic)
+    {
+        command_buffer.setColorWriteMaskEXT(0, COLOR_WRITE_MASK, dispatcher);
+    }
+}
+
+
+void PipelineCompiler::waitIdle()
+{
+    workers_.waitIdle();
+}
+
+
+uint32_t PipelineCompiler::getPendingCount() const
+{
+    return workers_.getPendingCount();
+}
@@ -0,0 +1,163 @@
+#pragma once
+
+#include <vulkan/vulkan_raii.hpp>
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "utils/ThreadPool.h"
+
+// forward declaring classes
+class VulkanContext;
+
+// Everything that varies between graphics pipeline permutations.
+// Viewport and scissor are always dynamic so they are not part of the description. Cull mode, front face,
+// topology (within its class) and the depth test are dynamic too, as is whatever extended dynamic state 3
+// covers on the device: those are still described here, PipelineCompiler::recordDynamicState() sets them.
+struct GraphicsPipelineDescription
+{
+    std::string name;
+    std::string vertexShaderPath;
+    std::string fragmentShaderPath;
+    std::string vertexEntryPoint = "vertexMain";
+    std::string fragmentEntryPoint = "fragmentMain";
+    vk::Format colorFormat = vk::Format::eUndefined;
+    vk::Format depthFormat = vk::Format::eUndefined;  // eUndefined: no depth test or writes
+    vk::SampleCountFlagBits sampleCount = vk::SampleCountFlagBits::e1;
+    vk::CompareOp depthCompareOp = vk::CompareOp::eLess;
+    vk::PrimitiveTopology topology = vk::PrimitiveTopology::eTriangleList;
+    vk::PolygonMode polygonMode = vk::PolygonMode::eFill;
+    vk::CullModeFlags cullMode = vk::CullModeFlagBits::eBack;
+    vk::FrontFace frontFace = vk::FrontFace::eClockwise;
+    bool blendEnable = false;
+
+    bool operator==(const GraphicsPipelineDescription&) const = default;
+};
+
+
+// The fixed function create infos of a description, shared by full pipelines and the library parts the
+// PipelineStateCache links. Points into itself and into description, which must outlive it.
+struct GraphicsPipelineStateInfo
+{
+    GraphicsPipelineStateInfo(const VulkanContext& context, const GraphicsPipelineDescription& description);
+
+    // deleting copy constructors
+    GraphicsPipelineStateInfo(const GraphicsPipelineStateInfo&) = delete;
+    GraphicsPipelineStateInfo& operator=(const GraphicsPipelineStateInfo&) = delete;
+
+    vk::PipelineVertexInputStateCreateInfo vertexInputState;
+    vk::PipelineInputAssemblyStateCreateInfo inputAssemblyState;
+    vk::PipelineViewportStateCreateInfo viewportState;
+    vk::PipelineRasterizationStateCreateInfo rasterizationState;
+    vk::PipelineMultisampleStateCreateInfo multisampleState;
+    vk::PipelineDepthStencilStateCreateInfo depthStencilState;
+    vk::PipelineColorBlendAttachmentState colorBlendAttachment;
+    vk::PipelineColorBlendStateCreateInfo colorBlendState;
+    std::vector<vk::DynamicState> dynamicStates;
+    vk::PipelineDynamicStateCreateInfo dynamicState;
+    vk::PipelineRenderingCreateInfo renderingCreateInfo;  // pNext is left for the caller
+};
+
+
+enum class PipelineStatus
+{
+    ePending,
+    eReady,
+    eFailed
+};
+
+
+// Shared handle to a pipeline that may still be compiling on a worker thread.
+// isReady() never blocks, so it can be checked every frame from Renderer::drawFrame.
+class PipelineHandle
+{
+public:
+    PipelineHandle() = default;  // empty handle, isValid() returns false
+
+    bool isValid() const;
+    bool isReady() const;
+    bool hasFailed() const;
+    void wait() const;  // blocks until the compile finished, successfully or not
+
+    auto getName() const -> const std::string&;
+    auto getPipeline() const -> const vk::raii::Pipeline&;  // only valid once isReady() returns true
+
+private:
+    friend class PipelineCompiler;
+
+    struct State
+    {
+        std::string name;
+        std::atomic<PipelineStatus> status = PipelineStatus::ePending;
+        vk::raii::Pipeline pipeline = nullptr;  // written by the worker before status is published
+    };
+
+    explicit PipelineHandle(std::shared_ptr<State> state);
+
+    std::shared_ptr<State> state_;
+};
+
+
+// Compiles graphics pipelines on a pool of worker threads against the shared logical device.
+// vkCreateGraphicsPipelines and the pipeline cache are both safe to use from several threads.
+// Must outlive every handle it hands out that is still pending.
+class PipelineCompiler
+{
+public:
+    // invoked on the worker thread right after the pipeline is ready or failed
+    using ReadyCallback = std::function<void(const PipelineHandle&)>;
+
+    explicit PipelineCompiler(const VulkanContext& context, uint32_t worker_count = 0);
+
+    // deleting copy constructors
+    PipelineCompiler(const PipelineCompiler&) = delete;
+    PipelineCompiler& operator=(const PipelineCompiler&) = delete;
+
+    // queues the description and returns straight away, layout must stay alive until the handle is ready
+    auto compile(
+        GraphicsPipelineDescription description,
+        vk::PipelineLayout layout,
+        ReadyCallback on_ready = {}
+    ) -> PipelineHandle;
+
+    // builds on the calling thread, the returned handle is already ready
+    static auto compileNow(
+        const VulkanContext& context,
+        const GraphicsPipelineDescription& description,
+        vk::PipelineLayout layout
+    ) -> PipelineHandle;
+
+    // creates the vk::raii::Pipeline through the context's pipeline cache
+    static auto build(
+        const VulkanContext& context,
+        const GraphicsPipelineDescription& description,
+        vk::PipelineLayout layout
+    ) -> vk::raii::Pipeline;
+
+    // the states build() makes dynamic on this device
+    static auto getDynamicStates(const VulkanContext& context) -> std::vector<vk::DynamicState>;
+
+    // sets every dynamic state but viewport and scissor to the description's values, after binding a
+    // pipeline built from it (or from a description only differing in those states)
+    static void recordDynamicState(
+        vk::CommandBuffer command_buffer,
+        const VulkanContext& context,
+        const GraphicsPipelineDescription& description
+    );
+
+    void waitIdle();
+    uint32_t getPendingCount() const;
+
+private:
+    static void compileInto(
+        const VulkanContext& context,
+        const GraphicsPipelineDescription& description,
+        vk::PipelineLayout layout,
+        PipelineHandle::State& state
+    );
+
+    const VulkanContext& context_;
+    ThreadPool workers_;  // declared last, workers are joined before anything they use is destroyed
+};
@@ -0,0 +1,373 @@
+#include "PipelineStateCache.h"
+#include "FrameScheduler.h"
+#include "core/VulkanContext.h"
+#include "utils/Trace.h"
+#include <chrono>
+#include <functional>
+#include <iostream>
+
+
+namespace
+{
+    // 64 bit FNV-1a style mixing of already hashed values
+    void combineHash(uint64_t& hash, uint64_t value)
+    {
+        hash ^= value;
+        hash *= 1099511628211ull;
+    }
+
+    template <typename Enum>
+    uint64_t enumValue(Enum value)
+    {
+        return static_cast<uint64_t>(value);
+    }
+}
+
+
+PipelineStateCache::PipelineStateCache(const VulkanContext& context, PipelineCompiler& compiler)
+    : context_(context), compiler_(compiler), usesPipelineLibraries_(context.isGraphicsPipelineLibraryEnabled())
+{
+}
+
+
+PipelineStateCache::~PipelineStateCache()
+{
+    // the workers still reference the layouts of pending compiles, every one of them finishes before
+    // anything is destroyed. Same as releaseLayout(), the pipelines go while holding the lock
+    std::lock_guard lock(mutex_);
+    for (const auto& [key, entry] : pipelines_)
+    {
+        entry.optimizedHandle.wait();
+    }
+    pipelines_.clear();
+    for (auto& libraries : libraries_)
+    {
+        libraries.clear();
+    }
+}
+
+
+vk::Pipeline PipelineStateCache::getPipeline(const GraphicsPipelineDescription& description, vk::PipelineLayout layout)
+{
+    Key key{.description = makeStateKey(context_, description), .layout = layout};
+
+    std::lock_guard lock(mutex_);
+    if (auto it = pipelines_.find(key); it != pipelines_.end())
+    {
+        hitCount_++;
+        return getCurrentPipeline(it->second);
+    }
+
+    TRACE_SCOPE("PipelineStateCache::miss");
+    Entry entry;
+    if (usesPipelineLibraries_)
+    {
+        // a failed link isn't fatal, the compiler's pipeline takes over once it's ready
+        try
+        {
+            entry.linkedPipeline = linkPipeline(key);
+        }
+        catch (const std::exception& e)
+        {
+            std::cerr << "pipeline state cache: failed to link '" << description.name << "': " << e.what() << "\n";
+        }
+    }
+
+    GraphicsPipelineDescription compile_description = key.description;
+    compile_description.name = description.name;  // only for the compiler's messages
+    entry.optimizedHandle = compiler_.compile(std::move(compile_description), layout);
+
+    auto [it, is_inserted] = pipelines_.emplace(std::move(key), std::move(entry));
+    return getCurrentPipeline(it->second);
+}
+
+
+void PipelineStateCache::releaseLayout(vk::PipelineLayout layout)
+{
+    // a new layout may get the same handle, it must not find these pipelines
+    std::lock_guard lock(mutex_);
+    std::erase_if(pipelines_, [layout](const auto& pipeline)
+    {
+        if (pipeline.first.layout != layout) return false;
+
+        pipeline.second.optimizedHandle.wait();  // the worker still references the layout
+        return true;
+    });
+    for (auto& libraries : libraries_)
+    {
+        std::erase_if(libraries, [layout](const auto& library) { return library.first.layout == layout; });
+    }
+}
+
+
+void PipelineStateCache::collect(FrameScheduler& scheduler)
+{
+    std::lock_guard lock(mutex_);
+    for (auto& [key, entry] : pipelines_)
+    {
+        if (*entry.linkedPipeline && entry.optimizedHandle.isReady())
+        {
+            scheduler.retire(std::move(entry.linkedPipeline));
+            entry.linkedPipeline = nullptr;
+        }
+    }
+}
+
+
+GraphicsPipelineDescription PipelineStateCache::makeStateKey(const VulkanContext& context, GraphicsPipelineDescription description)
+{
+    // dynamic state is reset to the defaults, two descriptions differing only there become equal
+    const GraphicsPipelineDescription defaults{};
+    description.name.clear();
+    description.cullMode = defaults.cullMode;
+    description.frontFace = defaults.frontFace;
+    description.depthCompareOp = defaults.depthCompareOp;
+    description.topology = getTopologyClass(description.topology);
+
+    const ExtendedDynamicState3Support& support = context.getExtendedDynamicState3Support();
+    if (support.isPolygonModeDynamic) description.polygonMode = defaults.polygonMode;
+    if (support.isRasterizationSamplesDynamic) description.sampleCount = defaults.sampleCount;
+    if (support.isColorBlendEnableDynamic) description.blendEnable = defaults.blendEnable;
+
+    return description;
+}
+
+
+vk::Pipeline PipelineStateCache::getCurrentPipeline(const Entry& entry)
+{
+    if (entry.optimizedHandle.isReady()) return *entry.optimizedHandle.getPipeline();
+    return *entry.linkedPipeline;  // null without libraries
+}
+
+
+vk::raii::Pipeline PipelineStateCache::linkPipeline(const Key& key)
+{
+    std::array<vk::Pipeline, LIBRARY_PART_COUNT> libraries = {
+        getLibrary(LibraryPart::eVertexInput, key),
+        getLibrary(LibraryPart::ePreRasterization, key),
+        getLibrary(LibraryPart::eFragmentShader, key),
+        getLibrary(LibraryPart::eFragmentOutput, key)
+    };
+
+    TRACE_SCOPE("PipelineStateCache::link");
+    auto start_time = std::chrono::steady_clock::now();
+
+    // no link time optimization flag, this is the fast link
+    vk::PipelineLibraryCreateInfoKHR library_create_info{
+        .libraryCount = static_cast<uint32_t>(libraries.size()),
+        .pLibraries = libraries.data()
+    };
+
+    vk::GraphicsPipelineCreateInfo pipeline_create_info{
+        .pNext = &library_create_info,
+        .layout = key.layout
+    };
+
+    vk::raii::Pipeline pipeline(context_.getLogicalDevice(), context_.getPipelineCache().get(), pipeline_create_info);
+
+    linkCount_++;
+    linkTimeNs_ += static_cast<uint64_t>(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start_time).count()
+    );
+    return pipeline;
+}
+
+
+vk::Pipeline PipelineStateCache::getLibrary(LibraryPart part, const Key& key)
+{
+    auto& libraries = libraries_[static_cast<uint32_t>(part)];
+    Key library_key = makeLibraryKey(part, key);
+    if (auto it = libraries.find(library_key); it != libraries.end())
+    {
+        return *it->second;
+    }
+
+    auto [it, is_inserted] = libraries.emplace(library_key, createLibrary(part, library_key));
+    return *it->second;
+}
+
+
+vk::raii::Pipeline PipelineStateCache::createLibrary(LibraryPart part, const Key& key) const
+{
+    TRACE_SCOPE("PipelineStateCache::createLibrary");
+    const GraphicsPipelineDescription& description = key.description;
+    GraphicsPipelineStateInfo state_info(context_, description);
+
+    vk::GraphicsPipelineLibraryCreateInfoEXT library_info{};
+    state_info.renderingCreateInfo.pNext = &library_info;
+
+    // every part gets the dynamic state list and the rendering info, each one only uses what belongs to it
+    vk::GraphicsPipelineCreateInfo pipeline_create_info{
+        .pNext = &state_info.renderingCreateInfo,
+        .flags = vk::PipelineCreateFlagBits::eLibraryKHR,
+        .pDynamicState = &state_info.dynamicState,
+        .layout = key.layout
+    };
+
+    ShaderModuleCache::ShaderModulePtr shader_module;
+    vk::PipelineShaderStageCreateInfo shader_stage{};
+    switch (part)
+    {
+        case LibraryPart::eVertexInput:
+            library_info.flags = vk::GraphicsPipelineLibraryFlagBitsEXT::eVertexInputInterface;
+            pipeline_create_info.pVertexInputState = &state_info.vertexInputState;
+            pipeline_create_info.pInputAssemblyState = &state_info.inputAssemblyState;
+            break;
+        case LibraryPart::ePreRasterization:
+            library_info.flags = vk::GraphicsPipelineLibraryFlagBitsEXT::ePreRasterizationShaders;
+            shader_module = context_.getShaderModuleCache().getModule(description.vertexShaderPath);
+            shader_stage = vk::PipelineShaderStageCreateInfo{
+                .stage = vk::ShaderStageFlagBits::eVertex,
+                .module = **shader_module,
+                .pName = description.vertexEntryPoint.c_str()
+            };
+            pipeline_create_info.stageCount = 1;
+            pipeline_create_info.pStages = &shader_stage;
+            pipeline_create_info.pViewportState = &state_info.viewportState;
+            pipeline_create_info.pRasterizationState = &state_info.rasterizationState;
+            break;
+        case LibraryPart::eFragmentShader:
+            library_info.flags = vk::GraphicsPipelineLibraryFlagBitsEXT::eFragmentShader;
+            shader_module = context_.getShaderModuleCache().getModule(description.fragmentShaderPath);
+            shader_stage = vk::PipelineShaderStageCreateInfo{
+                .stage = vk::ShaderStageFlagBits::eFragment,
+                .module = **shader_module,
+                .pName = description.fragmentEntryPoint.c_str()
+            };
+            pipeline_create_info.stageCount = 1;
+            pipeline_create_info.pStages = &shader_stage;
+            pipeline_create_info.pMultisampleState = &state_info.multisampleState;
+            pipeline_create_info.pDepthStencilState = &state_info.depthStencilState;
+            break;
+        case LibraryPart::eFragmentOutput:
+            library_info.flags = vk::GraphicsPipelineLibraryFlagBitsEXT::eFragmentOutputInterface;
+            pipeline_create_info.pMultisampleState = &state_info.multisampleState;
+            pipeline_create_info.pColorBlendState = &state_info.colorBlendState;
+            break;
+    }
+
+    return vk::raii::Pipeline(context_.getLogicalDevice(), context_.getPipelineCache().get(), pipeline_create_info);
+}
+
+
+PipelineStateCache::Key PipelineStateCache::makeLibraryKey(LibraryPart part, const Key& key)
+{
+    // starting from the defaults, so pipelines differing elsewhere share the part
+    const GraphicsPipelineDescription& description = key.description;
+    Key library_key{};
+    GraphicsPipelineDescription& library_description = library_key.description;
+    switch (part)
+    {
+        case LibraryPart::eVertexInput:
+            library_description.topology = description.topology;
+            break;
+        case LibraryPart::ePreRasterization:
+            library_description.vertexShaderPath = description.vertexShaderPath;
+            library_description.vertexEntryPoint = description.vertexEntryPoint;
+            library_description.polygonMode = description.polygonMode;
+            library_key.layout = key.layout;
+            break;
+        case LibraryPart::eFragmentShader:
+            library_description.fragmentShaderPath = description.fragmentShaderPath;
+            library_description.fragmentEntryPoint = description.fragmentEntryPoint;
+            library_description.depthFormat = description.depthFormat;
+            library_description.sampleCount = description.sampleCount;
+            library_key.layout = key.layout;
+            break;
+        case LibraryPart::eFragmentOutput:
+            library_description.colorFormat = description.colorFormat;
+            library_description.depthFormat = description.depthFormat;
+            library_description.sampleCount = description.sampleCount;
+            library_description.blendEnable = description.blendEnable;
+            break;
+    }
+    return library_key;
+}
+
+
+vk::PrimitiveTopology PipelineStateCache::getTopologyClass(vk::PrimitiveTopology topology)
+{
+    // without dynamicPrimitiveTopologyUnrestricted the dynamic topology has to stay in the baked one's class
+    switch (topology)
+    {
+        case vk::PrimitiveTopology::ePointList:
+            return vk::PrimitiveTopology::ePointList;
+        case vk::PrimitiveTopology::eLineList:
+        case vk::PrimitiveTopology::eLineStrip:
+        case vk::PrimitiveTopology::eLineListWithAdjacency:
+        case vk::PrimitiveTopology::eLineStripWithAdjacency:
+            return vk::PrimitiveTopology::eLineList;
+        case vk::PrimitiveTopology::ePatchList:
+            return vk::PrimitiveTopology::ePatchList;
+        default:
+            return vk::PrimitiveTopology::eTriangleList;
+    }
+}
+
+
+size_t PipelineStateCache::KeyHash::operator()(const Key& key) const
+{
+    const GraphicsPipelineDescription& description = key.description;
+    std::hash<std::string> hash_string;
+
+    uint64_t hash = 14695981039346656037ull;
+    combineHash(hash, hash_string(description.vertexShaderPath));
+    combineHash(hash, hash_string(description.fragmentShaderPath));
+    combineHash(hash, hash_string(description.vertexEntryPoint));
+    combineHash(hash, hash_string(description.fragmentEntryPoint));
+    combineHash(hash, enumValue(description.colorFormat));
+    combineHash(hash, enumValue(description.depthFormat));
+    combineHash(hash, enumValue(description.sampleCount));
+    combineHash(hash, enumValue(description.depthCompareOp));
+    combineHash(hash, enumValue(description.topology));
+    combineHash(hash, enumValue(description.polygonMode));
+    combineHash(hash, static_cast<uint64_t>(static_cast<VkCullModeFlags>(description.cullMode)));
+    combineHash(hash, enumValue(description.frontFace));
+    combineHash(hash, description.blendEnable ? 1 : 0);
+    combineHash(hash, std::hash<VkPipelineLayout>{}(static_cast<VkPipelineLayout>(key.layout)));
+    return static_cast<size_t>(hash);
+}
+
+
+// Accessor functions
+uint32_t PipelineStateCache::getPipelineCount() const
+{
+    std::lock_guard lock(mutex_);
+    return static_cast<uint32_t>(pipelines_.size());
+}
+
+
+uint32_t PipelineStateCache::getLibraryCount() const
+{
+    std::lock_guard lock(mutex_);
+    uint32_t library_count = 0;
+    for (const auto& libraries : libraries_)
+    {
+        library_count += static_cast<uint32_t>(libraries.size());
+    }
+    return library_count;
+}
+
+
+uint32_t PipelineStateCache::getHitCount() const
+{
+    return hitCount_.load();
+}
+
+
+uint32_t PipelineStateCache::getLinkCount() const
+{
+    return linkCount_.load();
+}
+
+
+uint64_t PipelineStateCache::getLinkTimeNs() const
+{
+    return linkTimeNs_.load();
+}
+
+
+bool PipelineStateCache::usesPipelineLibraries() const
+{
+    return usesPipelineLibraries_;
+}
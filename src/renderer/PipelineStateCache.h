@@ -0,0 +1,108 @@
+#pragma once
+
+#include <vulkan/vulkan_raii.hpp>
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <unordered_map>
+
+#include "PipelineCompiler.h"
+
+// forward declaring classes
+class VulkanContext;
+class FrameScheduler;
+
+// Graphics pipelines deduplicated by the state they actually bake. A description is reduced to what the
+// device can't set at record time (see PipelineCompiler::getDynamicStates()), so descriptions that only
+// differ in cull mode, front face, depth test, topology within its class or, with extended dynamic
+// state 3, polygon mode, sample count and blending share one pipeline. Bind what getPipeline() returns
+// and set the rest with PipelineCompiler::recordDynamicState() and the full description.
+//
+// With VK_EXT_graphics_pipeline_library a missing pipeline is linked on the calling thread from four
+// cached parts (vertex input, vertex shader, fragment shader and fragment output), which takes
+// microseconds on drivers with fast linking, and the optimized monolithic pipeline is queued on the
+// compiler to replace it. Without libraries getPipeline() returns null until the compiler is done.
+// Thread safe.
+class PipelineStateCache
+{
+public:
+    // compiler must outlive the cache
+    PipelineStateCache(const VulkanContext& context, PipelineCompiler& compiler);
+    ~PipelineStateCache();  // waits for the pending compiles, the GPU must be done with every pipeline
+
+    // deleting copy constructors
+    PipelineStateCache(const PipelineStateCache&) = delete;
+    PipelineStateCache& operator=(const PipelineStateCache&) = delete;
+
+    // null while the pipeline is compiling or when it failed. layout must stay alive until releaseLayout()
+    vk::Pipeline getPipeline(const GraphicsPipelineDescription& description, vk::PipelineLayout layout);
+
+    // drops every pipeline and library built with layout, after waiting for their pending compiles.
+    // Call it before destroying the layout, the GPU must be done with those pipelines
+    void releaseLayout(vk::PipelineLayout layout);
+
+    // once per frame before recording: linked pipelines whose optimized replacement is ready are
+    // retired to scheduler until the frames that used them completed
+    void collect(FrameScheduler& scheduler);
+
+    // description without the state the device sets dynamically, the name is dropped too
+    static auto makeStateKey(const VulkanContext& context, GraphicsPipelineDescription description) -> GraphicsPipelineDescription;
+
+    // accessor functions
+    uint32_t getPipelineCount() const;  // distinct baked states
+    uint32_t getLibraryCount() const;   // library parts, shared between pipelines
+    uint32_t getHitCount() const;       // getPipeline() calls that found an existing pipeline
+    uint32_t getLinkCount() const;      // pipelines linked from libraries
+    uint64_t getLinkTimeNs() const;     // spent linking them
+    bool usesPipelineLibraries() const;
+
+private:
+    struct Key
+    {
+        GraphicsPipelineDescription description;
+        vk::PipelineLayout layout = nullptr;
+
+        bool operator==(const Key&) const = default;
+    };
+
+    struct KeyHash
+    {
+        size_t operator()(const Key& key) const;
+    };
+
+    // the four VkGraphicsPipelineLibraryFlagBitsEXT subsets, in that order
+    enum class LibraryPart
+    {
+        eVertexInput,
+        ePreRasterization,
+        eFragmentShader,
+        eFragmentOutput
+    };
+    static constexpr uint32_t LIBRARY_PART_COUNT = 4;
+
+    struct Entry
+    {
+        vk::raii::Pipeline linkedPipeline = nullptr;  // from the libraries, until the optimized one is ready
+        PipelineHandle optimizedHandle;               // monolithic, from the compiler
+    };
+
+    static auto getCurrentPipeline(const Entry& entry) -> vk::Pipeline;
+    auto linkPipeline(const Key& key) -> vk::raii::Pipeline;                  // mutex_ held
+    auto getLibrary(LibraryPart part, const Key& key) -> vk::Pipeline;       // mutex_ held
+    auto createLibrary(LibraryPart part, const Key& key) const -> vk::raii::Pipeline;
+    static auto makeLibraryKey(LibraryPart part, const Key& key) -> Key;    // only the state the part depends on
+    static auto getTopologyClass(vk::PrimitiveTopology topology) -> vk::PrimitiveTopology;
+
+    const VulkanContext& context_;
+    PipelineCompiler& compiler_;
+    bool usesPipelineLibraries_ = false;
+
+    mutable std::mutex mutex_;  // guards pipelines_ and libraries_
+    std::unordered_map<Key, Entry, KeyHash> pipelines_;
+    std::array<std::unordered_map<Key, vk::raii::Pipeline, KeyHash>, LIBRARY_PART_COUNT> libraries_;
+
+    std::atomic<uint32_t> hitCount_ = 0;
+    std::atomic<uint32_t> linkCount_ = 0;
+    std::atomic<uint64_t> linkTimeNs_ = 0;
+};
@@ -0,0 +1,544 @@
+#include "PostProcessor.h"
+#include "core/VulkanContext.h"
+#include "utils/Trace.h"
+#include <algorithm>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+
+
+namespace
+{
+    // matches the flags in shaders/post.slang
+    constexpr uint32_t OUTPUT_BGRA = 1;
+    constexpr uint32_t OUTPUT_SRGB = 2;
+
+    constexpr uint32_t TILE_SIZE = 8;        // [numthreads] of every per pixel kernel but the histogram
+    constexpr uint32_t HISTOGRAM_TILE_SIZE = 16;
+
+    uint32_t getGroupCount(uint32_t size, uint32_t tile_size)
+    {
+        return (size + tile_size - 1) / tile_size;
+    }
+
+    // every kernel reads what the one before it wrote, a global barrier is all they need
+    void recordComputeBarrier(vk::CommandBuffer command_buffer)
+    {
+        vk::MemoryBarrier2 memory_barrier{
+            .srcStageMask = vk::PipelineStageFlagBits2::eComputeShader | vk::PipelineStageFlagBits2::eAllTransfer,
+            .srcAccessMask = vk::AccessFlagBits2::eShaderStorageWrite | vk::AccessFlagBits2::eTransferWrite,
+            .dstStageMask = vk::PipelineStageFlagBits2::eComputeShader | vk::PipelineStageFlagBits2::eAllTransfer,
+            .dstAccessMask = vk::AccessFlagBits2::eShaderStorageRead | vk::AccessFlagBits2::eShaderStorageWrite |
+                             vk::AccessFlagBits2::eTransferWrite
+        };
+        command_buffer.pipelineBarrier2({.memoryBarrierCount = 1, .pMemoryBarriers = &memory_barrier});
+    }
+}
+
+
+PostProcessor::PostProcessor(const VulkanContext& context, uint32_t frame_count, const PostProcessSettings& settings)
+    : context_(context), settings_(settings), scheduler_(context), profiler_(context, frame_count, QueueType::eCompute)
+{
+    if (context_.hasAsyncComputeQueue())
+    {
+        queueFamilies_ = {context_.getQueueFamilyIndex(QueueType::eGraphics), context_.getQueueFamilyIndex(QueueType::eCompute)};
+    }
+
+    createPipelines();
+
+    // the kernels sample the scene with bilinear taps, edges clamp
+    vk::SamplerCreateInfo sampler_create_info{
+        .magFilter = vk::Filter::eLinear,
+        .minFilter = vk::Filter::eLinear,
+        .mipmapMode = vk::SamplerMipmapMode::eNearest,
+        .addressModeU = vk::SamplerAddressMode::eClampToEdge,
+        .addressModeV = vk::SamplerAddressMode::eClampToEdge,
+        .addressModeW = vk::SamplerAddressMode::eClampToEdge
+    };
+    sampler_ = vk::raii::Sampler(context_.getLogicalDevice(), sampler_create_info);
+    samplerHandle_ = context_.getBindlessHeap().registerSampler(*sampler_);
+
+    createFrames(frame_count);
+
+    // the per frame histogram and the adapted luminance, only the compute queue touches them
+    histogramBuffer_ = createBuffer(
+        HISTOGRAM_BIN_COUNT * sizeof(uint32_t),
+        vk::BufferUsageFlagBits::eStorageBuffer | vk::BufferUsageFlagBits::eTransferDst,
+        false,
+        histogramAllocation_
+    );
+    exposureBuffer_ = createBuffer(
+        sizeof(float),
+        vk::BufferUsageFlagBits::eStorageBuffer | vk::BufferUsageFlagBits::eTransferDst,
+        false,
+        exposureAllocation_
+    );
+    histogramHandle_ = context_.getBindlessHeap().registerStorageBuffer(*histogramBuffer_);
+    exposureHandle_ = context_.getBindlessHeap().registerStorageBuffer(*exposureBuffer_);
+}
+
+
+PostProcessor::~PostProcessor()
+{
+    scheduler_.waitIdle();
+    destroySizedResources();
+
+    BindlessHeap& bindless_heap = context_.getBindlessHeap();
+    MemoryAllocator& memory_allocator = context_.getMemoryAllocator();
+    bindless_heap.release(BindlessType::eStorageBuffer, histogramHandle_, lastSceneValue_);
+    bindless_heap.release(BindlessType::eStorageBuffer, exposureHandle_, lastSceneValue_);
+    bindless_heap.release(BindlessType::eSampler, samplerHandle_, lastSceneValue_);
+    histogramBuffer_.clear();
+    exposureBuffer_.clear();
+    memory_allocator.free(histogramAllocation_);
+    memory_allocator.free(exposureAllocation_);
+}
+
+
+void PostProcessor::createFrames(uint32_t frame_count)
+{
+    vk::CommandPoolCreateInfo command_pool_create_info{
+        .flags = vk::CommandPoolCreateFlagBits::eTransient,
+        .queueFamilyIndex = context_.getQueueFamilyIndex(QueueType::eCompute)
+    };
+
+    frames_.resize(frame_count);
+    for (auto& frame : frames_)
+    {
+        frame.commandPool = vk::raii::CommandPool(context_.getLogicalDevice(), command_pool_create_info);
+
+        vk::CommandBufferAllocateInfo command_buffer_allocate_info{
+            .commandPool = *frame.commandPool,
+            .level = vk::CommandBufferLevel::ePrimary,
+            .commandBufferCount = 1
+        };
+        frame.commandBuffer = std::move(context_.getLogicalDevice().allocateCommandBuffers(command_buffer_allocate_info).front());
+    }
+}
+
+
+void PostProcessor::createPipelines()
+{
+    // same layout as every other pipeline, all images and buffers are reached through bindless handles
+    const BindlessHeap& bindless_heap = context_.getBindlessHeap();
+    vk::DescriptorSetLayout set_layout = *bindless_heap.getSetLayout();
+    vk::PushConstantRange push_constant_range = bindless_heap.getPushConstantRange();
+    static_assert(sizeof(PostConstants) <= BindlessHeap::PUSH_CONSTANT_SIZE);
+
+    vk::PipelineLayoutCreateInfo pipeline_layout_create_info{
+        .setLayoutCount = 1,
+        .pSetLayouts = &set_layout,
+        .pushConstantRangeCount = 1,
+        .pPushConstantRanges = &push_constant_range
+    };
+    layout_ = vk::raii::PipelineLayout(context_.getLogicalDevice(), pipeline_layout_create_info);
+
+    PipelineCache& pipeline_cache = context_.getPipelineCache();
+    for (uint32_t i = 0; i < KERNEL_COUNT; i++)
+    {
+        ShaderModuleCache::ShaderModulePtr shader_module = context_.getShaderModuleCache().getModule(SHADER_PATHS[i]);
+
+        vk::ComputePipelineCreateInfo pipeline_create_info{
+            .stage = {
+                .stage = vk::ShaderStageFlagBits::eCompute,
+                .module = **shader_module,
+                .pName = ENTRY_POINTS[i]
+            },
+            .layout = *layout_
+        };
+        pipelines_[i] = vk::raii::Pipeline(context_.getLogicalDevice(), pipeline_cache.get(), pipeline_create_info);
+    }
+}
+
+
+vk::raii::Buffer PostProcessor::createBuffer(vk::DeviceSize size, vk::BufferUsageFlags usage, bool is_shared, Allocation& allocation) const
+{
+    // results are copied on the graphics queue, with an async family both have to be able to use them
+    bool is_concurrent = is_shared && !queueFamilies_.empty();
+
+    vk::BufferCreateInfo buffer_create_info{
+        .size = size,
+        .usage = usage,
+        .sharingMode = is_concurrent ? vk::SharingMode::eConcurrent : vk::SharingMode::eExclusive,
+        .queueFamilyIndexCount = is_concurrent ? static_cast<uint32_t>(queueFamilies_.size()) : 0,
+        .pQueueFamilyIndices = is_concurrent ? queueFamilies_.data() : nullptr
+    };
+
+    vk::raii::Buffer buffer = vk::raii::Buffer(context_.getLogicalDevice(), buffer_create_info);
+    allocation = context_.getMemoryAllocator().allocateForBuffer(buffer, MemoryUsage::eGpuOnly);
+    return buffer;
+}
+
+
+void PostProcessor::update(vk::Format target_format, vk::Extent2D extent)
+{
+    if (targetFormat_ == target_format && extent_ == extent) return;
+
+    std::optional<uint32_t> output_flags = getOutputFlags(target_format);
+    if (!output_flags)
+    {
+        throw std::runtime_error("post processing can't write " + vk::to_string(target_format) + ", it needs an 8 bit RGBA or BGRA target");
+    }
+
+    // resizes are rare, waiting for the last compute submit beats tracking the resources on two timelines.
+    // That submit waited for the latest scene, so the graphics queue is done with them as well
+    TRACE_SCOPE("PostProcessor::update");
+    scheduler_.waitIdle();
+    destroySizedResources();
+
+    targetFormat_ = target_format;
+    extent_ = extent;
+    bloomExtent_ = vk::Extent2D{
+        std::max(1u, extent.width / BLOOM_DOWNSAMPLE),
+        std::max(1u, extent.height / BLOOM_DOWNSAMPLE)
+    };
+    outputFlags_ = *output_flags;
+    lastResult_.reset();
+    createSizedResources();
+}
+
+
+void PostProcessor::createSizedResources()
+{
+    BindlessHeap& bindless_heap = context_.getBindlessHeap();
+    bool is_concurrent = !queueFamilies_.empty();
+
+    // rendered on the graphics queue, sampled on the compute queue
+    vk::ImageCreateInfo image_create_info{
+        .imageType = vk::ImageType::e2D,
+        .format = SCENE_FORMAT,
+        .extent = {extent_.width, extent_.height, 1},
+        .mipLevels = 1,
+        .arrayLayers = 1,
+        .samples = vk::SampleCountFlagBits::e1,
+        .tiling = vk::ImageTiling::eOptimal,
+        .usage = vk::ImageUsageFlagBits::eColorAttachment | vk::ImageUsageFlagBits::eSampled,
+        .sharingMode = is_concurrent ? vk::SharingMode::eConcurrent : vk::SharingMode::eExclusive,
+        .queueFamilyIndexCount = is_concurrent ? static_cast<uint32_t>(queueFamilies_.size()) : 0,
+        .pQueueFamilyIndices = is_concurrent ? queueFamilies_.data() : nullptr,
+        .initialLayout = vk::ImageLayout::eUndefined
+    };
+
+    vk::ImageViewCreateInfo image_view_create_info{
+        .viewType = vk::ImageViewType::e2D,
+        .format = SCENE_FORMAT,
+        .subresourceRange = {
+            .aspectMask = vk::ImageAspectFlagBits::eColor,
+            .baseMipLevel = 0,
+            .levelCount = 1,
+            .baseArrayLayer = 0,
+            .layerCount = 1
+        }
+    };
+
+    for (auto& frame : frames_)
+    {
+        frame.sceneImage = vk::raii::Image(context_.getLogicalDevice(), image_create_info);
+        frame.sceneAllocation = context_.getMemoryAllocator().allocateForImage(frame.sceneImage, MemoryUsage::eGpuOnly);
+        image_view_create_info.image = *frame.sceneImage;
+        frame.sceneImageView = vk::raii::ImageView(context_.getLogicalDevice(), image_view_create_info);
+        frame.sceneHandle = bindless_heap.registerSampledImage(*frame.sceneImageView, SCENE_FINAL_LAYOUT);
+
+        // one packed 32 bit texel per pixel, copied into the target as is
+        frame.outputBuffer = createBuffer(
+            vk::DeviceSize(extent_.width) * extent_.height * sizeof(uint32_t),
+            vk::BufferUsageFlagBits::eStorageBuffer | vk::BufferUsageFlagBits::eTransferSrc,
+            true,
+            frame.outputAllocation
+        );
+        frame.outputHandle = bindless_heap.registerStorageBuffer(*frame.outputBuffer);
+    }
+
+    for (uint32_t i = 0; i < bloomBuffers_.size(); i++)
+    {
+        bloomBuffers_[i] = createBuffer(
+            vk::DeviceSize(bloomExtent_.width) * bloomExtent_.height * sizeof(glm::vec4),
+            vk::BufferUsageFlagBits::eStorageBuffer,
+            false,
+            bloomAllocations_[i]
+        );
+        bloomHandles_[i] = bindless_heap.registerStorageBuffer(*bloomBuffers_[i]);
+    }
+}
+
+
+void PostProcessor::destroySizedResources()
+{
+    if (extent_.width == 0) return;  // update() never ran
+
+    // the compute queue is idle and its last submit waited for lastSceneValue_, the handles are free once
+    // the heap sees that graphics value, which is usually right away
+    BindlessHeap& bindless_heap = context_.getBindlessHeap();
+    MemoryAllocator& memory_allocator = context_.getMemoryAllocator();
+    for (auto& frame : frames_)
+    {
+        bindless_heap.release(BindlessType::eSampledImage, frame.sceneHandle, lastSceneValue_);
+        bindless_heap.release(BindlessType::eStorageBuffer, frame.outputHandle, lastSceneValue_);
+        frame.sceneImageView.clear();
+        frame.sceneImage.clear();
+        frame.outputBuffer.clear();
+        memory_allocator.free(frame.sceneAllocation);
+        memory_allocator.free(frame.outputAllocation);
+    }
+
+    for (uint32_t i = 0; i < bloomBuffers_.size(); i++)
+    {
+        bindless_heap.release(BindlessType::eStorageBuffer, bloomHandles_[i], lastSceneValue_);
+        bloomBuffers_[i].clear();
+        memory_allocator.free(bloomAllocations_[i]);
+    }
+}
+
+
+void PostProcessor::waitForFrame(uint32_t frame_index) const
+{
+    scheduler_.wait(frames_[frame_index].timelineValue);
+}
+
+
+void PostProcessor::recordComposite(vk::CommandBuffer command_buffer, vk::Image image) const
+{
+    vk::ImageSubresourceRange subresource_range{
+        .aspectMask = vk::ImageAspectFlagBits::eColor,
+        .baseMipLevel = 0,
+        .levelCount = 1,
+        .baseArrayLayer = 0,
+        .layerCount = 1
+    };
+
+    if (lastResult_)
+    {
+        vk::BufferImageCopy copy_region{
+            .bufferOffset = 0,
+            .bufferRowLength = 0,  // tightly packed
+            .bufferImageHeight = 0,
+            .imageSubresource = {
+                .aspectMask = vk::ImageAspectFlagBits::eColor,
+                .mipLevel = 0,
+                .baseArrayLayer = 0,
+                .layerCount = 1
+            },
+            .imageOffset = {0, 0, 0},
+            .imageExtent = {extent_.width, extent_.height, 1}
+        };
+        command_buffer.copyBufferToImage(*frames_[lastResult_->frameIndex].outputBuffer, image, vk::ImageLayout::eTransferDstOptimal, copy_region);
+    }
+    else
+    {
+        // the first frame after a resize has nothing to show yet
+        vk::ClearColorValue clear_color = {.float32 = std::array<float, 4>{0.0f, 0.0f, 0.0f, 1.0f}};
+        command_buffer.clearColorImage(image, vk::ImageLayout::eTransferDstOptimal, clear_color, subresource_range);
+    }
+}
+
+
+std::optional<vk::SemaphoreSubmitInfo> PostProcessor::getCompositeWaitInfo() const
+{
+    if (!lastResult_) return std::nullopt;
+
+    return vk::SemaphoreSubmitInfo{
+        .semaphore = *scheduler_.getSemaphore(),
+        .value = lastResult_->timelineValue,
+        .stageMask = vk::PipelineStageFlagBits2::eAllTransfer  // the scene pass before the copy doesn't wait
+    };
+}
+
+
+void PostProcessor::submit(uint32_t frame_index, const FrameScheduler& graphics_scheduler, uint64_t scene_value)
+{
+    TRACE_FUNCTION();
+    Frame& frame = frames_[frame_index];
+    scheduler_.wait(frame.timelineValue);  // normally a no op, waitForFrame() ran before the scene was recorded
+
+    frame.commandPool.reset();
+    frame.commandBuffer.begin({.flags = vk::CommandBufferUsageFlagBits::eOneTimeSubmit});
+    profiler_.beginFrame(frame_index, *frame.commandBuffer);
+    {
+        GpuProfileScope post_scope(profiler_, *frame.commandBuffer, "post process");
+        recordKernels(*frame.commandBuffer, frame);
+    }
+    frame.commandBuffer.end();
+
+    // the kernels only need the scene, the layout transition at the end of its pass included
+    vk::SemaphoreSubmitInfo wait_info{
+        .semaphore = *graphics_scheduler.getSemaphore(),
+        .value = scene_value,
+        .stageMask = vk::PipelineStageFlagBits2::eComputeShader
+    };
+
+    frame.timelineValue = scheduler_.reserveValue();
+    vk::SemaphoreSubmitInfo signal_info = scheduler_.getSignalInfo(frame.timelineValue, vk::PipelineStageFlagBits2::eAllCommands);
+
+    vk::CommandBufferSubmitInfo command_buffer_submit_info{
+        .commandBuffer = *frame.commandBuffer
+    };
+
+    vk::SubmitInfo2 submit_info{
+        .waitSemaphoreInfoCount = 1,
+        .pWaitSemaphoreInfos = &wait_info,
+        .commandBufferInfoCount = 1,
+        .pCommandBufferInfos = &command_buffer_submit_info,
+        .signalSemaphoreInfoCount = 1,
+        .pSignalSemaphoreInfos = &signal_info
+    };
+
+    {
+        auto queue_lock = context_.lockQueue(QueueType::eCompute);
+        context_.getQueue(QueueType::eCompute).submit2(submit_info);
+    }
+
+    lastResult_ = Result{.frameIndex = frame_index, .timelineValue = frame.timelineValue};
+    lastSceneValue_ = scene_value;
+}
+
+
+void PostProcessor::recordKernels(vk::CommandBuffer command_buffer, const Frame& frame)
+{
+    // the previous submit on this queue may still use the shared buffers
+    recordComputeBarrier(command_buffer);
+    if (isExposureReset_)
+    {
+        command_buffer.fillBuffer(*exposureBuffer_, 0, vk::WholeSize, 0);
+        isExposureReset_ = false;
+    }
+    command_buffer.fillBuffer(*histogramBuffer_, 0, vk::WholeSize, 0);
+    recordComputeBarrier(command_buffer);
+
+    context_.getBindlessHeap().bind(command_buffer, vk::PipelineBindPoint::eCompute, *layout_);
+
+    PostConstants constants{
+        .sceneExtent = {extent_.width, extent_.height},
+        .bloomExtent = {bloomExtent_.width, bloomExtent_.height},
+        .sceneImageHandle = frame.sceneHandle,
+        .sceneSamplerHandle = samplerHandle_,
+        .histogramBufferHandle = histogramHandle_,
+        .exposureBufferHandle = exposureHandle_,
+        .outputFlags = outputFlags_,
+        .bloomThreshold = settings_.bloomThreshold,
+        .bloomIntensity = settings_.bloomIntensity,
+        .exposureAdaptation = settings_.exposureAdaptation,
+        .minLogLuminance = settings_.minLogLuminance,
+        .logLuminanceRange = settings_.maxLogLuminance - settings_.minLogLuminance
+    };
+    uint32_t bloom_groups_x = getGroupCount(bloomExtent_.width, TILE_SIZE);
+    uint32_t bloom_groups_y = getGroupCount(bloomExtent_.height, TILE_SIZE);
+
+    {
+        // threshold into bloom buffer 0, then blur 0 -> 1 horizontally and 1 -> 0 vertically
+        GpuProfileScope bloom_scope(profiler_, command_buffer, "bloom");
+        constants.targetBufferHandle = bloomHandles_[0];
+        dispatch(command_buffer, Kernel::eBloomDownsample, constants, bloom_groups_x, bloom_groups_y);
+        recordComputeBarrier(command_buffer);
+
+        constants.sourceBufferHandle = bloomHandles_[0];
+        constants.targetBufferHandle = bloomHandles_[1];
+        constants.blurDirection = {1, 0};
+        dispatch(command_buffer, Kernel::eBloomBlur, constants, bloom_groups_x, bloom_groups_y);
+        recordComputeBarrier(command_buffer);
+
+        constants.sourceBufferHandle = bloomHandles_[1];
+        constants.targetBufferHandle = bloomHandles_[0];
+        constants.blurDirection = {0, 1};
+        dispatch(command_buffer, Kernel::eBloomBlur, constants, bloom_groups_x, bloom_groups_y);
+    }
+
+    {
+        // independent of the bloom chain, no barrier in between
+        GpuProfileScope luminance_scope(profiler_, command_buffer, "luminance");
+        dispatch(
+            command_buffer,
+            Kernel::eHistogram,
+            constants,
+            getGroupCount(extent_.width, HISTOGRAM_TILE_SIZE),
+            getGroupCount(extent_.height, HISTOGRAM_TILE_SIZE)
+        );
+        recordComputeBarrier(command_buffer);
+        dispatch(command_buffer, Kernel::eExposure, constants, 1, 1);
+    }
+    recordComputeBarrier(command_buffer);
+
+    {
+        GpuProfileScope tone_map_scope(profiler_, command_buffer, "tone map");
+        constants.sourceBufferHandle = bloomHandles_[0];
+        constants.targetBufferHandle = frame.outputHandle;
+        dispatch(command_buffer, Kernel::eToneMap, constants, getGroupCount(extent_.width, TILE_SIZE), getGroupCount(extent_.height, TILE_SIZE));
+    }
+}
+
+
+void PostProcessor::dispatch(
+    vk::CommandBuffer command_buffer,
+    Kernel kernel,
+    const PostConstants& constants,
+    uint32_t group_count_x,
+    uint32_t group_count_y
+) const
+{
+    command_buffer.bindPipeline(vk::PipelineBindPoint::eCompute, *pipelines_[static_cast<size_t>(kernel)]);
+    command_buffer.pushConstants(*layout_, vk::ShaderStageFlagBits::eAll, 0, sizeof(constants), &constants);
+    command_buffer.dispatch(group_count_x, group_count_y, 1);
+}
+
+
+std::optional<uint32_t> PostProcessor::getOutputFlags(vk::Format target_format)
+{
+    switch (target_format)
+    {
+        case vk::Format::eR8G8B8A8Unorm:
+            return 0u;
+        case vk::Format::eR8G8B8A8Srgb:
+            return OUTPUT_SRGB;
+        case vk::Format::eB8G8R8A8Unorm:
+            return OUTPUT_BGRA;
+        case vk::Format::eB8G8R8A8Srgb:
+            return OUTPUT_BGRA | OUTPUT_SRGB;
+        default:
+            return std::nullopt;
+    }
+}
+
+
+void PostProcessor::printStatistics(const GpuProfiler& graphics_profiler) const
+{
+    std::cout << "post process on the " << (isAsync() ? "async compute" : "graphics") << " queue, ";
+    profiler_.printStatistics();
+
+    QueueOverlapStatistics overlap = GpuProfiler::measureOverlap(graphics_profiler, profiler_);
+    if (overlap.frameCount == 0)
+    {
+        std::cout << "\t no timestamps to measure the overlap with\n";
+        return;
+    }
+
+    // busy fractions of the window both histories cover, overlap is the compute time the graphics queue was busy too
+    std::cout << "\t over " << overlap.windowMs << " ms: graphics busy " << 100.0 * overlap.firstBusyMs / overlap.windowMs
+              << "%, compute busy " << 100.0 * overlap.secondBusyMs / overlap.windowMs << "%\n"
+              << "\t overlap: " << overlap.overlapMs / overlap.frameCount << " ms per frame, "
+              << (overlap.secondBusyMs > 0.0 ? 100.0 * overlap.overlapMs / overlap.secondBusyMs : 0.0)
+              << "% of the post processing ran alongside graphics work\n";
+}
+
+
+// Accessor functions
+vk::Image PostProcessor::getSceneImage(uint32_t frame_index) const
+{
+    return *frames_[frame_index].sceneImage;
+}
+
+
+vk::ImageView PostProcessor::getSceneImageView(uint32_t frame_index) const
+{
+    return *frames_[frame_index].sceneImageView;
+}
+
+
+const GpuProfiler& PostProcessor::getGpuProfiler() const
+{
+    return profiler_;
+}
+
+
+bool PostProcessor::isAsync() const
+{
+    return context_.hasAsyncComputeQueue();
+}
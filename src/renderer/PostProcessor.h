@@ -0,0 +1,187 @@
+#pragma once
+
+#include <vulkan/vulkan_raii.hpp>
+#include <glm/glm.hpp>
+#include <array>
+#include <cstdint>
+#include <optional>
+#include <vector>
+
+#include "FrameScheduler.h"
+#include "GpuProfiler.h"
+#include "core/MemoryAllocator.h"
+
+// forward declaring classes
+class VulkanContext;
+
+struct PostProcessSettings
+{
+    float bloomThreshold = 1.0f;       // scene brightness where bloom starts, before exposure
+    float bloomIntensity = 0.04f;
+    float exposureAdaptation = 0.05f;  // fraction of the way to the measured luminance, per frame
+    float minLogLuminance = -10.0f;    // log2 luminance range the histogram covers
+    float maxLogLuminance = 6.0f;
+};
+
+
+// Bloom, a luminance histogram driving auto exposure and ACES tone mapping on the async compute queue.
+// Frames render into an HDR scene image of this class instead of the target. submit() waits on the graphics
+// timeline for the scene, runs the kernels and signals a compute timeline of its own, the result is packed
+// in the target's byte order into a buffer. The next frame copies it into its target image with
+// recordComposite(): that copy is the only graphics work waiting on the compute timeline, so the post
+// processing of one frame overlaps the geometry of the next at the cost of one frame of latency.
+// Scene images and result buffers use concurrent sharing between the two families, no ownership
+// transfers. Without an async compute family the submits go to the graphics queue and simply run in order.
+// The compute submits have their own GpuProfiler, printStatistics() measures the overlap against the
+// graphics one.
+// Not thread safe, driven by Renderer::drawFrame().
+class PostProcessor
+{
+public:
+    PostProcessor(const VulkanContext& context, uint32_t frame_count, const PostProcessSettings& settings);
+    ~PostProcessor();  // waits for the compute submits, the graphics queue must be done with the scene images
+
+    // deleting copy constructors
+    PostProcessor(const PostProcessor&) = delete;
+    PostProcessor& operator=(const PostProcessor&) = delete;
+
+    // waits for the compute submit that last read the slot's scene image, before the slot renders again
+    void waitForFrame(uint32_t frame_index) const;
+
+    // recreates the scene images and buffers when the target's format or extent changed (after waiting for
+    // the compute queue), the pending result is dropped and the next composite clears instead.
+    // throws std::runtime_error unless target_format is 8 bit RGBA or BGRA, unorm or sRGB
+    void update(vk::Format target_format, vk::Extent2D extent);
+
+    // graphics, outside of rendering: copies the previous frame's result into image, which must be a transfer
+    // destination in eTransferDstOptimal (the Renderer's render graph transitions it around the copy)
+    void recordComposite(vk::CommandBuffer command_buffer, vk::Image image) const;
+    auto getCompositeWaitInfo() const -> std::optional<vk::SemaphoreSubmitInfo>;  // for the submit of recordComposite()
+
+    // records and submits the kernels for the slot's scene image, after the graphics submit that
+    // signals scene_value on graphics_scheduler
+    void submit(uint32_t frame_index, const FrameScheduler& graphics_scheduler, uint64_t scene_value);
+
+    void printStatistics(const GpuProfiler& graphics_profiler) const;
+
+    // accessor functions
+    auto getSceneImage(uint32_t frame_index) const -> vk::Image;
+    auto getSceneImageView(uint32_t frame_index) const -> vk::ImageView;
+    auto getGpuProfiler() const -> const GpuProfiler&;
+    bool isAsync() const;  // the submits go to a compute family of their own
+
+    static constexpr vk::Format SCENE_FORMAT = vk::Format::eR16G16B16A16Sfloat;  // pipelines render the scene in this
+    static constexpr vk::ImageLayout SCENE_FINAL_LAYOUT = vk::ImageLayout::eShaderReadOnlyOptimal;  // where the scene pass leaves it
+    static constexpr uint32_t BLOOM_DOWNSAMPLE = 4;      // matches shaders/post.slang
+    static constexpr uint32_t HISTOGRAM_BIN_COUNT = 256;
+
+private:
+    enum class Kernel
+    {
+        eBloomDownsample,
+        eBloomBlur,
+        eHistogram,
+        eExposure,
+        eToneMap
+    };
+    static constexpr uint32_t KERNEL_COUNT = 5;
+
+    // push constants of every kernel, mirrors PostConstants in shaders/post.slang
+    struct PostConstants
+    {
+        glm::uvec2 sceneExtent = {0, 0};
+        glm::uvec2 bloomExtent = {0, 0};
+        glm::ivec2 blurDirection = {0, 0};
+        uint32_t sceneImageHandle = 0;
+        uint32_t sceneSamplerHandle = 0;
+        uint32_t sourceBufferHandle = 0;
+        uint32_t targetBufferHandle = 0;
+        uint32_t histogramBufferHandle = 0;
+        uint32_t exposureBufferHandle = 0;
+        uint32_t outputFlags = 0;
+        float bloomThreshold = 0.0f;
+        float bloomIntensity = 0.0f;
+        float exposureAdaptation = 0.0f;
+        float minLogLuminance = 0.0f;
+        float logLuminanceRange = 0.0f;
+    };
+
+    struct Frame
+    {
+        vk::raii::CommandPool commandPool = nullptr;
+        vk::raii::CommandBuffer commandBuffer = nullptr;
+        uint64_t timelineValue = 0;  // compute timeline, 0 until the first submit
+
+        // sized by update()
+        vk::raii::Image sceneImage = nullptr;
+        vk::raii::ImageView sceneImageView = nullptr;
+        vk::raii::Buffer outputBuffer = nullptr;
+        Allocation sceneAllocation;
+        Allocation outputAllocation;
+        uint32_t sceneHandle = 0;
+        uint32_t outputHandle = 0;
+    };
+
+    // a submitted result the next composite copies
+    struct Result
+    {
+        uint32_t frameIndex = 0;
+        uint64_t timelineValue = 0;
+    };
+
+    void createFrames(uint32_t frame_count);
+    void createPipelines();
+    void createSizedResources();
+    void destroySizedResources();
+    void recordKernels(vk::CommandBuffer command_buffer, const Frame& frame);
+    void dispatch(vk::CommandBuffer command_buffer, Kernel kernel, const PostConstants& constants, uint32_t group_count_x, uint32_t group_count_y) const;
+    auto createBuffer(vk::DeviceSize size, vk::BufferUsageFlags usage, bool is_shared, Allocation& allocation) const -> vk::raii::Buffer;
+    static auto getOutputFlags(vk::Format target_format) -> std::optional<uint32_t>;
+
+    // shader paths, relative to the executable working directory
+    static constexpr std::array<const char*, KERNEL_COUNT> SHADER_PATHS = {
+        "shaders/post_bloom_downsample.comp.spv",
+        "shaders/post_bloom_blur.comp.spv",
+        "shaders/post_histogram.comp.spv",
+        "shaders/post_exposure.comp.spv",
+        "shaders/post_tone_map.comp.spv"
+    };
+    static constexpr std::array<const char*, KERNEL_COUNT> ENTRY_POINTS = {
+        "bloomDownsampleMain",
+        "bloomBlurMain",
+        "histogramMain",
+        "exposureMain",
+        "toneMapMain"
+    };
+
+    const VulkanContext& context_;
+    PostProcessSettings settings_;
+    FrameScheduler scheduler_;  // the compute timeline, declared before everything its submits use
+    GpuProfiler profiler_;
+    std::vector<uint32_t> queueFamilies_;  // graphics and compute when they differ, for concurrent sharing
+
+    vk::raii::PipelineLayout layout_ = nullptr;
+    std::array<vk::raii::Pipeline, KERNEL_COUNT> pipelines_ = {nullptr, nullptr, nullptr, nullptr, nullptr};
+    vk::raii::Sampler sampler_ = nullptr;
+    uint32_t samplerHandle_ = 0;
+    std::vector<Frame> frames_;
+
+    // shared by every frame, submits on one queue run in order
+    std::array<vk::raii::Buffer, 2> bloomBuffers_ = {nullptr, nullptr};  // ping pong for the separable blur
+    std::array<Allocation, 2> bloomAllocations_;
+    std::array<uint32_t, 2> bloomHandles_ = {0, 0};
+    vk::raii::Buffer histogramBuffer_ = nullptr;
+    vk::raii::Buffer exposureBuffer_ = nullptr;
+    Allocation histogramAllocation_;
+    Allocation exposureAllocation_;
+    uint32_t histogramHandle_ = 0;
+    uint32_t exposureHandle_ = 0;
+    bool isExposureReset_ = true;  // the exposure buffer is cleared by the next submit
+
+    vk::Format targetFormat_ = vk::Format::eUndefined;
+    vk::Extent2D extent_ = {0, 0};
+    vk::Extent2D bloomExtent_ = {0, 0};
+    uint32_t outputFlags_ = 0;
+    std::optional<Result> lastResult_;
+    uint64_t lastSceneValue_ = 0;  // graphics timeline, the newest scene a submit waited for
+};
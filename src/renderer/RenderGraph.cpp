@@ -0,0 +1,1034 @@
+#include "RenderGraph.h"
+#include "FrameScheduler.h"
+#include "core/VulkanContext.h"
+#include "utils/Trace.h"
+#include <algorithm>
+#include <stdexcept>
+
+
+namespace
+{
+    // stages, access and image layout one RenderGraphAccess stands for
+    struct AccessInfo
+    {
+        vk::PipelineStageFlags2 stage;
+        vk::AccessFlags2 access;
+        vk::ImageLayout layout = vk::ImageLayout::eUndefined;
+        vk::ImageUsageFlags imageUsage;
+        vk::BufferUsageFlags bufferUsage;
+        bool isImageAccess = true;
+        bool isBufferAccess = true;
+        bool isComputeAccess = true;  // valid on a compute queue
+    };
+
+    AccessInfo getAccessInfo(RenderGraphAccess access, RenderGraphQueue queue)
+    {
+        vk::PipelineStageFlags2 shader_stage = queue == RenderGraphQueue::eGraphics
+            ? vk::PipelineStageFlagBits2::eVertexShader | vk::PipelineStageFlagBits2::eFragmentShader
+            : vk::PipelineStageFlagBits2::eComputeShader;
+        vk::PipelineStageFlags2 depth_stage = vk::PipelineStageFlagBits2::eEarlyFragmentTests |
+                                              vk::PipelineStageFlagBits2::eLateFragmentTests;
+
+        switch (access)
+        {
+            case RenderGraphAccess::eColorAttachment:
+                return {
+                    .stage = vk::PipelineStageFlagBits2::eColorAttachmentOutput,
+                    .access = vk::AccessFlagBits2::eColorAttachmentRead | vk::AccessFlagBits2::eColorAttachmentWrite,
+                    .layout = vk::ImageLayout::eColorAttachmentOptimal,
+                    .imageUsage = vk::ImageUsageFlagBits::eColorAttachment,
+                    .isBufferAccess = false,
+                    .isComputeAccess = false
+                };
+            case RenderGraphAccess::eDepthAttachment:
+                return {
+                    .stage = depth_stage,
+                    .access = vk::AccessFlagBits2::eDepthStencilAttachmentRead | vk::AccessFlagBits2::eDepthStencilAttachmentWrite,
+                    .layout = vk::ImageLayout::eDepthStencilAttachmentOptimal,
+                    .imageUsage = vk::ImageUsageFlagBits::eDepthStencilAttachment,
+                    .isBufferAccess = false,
+                    .isComputeAccess = false
+                };
+            case RenderGraphAccess::eDepthRead:
+                return {
+                    .stage = depth_stage,
+                    .access = vk::AccessFlagBits2::eDepthStencilAttachmentRead,
+                    .layout = vk::ImageLayout::eDepthStencilReadOnlyOptimal,
+                    .imageUsage = vk::ImageUsageFlagBits::eDepthStencilAttachment,
+                    .isBufferAccess = false,
+                    .isComputeAccess = false
+                };
+            case RenderGraphAccess::eShaderRead:
+                return {
+                    .stage = shader_stage,
+                    .access = vk::AccessFlagBits2::eShaderSampledRead | vk::AccessFlagBits2::eShaderStorageRead,
+                    .layout = vk::ImageLayout::eShaderReadOnlyOptimal,
+                    .imageUsage = vk::ImageUsageFlagBits::eSampled,
+                    .bufferUsage = vk::BufferUsageFlagBits::eStorageBuffer
+                };
+            case RenderGraphAccess::eShaderWrite:
+                return {
+                    .stage = shader_stage,
+                    .access = vk::AccessFlagBits2::eShaderStorageRead | vk::AccessFlagBits2::eShaderStorageWrite,
+                    .layout = vk::ImageLayout::eGeneral,
+                    .imageUsage = vk::ImageUsageFlagBits::eStorage,
+                    .bufferUsage = vk::BufferUsageFlagBits::eStorageBuffer
+                };
+            case RenderGraphAccess::eTransferSrc:
+                return {
+                    .stage = vk::PipelineStageFlagBits2::eAllTransfer,
+                    .access = vk::AccessFlagBits2::eTransferRead,
+                    .layout = vk::ImageLayout::eTransferSrcOptimal,
+                    .imageUsage = vk::ImageUsageFlagBits::eTransferSrc,
+                    .bufferUsage = vk::BufferUsageFlagBits::eTransferSrc
+                };
+            case RenderGraphAccess::eTransferDst:
+                return {
+                    .stage = vk::PipelineStageFlagBits2::eAllTransfer,
+                    .access = vk::AccessFlagBits2::eTransferWrite,
+                    .layout = vk::ImageLayout::eTransferDstOptimal,
+                    .imageUsage = vk::ImageUsageFlagBits::eTransferDst,
+                    .bufferUsage = vk::BufferUsageFlagBits::eTransferDst
+                };
+            case RenderGraphAccess::eIndirectRead:
+            default:
+                return {
+                    .stage = vk::PipelineStageFlagBits2::eDrawIndirect,
+                    .access = vk::AccessFlagBits2::eIndirectCommandRead,
+                    .bufferUsage = vk::BufferUsageFlagBits::eIndirectBuffer,
+                    .isImageAccess = false
+                };
+        }
+    }
+
+    vk::ImageAspectFlags getAspectMask(vk::Format format)
+    {
+        switch (format)
+        {
+            case vk::Format::eD16Unorm:
+            case vk::Format::eX8D24UnormPack32:
+            case vk::Format::eD32Sfloat:
+                return vk::ImageAspectFlagBits::eDepth;
+            case vk::Format::eD16UnormS8Uint:
+            case vk::Format::eD24UnormS8Uint:
+            case vk::Format::eD32SfloatS8Uint:
+                return vk::ImageAspectFlagBits::eDepth | vk::ImageAspectFlagBits::eStencil;
+            case vk::Format::eS8Uint:
+                return vk::ImageAspectFlagBits::eStencil;
+            default:
+                return vk::ImageAspectFlagBits::eColor;
+        }
+    }
+
+    // 64 bit FNV-1a over the value's bytes
+    void hashValue(uint64_t& hash, uint64_t value)
+    {
+        for (int i = 0; i < 8; i++)
+        {
+            hash ^= (value >> (i * 8)) & 0xff;
+            hash *= 0x100000001b3ull;
+        }
+    }
+
+    constexpr uint64_t HASH_SEED = 0xcbf29ce484222325ull;
+}
+
+
+// RenderGraphPass
+
+
+RenderGraphPass& RenderGraphPass::reads(RenderGraphResource resource, RenderGraphAccess access)
+{
+    uses_.push_back(Use{.resource = resource.index, .access = access, .isWrite = false});
+    return *this;
+}
+
+
+RenderGraphPass& RenderGraphPass::writes(RenderGraphResource resource, RenderGraphAccess access)
+{
+    uses_.push_back(Use{.resource = resource.index, .access = access, .isWrite = true});
+    return *this;
+}
+
+
+// RenderGraph
+
+
+RenderGraph::FrameResources::~FrameResources()
+{
+    // views, images and buffers go before the memory they're bound to
+    for (PhysicalResource& resource : resources)
+    {
+        resource.imageView.clear();
+        resource.image.clear();
+        resource.buffer.clear();
+        context.getMemoryAllocator().free(resource.allocation);
+    }
+    for (Allocation& heap : heaps)
+    {
+        context.getMemoryAllocator().free(heap);
+    }
+}
+
+
+RenderGraph::RenderGraph(const VulkanContext& context, uint32_t frame_count)
+    : context_(context), frameCount_(frame_count), frameCommands_(frame_count)
+{
+    vk::SemaphoreTypeCreateInfo semaphore_type_create_info{
+        .semaphoreType = vk::SemaphoreType::eTimeline,
+        .initialValue = 0
+    };
+    vk::SemaphoreCreateInfo semaphore_create_info{
+        .pNext = &semaphore_type_create_info
+    };
+
+    uint32_t queue_slot_count = context_.hasAsyncComputeQueue() ? QUEUE_SLOT_COUNT : 1;
+    for (uint32_t slot = 0; slot < queue_slot_count; slot++)
+    {
+        QueueType queue_type = slot == GRAPHICS_SLOT ? QueueType::eGraphics : QueueType::eCompute;
+        timelineSemaphores_[slot] = vk::raii::Semaphore(context_.getLogicalDevice(), semaphore_create_info);
+
+        for (FrameCommands& commands : frameCommands_)
+        {
+            vk::CommandPoolCreateInfo command_pool_create_info{
+                .flags = vk::CommandPoolCreateFlagBits::eTransient,
+                .queueFamilyIndex = context_.getQueueFamilyIndex(queue_type)
+            };
+            commands.commandPools[slot] = vk::raii::CommandPool(context_.getLogicalDevice(), command_pool_create_info);
+        }
+    }
+}
+
+
+RenderGraph::~RenderGraph()
+{
+    compiled_.frames.clear();
+}
+
+
+void RenderGraph::reset()
+{
+    // the compiled plan and memory stay, compile() compares against them
+    resources_.clear();
+    passes_.clear();
+}
+
+
+RenderGraphResource RenderGraph::createImage(const std::string& name, const RenderGraphImageDesc& desc)
+{
+    if (desc.format == vk::Format::eUndefined || desc.extent.width == 0 || desc.extent.height == 0)
+    {
+        throw std::runtime_error("render graph image '" + name + "' needs a format and a non zero extent");
+    }
+
+    resources_.push_back(Resource{.name = name, .type = ResourceType::eImage, .imageDesc = desc});
+    return RenderGraphResource{static_cast<uint32_t>(resources_.size() - 1)};
+}
+
+
+RenderGraphResource RenderGraph::createBuffer(const std::string& name, vk::DeviceSize size)
+{
+    if (size == 0)
+    {
+        throw std::runtime_error("render graph buffer '" + name + "' needs a non zero size");
+    }
+
+    resources_.push_back(Resource{.name = name, .type = ResourceType::eBuffer, .bufferSize = size});
+    return RenderGraphResource{static_cast<uint32_t>(resources_.size() - 1)};
+}
+
+
+RenderGraphResource RenderGraph::importImage(const std::string& name, const RenderGraphImportedImage& image)
+{
+    resources_.push_back(Resource{
+        .name = name,
+        .type = ResourceType::eImage,
+        .isImported = true,
+        .imageDesc = image.desc,
+        .importedImage = image
+    });
+    return RenderGraphResource{static_cast<uint32_t>(resources_.size() - 1)};
+}
+
+
+RenderGraphResource RenderGraph::importBuffer(const std::string& name, vk::Buffer buffer, vk::DeviceSize size)
+{
+    resources_.push_back(Resource{
+        .name = name,
+        .type = ResourceType::eBuffer,
+        .isImported = true,
+        .bufferSize = size,
+        .importedBuffer = buffer
+    });
+    return RenderGraphResource{static_cast<uint32_t>(resources_.size() - 1)};
+}
+
+
+RenderGraphPass& RenderGraph::addPass(const std::string& name, RenderGraphQueue queue, RenderGraphPass::ExecuteFunction execute)
+{
+    auto pass = std::make_unique<RenderGraphPass>();
+    pass->name_ = name;
+    pass->queue_ = queue;
+    pass->execute_ = std::move(execute);
+    passes_.push_back(std::move(pass));
+
+    return *passes_.back();
+}
+
+
+void RenderGraph::compile(FrameScheduler& scheduler)
+{
+    TRACE_FUNCTION();
+    computeLifetimes();
+
+    uint64_t topology_hash = computeTopologyHash();
+    wasRecompiled_ = !compiled_.isValid || compiled_.topologyHash != topology_hash;
+    if (!wasRecompiled_) return;
+
+    // frames in flight may still use the old memory
+    for (auto& frame : compiled_.frames)
+    {
+        scheduler.retire(std::move(frame));
+    }
+    compiled_ = CompiledGraph{};
+    compiled_.topologyHash = topology_hash;
+
+    std::vector<std::vector<uint32_t>> alias_predecessors = createFrameResources();
+    planBatches(alias_predecessors);
+    compiled_.isValid = true;
+}
+
+
+void RenderGraph::computeLifetimes()
+{
+    for (uint32_t pass_index = 0; pass_index < passes_.size(); pass_index++)
+    {
+        const RenderGraphPass& pass = *passes_[pass_index];
+        bool is_compute = pass.queue_ != RenderGraphQueue::eGraphics;
+
+        for (const RenderGraphPass::Use& use : pass.uses_)
+        {
+            if (use.resource >= resources_.size())
+            {
+                throw std::runtime_error("render graph pass '" + pass.name_ + "' uses an unknown resource");
+            }
+
+            Resource& resource = resources_[use.resource];
+            AccessInfo info = getAccessInfo(use.access, pass.queue_);
+            bool is_image = resource.type == ResourceType::eImage;
+            if ((is_image && !info.isImageAccess) || (!is_image && !info.isBufferAccess))
+            {
+                throw std::runtime_error("render graph pass '" + pass.name_ + "' uses '" + resource.name + "' with an access its type doesn't have");
+            }
+            if (is_compute && !info.isComputeAccess)
+            {
+                throw std::runtime_error("render graph compute pass '" + pass.name_ + "' uses '" + resource.name + "' as an attachment");
+            }
+
+            resource.imageUsage |= info.imageUsage;
+            resource.bufferUsage |= info.bufferUsage;
+            resource.firstPass = std::min(resource.firstPass, pass_index);
+            resource.lastPass = std::max(resource.lastPass, pass_index);
+            resource.isUsedAsync |= getQueueSlot(pass.queue_) == COMPUTE_SLOT;
+        }
+    }
+}
+
+
+uint64_t RenderGraph::computeTopologyHash() const
+{
+    // everything the plan and the memory depend on, not the imported handles or the execute functions
+    uint64_t hash = HASH_SEED;
+    for (const Resource& resource : resources_)
+    {
+        hashValue(hash, static_cast<uint64_t>(resource.type));
+        hashValue(hash, resource.isImported);
+        hashValue(hash, static_cast<uint64_t>(resource.imageDesc.format));
+        hashValue(hash, (static_cast<uint64_t>(resource.imageDesc.extent.width) << 32) | resource.imageDesc.extent.height);
+        hashValue(hash, resource.imageDesc.mipLevelCount);
+        hashValue(hash, static_cast<uint64_t>(resource.imageDesc.sampleCount));
+        hashValue(hash, resource.bufferSize);
+        hashValue(hash, static_cast<uint64_t>(resource.importedImage.initialLayout));
+        hashValue(hash, static_cast<uint64_t>(resource.importedImage.finalLayout));
+    }
+    for (const auto& pass : passes_)
+    {
+        hashValue(hash, static_cast<uint64_t>(pass->queue_));
+        hashValue(hash, pass->uses_.size());
+        for (const RenderGraphPass::Use& use : pass->uses_)
+        {
+            hashValue(hash, (static_cast<uint64_t>(use.resource) << 32) | (static_cast<uint64_t>(use.access) << 1) | use.isWrite);
+        }
+    }
+
+    return hash;
+}
+
+
+std::vector<std::vector<uint32_t>> RenderGraph::createFrameResources()
+{
+    TRACE_FUNCTION();
+    const vk::raii::Device& device = context_.getLogicalDevice();
+    MemoryAllocator& allocator = context_.getMemoryAllocator();
+
+    // resources an async pass touches are shared with the compute family, when it's a different one
+    std::vector<uint32_t> queue_families = {context_.getQueueFamilyIndex(QueueType::eGraphics)};
+    if (context_.hasAsyncComputeQueue() && context_.getQueueFamilyIndex(QueueType::eCompute) != queue_families[0])
+    {
+        queue_families.push_back(context_.getQueueFamilyIndex(QueueType::eCompute));
+    }
+
+    // images that are only ever attachments can be lazily allocated, tiled GPUs keep them in tile memory
+    auto is_attachment_only = [](const Resource& resource)
+    {
+        constexpr vk::ImageUsageFlags attachment_usage = vk::ImageUsageFlagBits::eColorAttachment |
+                                                         vk::ImageUsageFlagBits::eDepthStencilAttachment;
+        return resource.type == ResourceType::eImage && !(resource.imageUsage & ~attachment_usage);
+    };
+
+    auto create_resource = [&](const Resource& resource, PhysicalResource& physical)
+    {
+        bool is_concurrent = resource.isUsedAsync && queue_families.size() > 1;
+        if (resource.type == ResourceType::eImage)
+        {
+            vk::ImageUsageFlags usage = resource.imageUsage;
+            if (is_attachment_only(resource)) usage |= vk::ImageUsageFlagBits::eTransientAttachment;
+
+            vk::ImageCreateInfo image_create_info{
+                .imageType = vk::ImageType::e2D,
+                .format = resource.imageDesc.format,
+                .extent = {resource.imageDesc.extent.width, resource.imageDesc.extent.height, 1},
+                .mipLevels = resource.imageDesc.mipLevelCount,
+                .arrayLayers = 1,
+                .samples = resource.imageDesc.sampleCount,
+                .tiling = vk::ImageTiling::eOptimal,
+                .usage = usage,
+                .sharingMode = is_concurrent ? vk::SharingMode::eConcurrent : vk::SharingMode::eExclusive,
+                .queueFamilyIndexCount = is_concurrent ? static_cast<uint32_t>(queue_families.size()) : 0,
+                .pQueueFamilyIndices = is_concurrent ? queue_families.data() : nullptr,
+                .initialLayout = vk::ImageLayout::eUndefined
+            };
+            physical.image = vk::raii::Image(device, image_create_info);
+        }
+        else
+        {
+            vk::BufferCreateInfo buffer_create_info{
+                .size = resource.bufferSize,
+                .usage = resource.bufferUsage,
+                .sharingMode = is_concurrent ? vk::SharingMode::eConcurrent : vk::SharingMode::eExclusive,
+                .queueFamilyIndexCount = is_concurrent ? static_cast<uint32_t>(queue_families.size()) : 0,
+                .pQueueFamilyIndices = is_concurrent ? queue_families.data() : nullptr
+            };
+            physical.buffer = vk::raii::Buffer(device, buffer_create_info);
+        }
+    };
+
+    auto get_requirements = [](const PhysicalResource& physical)
+    {
+        return *physical.image ? physical.image.getMemoryRequirements() : physical.buffer.getMemoryRequirements();
+    };
+
+    // where a transient lives inside its kind's heap, the same in every frame slot
+    struct Placement
+    {
+        uint32_t heap = UINT32_MAX;  // UINT32_MAX: own allocation
+        vk::DeviceSize offset = 0;
+        vk::DeviceSize size = 0;
+    };
+    std::vector<Placement> placements(resources_.size());
+
+    // lazily allocated memory only takes attachment only images, they share heaps of their own
+    struct HeapGroup
+    {
+        ResourceKind kind = ResourceKind::eOptimal;
+        MemoryUsage usage = MemoryUsage::eGpuOnly;
+    };
+    constexpr std::array<HeapGroup, 3> HEAP_GROUPS = {{
+        {.kind = ResourceKind::eOptimal, .usage = MemoryUsage::eTransient},
+        {.kind = ResourceKind::eOptimal, .usage = MemoryUsage::eGpuOnly},
+        {.kind = ResourceKind::eLinear, .usage = MemoryUsage::eGpuOnly}
+    }};
+    std::vector<vk::MemoryRequirements> heap_requirements;
+    std::vector<HeapGroup> heap_groups;
+    std::vector<std::vector<uint32_t>> alias_predecessors(resources_.size());
+
+    for (uint32_t frame_index = 0; frame_index < frameCount_; frame_index++)
+    {
+        auto frame = std::make_unique<FrameResources>(context_);
+        frame->resources.resize(resources_.size());
+
+        for (uint32_t i = 0; i < resources_.size(); i++)
+        {
+            const Resource& resource = resources_[i];
+            if (resource.isImported || resource.firstPass == UINT32_MAX) continue;  // unused transients are never created
+            create_resource(resource, frame->resources[i]);
+        }
+
+        // the first slot decides the placement, identically created resources have identical requirements
+        if (frame_index == 0)
+        {
+            for (const HeapGroup& group : HEAP_GROUPS)
+            {
+                std::vector<uint32_t> candidates;
+                for (uint32_t i = 0; i < resources_.size(); i++)
+                {
+                    const Resource& resource = resources_[i];
+                    if (resource.isImported || resource.firstPass == UINT32_MAX) continue;
+                    if ((resource.type == ResourceType::eImage) != (group.kind == ResourceKind::eOptimal)) continue;
+                    bool is_lazy = is_attachment_only(resource);
+                    if (is_lazy != (group.usage == MemoryUsage::eTransient)) continue;
+
+                    vk::MemoryRequirements requirements = get_requirements(frame->resources[i]);
+                    placements[i].size = requirements.size;
+                    compiled_.unaliasedMemorySize += requirements.size;
+                    if (!resource.isUsedAsync) candidates.push_back(i);
+                }
+
+                // biggest first, the small ones fill the gaps
+                std::ranges::sort(candidates, [&](uint32_t a, uint32_t b) { return placements[a].size > placements[b].size; });
+
+                vk::MemoryRequirements heap{.size = 0, .alignment = 1, .memoryTypeBits = ~0u};
+                std::vector<uint32_t> placed;
+                for (uint32_t candidate : candidates)
+                {
+                    vk::MemoryRequirements requirements = get_requirements(frame->resources[candidate]);
+                    if ((heap.memoryTypeBits & requirements.memoryTypeBits) == 0) continue;  // keeps its own allocation
+
+                    const Resource& resource = resources_[candidate];
+                    auto lifetimes_overlap = [&](uint32_t other)
+                    {
+                        return resources_[other].firstPass <= resource.lastPass && resource.firstPass <= resources_[other].lastPass;
+                    };
+
+                    // lowest offset that doesn't collide with anything alive at the same time
+                    vk::DeviceSize offset = 0;
+                    bool has_moved = true;
+                    while (has_moved)
+                    {
+                        has_moved = false;
+                        for (uint32_t other : placed)
+                        {
+                            const Placement& other_placement = placements[other];
+                            bool memory_overlaps = offset < other_placement.offset + other_placement.size &&
+                                                   other_placement.offset < offset + requirements.size;
+                            if (memory_overlaps && lifetimes_overlap(other))
+                            {
+                                vk::DeviceSize end = other_placement.offset + other_placement.size;
+                                offset = (end + requirements.alignment - 1) / requirements.alignment * requirements.alignment;
+                                has_moved = true;
+                            }
+                        }
+                    }
+
+                    placements[candidate].heap = static_cast<uint32_t>(heap_requirements.size());
+                    placements[candidate].offset = offset;
+                    heap.size = std::max(heap.size, offset + requirements.size);
+                    heap.alignment = std::max(heap.alignment, requirements.alignment);
+                    heap.memoryTypeBits &= requirements.memoryTypeBits;
+
+                    // whoever uses the shared memory first must be done with it before the later one's first use.
+                    // Placement goes by size, so either of the two can be the one placed first
+                    for (uint32_t other : placed)
+                    {
+                        const Placement& other_placement = placements[other];
+                        bool memory_overlaps = offset < other_placement.offset + other_placement.size &&
+                                               other_placement.offset < offset + requirements.size;
+                        if (!memory_overlaps) continue;
+
+                        if (resources_[other].lastPass < resource.firstPass) alias_predecessors[candidate].push_back(other);
+                        else alias_predecessors[other].push_back(candidate);
+                    }
+                    placed.push_back(candidate);
+                }
+
+                if (!placed.empty())
+                {
+                    heap_requirements.push_back(heap);
+                    heap_groups.push_back(group);
+                }
+            }
+
+            for (const vk::MemoryRequirements& heap : heap_requirements)
+            {
+                compiled_.transientMemorySize += heap.size;
+            }
+            for (uint32_t i = 0; i < resources_.size(); i++)
+            {
+                if (placements[i].size > 0 && placements[i].heap == UINT32_MAX) compiled_.transientMemorySize += placements[i].size;
+            }
+        }
+
+        for (size_t heap = 0; heap < heap_requirements.size(); heap++)
+        {
+            frame->heaps.push_back(allocator.allocate(heap_requirements[heap], heap_groups[heap].usage, heap_groups[heap].kind));
+        }
+
+        for (uint32_t i = 0; i < resources_.size(); i++)
+        {
+            PhysicalResource& physical = frame->resources[i];
+            if (!*physical.image && !*physical.buffer) continue;
+
+            const Placement& placement = placements[i];
+            if (placement.heap == UINT32_MAX)
+            {
+                MemoryUsage usage = is_attachment_only(resources_[i]) ? MemoryUsage::eTransient : MemoryUsage::eGpuOnly;
+                physical.allocation = *physical.image
+                    ? allocator.allocateForImage(physical.image, usage)
+                    : allocator.allocateForBuffer(physical.buffer, usage);
+            }
+            else
+            {
+                const Allocation& heap = frame->heaps[placement.heap];
+                if (*physical.image) physical.image.bindMemory(heap.memory, heap.offset + placement.offset);
+                else physical.buffer.bindMemory(heap.memory, heap.offset + placement.offset);
+            }
+
+            if (*physical.image)
+            {
+                // depth stencil views only see depth, both aspects can't be sampled together
+                vk::ImageAspectFlags aspect_mask = getAspectMask(resources_[i].imageDesc.format);
+                if (aspect_mask & vk::ImageAspectFlagBits::eDepth) aspect_mask = vk::ImageAspectFlagBits::eDepth;
+
+                vk::ImageViewCreateInfo image_view_create_info{
+                    .image = *physical.image,
+                    .viewType = vk::ImageViewType::e2D,
+                    .format = resources_[i].imageDesc.format,
+                    .subresourceRange = {
+                        .aspectMask = aspect_mask,
+                        .baseMipLevel = 0,
+                        .levelCount = resources_[i].imageDesc.mipLevelCount,
+                        .baseArrayLayer = 0,
+                        .layerCount = 1
+                    }
+                };
+                physical.imageView = vk::raii::ImageView(device, image_view_create_info);
+            }
+        }
+
+        compiled_.frames.push_back(std::move(frame));
+    }
+
+    return alias_predecessors;
+}
+
+
+void RenderGraph::planBatches(const std::vector<std::vector<uint32_t>>& alias_predecessors)
+{
+    TRACE_FUNCTION();
+
+    // what the plan knows about a resource after the passes so far
+    struct ResourceState
+    {
+        vk::ImageLayout layout = vk::ImageLayout::eUndefined;
+        vk::PipelineStageFlags2 writeStage;  // last write, or the last layout transition
+        vk::AccessFlags2 writeAccess;
+        vk::PipelineStageFlags2 readStage;   // reads since then that the write is visible to
+        vk::AccessFlags2 readAccess;
+        uint32_t lastBatch = UINT32_MAX;
+        bool isSynchronized = false;         // a semaphore wait ordered it after the other queue
+    };
+    std::vector<ResourceState> states(resources_.size());
+
+    for (uint32_t i = 0; i < resources_.size(); i++)
+    {
+        const Resource& resource = resources_[i];
+        if (!resource.isImported) continue;
+
+        // we don't know who used an imported resource before the graph, so the first barrier waits for everything
+        states[i].layout = resource.type == ResourceType::eImage ? resource.importedImage.initialLayout : vk::ImageLayout::eUndefined;
+        states[i].writeStage = vk::PipelineStageFlagBits2::eAllCommands;
+        states[i].writeAccess = vk::AccessFlagBits2::eMemoryWrite;
+    }
+
+    std::array<uint32_t, QUEUE_SLOT_COUNT> signal_counts = {0, 0};
+    std::vector<Batch>& batches = compiled_.batches;
+
+    auto add_barrier = [&](BarrierBatch& barrier_batch, uint32_t resource, ResourceState& state, const AccessInfo& info, bool is_write)
+    {
+        bool is_image = resources_[resource].type == ResourceType::eImage;
+        bool is_transition = is_image && state.layout != info.layout;
+
+        BarrierBatch::Barrier barrier{
+            .resource = resource,
+            .dstStage = info.stage,
+            .dstAccess = info.access,
+            .oldLayout = is_image ? state.layout : vk::ImageLayout::eUndefined,
+            .newLayout = is_image ? info.layout : vk::ImageLayout::eUndefined
+        };
+
+        if (is_write || is_transition)
+        {
+            // write after read only needs the execution dependency, write after write the memory one too
+            barrier.srcStage = state.writeStage | state.readStage;
+            barrier.srcAccess = state.writeAccess;
+            if (!barrier.srcStage && state.isSynchronized) barrier.srcStage = vk::PipelineStageFlagBits2::eAllCommands;
+            if (barrier.srcStage || is_transition) barrier_batch.barriers.push_back(barrier);
+
+            state.layout = is_image ? info.layout : state.layout;
+            state.writeStage = info.stage;
+            state.writeAccess = is_write ? info.access : vk::AccessFlags2{};
+            state.readStage = is_write ? vk::PipelineStageFlags2{} : info.stage;
+            state.readAccess = is_write ? vk::AccessFlags2{} : info.access;
+        }
+        else
+        {
+            // read after read in the same layout is free, a read after a write once per stage and access
+            bool is_visible = (info.stage & state.readStage) == info.stage && (info.access & state.readAccess) == info.access;
+            if (state.writeStage && !is_visible)
+            {
+                barrier.srcStage = state.writeStage;
+                barrier.srcAccess = state.writeAccess;
+                barrier_batch.barriers.push_back(barrier);
+            }
+            state.readStage |= info.stage;
+            state.readAccess |= info.access;
+        }
+        state.isSynchronized = false;
+    };
+
+    for (uint32_t pass_index = 0; pass_index < passes_.size(); pass_index++)
+    {
+        const RenderGraphPass& pass = *passes_[pass_index];
+        uint32_t queue_slot = getQueueSlot(pass.queue_);
+        if (batches.empty() || batches.back().queueSlot != queue_slot)
+        {
+            batches.push_back(Batch{.queueSlot = queue_slot, .signalValue = ++signal_counts[queue_slot]});
+        }
+        uint32_t batch_index = static_cast<uint32_t>(batches.size() - 1);
+        Batch& batch = batches.back();
+
+        // a resource used twice in the pass is one use with the accesses merged
+        struct MergedUse
+        {
+            uint32_t resource = 0;
+            AccessInfo info;
+            bool isWrite = false;
+        };
+        std::vector<MergedUse> merged_uses;
+        for (const RenderGraphPass::Use& use : pass.uses_)
+        {
+            AccessInfo info = getAccessInfo(use.access, pass.queue_);
+            auto it = std::ranges::find(merged_uses, use.resource, &MergedUse::resource);
+            if (it == merged_uses.end())
+            {
+                merged_uses.push_back(MergedUse{.resource = use.resource, .info = info, .isWrite = use.isWrite});
+                continue;
+            }
+            if (resources_[use.resource].type == ResourceType::eImage && it->info.layout != info.layout)
+            {
+                throw std::runtime_error("render graph pass '" + pass.name_ + "' uses '" + resources_[use.resource].name + "' in two layouts");
+            }
+            it->info.stage |= info.stage;
+            it->info.access |= info.access;
+            it->isWrite |= use.isWrite;
+        }
+
+        BarrierBatch barrier_batch;
+        for (const MergedUse& use : merged_uses)
+        {
+            const Resource& resource = resources_[use.resource];
+            ResourceState& state = states[use.resource];
+
+            if (state.lastBatch == UINT32_MAX && !resource.isImported)
+            {
+                // first use of a transient: the contents are undefined, but aliased memory must be released by
+                // the resources that had it before (they ran on this queue, aliasing skips async resources)
+                for (uint32_t predecessor : alias_predecessors[use.resource])
+                {
+                    state.writeStage |= states[predecessor].writeStage | states[predecessor].readStage;
+                    state.writeAccess |= states[predecessor].writeAccess;
+                }
+            }
+            else if (state.lastBatch != UINT32_MAX && batches[state.lastBatch].queueSlot != queue_slot)
+            {
+                // the other queue used it last, the semaphore wait makes its work complete and visible
+                batch.waitValue = std::max(batch.waitValue, batches[state.lastBatch].signalValue);
+                state.writeStage = {};
+                state.writeAccess = {};
+                state.readStage = {};
+                state.readAccess = {};
+                state.isSynchronized = true;
+            }
+
+            add_barrier(barrier_batch, use.resource, state, use.info, use.isWrite);
+            state.lastBatch = batch_index;
+        }
+
+        batch.passes.push_back(pass_index);
+        batch.passBarriers.push_back(std::move(barrier_batch));
+    }
+
+    // the frame ends on the graphics queue, after everything the compute queue did
+    if (batches.empty() || batches.back().queueSlot != GRAPHICS_SLOT)
+    {
+        batches.push_back(Batch{.queueSlot = GRAPHICS_SLOT, .signalValue = ++signal_counts[GRAPHICS_SLOT]});
+    }
+    Batch& last_batch = batches.back();
+    last_batch.waitValue = std::max(last_batch.waitValue, signal_counts[COMPUTE_SLOT]);
+
+    // imported images end the frame in the layout their owner expects
+    uint32_t last_batch_index = static_cast<uint32_t>(batches.size() - 1);
+    for (uint32_t i = 0; i < resources_.size(); i++)
+    {
+        const Resource& resource = resources_[i];
+        ResourceState& state = states[i];
+        if (!resource.isImported || resource.type != ResourceType::eImage || state.lastBatch == UINT32_MAX) continue;
+        if (resource.importedImage.finalLayout == vk::ImageLayout::eUndefined || resource.importedImage.finalLayout == state.layout) continue;
+
+        bool was_on_other_queue = batches[state.lastBatch].queueSlot != GRAPHICS_SLOT;
+        last_batch.finalBarriers.barriers.push_back(BarrierBatch::Barrier{
+            .resource = i,
+            .srcStage = was_on_other_queue ? vk::PipelineStageFlagBits2::eAllCommands : state.writeStage | state.readStage,
+            .srcAccess = was_on_other_queue ? vk::AccessFlags2{} : state.writeAccess,
+            .dstStage = vk::PipelineStageFlagBits2::eBottomOfPipe,  // later consumers add their own barrier
+            .dstAccess = {},
+            .oldLayout = state.layout,
+            .newLayout = resource.importedImage.finalLayout
+        });
+        state.lastBatch = last_batch_index;
+    }
+
+    compiled_.signalCounts = signal_counts;
+    for (const Batch& batch : batches)
+    {
+        for (const BarrierBatch& barrier_batch : batch.passBarriers)
+        {
+            if (!barrier_batch.barriers.empty()) compiled_.barrierCount++;
+        }
+        if (!batch.finalBarriers.barriers.empty()) compiled_.barrierCount++;
+    }
+}
+
+
+void RenderGraph::execute(
+    uint32_t frame_index,
+    std::span<const vk::SemaphoreSubmitInfo> wait_infos,
+    std::span<const vk::SemaphoreSubmitInfo> signal_infos
+)
+{
+    TRACE_FUNCTION();
+    if (!compiled_.isValid)
+    {
+        throw std::runtime_error("render graph executed before it was compiled");
+    }
+
+    // the slot's previous frame completed, and with it every submit of the slot
+    currentFrame_ = frame_index;
+    FrameCommands& commands = frameCommands_[frame_index];
+    for (uint32_t slot = 0; slot < QUEUE_SLOT_COUNT; slot++)
+    {
+        if (*commands.commandPools[slot]) commands.commandPools[slot].reset();
+        commands.usedCommandBuffers[slot] = 0;
+    }
+
+    auto first_graphics_batch = std::ranges::find(compiled_.batches, GRAPHICS_SLOT, &Batch::queueSlot);
+    for (size_t batch_index = 0; batch_index < compiled_.batches.size(); batch_index++)
+    {
+        const Batch& batch = compiled_.batches[batch_index];
+        vk::CommandBuffer command_buffer = beginCommandBuffer(frame_index, batch.queueSlot);
+
+        for (size_t i = 0; i < batch.passes.size(); i++)
+        {
+            const RenderGraphPass& pass = *passes_[batch.passes[i]];
+            recordBarriers(command_buffer, batch.passBarriers[i]);
+            if (pass.execute_) pass.execute_(command_buffer, *this);
+        }
+        recordBarriers(command_buffer, batch.finalBarriers);
+        command_buffer.end();
+
+        uint32_t other_slot = batch.queueSlot == GRAPHICS_SLOT ? COMPUTE_SLOT : GRAPHICS_SLOT;
+        std::vector<vk::SemaphoreSubmitInfo> waits;
+        if (batch.waitValue > 0)
+        {
+            waits.push_back({
+                .semaphore = *timelineSemaphores_[other_slot],
+                .value = timelineValues_[other_slot] + batch.waitValue,
+                .stageMask = vk::PipelineStageFlagBits2::eAllCommands
+            });
+        }
+        if (batch_index == static_cast<size_t>(first_graphics_batch - compiled_.batches.begin()))
+        {
+            waits.insert(waits.end(), wait_infos.begin(), wait_infos.end());
+        }
+
+        std::vector<vk::SemaphoreSubmitInfo> signals = {{
+            .semaphore = *timelineSemaphores_[batch.queueSlot],
+            .value = timelineValues_[batch.queueSlot] + batch.signalValue,
+            .stageMask = vk::PipelineStageFlagBits2::eAllCommands
+        }};
+        if (batch_index == compiled_.batches.size() - 1)
+        {
+            signals.insert(signals.end(), signal_infos.begin(), signal_infos.end());
+        }
+
+        vk::CommandBufferSubmitInfo command_buffer_submit_info{
+            .commandBuffer = command_buffer
+        };
+
+        vk::SubmitInfo2 submit_info{
+            .waitSemaphoreInfoCount = static_cast<uint32_t>(waits.size()),
+            .pWaitSemaphoreInfos = waits.data(),
+            .commandBufferInfoCount = 1,
+            .pCommandBufferInfos = &command_buffer_submit_info,
+            .signalSemaphoreInfoCount = static_cast<uint32_t>(signals.size()),
+            .pSignalSemaphoreInfos = signals.data()
+        };
+
+        QueueType queue_type = batch.queueSlot == GRAPHICS_SLOT ? QueueType::eGraphics : QueueType::eCompute;
+        auto queue_lock = context_.lockQueue(queue_type);
+        context_.getQueue(queue_type).submit2(submit_info);
+    }
+
+    for (uint32_t slot = 0; slot < QUEUE_SLOT_COUNT; slot++)
+    {
+        timelineValues_[slot] += compiled_.signalCounts[slot];
+    }
+}
+
+
+vk::CommandBuffer RenderGraph::beginCommandBuffer(uint32_t frame_index, uint32_t queue_slot)
+{
+    FrameCommands& commands = frameCommands_[frame_index];
+    std::vector<vk::raii::CommandBuffer>& command_buffers = commands.commandBuffers[queue_slot];
+    uint32_t& used = commands.usedCommandBuffers[queue_slot];
+
+    if (used == command_buffers.size())
+    {
+        vk::CommandBufferAllocateInfo command_buffer_allocate_info{
+            .commandPool = *commands.commandPools[queue_slot],
+            .level = vk::CommandBufferLevel::ePrimary,
+            .commandBufferCount = 1
+        };
+        command_buffers.push_back(std::move(context_.getLogicalDevice().allocateCommandBuffers(command_buffer_allocate_info).front()));
+    }
+
+    vk::CommandBuffer command_buffer = *command_buffers[used++];
+    command_buffer.begin({.flags = vk::CommandBufferUsageFlagBits::eOneTimeSubmit});
+    return command_buffer;
+}
+
+
+void RenderGraph::recordBarriers(vk::CommandBuffer command_buffer, const BarrierBatch& barrier_batch) const
+{
+    if (barrier_batch.barriers.empty()) return;
+
+    std::vector<vk::ImageMemoryBarrier2> image_barriers;
+    std::vector<vk::BufferMemoryBarrier2> buffer_barriers;
+    for (const BarrierBatch::Barrier& barrier : barrier_batch.barriers)
+    {
+        const Resource& resource = resources_[barrier.resource];
+        vk::PipelineStageFlags2 src_stage = barrier.srcStage ? barrier.srcStage : vk::PipelineStageFlagBits2::eNone;
+
+        if (resource.type == ResourceType::eImage)
+        {
+            image_barriers.push_back(vk::ImageMemoryBarrier2{
+                .srcStageMask = src_stage,
+                .srcAccessMask = barrier.srcAccess,
+                .dstStageMask = barrier.dstStage,
+                .dstAccessMask = barrier.dstAccess,
+                .oldLayout = barrier.oldLayout,
+                .newLayout = barrier.newLayout,
+                .srcQueueFamilyIndex = vk::QueueFamilyIgnored,
+                .dstQueueFamilyIndex = vk::QueueFamilyIgnored,
+                .image = getImage(RenderGraphResource{barrier.resource}),
+                .subresourceRange = {
+                    .aspectMask = getAspectMask(resource.imageDesc.format),
+                    .baseMipLevel = 0,
+                    .levelCount = resource.imageDesc.mipLevelCount,
+                    .baseArrayLayer = 0,
+                    .layerCount = 1
+                }
+            });
+        }
+        else
+        {
+            buffer_barriers.push_back(vk::BufferMemoryBarrier2{
+                .srcStageMask = src_stage,
+                .srcAccessMask = barrier.srcAccess,
+                .dstStageMask = barrier.dstStage,
+                .dstAccessMask = barrier.dstAccess,
+                .srcQueueFamilyIndex = vk::QueueFamilyIgnored,
+                .dstQueueFamilyIndex = vk::QueueFamilyIgnored,
+                .buffer = getBuffer(RenderGraphResource{barrier.resource}),
+                .offset = 0,
+                .size = vk::WholeSize
+            });
+        }
+    }
+
+    vk::DependencyInfo dependency_info{
+        .bufferMemoryBarrierCount = static_cast<uint32_t>(buffer_barriers.size()),
+        .pBufferMemoryBarriers = buffer_barriers.data(),
+        .imageMemoryBarrierCount = static_cast<uint32_t>(image_barriers.size()),
+        .pImageMemoryBarriers = image_barriers.data()
+    };
+
+    command_buffer.pipelineBarrier2(dependency_info);
+}
+
+
+uint32_t RenderGraph::getQueueSlot(RenderGraphQueue queue) const
+{
+    return queue == RenderGraphQueue::eAsyncCompute && context_.hasAsyncComputeQueue() ? COMPUTE_SLOT : GRAPHICS_SLOT;
+}
+
+
+vk::Image RenderGraph::getImage(RenderGraphResource resource) const
+{
+    const Resource& graph_resource = resources_.at(resource.index);
+    if (graph_resource.isImported) return graph_resource.importedImage.image;
+    return *compiled_.frames[currentFrame_]->resources[resource.index].image;
+}
+
+
+vk::ImageView RenderGraph::getImageView(RenderGraphResource resource) const
+{
+    const Resource& graph_resource = resources_.at(resource.index);
+    if (graph_resource.isImported) return graph_resource.importedImage.imageView;
+    return *compiled_.frames[currentFrame_]->resources[resource.index].imageView;
+}
+
+
+vk::Buffer RenderGraph::getBuffer(RenderGraphResource resource) const
+{
+    const Resource& graph_resource = resources_.at(resource.index);
+    if (graph_resource.isImported) return graph_resource.importedBuffer;
+    return *compiled_.frames[currentFrame_]->resources[resource.index].buffer;
+}
+
+
+const RenderGraphImageDesc& RenderGraph::getImageDesc(RenderGraphResource resource) const
+{
+    return resources_.at(resource.index).imageDesc;
+}
+
+
+// Accessor functions
+uint32_t RenderGraph::getBatchCount() const
+{
+    return static_cast<uint32_t>(compiled_.batches.size());
+}
+
+
+uint32_t RenderGraph::getBarrierCount() const
+{
+    return compiled_.barrierCount;
+}
+
+
+vk::DeviceSize RenderGraph::getTransientMemorySize() const
+{
+    return compiled_.transientMemorySize;
+}
+
+
+vk::DeviceSize RenderGraph::getUnaliasedMemorySize() const
+{
+    return compiled_.unaliasedMemorySize;
+}
+
+
+bool RenderGraph::wasRecompiled() const
+{
+    return wasRecompiled_;
+}
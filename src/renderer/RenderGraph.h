@@ -0,0 +1,289 @@
+#pragma once
+
+#include <vulkan/vulkan_raii.hpp>
+#include <array>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <span>
+#include <string>
+#include <vector>
+
+#include "core/MemoryAllocator.h"
+
+// forward declaring classes
+class VulkanContext;
+class FrameScheduler;
+class RenderGraph;
+
+// Where a pass runs. eAsyncCompute passes go to the async compute queue when the device has one and
+// fall back to the graphics queue otherwise.
+enum class RenderGraphQueue
+{
+    eGraphics,     // rasterization, shader accesses are vertex and fragment stage
+    eCompute,      // compute on the graphics queue
+    eAsyncCompute  // compute overlapping the graphics queue
+};
+
+
+// How a pass uses a resource, each one maps to its stages, access flags and (for images) layout.
+enum class RenderGraphAccess
+{
+    eColorAttachment,  // write
+    eDepthAttachment,  // depth test and write
+    eDepthRead,        // depth test without writes, sample depth with eShaderRead
+    eShaderRead,       // sampled image or storage buffer read
+    eShaderWrite,      // storage image (general layout) or storage buffer, read and write
+    eTransferSrc,
+    eTransferDst,      // write
+    eIndirectRead      // buffers only, indirect draw or dispatch arguments
+};
+
+
+// Virtual resource handle, only meaningful in the graph that created it
+struct RenderGraphResource
+{
+    uint32_t index = UINT32_MAX;
+
+    bool isValid() const { return index != UINT32_MAX; }
+};
+
+
+struct RenderGraphImageDesc
+{
+    vk::Format format = vk::Format::eUndefined;
+    vk::Extent2D extent = {0, 0};
+    uint32_t mipLevelCount = 1;
+    vk::SampleCountFlagBits sampleCount = vk::SampleCountFlagBits::e1;
+};
+
+
+// An image the graph doesn't own (a swap chain image for example). It's transitioned from
+// initialLayout on first use and left in finalLayout at the end of the frame.
+struct RenderGraphImportedImage
+{
+    vk::Image image = nullptr;
+    vk::ImageView imageView = nullptr;
+    RenderGraphImageDesc desc;
+    vk::ImageLayout initialLayout = vk::ImageLayout::eUndefined;
+    vk::ImageLayout finalLayout = vk::ImageLayout::eUndefined;  // eUndefined: left in its last layout
+};
+
+
+// What a pass gets to record with, declared through RenderGraph::addPass()
+class RenderGraphPass
+{
+public:
+    using ExecuteFunction = std::function<void(vk::CommandBuffer command_buffer, const RenderGraph& graph)>;
+
+    // declaring a resource twice in one pass merges the accesses, their image layouts must agree
+    auto reads(RenderGraphResource resource, RenderGraphAccess access) -> RenderGraphPass&;
+    auto writes(RenderGraphResource resource, RenderGraphAccess access) -> RenderGraphPass&;
+
+private:
+    friend class RenderGraph;
+
+    struct Use
+    {
+        uint32_t resource = 0;
+        RenderGraphAccess access = RenderGraphAccess::eShaderRead;
+        bool isWrite = false;
+    };
+
+    std::string name_;
+    RenderGraphQueue queue_ = RenderGraphQueue::eGraphics;
+    ExecuteFunction execute_;
+    std::vector<Use> uses_;
+};
+
+
+// Frame graph: passes declare the resources they read and write, compile() derives the barriers, queue
+// submissions and transient memory from that. Rebuilt by the caller every frame:
+//     graph.reset();
+//     RenderGraphResource color = graph.importImage("swap chain", {...});
+//     RenderGraphResource depth = graph.createImage("depth", {...});
+//     graph.addPass("scene", RenderGraphQueue::eGraphics, record_scene)
+//         .writes(color, RenderGraphAccess::eColorAttachment)
+//         .writes(depth, RenderGraphAccess::eDepthAttachment);
+//     graph.compile(scheduler);
+//     graph.execute(frame_index, wait_infos, signal_infos);
+// compile() keeps the previous plan and memory as long as the topology (passes, accesses and resource
+// descs, not the imported handles) didn't change, so a steady frame costs a hash and no allocations.
+//
+// Passes run in declaration order on their queue. Every transition between two passes goes into
+// a single vk::DependencyInfo. Consecutive passes on the same queue share a submit, and the submits
+// of the two queues are ordered with timeline semaphores only where a resource crosses between them.
+// The last graphics submit always waits for the async compute work, so a completed frame means the
+// whole graph completed.
+//
+// Transient images and buffers live per frame slot. Those whose pass ranges don't overlap share
+// memory. Resources an async compute pass touches are never aliased, since the other queue might still
+// be using the memory. Images that are only ever attachments get eTransientAttachment usage and lazily
+// allocated memory where the device has it, and only alias each other.
+// Images imported into async compute passes must be usable on both queue families (eConcurrent).
+// Not thread safe.
+class RenderGraph
+{
+public:
+    RenderGraph(const VulkanContext& context, uint32_t frame_count);
+    ~RenderGraph();  // the GPU must be done with every frame slot
+
+    // deleting copy constructors
+    RenderGraph(const RenderGraph&) = delete;
+    RenderGraph& operator=(const RenderGraph&) = delete;
+
+    // declaration, valid until the next reset()
+    void reset();
+    auto createImage(const std::string& name, const RenderGraphImageDesc& desc) -> RenderGraphResource;
+    auto createBuffer(const std::string& name, vk::DeviceSize size) -> RenderGraphResource;
+    auto importImage(const std::string& name, const RenderGraphImportedImage& image) -> RenderGraphResource;
+    auto importBuffer(const std::string& name, vk::Buffer buffer, vk::DeviceSize size) -> RenderGraphResource;
+    auto addPass(const std::string& name, RenderGraphQueue queue, RenderGraphPass::ExecuteFunction execute) -> RenderGraphPass&;
+
+    // throws std::runtime_error for invalid graphs. Memory of a changed topology is retired to scheduler
+    void compile(FrameScheduler& scheduler);
+
+    // records and submits the compiled graph for frame slot frame_index, the slot's previous frame must
+    // have completed (Renderer::drawFrame waited for it). wait_infos go on the first graphics submit,
+    // signal_infos on the last one
+    void execute(
+        uint32_t frame_index,
+        std::span<const vk::SemaphoreSubmitInfo> wait_infos,
+        std::span<const vk::SemaphoreSubmitInfo> signal_infos
+    );
+
+    // resolve handles while a pass executes
+    vk::Image getImage(RenderGraphResource resource) const;
+    vk::ImageView getImageView(RenderGraphResource resource) const;  // every mip level
+    vk::Buffer getBuffer(RenderGraphResource resource) const;
+    auto getImageDesc(RenderGraphResource resource) const -> const RenderGraphImageDesc&;
+
+    // accessor functions
+    uint32_t getBatchCount() const;        // submits of the compiled graph
+    uint32_t getBarrierCount() const;      // vk::DependencyInfo calls of the compiled graph
+    auto getTransientMemorySize() const -> vk::DeviceSize;  // per frame slot, after aliasing
+    auto getUnaliasedMemorySize() const -> vk::DeviceSize;  // what the transients would take without aliasing
+    bool wasRecompiled() const;            // the last compile() built a new plan
+
+private:
+    // index into the per queue arrays
+    static constexpr uint32_t GRAPHICS_SLOT = 0;
+    static constexpr uint32_t COMPUTE_SLOT = 1;
+    static constexpr uint32_t QUEUE_SLOT_COUNT = 2;
+
+    enum class ResourceType
+    {
+        eImage,
+        eBuffer
+    };
+
+    struct Resource
+    {
+        std::string name;
+        ResourceType type = ResourceType::eImage;
+        bool isImported = false;
+        RenderGraphImageDesc imageDesc;
+        vk::DeviceSize bufferSize = 0;
+        RenderGraphImportedImage importedImage;  // imported images only
+        vk::Buffer importedBuffer = nullptr;     // imported buffers only
+
+        // derived by compile()
+        vk::ImageUsageFlags imageUsage;
+        vk::BufferUsageFlags bufferUsage;
+        uint32_t firstPass = UINT32_MAX;
+        uint32_t lastPass = 0;
+        bool isUsedAsync = false;
+    };
+
+    // one pipelineBarrier2 worth of transitions, resolved to handles at execute()
+    struct BarrierBatch
+    {
+        struct Barrier
+        {
+            uint32_t resource = 0;
+            vk::PipelineStageFlags2 srcStage;
+            vk::AccessFlags2 srcAccess;
+            vk::PipelineStageFlags2 dstStage;
+            vk::AccessFlags2 dstAccess;
+            vk::ImageLayout oldLayout = vk::ImageLayout::eUndefined;
+            vk::ImageLayout newLayout = vk::ImageLayout::eUndefined;
+        };
+
+        std::vector<Barrier> barriers;
+    };
+
+    // consecutive passes on one queue, submitted together
+    struct Batch
+    {
+        uint32_t queueSlot = GRAPHICS_SLOT;
+        std::vector<uint32_t> passes;
+        std::vector<BarrierBatch> passBarriers;  // recorded before the pass at the same position
+        BarrierBatch finalBarriers;              // recorded after the last pass
+        uint32_t waitValue = 0;  // on the other queue's semaphore, relative to the frame, 0: no wait
+        uint32_t signalValue = 0;                // on this queue's semaphore, relative to the frame
+    };
+
+    // the memory a transient resource got in every frame slot
+    struct PhysicalResource
+    {
+        vk::raii::Image image = nullptr;
+        vk::raii::ImageView imageView = nullptr;
+        vk::raii::Buffer buffer = nullptr;
+        Allocation allocation;  // only when the resource isn't aliased
+    };
+
+    struct FrameResources
+    {
+        explicit FrameResources(const VulkanContext& context) : context(context) {}
+        ~FrameResources();  // frees the heaps and own allocations
+
+        const VulkanContext& context;
+        std::vector<PhysicalResource> resources;  // indexed like resources_, empty for imports
+        std::vector<Allocation> heaps;            // what the aliased resources are bound into
+    };
+
+    // per frame slot, one command pool per queue
+    struct FrameCommands
+    {
+        std::array<vk::raii::CommandPool, QUEUE_SLOT_COUNT> commandPools = {nullptr, nullptr};
+        std::array<std::vector<vk::raii::CommandBuffer>, QUEUE_SLOT_COUNT> commandBuffers;
+        std::array<uint32_t, QUEUE_SLOT_COUNT> usedCommandBuffers = {0, 0};
+    };
+
+    // what compile() caches while the topology is unchanged
+    struct CompiledGraph
+    {
+        uint64_t topologyHash = 0;
+        std::vector<Batch> batches;
+        std::vector<std::unique_ptr<FrameResources>> frames;
+        std::array<uint32_t, QUEUE_SLOT_COUNT> signalCounts = {0, 0};  // batches per queue
+        vk::DeviceSize transientMemorySize = 0;
+        vk::DeviceSize unaliasedMemorySize = 0;
+        uint32_t barrierCount = 0;
+        bool isValid = false;
+    };
+
+    auto computeTopologyHash() const -> uint64_t;
+    void computeLifetimes();
+    auto createFrameResources() -> std::vector<std::vector<uint32_t>>;  // the aliasing predecessors of every resource
+    void planBatches(const std::vector<std::vector<uint32_t>>& alias_predecessors);
+    auto beginCommandBuffer(uint32_t frame_index, uint32_t queue_slot) -> vk::CommandBuffer;
+    void recordBarriers(vk::CommandBuffer command_buffer, const BarrierBatch& barrier_batch) const;
+    uint32_t getQueueSlot(RenderGraphQueue queue) const;
+
+    const VulkanContext& context_;
+    uint32_t frameCount_ = 0;
+
+    // declared since the last reset()
+    std::vector<Resource> resources_;
+    std::vector<std::unique_ptr<RenderGraphPass>> passes_;  // pointers, addPass() hands out references
+
+    CompiledGraph compiled_;
+    bool wasRecompiled_ = false;
+
+    // execution
+    std::vector<FrameCommands> frameCommands_;
+    std::array<vk::raii::Semaphore, QUEUE_SLOT_COUNT> timelineSemaphores_ = {nullptr, nullptr};
+    std::array<uint64_t, QUEUE_SLOT_COUNT> timelineValues_ = {0, 0};  // last value submitted per queue
+    uint32_t currentFrame_ = 0;  // valid during execute()
+};
@@ -0,0 +1,899 @@
+#include "Renderer.h"
+#include "GraphicsPipeline.h"
+#include "PipelineStateCache.h"
+#include "ScenePass.h"
+#include "core/SwapChain.h"
+#include "core/VulkanContext.h"
+#include "utils/Trace.h"
+#include <algorithm>
+#include <iostream>
+#include <memory>
+#include <stdexcept>
+
+
+Renderer::Renderer(const VulkanContext& context)
+    : context_(context),
+      scheduler_(context),
+      profiler_(context, MAX_FRAMES_IN_FLIGHT, QueueType::eGraphics),
+      uniformRing_(context, MAX_FRAMES_IN_FLIGHT),
+      graph_(context, MAX_FRAMES_IN_FLIGHT)
+{
+    presentWaitEnabled_ = context_.isPresentWaitEnabled();
+    presentFenceEnabled_ = context_.isPresentFenceEnabled();
+}
+
+
+Renderer::~Renderer()
+{
+    scheduler_.waitIdle();
+    waitForPresents();
+}
+
+
+vk::raii::Fence Renderer::createPresentFence() const
+{
+    return vk::raii::Fence(context_.getLogicalDevice(), vk::FenceCreateInfo{});  // unsignaled, the present signals it
+}
+
+
+void Renderer::createPresentSemaphores(PresentState& state, uint32_t image_count)
+{
+    // the previous semaphores were handed over to retireSwapChain(), presents may still wait on them
+    state.renderFinished.clear();
+    for (uint32_t i = 0; i < image_count; i++)
+    {
+        state.renderFinished.emplace_back(context_.getLogicalDevice(), vk::SemaphoreCreateInfo{});
+    }
+}
+
+
+Renderer::PresentState& Renderer::getPresentState(const SwapChain& swap_chain)
+{
+    auto [state_it, is_new] = presentStates_.try_emplace(&swap_chain);
+    PresentState& state = state_it->second;
+    if (is_new)
+    {
+        for (uint32_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++)
+        {
+            state.imageAvailable[i] = vk::raii::Semaphore(context_.getLogicalDevice(), vk::SemaphoreCreateInfo{});
+            if (presentFenceEnabled_) state.presentFences[i] = createPresentFence();
+        }
+    }
+
+    if (state.renderFinished.size() != swap_chain.getImageCount())
+    {
+        createPresentSemaphores(state, swap_chain.getImageCount());
+    }
+    state.swapChain = *swap_chain.get();
+    return state;
+}
+
+
+void Renderer::waitForPresentFence(PresentState& state, uint32_t frame_index)
+{
+    // the fence tells us when the presentation engine is done with the image and renderFinished
+    if (!state.isPresentFencePending[frame_index]) return;
+
+    TRACE_SCOPE("wait for present fence");
+    (void)context_.getLogicalDevice().waitForFences(*state.presentFences[frame_index], true, UINT64_MAX);
+    context_.getLogicalDevice().resetFences(*state.presentFences[frame_index]);
+    state.isPresentFencePending[frame_index] = false;
+}
+
+
+void Renderer::updatePresentFence(PresentState& state, uint32_t frame_index, bool is_presented)
+{
+    if (!presentFenceEnabled_) return;
+
+    if (is_presented)
+    {
+        state.isPresentFencePending[frame_index] = true;
+        return;
+    }
+
+    // the failed present may or may not signal the fence, so it can be neither reset nor destroyed yet.
+    // It's dropped once it signaled or the frames after it completed, the frame gets a fresh one
+    failedPresentFences_.push_back({
+        .fence = std::move(state.presentFences[frame_index]),
+        .timelineValue = scheduler_.getLastReservedValue() + MAX_FRAMES_IN_FLIGHT
+    });
+    state.presentFences[frame_index] = createPresentFence();
+}
+
+
+void Renderer::waitForPresents()
+{
+    // fences and swap chains can't be destroyed while a present still uses them
+    for (auto& [swap_chain, state] : presentStates_)
+    {
+        for (uint32_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++)
+        {
+            waitForPresentFence(state, i);
+        }
+    }
+    for (const auto& retired : retiredSwapChains_)
+    {
+        for (const auto& present_fence : retired.presentFences)
+        {
+            (void)context_.getLogicalDevice().waitForFences(*present_fence, true, UINT64_MAX);
+        }
+    }
+
+    if (!presentFenceEnabled_ || !failedPresentFences_.empty())
+    {
+        // nothing reports when a present is done, an idle queue is as close as it gets
+        auto queue_lock = context_.lockQueue(QueueType::eGraphics);
+        context_.getQueue(QueueType::eGraphics).waitIdle();
+    }
+    retiredSwapChains_.clear();
+    failedPresentFences_.clear();
+}
+
+
+void Renderer::waitForInputSample(const SwapChain& swap_chain)
+{
+    TRACE_SCOPE("waitForInputSample");
+    bool is_same_swap_chain = trackedSwapChain_ == *swap_chain.get();
+    if (shouldWaitForPreviousPresent(swap_chain.getPresentProfile()) && is_same_swap_chain && !pendingPresents_.empty())
+    {
+        const PendingPresent& previous = pendingPresents_.back();
+        if (presentWaitEnabled_)
+        {
+            try
+            {
+                (void)swap_chain.get().waitForPresent(previous.presentId, PRESENT_WAIT_TIMEOUT_NS);
+            }
+            catch (const vk::SystemError&)
+            {
+                // out of date or surface lost, drawFrame reports the recreate
+            }
+        }
+        else
+        {
+            scheduler_.wait(previous.timelineValue);  // best effort: at least the GPU is done with it
+        }
+    }
+
+    collectPresentedFrames(swap_chain);
+    inputSampleTime_ = Clock::now();
+    isInputSampled_ = true;
+}
+
+
+void Renderer::collectPresentedFrames(const SwapChain& swap_chain)
+{
+    if (trackedSwapChain_ != *swap_chain.get())
+    {
+        pendingPresents_.clear();  // the old swap chain is gone together with its present ids
+        trackedSwapChain_ = *swap_chain.get();
+        return;
+    }
+
+    while (!pendingPresents_.empty())
+    {
+        const PendingPresent& oldest = pendingPresents_.front();
+
+        bool is_presented = false;
+        if (presentWaitEnabled_)
+        {
+            try
+            {
+                is_presented = swap_chain.get().waitForPresent(oldest.presentId, 0) == vk::Result::eSuccess;
+            }
+            catch (const vk::SystemError&)
+            {
+                pendingPresents_.clear();
+                return;
+            }
+        }
+        else
+        {
+            is_presented = scheduler_.isComplete(oldest.timelineValue);
+        }
+
+        if (!is_presented) return;  // presents complete in order, the newer ones aren't done either
+
+        // polled once per frame, so without a pacing wait this is up to a frame late
+        double latency_ms = std::chrono::duration<double, std::milli>(Clock::now() - oldest.inputSampleTime).count();
+        latencyFrameCount_++;
+        latencyTotalMs_ += latency_ms;
+        latencyMaxMs_ = std::max(latencyMaxMs_, latency_ms);
+
+        pendingPresents_.pop_front();
+    }
+}
+
+
+void Renderer::beginFrameGraph()
+{
+    graph_.reset();
+
+    // the frame's profile scope spans every pass, it opens in the first and closes in executeFrameGraph()'s last
+    graph_.addPass("begin frame", RenderGraphQueue::eGraphics, [this](vk::CommandBuffer command_buffer, const RenderGraph&)
+    {
+        profiler_.beginFrame(currentFrame_, command_buffer);  // reads back the slot's last frame, it completed before
+
+        // pipeline statistics queries can't stay active while the primary executes secondaries
+        profiler_.beginScope(command_buffer, "frame", !recorder_);
+    });
+}
+
+
+void Renderer::addCullPass(const ScenePass& scene_pass, vk::Extent2D extent)
+{
+    // compute on the graphics queue, the culler's own barriers order its buffers before the indirect draws
+    graph_.addPass("cull", RenderGraphQueue::eCompute, [this, &scene_pass, extent](vk::CommandBuffer command_buffer, const RenderGraph&)
+    {
+        GpuProfileScope cull_scope(profiler_, command_buffer, "cull");
+        scene_pass.recordCull(command_buffer, extent);
+    });
+}
+
+
+void Renderer::addTransientAttachments(RenderGraphPass& pass, vk::Format color_format, vk::Extent2D extent)
+{
+    msaaColorImage_ = {};
+    depthImage_ = {};
+    if (!transientAttachmentDesc_.isEnabled()) return;
+
+    // never stored, every frame starts them from undefined. A new extent or format recompiles the graph
+    RenderGraphImageDesc desc{
+        .format = color_format,
+        .extent = extent,
+        .sampleCount = transientAttachmentDesc_.sampleCount
+    };
+    if (transientAttachmentDesc_.sampleCount != vk::SampleCountFlagBits::e1)
+    {
+        msaaColorImage_ = graph_.createImage("msaa color", desc);
+        pass.writes(msaaColorImage_, RenderGraphAccess::eColorAttachment);
+    }
+    if (transientAttachmentDesc_.depthFormat != vk::Format::eUndefined)
+    {
+        desc.format = transientAttachmentDesc_.depthFormat;
+        depthImage_ = graph_.createImage("depth", desc);
+        pass.writes(depthImage_, RenderGraphAccess::eDepthAttachment);
+    }
+}
+
+
+std::optional<TransientAttachments> Renderer::getTransientAttachments(const RenderGraph& graph) const
+{
+    if (!transientAttachmentDesc_.isEnabled()) return std::nullopt;
+
+    return TransientAttachments(
+        transientAttachmentDesc_,
+        msaaColorImage_.isValid() ? graph.getImageView(msaaColorImage_) : vk::ImageView{},
+        depthImage_.isValid() ? graph.getImageView(depthImage_) : vk::ImageView{}
+    );
+}
+
+
+void Renderer::executeFrameGraph(std::span<const vk::SemaphoreSubmitInfo> wait_infos, std::span<const vk::SemaphoreSubmitInfo> signal_infos)
+{
+    graph_.addPass("end frame", RenderGraphQueue::eGraphics, [this](vk::CommandBuffer command_buffer, const RenderGraph&)
+    {
+        profiler_.endScope(command_buffer);
+    });
+
+    // a steady frame keeps its topology, compile() only hashes it then
+    graph_.compile(scheduler_);
+    graph_.execute(currentFrame_, wait_infos, signal_infos);
+}
+
+
+bool Renderer::drawFrame(RenderTarget& target, GraphicsPipeline& pipeline)
+{
+    TRACE_SCOPE("drawFrame");
+    FrameData& frame = frames_[currentFrame_];
+    SwapChain* swap_chain = target.asSwapChain();  // null for offscreen targets, the frame is never presented
+
+    if (swap_chain) collectPresentedFrames(*swap_chain);
+    collectRetiredSwapChains();
+    if (!isInputSampled_)
+    {
+        inputSampleTime_ = Clock::now();  // the caller didn't pace, the frame starts now
+    }
+    isInputSampled_ = false;
+
+    // wait for exactly the submit that last used this frame's resources
+    {
+        TRACE_SCOPE("wait for frame");
+        scheduler_.wait(frame.timelineValue);
+        if (postProcessor_) postProcessor_->waitForFrame(currentFrame_);  // the slot's scene image is read on the compute queue
+    }
+    scheduler_.collect();
+    context_.getBindlessHeap().collect(scheduler_.getCompletedValue());
+
+    // offscreen targets don't signal anything on acquire
+    PresentState* present_state = swap_chain ? &getPresentState(*swap_chain) : nullptr;
+    vk::Semaphore image_available = present_state ? *present_state->imageAvailable[currentFrame_] : vk::Semaphore{};
+
+    std::optional<uint32_t> acquired_index;
+    {
+        TRACE_SCOPE("acquire");
+        acquired_index = target.acquireNextImage(image_available);
+    }
+    if (!acquired_index) return true;  // nothing was submitted, the frame's resources are still free
+    uint32_t image_index = *acquired_index;
+
+    pipeline.applyReload(scheduler_);
+    pipeline.getStateCache().collect(scheduler_);  // linked pipelines whose optimized build is ready
+
+    // with post processing the pipeline renders into the scene image, the target only receives the copy
+    vk::Extent2D extent = target.getExtent();
+    vk::Format color_format = target.getFormat();
+    if (postProcessor_)
+    {
+        if (!(target.getImageUsage() & vk::ImageUsageFlagBits::eTransferDst))
+        {
+            throw std::runtime_error("post processing needs a render target that is a transfer destination");
+        }
+        postProcessor_->update(target.getFormat(), extent);
+        color_format = PostProcessor::SCENE_FORMAT;
+    }
+
+    // the triangle stands in until the scene's mesh and pipeline are ready
+    ScenePass* scene_pass = scenePass_ && scenePass_->isReady() ? scenePass_ : nullptr;
+    std::optional<vk::SemaphoreSubmitInfo> scene_wait_info = scene_pass ? scene_pass->prepare(currentFrame_) : std::nullopt;
+
+    // the frame's timeline value completed, every pool it recorded from can be reset in bulk
+    if (recorder_) recorder_->resetFrame(currentFrame_);
+    uniformRing_.reset(currentFrame_);
+
+    // the images start out undefined, the frame clears, resolves or copies over all of them
+    beginFrameGraph();
+    RenderGraphResource target_image = graph_.importImage("target", {
+        .image = target.getImages()[image_index],
+        .imageView = *target.getImageViews()[image_index],
+        .desc = {.format = target.getFormat(), .extent = extent},
+        .initialLayout = vk::ImageLayout::eUndefined,
+        .finalLayout = target.getFinalLayout()  // present source for swap chains
+    });
+    RenderGraphResource color_image = target_image;
+    if (postProcessor_)
+    {
+        color_image = graph_.importImage("scene", {
+            .image = postProcessor_->getSceneImage(currentFrame_),
+            .imageView = postProcessor_->getSceneImageView(currentFrame_),
+            .desc = {.format = PostProcessor::SCENE_FORMAT, .extent = extent},
+            .initialLayout = vk::ImageLayout::eUndefined,
+            .finalLayout = PostProcessor::SCENE_FINAL_LAYOUT  // what the compute queue reads it in
+        });
+    }
+
+    if (scene_pass && scene_pass->isCulling())
+    {
+        addCullPass(*scene_pass, extent);
+    }
+
+    const GraphicsPipelineDescription& pass_description = scene_pass ? scene_pass->getDescription() : pipeline.getDescription();
+    RenderGraphPass& draw_pass = graph_.addPass(
+        pass_description.name,
+        RenderGraphQueue::eGraphics,
+        [this, &pipeline, scene_pass, extent, color_image, pass_name = pass_description.name.c_str()](
+            vk::CommandBuffer command_buffer,
+            const RenderGraph& graph
+        )
+        {
+            GpuProfileScope pass_scope(profiler_, command_buffer, pass_name);
+            std::optional<TransientAttachments> attachments = getTransientAttachments(graph);
+            if (recorder_)
+            {
+                pipeline.recordParallel(
+                    command_buffer,
+                    extent,
+                    graph.getImageView(color_image),
+                    uniformRing_,
+                    *recorder_,
+                    currentFrame_,
+                    scene_pass,
+                    attachments ? &*attachments : nullptr
+                );
+            }
+            else
+            {
+                pipeline.record(
+                    command_buffer,
+                    extent,
+                    graph.getImageView(color_image),
+                    uniformRing_,
+                    scene_pass,
+                    attachments ? &*attachments : nullptr
+                );
+            }
+        }
+    );
+    draw_pass.writes(color_image, RenderGraphAccess::eColorAttachment);
+    addTransientAttachments(draw_pass, color_format, extent);
+
+    // the previous frame's post processing result, the only part of the frame waiting for the compute queue
+    if (postProcessor_)
+    {
+        graph_.addPass("composite", RenderGraphQueue::eGraphics, [this, target_image](vk::CommandBuffer command_buffer, const RenderGraph& graph)
+        {
+            GpuProfileScope composite_scope(profiler_, command_buffer, "composite");
+            postProcessor_->recordComposite(command_buffer, graph.getImage(target_image));
+        }).writes(target_image, RenderGraphAccess::eTransferDst);
+    }
+
+    std::vector<vk::SemaphoreSubmitInfo> wait_infos = std::move(pendingWaits_);
+    pendingWaits_.clear();
+    if (swap_chain)
+    {
+        // with post processing the image is only written by the composite copy
+        wait_infos.push_back({
+            .semaphore = image_available,
+            .stageMask = postProcessor_ ? vk::PipelineStageFlagBits2::eAllTransfer : vk::PipelineStageFlagBits2::eColorAttachmentOutput
+        });
+    }
+    if (postProcessor_)
+    {
+        if (auto composite_wait_info = postProcessor_->getCompositeWaitInfo()) wait_infos.push_back(*composite_wait_info);
+    }
+    if (scene_wait_info) wait_infos.push_back(*scene_wait_info);
+
+    frame.timelineValue = scheduler_.reserveValue();
+    if (scene_pass) scene_pass->markUsed(frame.timelineValue);
+    std::vector<vk::SemaphoreSubmitInfo> signal_infos = {
+        scheduler_.getSignalInfo(frame.timelineValue, vk::PipelineStageFlagBits2::eAllCommands)
+    };
+    if (swap_chain)
+    {
+        signal_infos.push_back({
+            .semaphore = *present_state->renderFinished[image_index],
+            .stageMask = vk::PipelineStageFlagBits2::eAllCommands
+        });
+        waitForPresentFence(*present_state, currentFrame_);  // the submit signals renderFinished again
+    }
+
+    {
+        TRACE_SCOPE("record and submit");
+        executeFrameGraph(wait_infos, signal_infos);
+    }
+
+    if (!swap_chain)
+    {
+        // offscreen: the timeline value is all that tracks the frame
+        if (postProcessor_) postProcessor_->submit(currentFrame_, scheduler_, frame.timelineValue);
+
+        currentFrame_ = (currentFrame_ + 1) % MAX_FRAMES_IN_FLIGHT;
+        return false;
+    }
+
+    // the id lets waitForPresent() find this present again
+    uint64_t present_id = nextPresentId_++;
+    vk::PresentIdKHR present_id_info{
+        .swapchainCount = 1,
+        .pPresentIds = &present_id
+    };
+
+    vk::SwapchainPresentFenceInfoEXT present_fence_info{
+        .swapchainCount = 1,
+        .pFences = &*present_state->presentFences[currentFrame_]
+    };
+
+    const void* present_next = nullptr;
+    if (presentFenceEnabled_)
+    {
+        present_fence_info.pNext = present_next;
+        present_next = &present_fence_info;
+    }
+    if (presentWaitEnabled_)
+    {
+        present_id_info.pNext = present_next;
+        present_next = &present_id_info;
+    }
+
+    vk::PresentInfoKHR present_info{
+        .pNext = present_next,
+        .waitSemaphoreCount = 1,
+        .pWaitSemaphores = &*present_state->renderFinished[image_index],
+        .swapchainCount = 1,
+        .pSwapchains = &*swap_chain->get(),
+        .pImageIndices = &image_index
+    };
+
+    bool recreate_needed = false;
+    bool is_presented = false;
+    {
+        TRACE_SCOPE("present");
+        auto queue_lock = context_.lockQueue(QueueType::eGraphics);
+        try
+        {
+            vk::Result result = context_.getQueue(QueueType::eGraphics).presentKHR(present_info);
+            is_presented = true;
+            recreate_needed = (result == vk::Result::eSuboptimalKHR || result == vk::Result::eErrorOutOfDateKHR);
+        }
+        catch (const vk::OutOfDateKHRError&)
+        {
+            recreate_needed = true;
+        }
+    }
+
+    // after the graphics lock is released, without an async family the compute queue is the graphics queue
+    if (postProcessor_) postProcessor_->submit(currentFrame_, scheduler_, frame.timelineValue);
+
+    updatePresentFence(*present_state, currentFrame_, is_presented);
+
+    if (is_presented)
+    {
+        pendingPresents_.push_back({
+            .presentId = present_id,
+            .timelineValue = frame.timelineValue,
+            .inputSampleTime = inputSampleTime_
+        });
+    }
+
+    currentFrame_ = (currentFrame_ + 1) % MAX_FRAMES_IN_FLIGHT;
+    return recreate_needed;
+}
+
+
+std::vector<SwapChain*> Renderer::drawFrame(std::span<const WindowViewport> viewports)
+{
+    TRACE_SCOPE("drawFrame viewports");
+    if (postProcessor_ || transientAttachmentDesc_.isEnabled())
+    {
+        throw std::runtime_error("post processing and transient attachments only support a single render target");
+    }
+
+    FrameData& frame = frames_[currentFrame_];
+    collectRetiredSwapChains();
+    isInputSampled_ = false;
+
+    // wait for exactly the submit that last used this frame's resources
+    {
+        TRACE_SCOPE("wait for frame");
+        scheduler_.wait(frame.timelineValue);
+    }
+    scheduler_.collect();
+    context_.getBindlessHeap().collect(scheduler_.getCompletedValue());
+
+    // a viewport that acquired an image this frame
+    struct AcquiredViewport
+    {
+        SwapChain* swapChain = nullptr;
+        GraphicsPipeline* pipeline = nullptr;
+        PresentState* presentState = nullptr;
+        uint32_t imageIndex = 0;
+    };
+
+    std::vector<AcquiredViewport> acquired_viewports;
+    std::vector<SwapChain*> recreate_swap_chains;
+    {
+        TRACE_SCOPE("acquire");
+        for (const WindowViewport& viewport : viewports)
+        {
+            PresentState& state = getPresentState(*viewport.swapChain);
+            std::optional<uint32_t> image_index = viewport.swapChain->acquireNextImage(*state.imageAvailable[currentFrame_]);
+            if (!image_index)
+            {
+                recreate_swap_chains.push_back(viewport.swapChain);
+                continue;
+            }
+
+            acquired_viewports.push_back({
+                .swapChain = viewport.swapChain,
+                .pipeline = viewport.pipeline,
+                .presentState = &state,
+                .imageIndex = *image_index
+            });
+        }
+    }
+    if (acquired_viewports.empty()) return recreate_swap_chains;  // nothing was submitted, the frame's resources are still free
+
+    std::vector<PipelineStateCache*> state_caches;
+    for (const AcquiredViewport& viewport : acquired_viewports)
+    {
+        viewport.pipeline->applyReload(scheduler_);  // once per pipeline, later calls find nothing to apply
+
+        // once per cache, the viewports usually share it
+        PipelineStateCache* state_cache = &viewport.pipeline->getStateCache();
+        if (std::ranges::find(state_caches, state_cache) == state_caches.end()) state_caches.push_back(state_cache);
+    }
+    for (PipelineStateCache* state_cache : state_caches)
+    {
+        state_cache->collect(scheduler_);
+    }
+
+    // every viewport shows the same scene
+    ScenePass* scene_pass = scenePass_ && scenePass_->isReady() ? scenePass_ : nullptr;
+    std::optional<vk::SemaphoreSubmitInfo> scene_wait_info = scene_pass ? scene_pass->prepare(currentFrame_) : std::nullopt;
+
+    // the frame's timeline value completed, every pool it recorded from can be reset in bulk
+    if (recorder_) recorder_->resetFrame(currentFrame_);
+    uniformRing_.reset(currentFrame_);
+
+    beginFrameGraph();
+    for (const AcquiredViewport& viewport : acquired_viewports)
+    {
+        const SwapChain& swap_chain = *viewport.swapChain;
+        vk::Extent2D extent = swap_chain.getExtent();
+        RenderGraphResource swap_chain_image = graph_.importImage("swap chain", {
+            .image = swap_chain.getImages()[viewport.imageIndex],
+            .imageView = *swap_chain.getImageViews()[viewport.imageIndex],
+            .desc = {.format = swap_chain.getFormat(), .extent = extent},
+            .initialLayout = vk::ImageLayout::eUndefined,  // cleared anyway
+            .finalLayout = swap_chain.getFinalLayout()
+        });
+
+        // the extents can differ between windows, each viewport culls for its own. The culls serialize
+        // on the frame's command buffer, the previous viewport's draws go first
+        if (scene_pass && scene_pass->isCulling())
+        {
+            addCullPass(*scene_pass, extent);
+        }
+
+        const GraphicsPipelineDescription& pass_description = scene_pass ? scene_pass->getDescription() : viewport.pipeline->getDescription();
+        graph_.addPass(
+            pass_description.name,
+            RenderGraphQueue::eGraphics,
+            [this, pipeline = viewport.pipeline, scene_pass, extent, swap_chain_image, pass_name = pass_description.name.c_str()](
+                vk::CommandBuffer command_buffer,
+                const RenderGraph& graph
+            )
+            {
+                GpuProfileScope pass_scope(profiler_, command_buffer, pass_name);
+                if (recorder_)
+                {
+                    pipeline->recordParallel(
+                        command_buffer,
+                        extent,
+                        graph.getImageView(swap_chain_image),
+                        uniformRing_,
+                        *recorder_,
+                        currentFrame_,
+                        scene_pass,
+                        nullptr
+                    );
+                }
+                else
+                {
+                    pipeline->record(command_buffer, extent, graph.getImageView(swap_chain_image), uniformRing_, scene_pass, nullptr);
+                }
+            }
+        ).writes(swap_chain_image, RenderGraphAccess::eColorAttachment);
+    }
+
+    // one submit waits for every acquire and signals every present
+    std::vector<vk::SemaphoreSubmitInfo> wait_infos = std::move(pendingWaits_);
+    pendingWaits_.clear();
+    if (scene_wait_info) wait_infos.push_back(*scene_wait_info);
+    frame.timelineValue = scheduler_.reserveValue();
+    if (scene_pass) scene_pass->markUsed(frame.timelineValue);
+    std::vector<vk::SemaphoreSubmitInfo> signal_infos = {
+        scheduler_.getSignalInfo(frame.timelineValue, vk::PipelineStageFlagBits2::eAllCommands)
+    };
+
+    std::vector<vk::Semaphore> present_waits;
+    std::vector<vk::SwapchainKHR> present_swap_chains;
+    std::vector<uint32_t> present_image_indices;
+    std::vector<vk::Fence> present_fences;
+    for (const AcquiredViewport& viewport : acquired_viewports)
+    {
+        PresentState& state = *viewport.presentState;
+        wait_infos.push_back({
+            .semaphore = *state.imageAvailable[currentFrame_],
+            .stageMask = vk::PipelineStageFlagBits2::eColorAttachmentOutput
+        });
+        signal_infos.push_back({
+            .semaphore = *state.renderFinished[viewport.imageIndex],
+            .stageMask = vk::PipelineStageFlagBits2::eAllCommands
+        });
+
+        waitForPresentFence(state, currentFrame_);
+        present_waits.push_back(*state.renderFinished[viewport.imageIndex]);
+        present_swap_chains.push_back(*viewport.swapChain->get());
+        present_image_indices.push_back(viewport.imageIndex);
+        present_fences.push_back(*state.presentFences[currentFrame_]);
+    }
+
+    {
+        TRACE_SCOPE("record and submit");
+        executeFrameGraph(wait_infos, signal_infos);
+    }
+
+    // no present ids, latency is only tracked for single target frames
+    vk::SwapchainPresentFenceInfoEXT present_fence_info{
+        .swapchainCount = static_cast<uint32_t>(present_fences.size()),
+        .pFences = present_fences.data()
+    };
+
+    // per swap chain results, one out of date window doesn't keep the others from presenting
+    std::vector<vk::Result> present_results(acquired_viewports.size(), vk::Result::eErrorOutOfDateKHR);
+    vk::PresentInfoKHR present_info{
+        .pNext = presentFenceEnabled_ ? &present_fence_info : nullptr,
+        .waitSemaphoreCount = static_cast<uint32_t>(present_waits.size()),
+        .pWaitSemaphores = present_waits.data(),
+        .swapchainCount = static_cast<uint32_t>(present_swap_chains.size()),
+        .pSwapchains = present_swap_chains.data(),
+        .pImageIndices = present_image_indices.data(),
+        .pResults = present_results.data()
+    };
+
+    {
+        TRACE_SCOPE("present");
+        auto queue_lock = context_.lockQueue(QueueType::eGraphics);
+        try
+        {
+            (void)context_.getQueue(QueueType::eGraphics).presentKHR(present_info);
+        }
+        catch (const vk::OutOfDateKHRError&)
+        {
+            // present_results says which ones
+        }
+    }
+
+    for (size_t i = 0; i < acquired_viewports.size(); i++)
+    {
+        vk::Result result = present_results[i];
+        bool is_presented = result == vk::Result::eSuccess || result == vk::Result::eSuboptimalKHR;
+        updatePresentFence(*acquired_viewports[i].presentState, currentFrame_, is_presented);
+        if (result == vk::Result::eSuboptimalKHR || result == vk::Result::eErrorOutOfDateKHR)
+        {
+            recreate_swap_chains.push_back(acquired_viewports[i].swapChain);
+        }
+    }
+
+    currentFrame_ = (currentFrame_ + 1) % MAX_FRAMES_IN_FLIGHT;
+    return recreate_swap_chains;
+}
+
+
+void Renderer::enableParallelRecording(uint32_t worker_count)
+{
+    // the old recorder's pools may still be in use by frames in flight
+    if (recorder_) scheduler_.waitIdle();
+    recorder_ = std::make_unique<ParallelRecorder>(context_, MAX_FRAMES_IN_FLIGHT, worker_count);
+}
+
+
+void Renderer::enableTransientAttachments(const TransientAttachmentDesc& desc)
+{
+    transientAttachmentDesc_ = desc;  // the next drawFrame declares them, the graph recompiles for the new descs
+}
+
+
+void Renderer::retireSwapChain(RetiredSwapChain&& retired_swap_chain)
+{
+    RetiredPresentResources retired{
+        .swapChain = std::move(retired_swap_chain)
+    };
+
+    // the state that presented the old handle, a swap chain that never presented has none
+    auto state_it = std::ranges::find_if(
+        presentStates_,
+        [&retired](const auto& entry) { return entry.second.swapChain == *retired.swapChain.swapChain; }
+    );
+    if (state_it != presentStates_.end())
+    {
+        PresentState& state = state_it->second;
+        retired.renderFinished = std::move(state.renderFinished);
+        state.renderFinished.clear();  // recreated for the new image count by the next drawFrame
+        state.swapChain = nullptr;
+
+        // the pending fences track presents of the old swap chain, these frames start over with fresh ones
+        for (uint32_t i = 0; presentFenceEnabled_ && i < MAX_FRAMES_IN_FLIGHT; i++)
+        {
+            if (!state.isPresentFencePending[i]) continue;
+
+            retired.presentFences.push_back(std::move(state.presentFences[i]));
+            state.presentFences[i] = createPresentFence();
+            state.isPresentFencePending[i] = false;
+        }
+    }
+
+    if (!presentFenceEnabled_)
+    {
+        // without present fences nothing reports when the presentation engine let go of the old images,
+        // once the frames submitted after the swap completed their presents were queued behind the old ones
+        retired.timelineValue = scheduler_.getLastReservedValue() + MAX_FRAMES_IN_FLIGHT;
+    }
+    retiredSwapChains_.push_back(std::move(retired));
+}
+
+
+void Renderer::removeSwapChain(const SwapChain& swap_chain)
+{
+    // rare enough to stall for: the surface can only go once every swap chain created on it is gone
+    scheduler_.waitIdle();
+    waitForPresents();
+
+    presentStates_.erase(&swap_chain);
+    if (trackedSwapChain_ == *swap_chain.get())
+    {
+        pendingPresents_.clear();
+        trackedSwapChain_ = nullptr;
+    }
+}
+
+
+void Renderer::collectRetiredSwapChains()
+{
+    while (!retiredSwapChains_.empty())
+    {
+        const RetiredPresentResources& oldest = retiredSwapChains_.front();
+        bool is_done = scheduler_.isComplete(oldest.timelineValue) && std::ranges::all_of(
+            oldest.presentFences,
+            [](const vk::raii::Fence& present_fence) { return present_fence.getStatus() == vk::Result::eSuccess; }
+        );
+        if (!is_done) break;
+
+        retiredSwapChains_.pop_front();
+    }
+
+    std::erase_if(failedPresentFences_, [this](const FailedPresentFence& failed)
+    {
+        return failed.fence.getStatus() == vk::Result::eSuccess || scheduler_.isComplete(failed.timelineValue);
+    });
+}
+
+
+void Renderer::enablePostProcessing(const PostProcessSettings& settings)
+{
+    // frames in flight may still render into the old scene images or wait on the old compute timeline
+    if (postProcessor_) scheduler_.waitIdle();
+    postProcessor_ = std::make_unique<PostProcessor>(context_, MAX_FRAMES_IN_FLIGHT, settings);
+}
+
+
+void Renderer::setScenePass(ScenePass* scene_pass)
+{
+    scenePass_ = scene_pass;
+}
+
+
+void Renderer::addWaitSemaphore(const vk::SemaphoreSubmitInfo& wait_info)
+{
+    pendingWaits_.push_back(wait_info);
+}
+
+
+// Accessor functions
+FrameScheduler& Renderer::getFrameScheduler()
+{
+    return scheduler_;
+}
+
+
+const GpuProfiler& Renderer::getGpuProfiler() const
+{
+    return profiler_;
+}
+
+
+UniformRing& Renderer::getUniformRing()
+{
+    return uniformRing_;
+}
+
+
+const PostProcessor* Renderer::getPostProcessor() const
+{
+    return postProcessor_.get();
+}
+
+
+uint32_t Renderer::getCurrentFrameIndex() const
+{
+    return currentFrame_;
+}
+
+
+LatencyStatistics Renderer::getLatencyStatistics() const
+{
+    return LatencyStatistics{
+        .frameCount = latencyFrameCount_,
+        .averageMs = latencyFrameCount_ > 0 ? latencyTotalMs_ / latencyFrameCount_ : 0.0,
+        .maxMs = latencyMaxMs_,
+        .measuredAtPresent = presentWaitEnabled_
+    };
+}
+
+
+void Renderer::printLatencyStatistics() const
+{
+    LatencyStatistics statistics = getLatencyStatistics();
+    std::cout << "input to " << (statistics.measuredAtPresent ? "present" : "gpu completion") << " latency over "
+              << statistics.frameCount << " frames: avg " << statistics.averageMs << " ms, max " << statistics.maxMs << " ms\n";
+}
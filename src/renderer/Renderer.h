@@ -0,0 +1,202 @@
+#pragma once
+
+#include <vulkan/vulkan_raii.hpp>
+#include <array>
+#include <chrono>
+#include <deque>
+#include <memory>
+#include <optional>
+#include <span>
+#include <unordered_map>
+#include <vector>
+
+#include "FrameData.h"
+#include "FrameScheduler.h"
+#include "GpuProfiler.h"
+#include "ParallelRecorder.h"
+#include "PostProcessor.h"
+#include "RenderGraph.h"
+#include "UniformRing.h"
+#include "core/RenderTarget.h"
+#include "core/SwapChain.h"
+#include "core/TransientAttachments.h"
+
+// forward declaring classes
+class VulkanContext;
+class GraphicsPipeline;
+class ScenePass;
+
+// Input to present latency, measured at the present itself with VK_KHR_present_wait and at GPU
+// completion of the frame otherwise (a lower bound then).
+struct LatencyStatistics
+{
+    uint32_t frameCount = 0;
+    double averageMs = 0.0;
+    double maxMs = 0.0;
+    bool measuredAtPresent = false;
+};
+
+
+// One window of a multi viewport frame
+struct WindowViewport
+{
+    SwapChain* swapChain = nullptr;
+    GraphicsPipeline* pipeline = nullptr;  // built for the swap chain's format
+};
+
+
+class Renderer
+{
+public:
+    static constexpr uint32_t MAX_FRAMES_IN_FLIGHT = 2;
+
+    explicit Renderer(const VulkanContext& context);
+    ~Renderer();  // waits for the last submitted frame and every retired swap chain
+
+    // deleting copy constructors
+    Renderer(const Renderer&) = delete;
+    Renderer& operator=(const Renderer&) = delete;
+
+    // call right before polling input, the profiles that pace frames block here until the previous
+    // frame was presented so the input is sampled as late as possible
+    void waitForInputSample(const SwapChain& swap_chain);
+
+    // renders into a swap chain (and presents) or an offscreen target, the same frame code either way.
+    // returns true if swap chain recreation is needed, never for offscreen targets
+    bool drawFrame(RenderTarget& target, GraphicsPipeline& pipeline);
+
+    // renders several windows presenting from this device: every viewport is recorded into the frame's one
+    // command buffer, submitted once and presented with a single vkQueuePresentKHR carrying all their swap
+    // chains. A viewport whose acquire fails sits the frame out. Returns the swap chains that need
+    // recreating, retire what their recreate() returns as usual. Latency isn't tracked for these frames.
+    // throws std::runtime_error with post processing or transient attachments, both are sized for one target
+    auto drawFrame(std::span<const WindowViewport> viewports) -> std::vector<SwapChain*>;
+
+    // forgets a swap chain before it's destroyed together with its surface, e.g. when its window closes.
+    // Waits for the GPU and every present, retired swap chains are released as well
+    void removeSwapChain(const SwapChain& swap_chain);
+
+    // records the draws into secondaries on worker_count threads (0 picks the hardware thread count)
+    // instead of on the calling thread, takes effect with the next drawFrame
+    void enableParallelRecording(uint32_t worker_count = 0);
+
+    // renders through depth and MSAA transient attachments sized to the target, the pipeline must have been
+    // built with the same desc. They're recreated by the first drawFrame after the target's extent or format
+    // changed (SwapChain::recreate()), the old ones are retired until the frames using them completed
+    void enableTransientAttachments(const TransientAttachmentDesc& desc);
+
+    // renders into the PostProcessor's HDR scene images and tone maps them on the async compute queue, the
+    // pipeline must have been built for PostProcessor::SCENE_FORMAT. Frames show what the previous frame
+    // rendered, so the post processing overlaps the next frame's geometry. The target must be a transfer
+    // destination with an 8 bit RGBA or BGRA format
+    void enablePostProcessing(const PostProcessSettings& settings = {});
+
+    // keeps what SwapChain::recreate() returned alive until its presents are done, never blocks
+    void retireSwapChain(RetiredSwapChain&& retired_swap_chain);
+
+    // extra waits for the next frame submit, e.g. UploadEngine::getWaitInfo() for resources the frame reads
+    void addWaitSemaphore(const vk::SemaphoreSubmitInfo& wait_info);
+
+    // drawn by every frame instead of the pipeline's triangle once scene_pass->isReady(), the triangle stands
+    // in until then. Null goes back to the triangle. The pass must outlive its use or be replaced first
+    void setScenePass(ScenePass* scene_pass);
+
+    // accessor functions
+    auto getFrameScheduler() -> FrameScheduler&;
+    auto getGpuProfiler() const -> const GpuProfiler&;
+    auto getUniformRing() -> UniformRing&;  // reset for the frame slot by drawFrame, before recording
+    auto getPostProcessor() const -> const PostProcessor*;  // null unless enablePostProcessing() was called
+    uint32_t getCurrentFrameIndex() const;
+    auto getLatencyStatistics() const -> LatencyStatistics;
+    void printLatencyStatistics() const;
+
+private:
+    // presentation resources of one swap chain, created by the first frame presenting it
+    struct PresentState
+    {
+        vk::SwapchainKHR swapChain = nullptr;  // the handle last presented, how retireSwapChain() finds the state
+        std::array<vk::raii::Semaphore, MAX_FRAMES_IN_FLIGHT> imageAvailable = {nullptr, nullptr};  // binary, acquire can't signal a timeline semaphore
+        // binary, one per swap chain image: the present of an image only retires once that image is acquired again
+        std::vector<vk::raii::Semaphore> renderFinished;
+        std::array<vk::raii::Fence, MAX_FRAMES_IN_FLIGHT> presentFences = {nullptr, nullptr};  // VK_EXT_swapchain_maintenance1 only, signaled once the present is done
+        std::array<bool, MAX_FRAMES_IN_FLIGHT> isPresentFencePending = {false, false};
+    };
+
+    // private member functions
+    void createPresentSemaphores(PresentState& state, uint32_t image_count);
+    void collectPresentedFrames(const SwapChain& swap_chain);  // never blocks
+    void collectRetiredSwapChains();  // never blocks, failed present fences as well
+    void waitForPresents();  // every present of every swap chain, retired ones included
+    auto createPresentFence() const -> vk::raii::Fence;
+
+    // the frame's RenderGraph: begin resets it and opens the frame's profile scope, execute closes it,
+    // compiles and submits. The other passes are declared in between
+    void beginFrameGraph();
+    void addCullPass(const ScenePass& scene_pass, vk::Extent2D extent);
+    void addTransientAttachments(RenderGraphPass& pass, vk::Format color_format, vk::Extent2D extent);  // graph transients pass renders with
+    auto getTransientAttachments(const RenderGraph& graph) const -> std::optional<TransientAttachments>;  // inside the pass
+    void executeFrameGraph(std::span<const vk::SemaphoreSubmitInfo> wait_infos, std::span<const vk::SemaphoreSubmitInfo> signal_infos);
+    auto getPresentState(const SwapChain& swap_chain) -> PresentState&;
+    void waitForPresentFence(PresentState& state, uint32_t frame_index);  // before the frame presents again
+    void updatePresentFence(PresentState& state, uint32_t frame_index, bool is_presented);  // after the present
+
+    using Clock = std::chrono::steady_clock;
+
+    // a present we haven't seen complete yet
+    struct PendingPresent
+    {
+        uint64_t presentId = 0;
+        uint64_t timelineValue = 0;
+        Clock::time_point inputSampleTime;
+    };
+
+    // a swap chain replaced by recreate() together with everything its last presents still use
+    struct RetiredPresentResources
+    {
+        RetiredSwapChain swapChain;
+        std::vector<vk::raii::Semaphore> renderFinished;
+        std::vector<vk::raii::Fence> presentFences;  // done once all of them are signaled
+        uint64_t timelineValue = 0;  // without present fences, done once this value completed
+    };
+
+    // the fence of a present that failed, it may still get signaled
+    struct FailedPresentFence
+    {
+        vk::raii::Fence fence = nullptr;
+        uint64_t timelineValue = 0;  // dropped once this value completed, if it wasn't signaled before
+    };
+
+    // upper bound for the pacing wait, a minimized window may never present
+    static constexpr uint64_t PRESENT_WAIT_TIMEOUT_NS = 100'000'000;  // 100 ms
+
+    // private member variables
+    const VulkanContext& context_;
+    FrameScheduler scheduler_;  // declared first so it outlives the frames it paces
+    GpuProfiler profiler_;      // one query pool set per frame in flight
+    UniformRing uniformRing_;   // one region per frame in flight
+    RenderGraph graph_;         // declared again by every drawFrame, owns the frames' command buffers
+    std::array<FrameData, MAX_FRAMES_IN_FLIGHT> frames_;
+    std::unique_ptr<ParallelRecorder> recorder_;  // null while recording on the calling thread
+    TransientAttachmentDesc transientAttachmentDesc_;
+    RenderGraphResource msaaColorImage_;  // declared by the current frame's graph, invalid without MSAA
+    RenderGraphResource depthImage_;      // declared by the current frame's graph, invalid without depth
+    std::unique_ptr<PostProcessor> postProcessor_;  // null while rendering straight into the target
+    ScenePass* scenePass_ = nullptr;
+    std::unordered_map<const SwapChain*, PresentState> presentStates_;
+    std::vector<vk::SemaphoreSubmitInfo> pendingWaits_;
+    uint32_t currentFrame_ = 0;
+    bool presentFenceEnabled_ = false;
+    std::deque<RetiredPresentResources> retiredSwapChains_;  // oldest first, see retireSwapChain()
+    std::vector<FailedPresentFence> failedPresentFences_;
+
+    // frame pacing and latency tracking
+    bool presentWaitEnabled_ = false;
+    uint64_t nextPresentId_ = 1;
+    vk::SwapchainKHR trackedSwapChain_ = nullptr;  // present ids only order presents of one swap chain
+    std::deque<PendingPresent> pendingPresents_;   // oldest first
+    Clock::time_point inputSampleTime_;
+    bool isInputSampled_ = false;
+    uint32_t latencyFrameCount_ = 0;
+    double latencyTotalMs_ = 0.0;
+    double latencyMaxMs_ = 0.0;
+};
@@ -0,0 +1,305 @@
+#include "ScenePass.h"
+#include "FrameScheduler.h"
+#include "GpuCuller.h"
+#include "PipelineStateCache.h"
+#include "UniformRing.h"
+#include "UploadEngine.h"
+#include "core/VulkanContext.h"
+#include "resources/Mesh.h"
+#include "resources/Texture.h"
+#include <glm/gtc/matrix_transform.hpp>
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <vector>
+
+
+ScenePass::ScenePass(
+    const VulkanContext& context,
+    UploadEngine& upload_engine,
+    PipelineStateCache& state_cache,
+    const FrameScheduler& scheduler,
+    uint32_t frame_count,
+    vk::Format color_format,
+    const TransientAttachmentDesc& attachment_desc,
+    AssetHandle<Mesh> mesh,
+    AssetHandle<Texture> albedo,
+    uint32_t grid_size
+)
+    : context_(context),
+      uploadEngine_(upload_engine),
+      stateCache_(state_cache),
+      scheduler_(scheduler),
+      mesh_(std::move(mesh)),
+      albedo_(std::move(albedo)),
+      batcher_(context, scheduler, frame_count, std::max(1u, grid_size * grid_size)),
+      gridSize_(std::max(1u, grid_size))
+{
+    description_ = GraphicsPipelineDescription{
+        .name = "mesh",
+        .vertexShaderPath = VERTEX_SHADER_PATH,
+        .fragmentShaderPath = FRAGMENT_SHADER_PATH,
+        .colorFormat = color_format,
+        .depthFormat = attachment_desc.depthFormat,
+        .sampleCount = attachment_desc.sampleCount,
+        .frontFace = vk::FrontFace::eCounterClockwise  // counter clockwise meshes, the projection flips y
+    };
+
+    createPipelineLayout();
+    createSampler();
+    if (context_.isMultiDrawIndirectEnabled())
+    {
+        culler_ = std::make_unique<GpuCuller>(context_, uploadEngine_, scheduler_, gridSize_ * gridSize_, frame_count);
+        cullFrames_.resize(frame_count);
+    }
+    (void)stateCache_.getPipeline(description_, *layout_);  // queued now, isReady() tells when it's done
+}
+
+
+ScenePass::~ScenePass()
+{
+    scheduler_.waitIdle();
+    stateCache_.releaseLayout(*layout_);
+    context_.getBindlessHeap().release(BindlessType::eSampler, samplerHandle_, scheduler_.getLastReservedValue());
+}
+
+
+void ScenePass::createPipelineLayout()
+{
+    // same sets and range as GraphicsPipeline, the frame constants come from the ring
+    const BindlessHeap& bindless_heap = context_.getBindlessHeap();
+    uniformSetLayout_ = UniformRing::createSetLayout(context_.getLogicalDevice());
+    std::array<vk::DescriptorSetLayout, 2> set_layouts = {*bindless_heap.getSetLayout(), *uniformSetLayout_};
+    vk::PushConstantRange push_constant_range = bindless_heap.getPushConstantRange();
+
+    vk::PipelineLayoutCreateInfo pipeline_layout_create_info{
+        .setLayoutCount = static_cast<uint32_t>(set_layouts.size()),
+        .pSetLayouts = set_layouts.data(),
+        .pushConstantRangeCount = 1,
+        .pPushConstantRanges = &push_constant_range
+    };
+
+    layout_ = vk::raii::PipelineLayout(context_.getLogicalDevice(), pipeline_layout_create_info);
+}
+
+
+void ScenePass::createSampler()
+{
+    // trilinear through the full chain, uvs outside [0, 1] wrap
+    vk::SamplerCreateInfo sampler_create_info{
+        .magFilter = vk::Filter::eLinear,
+        .minFilter = vk::Filter::eLinear,
+        .mipmapMode = vk::SamplerMipmapMode::eLinear,
+        .addressModeU = vk::SamplerAddressMode::eRepeat,
+        .addressModeV = vk::SamplerAddressMode::eRepeat,
+        .addressModeW = vk::SamplerAddressMode::eRepeat,
+        .maxLod = VK_LOD_CLAMP_NONE
+    };
+    sampler_ = vk::raii::Sampler(context_.getLogicalDevice(), sampler_create_info);
+    samplerHandle_ = context_.getBindlessHeap().registerSampler(*sampler_);
+}
+
+
+void ScenePass::createObjects()
+{
+    // copies a few radii apart, each turned a bit further around y so the grid doesn't look stamped
+    const Mesh& mesh = mesh_.get();
+    glm::vec3 center = (mesh.getBoundsMin() + mesh.getBoundsMax()) * 0.5f;
+    float radius = std::max(glm::length(mesh.getBoundsMax() - mesh.getBoundsMin()) * 0.5f, 0.001f);
+    float spacing = radius * 2.5f;
+    float grid_offset = static_cast<float>(gridSize_ - 1) * 0.5f;
+
+    scene_.reserve(gridSize_ * gridSize_);
+    for (uint32_t z = 0; z < gridSize_; z++)
+    {
+        for (uint32_t x = 0; x < gridSize_; x++)
+        {
+            float angle = static_cast<float>(z * gridSize_ + x) * 0.7f;
+            scene_.createObject(SceneObjectDesc{
+                .position = glm::vec3(static_cast<float>(x) - grid_offset, 0.0f, static_cast<float>(z) - grid_offset) * spacing,
+                .rotation = glm::angleAxis(angle, glm::vec3(0.0f, 1.0f, 0.0f)),
+                .boundingSphere = glm::vec4(center, radius)
+            });
+        }
+    }
+
+    // the rotation swings the mesh's center around the object origin, the extra length covers that
+    float grid_radius = grid_offset * spacing * std::sqrt(2.0f) + glm::length(glm::vec2(center.x, center.z)) + radius;
+    sceneBoundingSphere_ = glm::vec4(0.0f, center.y, 0.0f, grid_radius);
+}
+
+
+std::optional<vk::SemaphoreSubmitInfo> ScenePass::prepare(uint32_t frame_index)
+{
+    if (scene_.getObjectCount() == 0) createObjects();
+
+    bool is_scene_changed = scene_.getDirtyGroupCount() > 0 || cullStructureVersion_ != scene_.getStructureVersion();
+    scene_.updateTransforms();
+    batches_ = batcher_.build(scene_, frame_index);
+    frameIndex_ = frame_index;
+
+    if (!culler_) return std::nullopt;
+    if (is_scene_changed)
+    {
+        cullVersion_++;
+        cullStructureVersion_ = scene_.getStructureVersion();
+    }
+
+    // only this slot's list is replaced, the frames in flight keep culling theirs
+    CullFrame& cull_frame = cullFrames_[frame_index];
+    if (cull_frame.version != cullVersion_)
+    {
+        cull_frame.uploadValue = updateCullObjects(frame_index);
+        cull_frame.version = cullVersion_;
+    }
+
+    // the cull dispatch is the first to read the objects
+    if (uploadEngine_.isComplete(cull_frame.uploadValue)) return std::nullopt;
+    return uploadEngine_.getWaitInfo(cull_frame.uploadValue, vk::PipelineStageFlagBits2::eComputeShader);
+}
+
+
+uint64_t ScenePass::updateCullObjects(uint32_t frame_index)
+{
+    const Mesh& mesh = mesh_.get();
+    std::span<const glm::mat4> world_matrices = scene_.getWorldMatrices();
+    std::span<const glm::vec4> bounding_spheres = scene_.getBoundingSpheres();
+    std::vector<CullObject> objects;
+    objects.reserve(batcher_.getInstanceCount());
+    for (uint32_t object_index : batcher_.getInstanceObjects())
+    {
+        objects.push_back(CullObject{
+            .transform = world_matrices[object_index],
+            .boundingSphere = bounding_spheres[object_index],
+            .indexCount = mesh.getIndexCount()
+        });
+    }
+
+    return culler_->setObjects(frame_index, objects);
+}
+
+
+void ScenePass::recordCull(vk::CommandBuffer command_buffer, vk::Extent2D extent) const
+{
+    if (culler_) culler_->cull(command_buffer, frameIndex_, makeSceneConstants(extent).viewProjection);
+}
+
+
+void ScenePass::recordDraw(vk::CommandBuffer command_buffer, vk::Extent2D extent, UniformRing& uniform_ring) const
+{
+    const Mesh& mesh = mesh_.get();
+
+    // dynamic state and bound sets aren't inherited by secondaries, so they're set together with every bind
+    command_buffer.bindPipeline(vk::PipelineBindPoint::eGraphics, stateCache_.getPipeline(description_, *layout_));
+    context_.getBindlessHeap().bind(command_buffer, vk::PipelineBindPoint::eGraphics, *layout_);
+    command_buffer.setViewport(
+        0,
+        vk::Viewport{
+            .x = 0.0f,
+            .y = 0.0f,
+            .width = static_cast<float>(extent.width),
+            .height = static_cast<float>(extent.height),
+            .minDepth = 0.0f,
+            .maxDepth = 1.0f
+        }
+    );
+    command_buffer.setScissor(0, vk::Rect2D{.offset = {0, 0}, .extent = extent});
+    PipelineCompiler::recordDynamicState(command_buffer, context_, description_);
+
+    uniform_ring.bindDrawData(command_buffer, vk::PipelineBindPoint::eGraphics, *layout_, makeSceneConstants(extent));
+
+    MeshDrawData draw_data{
+        .boundsMin = glm::vec4(mesh.getBoundsMin(), 0.0f),
+        .boundsMax = glm::vec4(mesh.getBoundsMax(), 0.0f),
+        .vertexBufferHandle = mesh.getVertexBufferHandle(),
+        .instanceBufferHandle = batcher_.getInstanceBufferHandle(frameIndex_)
+    };
+    if (const Texture* albedo = getAlbedo())
+    {
+        draw_data.albedoImageHandle = albedo->getImageHandle();
+        draw_data.albedoSamplerHandle = samplerHandle_;
+    }
+    uniform_ring.bindDrawData(command_buffer, vk::PipelineBindPoint::eGraphics, *layout_, draw_data);
+
+    // SV_VertexID is the index plus the vertex offset, the shader fetches the vertex itself. SV_VulkanInstanceID
+    // includes firstInstance, the instance index both for the culled draws and the batches
+    command_buffer.bindIndexBuffer(*mesh.getIndexBuffer(), 0, mesh.getIndexType());
+    if (culler_)
+    {
+        culler_->draw(command_buffer, frameIndex_);
+        return;
+    }
+
+    // every object shares the one mesh and pipeline, so that's a single batch
+    for (const DrawBatch& batch : batches_)
+    {
+        command_buffer.drawIndexed(mesh.getIndexCount(), batch.instanceCount, 0, 0, batch.firstInstance);
+    }
+}
+
+
+void ScenePass::markUsed(uint64_t timeline_value) const
+{
+    mesh_.get().markUsed(timeline_value);
+    if (const Texture* albedo = getAlbedo()) albedo->markUsed(timeline_value);
+}
+
+
+ScenePass::SceneConstants ScenePass::makeSceneConstants(vk::Extent2D extent) const
+{
+    // in front of the grid and a bit above it, far enough back for its bounding sphere to fit
+    glm::vec3 center = glm::vec3(sceneBoundingSphere_);
+    float radius = sceneBoundingSphere_.w;
+    glm::vec3 eye = center + glm::normalize(glm::vec3(0.0f, 0.4f, 1.0f)) * (radius * 2.5f);
+
+    float aspect = static_cast<float>(extent.width) / static_cast<float>(std::max(extent.height, 1u));
+    glm::mat4 view = glm::lookAt(eye, center, glm::vec3(0.0f, 1.0f, 0.0f));
+    glm::mat4 projection = glm::perspective(glm::radians(45.0f), aspect, radius * 0.1f, radius * 10.0f);
+    projection[1][1] *= -1.0f;  // Vulkan's clip space y points down
+
+    glm::vec3 light_direction = glm::normalize(glm::vec3(view * glm::vec4(0.4f, 1.0f, 0.6f, 0.0f)));
+    return SceneConstants{
+        .viewProjection = projection * view,
+        .view = view,
+        .lightDirection = glm::vec4(light_direction, 0.0f)
+    };
+}
+
+
+const Texture* ScenePass::getAlbedo() const
+{
+    return albedo_.isReady() ? &albedo_.get() : nullptr;
+}
+
+
+// Accessor functions
+bool ScenePass::isReady() const
+{
+    // a texture that failed to load leaves the mesh grey rather than hiding it
+    bool is_albedo_settled = !albedo_.isValid() || albedo_.isReady() || albedo_.hasFailed();
+    return mesh_.isReady() && is_albedo_settled && stateCache_.getPipeline(description_, *layout_) != nullptr;
+}
+
+
+bool ScenePass::hasFailed() const
+{
+    return mesh_.hasFailed();
+}
+
+
+const Scene& ScenePass::getScene() const
+{
+    return scene_;
+}
+
+
+bool ScenePass::isCulling() const
+{
+    return culler_ != nullptr;
+}
+
+
+const GraphicsPipelineDescription& ScenePass::getDescription() const
+{
+    return description_;
+}
@@ -0,0 +1,150 @@
+#pragma once
+
+#include <vulkan/vulkan_raii.hpp>
+#include <glm/glm.hpp>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <span>
+#include <vector>
+
+#include "PipelineCompiler.h"
+#include "core/TransientAttachments.h"
+#include "resources/AssetStreamer.h"
+#include "scene/InstanceBatcher.h"
+#include "scene/Scene.h"
+
+// forward declaring classes
+class VulkanContext;
+class UploadEngine;
+class FrameScheduler;
+class GpuCuller;
+class PipelineStateCache;
+class UniformRing;
+class Mesh;
+class Texture;
+
+// Draws a grid of copies of a streamed mesh (resources/Mesh.h, AssetStreamer::requestMesh()) in place of
+// the GraphicsPipeline's triangle, see Renderer::setScenePass(). The triangle is the fallback until both
+// the mesh and the pipeline are ready, a ready mesh has completed its upload so frames don't wait for it.
+// An optional albedo texture (AssetStreamer::requestTexture(), BC1/BC3 from the KTX2 cache where the device
+// has BC) is sampled with the uvs, the pass waits for it too unless it failed to load.
+//
+// The copies are objects of a Scene, grouped into instanced draws by an InstanceBatcher. Where the device
+// has multiDrawIndirect a GpuCuller frustum culls them on the GPU first and draws the visible ones with
+// drawIndexedIndirectCount(), its object list is in the batcher's instance order so firstInstance indexes
+// the instance buffer either way. shaders/mesh.slang reads the world matrix from the batcher's instance
+// buffer at SV_VulkanInstanceID, and pulls and dequantizes the vertices from the mesh's bindless storage
+// buffer, so the pipeline has no vertex input.
+// The frame constants are bigger than the push constant range and go through the UniformRing's buffer,
+// the per draw handles are pushed.
+// Not thread safe.
+class ScenePass
+{
+public:
+    // color_format and attachment_desc must match the GraphicsPipeline the pass draws in place of.
+    // scheduler is the graphics timeline drawing the pass, frame_count its frames in flight. Everything but
+    // the assets must outlive the pass, the pass keeps them alive. An empty albedo handle draws a plain grey,
+    // grid_size copies of the mesh are placed along each of x and z
+    ScenePass(
+        const VulkanContext& context,
+        UploadEngine& upload_engine,
+        PipelineStateCache& state_cache,
+        const FrameScheduler& scheduler,
+        uint32_t frame_count,
+        vk::Format color_format,
+        const TransientAttachmentDesc& attachment_desc,
+        AssetHandle<Mesh> mesh,
+        AssetHandle<Texture> albedo = {},
+        uint32_t grid_size = 1
+    );
+    ~ScenePass();  // waits for the frames that drew it
+
+    // deleting copy constructors
+    ScenePass(const ScenePass&) = delete;
+    ScenePass& operator=(const ScenePass&) = delete;
+
+    // once isReady(), before recording a frame that draws the pass. Writes the frame slot's instance
+    // buffer, the slot's previous submit must have completed (Renderer::drawFrame waited for it).
+    // The frame's submit waits for what it returns, the upload of the slot's culler objects after the
+    // scene changed
+    auto prepare(uint32_t frame_index) -> std::optional<vk::SemaphoreSubmitInfo>;
+
+    // outside rendering, after prepare() and before every recordDraw() of a target with this extent
+    void recordCull(vk::CommandBuffer command_buffer, vk::Extent2D extent) const;
+
+    // inside rendering, after recordCull()
+    void recordDraw(vk::CommandBuffer command_buffer, vk::Extent2D extent, UniformRing& uniform_ring) const;
+
+    // timeline_value: the graphics submit of the frame that drew the pass
+    void markUsed(uint64_t timeline_value) const;
+
+    // accessor functions
+    bool isReady() const;  // the assets streamed in and the pipeline compiled (or was linked), never blocks
+    bool hasFailed() const;  // the mesh failed to load, the pass never becomes ready
+    auto getScene() const -> const Scene&;  // empty until the first prepare()
+    bool isCulling() const;  // on the GPU, false draws every batch
+    auto getDescription() const -> const GraphicsPipelineDescription&;
+
+private:
+    // mirrors SceneConstants in shaders/mesh.slang, 144 bytes so it takes the ring path of bindDrawData()
+    struct SceneConstants
+    {
+        glm::mat4 viewProjection = glm::mat4(1.0f);
+        glm::mat4 view = glm::mat4(1.0f);
+        glm::vec4 lightDirection = glm::vec4(0.0f);  // view space, pointing towards the light
+    };
+
+    // mirrors MeshDrawData in shaders/mesh.slang, pushed
+    struct MeshDrawData
+    {
+        glm::vec4 boundsMin = glm::vec4(0.0f);  // dequantizes PackedVertex::position, w unused
+        glm::vec4 boundsMax = glm::vec4(0.0f);
+        uint32_t vertexBufferHandle = 0;
+        uint32_t albedoImageHandle = UINT32_MAX;  // UINT32_MAX without a texture
+        uint32_t albedoSamplerHandle = UINT32_MAX;
+        uint32_t instanceBufferHandle = 0;        // InstanceData of the frame slot
+    };
+
+    // private member functions
+    void createPipelineLayout();
+    void createSampler();
+    void createObjects();  // the grid, once the mesh bounds are known
+    auto updateCullObjects(uint32_t frame_index) -> uint64_t;  // the slot's list in instance order, returns its upload value
+    auto getAlbedo() const -> const Texture*;  // null while there's none to sample
+    auto makeSceneConstants(vk::Extent2D extent) const -> SceneConstants;  // a camera framing the grid
+
+    // shader paths, relative to the executable working directory
+    static constexpr const char* VERTEX_SHADER_PATH = "shaders/mesh.vert.spv";
+    static constexpr const char* FRAGMENT_SHADER_PATH = "shaders/mesh.frag.spv";
+
+    // private member variables
+    const VulkanContext& context_;
+    UploadEngine& uploadEngine_;
+    PipelineStateCache& stateCache_;
+    const FrameScheduler& scheduler_;
+    AssetHandle<Mesh> mesh_;
+    AssetHandle<Texture> albedo_;
+    GraphicsPipelineDescription description_;
+    vk::raii::DescriptorSetLayout uniformSetLayout_ = nullptr;  // UniformRing::createSetLayout(), set 1
+    vk::raii::PipelineLayout layout_ = nullptr;
+    vk::raii::Sampler sampler_ = nullptr;
+    uint32_t samplerHandle_ = UINT32_MAX;
+    Scene scene_;
+    InstanceBatcher batcher_;
+    uint32_t gridSize_ = 1;
+    glm::vec4 sceneBoundingSphere_ = glm::vec4(0.0f, 0.0f, 0.0f, 1.0f);  // world space, of the whole grid
+    std::span<const DrawBatch> batches_;  // of the last prepare()
+    uint32_t frameIndex_ = 0;
+    // a frame slot whose object list is older than cullVersion_ gets it uploaded again
+    struct CullFrame
+    {
+        uint64_t version = UINT64_MAX;
+        uint64_t uploadValue = 0;
+    };
+
+    std::unique_ptr<GpuCuller> culler_;  // null without multiDrawIndirect
+    std::vector<CullFrame> cullFrames_;  // one per frame in flight
+    uint64_t cullVersion_ = 0;  // bumped whenever the scene changed
+    uint64_t cullStructureVersion_ = UINT64_MAX;  // of the scene the last cullVersion_ was built from
+};
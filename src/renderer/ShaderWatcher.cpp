@@ -0,0 +1,90 @@
+#include "ShaderWatcher.h"
+#include "GraphicsPipeline.h"
+#include "PipelineCompiler.h"
+#include <algorithm>
+#include <iostream>
+#include <system_error>
+
+
+ShaderWatcher::ShaderWatcher(PipelineCompiler& compiler): compiler_(compiler)
+{
+}
+
+
+std::filesystem::file_time_type ShaderWatcher::getWriteTime(const std::filesystem::path& path)
+{
+    // a missing file (slangc halfway through writing it) reads as the minimum and never triggers a reload
+    std::error_code error;
+    std::filesystem::file_time_type write_time = std::filesystem::last_write_time(path, error);
+    return error ? std::filesystem::file_time_type::min() : write_time;
+}
+
+
+void ShaderWatcher::watch(GraphicsPipeline& pipeline)
+{
+    const GraphicsPipelineDescription& description = pipeline.getDescription();
+
+    for (const std::string& shader_path : {description.vertexShaderPath, description.fragmentShaderPath})
+    {
+        std::filesystem::path path = shader_path;
+        auto file_it = std::ranges::find_if(files_, [&path](const WatchedFile& file) { return file.path == path; });
+        if (file_it == files_.end())
+        {
+            files_.push_back({.path = path, .writeTime = getWriteTime(path)});
+            file_it = files_.end() - 1;
+        }
+
+        if (std::ranges::find(file_it->pipelines, &pipeline) == file_it->pipelines.end())
+        {
+            file_it->pipelines.push_back(&pipeline);
+        }
+    }
+}
+
+
+void ShaderWatcher::unwatch(GraphicsPipeline& pipeline)
+{
+    for (auto& file : files_)
+    {
+        std::erase(file.pipelines, &pipeline);
+    }
+    std::erase_if(files_, [](const WatchedFile& file) { return file.pipelines.empty(); });
+}
+
+
+void ShaderWatcher::poll()
+{
+    auto now = std::chrono::steady_clock::now();
+    if (now - lastPoll_ < POLL_INTERVAL) return;
+    lastPoll_ = now;
+
+    // both stages of a pipeline usually change together, it's only recompiled once
+    std::vector<GraphicsPipeline*> changed_pipelines;
+    for (auto& file : files_)
+    {
+        std::filesystem::file_time_type write_time = getWriteTime(file.path);
+        if (write_time == std::filesystem::file_time_type::min() || write_time == file.writeTime) continue;
+
+        // debounced by one poll so we never map a file the shader compiler is still writing
+        if (write_time != file.pendingWriteTime)
+        {
+            file.pendingWriteTime = write_time;
+            continue;
+        }
+
+        file.writeTime = write_time;
+        std::cout << "shader changed: " << file.path.string() << "\n";
+        for (GraphicsPipeline* pipeline : file.pipelines)
+        {
+            if (std::ranges::find(changed_pipelines, pipeline) == changed_pipelines.end())
+            {
+                changed_pipelines.push_back(pipeline);
+            }
+        }
+    }
+
+    for (GraphicsPipeline* pipeline : changed_pipelines)
+    {
+        pipeline->reload(compiler_);
+    }
+}
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <chrono>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+// forward declaring classes
+class GraphicsPipeline;
+class PipelineCompiler;
+
+// Development build shader hot reload. poll() stats the SPIR-V files of every watched pipeline and
+// queues a background recompile of only the pipelines whose files changed, the Renderer swaps them in
+// once they're ready (GraphicsPipeline::applyReload()). Rebuilding the Shaders target is enough to
+// see the change, no restart.
+// Not thread safe, used from the main loop.
+class ShaderWatcher
+{
+public:
+#ifdef NDEBUG
+    static constexpr bool ENABLED = false;
+#else
+    static constexpr bool ENABLED = true;
+#endif
+
+    explicit ShaderWatcher(PipelineCompiler& compiler);
+
+    // deleting copy constructors
+    ShaderWatcher(const ShaderWatcher&) = delete;
+    ShaderWatcher& operator=(const ShaderWatcher&) = delete;
+
+    void watch(GraphicsPipeline& pipeline);    // the pipeline must outlive the watcher or be unwatched first
+    void unwatch(GraphicsPipeline& pipeline);
+
+    void poll();  // cheap to call every frame, only touches the file system every POLL_INTERVAL
+
+    static constexpr std::chrono::milliseconds POLL_INTERVAL{250};
+
+private:
+    struct WatchedFile
+    {
+        std::filesystem::path path;
+        std::filesystem::file_time_type writeTime;         // of the SPIR-V the pipelines were built from
+        std::filesystem::file_time_type pendingWriteTime;  // seen once, reloaded when it holds for another poll
+        std::vector<GraphicsPipeline*> pipelines;
+    };
+
+    static auto getWriteTime(const std::filesystem::path& path) -> std::filesystem::file_time_type;
+
+    PipelineCompiler& compiler_;
+    std::vector<WatchedFile> files_;
+    std::chrono::steady_clock::time_point lastPoll_;
+};
@@ -0,0 +1,186 @@
+#include "UniformRing.h"
+#include "core/VulkanContext.h"
+#include <algorithm>
+#include <cstddef>
+#include <limits>
+#include <stdexcept>
+#include <string>
+
+
+namespace
+{
+    vk::DeviceSize alignUp(vk::DeviceSize value, vk::DeviceSize alignment)
+    {
+        return (value + alignment - 1) & ~(alignment - 1);
+    }
+}
+
+
+UniformRing::UniformRing(const VulkanContext& context, uint32_t frame_count, vk::DeviceSize size_per_frame)
+    : context_(context)
+{
+    const vk::PhysicalDeviceLimits limits = context_.getPhysicalDevice().getProperties().limits;
+    alignment_ = std::max<vk::DeviceSize>(limits.minUniformBufferOffsetAlignment, 1);
+    sizePerFrame_ = alignUp(std::max<vk::DeviceSize>(size_per_frame, alignment_), alignment_);
+    range_ = std::min({MAX_RANGE, static_cast<vk::DeviceSize>(limits.maxUniformBufferRange), sizePerFrame_});
+
+    createBuffer(frame_count);
+    createDescriptorSet();
+    reset(0);
+}
+
+
+UniformRing::~UniformRing()
+{
+    set_.clear();
+    buffer_.clear();
+    context_.getMemoryAllocator().free(allocation_);
+}
+
+
+void UniformRing::reset(uint32_t frame_index)
+{
+    regionOffset_ = sizePerFrame_ * frame_index;
+    head_.store(0, std::memory_order_relaxed);
+}
+
+
+UniformAllocation UniformRing::allocate(vk::DeviceSize size)
+{
+    if (size > range_)
+    {
+        throw std::runtime_error("uniform allocation of " + std::to_string(size) + " bytes exceeds the descriptor range of " + std::to_string(range_));
+    }
+
+    // every allocation is rounded up, so the head stays aligned and one fetch_add is enough
+    vk::DeviceSize aligned_size = alignUp(std::max<vk::DeviceSize>(size, 1), alignment_);
+    vk::DeviceSize offset = head_.fetch_add(aligned_size, std::memory_order_relaxed);
+    if (offset + aligned_size > sizePerFrame_)
+    {
+        throw std::runtime_error("uniform ring region of " + std::to_string(sizePerFrame_) + " bytes is full");
+    }
+
+    vk::DeviceSize buffer_offset = regionOffset_ + offset;
+    return UniformAllocation{
+        .mappedData = static_cast<std::byte*>(allocation_.mappedData) + buffer_offset,
+        .dynamicOffset = static_cast<uint32_t>(buffer_offset),
+        .size = size
+    };
+}
+
+
+void UniformRing::createBuffer(uint32_t frame_count)
+{
+    // the descriptor always covers range_ bytes past the dynamic offset, the tail keeps the last region's
+    // allocations inside the buffer
+    vk::DeviceSize buffer_size = sizePerFrame_ * frame_count + range_;
+    if (buffer_size > std::numeric_limits<uint32_t>::max())
+    {
+        throw std::runtime_error("uniform ring is too large for 32 bit dynamic offsets");
+    }
+
+    vk::BufferCreateInfo buffer_create_info{
+        .size = buffer_size,
+        .usage = vk::BufferUsageFlagBits::eUniformBuffer,
+        .sharingMode = vk::SharingMode::eExclusive
+    };
+    buffer_ = vk::raii::Buffer(context_.getLogicalDevice(), buffer_create_info);
+
+    // host coherent, writes need no flush. Device local on ReBAR, so shaders read it without crossing the bus
+    allocation_ = context_.getMemoryAllocator().allocateForBuffer(buffer_, MemoryUsage::eDynamic);
+    vk::PhysicalDeviceMemoryProperties memory_properties = context_.getPhysicalDevice().getMemoryProperties();
+    isDeviceLocal_ = static_cast<bool>(memory_properties.memoryTypes[allocation_.memoryTypeIndex].propertyFlags & vk::MemoryPropertyFlagBits::eDeviceLocal);
+}
+
+
+void UniformRing::createDescriptorSet()
+{
+    const vk::raii::Device& device = context_.getLogicalDevice();
+    setLayout_ = createSetLayout(device);
+
+    // free descriptor set because the raii set frees itself on destruction
+    vk::DescriptorPoolSize pool_size{.type = vk::DescriptorType::eUniformBufferDynamic, .descriptorCount = 1};
+    vk::DescriptorPoolCreateInfo pool_create_info{
+        .flags = vk::DescriptorPoolCreateFlagBits::eFreeDescriptorSet,
+        .maxSets = 1,
+        .poolSizeCount = 1,
+        .pPoolSizes = &pool_size
+    };
+    pool_ = vk::raii::DescriptorPool(device, pool_create_info);
+
+    vk::DescriptorSetAllocateInfo set_allocate_info{
+        .descriptorPool = *pool_,
+        .descriptorSetCount = 1,
+        .pSetLayouts = &*setLayout_
+    };
+    set_ = std::move(device.allocateDescriptorSets(set_allocate_info).front());
+
+    // written once, the offset of every draw comes in at bind time
+    vk::DescriptorBufferInfo buffer_info{
+        .buffer = *buffer_,
+        .offset = 0,
+        .range = range_
+    };
+    vk::WriteDescriptorSet write{
+        .dstSet = *set_,
+        .dstBinding = 0,
+        .dstArrayElement = 0,
+        .descriptorCount = 1,
+        .descriptorType = vk::DescriptorType::eUniformBufferDynamic,
+        .pBufferInfo = &buffer_info
+    };
+    device.updateDescriptorSets(write, nullptr);
+}
+
+
+vk::raii::DescriptorSetLayout UniformRing::createSetLayout(const vk::raii::Device& device)
+{
+    vk::DescriptorSetLayoutBinding binding{
+        .binding = 0,
+        .descriptorType = vk::DescriptorType::eUniformBufferDynamic,
+        .descriptorCount = 1,
+        .stageFlags = vk::ShaderStageFlagBits::eAll
+    };
+    vk::DescriptorSetLayoutCreateInfo set_layout_create_info{
+        .bindingCount = 1,
+        .pBindings = &binding
+    };
+    return vk::raii::DescriptorSetLayout(device, set_layout_create_info);
+}
+
+
+// Accessor functions
+const vk::raii::DescriptorSetLayout& UniformRing::getSetLayout() const
+{
+    return setLayout_;
+}
+
+
+vk::DescriptorSet UniformRing::getDescriptorSet() const
+{
+    return *set_;
+}
+
+
+vk::DeviceSize UniformRing::getUsedSize() const
+{
+    return std::min(head_.load(std::memory_order_relaxed), sizePerFrame_);
+}
+
+
+vk::DeviceSize UniformRing::getSizePerFrame() const
+{
+    return sizePerFrame_;
+}
+
+
+vk::DeviceSize UniformRing::getMaxAllocationSize() const
+{
+    return range_;
+}
+
+
+bool UniformRing::isDeviceLocal() const
+{
+    return isDeviceLocal_;
+}
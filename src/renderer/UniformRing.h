@@ -0,0 +1,125 @@
+#pragma once
+
+#include <vulkan/vulkan_raii.hpp>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+#include "core/BindlessHeap.h"
+#include "core/MemoryAllocator.h"
+
+// forward declaring classes
+class VulkanContext;
+
+// A slice of the ring, written by the CPU and valid until its frame slot is reset
+struct UniformAllocation
+{
+    void* mappedData = nullptr;
+    uint32_t dynamicOffset = 0;  // from the start of the buffer, what bindDescriptorSets takes
+    vk::DeviceSize size = 0;
+
+    explicit operator bool() const { return mappedData != nullptr; }
+};
+
+
+// Per frame uniform data without per draw allocations or descriptor writes. One buffer, persistently
+// mapped and host coherent (and device local with ReBAR), is split into a region per frame in flight.
+// allocate() bumps an atomic offset in the current region, aligned to minUniformBufferOffsetAlignment,
+// and reset() drops the whole region at once when the frame slot is recycled.
+// Shaders read allocations through one dynamic uniform buffer descriptor (set DESCRIPTOR_SET_INDEX,
+// binding 0) written once, so a draw only passes its offset to bindDescriptorSets. Dynamic descriptors
+// can't live in the update after bind bindless set, hence a set of its own.
+// bindDrawData() takes the push constant fast path for data up to PUSH_CONSTANT_FAST_PATH_SIZE.
+// Thread safe for allocate() and bindDrawData(), workers recording secondaries share the region.
+// reset() must not run concurrently with them.
+class UniformRing
+{
+public:
+    UniformRing(const VulkanContext& context, uint32_t frame_count, vk::DeviceSize size_per_frame = DEFAULT_SIZE_PER_FRAME);
+    ~UniformRing();  // the GPU must be done with every frame slot
+
+    // deleting copy constructors
+    UniformRing(const UniformRing&) = delete;
+    UniformRing& operator=(const UniformRing&) = delete;
+
+    // makes frame_index the current region and empties it, the slot's previous submit must have completed
+    void reset(uint32_t frame_index);
+
+    // throws std::runtime_error when size exceeds the descriptor range or the region is full
+    auto allocate(vk::DeviceSize size) -> UniformAllocation;
+
+    template <typename T>
+    auto write(const T& value) -> UniformAllocation;
+
+    // small data goes through push constants at offset 0, bigger data is written to the ring and bound with
+    // its dynamic offset. sizeof(T) picks the path at compile time, the shader must declare it the same way.
+    // layout must include the bindless push constant range and, for the ring path, getSetLayout()
+    template <typename T>
+    void bindDrawData(vk::CommandBuffer command_buffer, vk::PipelineBindPoint bind_point, vk::PipelineLayout layout, const T& value);
+
+    // a layout identical to getSetLayout(), and so compatible with it, for pipelines created before the ring
+    static auto createSetLayout(const vk::raii::Device& device) -> vk::raii::DescriptorSetLayout;
+
+    // accessor functions
+    auto getSetLayout() const -> const vk::raii::DescriptorSetLayout&;  // set DESCRIPTOR_SET_INDEX of pipelines reading the ring
+    auto getDescriptorSet() const -> vk::DescriptorSet;
+    auto getUsedSize() const -> vk::DeviceSize;  // of the current region
+    auto getSizePerFrame() const -> vk::DeviceSize;
+    auto getMaxAllocationSize() const -> vk::DeviceSize;  // the range of the descriptor
+    bool isDeviceLocal() const;
+
+    static constexpr vk::DeviceSize DEFAULT_SIZE_PER_FRAME = 4 << 20;  // 4 MiB
+    static constexpr vk::DeviceSize MAX_RANGE = 64 << 10;              // per allocation, clamped to maxUniformBufferRange
+    static constexpr uint32_t DESCRIPTOR_SET_INDEX = 1;                // right after the bindless heap
+    static constexpr uint32_t PUSH_CONSTANT_FAST_PATH_SIZE = BindlessHeap::PUSH_CONSTANT_SIZE;
+
+private:
+    // private member functions
+    void createBuffer(uint32_t frame_count);
+    void createDescriptorSet();
+
+    // private member variables
+    const VulkanContext& context_;
+    vk::DeviceSize alignment_ = 0;
+    vk::DeviceSize sizePerFrame_ = 0;  // multiple of alignment_
+    vk::DeviceSize range_ = 0;
+    vk::raii::Buffer buffer_ = nullptr;
+    Allocation allocation_;
+    bool isDeviceLocal_ = false;
+
+    vk::raii::DescriptorSetLayout setLayout_ = nullptr;
+    vk::raii::DescriptorPool pool_ = nullptr;
+    vk::raii::DescriptorSet set_ = nullptr;
+
+    vk::DeviceSize regionOffset_ = 0;
+    std::atomic<vk::DeviceSize> head_ = 0;  // relative to regionOffset_, may run past the region once it's full
+};
+
+
+template <typename T>
+auto UniformRing::write(const T& value) -> UniformAllocation
+{
+    static_assert(std::is_trivially_copyable_v<T>, "uniform data is copied as bytes");
+    UniformAllocation allocation = allocate(sizeof(T));
+    std::memcpy(allocation.mappedData, &value, sizeof(T));
+    return allocation;
+}
+
+
+template <typename T>
+void UniformRing::bindDrawData(vk::CommandBuffer command_buffer, vk::PipelineBindPoint bind_point, vk::PipelineLayout layout, const T& value)
+{
+    static_assert(std::is_trivially_copyable_v<T>, "draw data is copied as bytes");
+    if constexpr (sizeof(T) <= PUSH_CONSTANT_FAST_PATH_SIZE)
+    {
+        // lands in the command buffer itself, no memory write and no descriptor bind
+        command_buffer.pushConstants(layout, vk::ShaderStageFlagBits::eAll, 0, sizeof(T), &value);
+    }
+    else
+    {
+        UniformAllocation allocation = write(value);
+        vk::DescriptorSet set = *set_;
+        command_buffer.bindDescriptorSets(bind_point, layout, DESCRIPTOR_SET_INDEX, set, allocation.dynamicOffset);
+    }
+}
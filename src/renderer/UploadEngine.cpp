@@ -0,0 +1,409 @@
+#include "UploadEngine.h"
+#include "core/VulkanContext.h"
+#include "utils/Trace.h"
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
+
+namespace
+{
+    vk::DeviceSize alignUp(vk::DeviceSize value, vk::DeviceSize alignment)
+    {
+        return (value + alignment - 1) & ~(alignment - 1);
+    }
+}
+
+
+UploadEngine::UploadEngine(const VulkanContext& context, vk::DeviceSize staging_size)
+    : context_(context), stagingSize_(staging_size)
+{
+    // image copies need offsets aligned to the texel block size as well, 16 covers every BCn/ASTC block
+    vk::DeviceSize optimal_alignment = context_.getPhysicalDevice().getProperties().limits.optimalBufferCopyOffsetAlignment;
+    copyOffsetAlignment_ = std::max<vk::DeviceSize>(optimal_alignment, 16);
+
+    createStagingBuffer();
+    createTimelineSemaphore();
+}
+
+
+UploadEngine::~UploadEngine()
+{
+    uint64_t last_value = flush();
+    wait(last_value);
+
+    context_.getMemoryAllocator().free(stagingAllocation_);
+}
+
+
+void UploadEngine::createStagingBuffer()
+{
+    vk::BufferCreateInfo buffer_create_info{
+        .size = stagingSize_,
+        .usage = vk::BufferUsageFlagBits::eTransferSrc,
+        .sharingMode = vk::SharingMode::eExclusive  // only ever read by the upload queue
+    };
+
+    stagingBuffer_ = vk::raii::Buffer(context_.getLogicalDevice(), buffer_create_info);
+    stagingAllocation_ = context_.getMemoryAllocator().allocateForBuffer(stagingBuffer_, MemoryUsage::eUpload);
+}
+
+
+void UploadEngine::createTimelineSemaphore()
+{
+    vk::SemaphoreTypeCreateInfo semaphore_type_create_info{
+        .semaphoreType = vk::SemaphoreType::eTimeline,
+        .initialValue = 0
+    };
+
+    vk::SemaphoreCreateInfo semaphore_create_info{
+        .pNext = &semaphore_type_create_info
+    };
+
+    timelineSemaphore_ = vk::raii::Semaphore(context_.getLogicalDevice(), semaphore_create_info);
+}
+
+
+UploadEngine::Batch& UploadEngine::beginPendingBatch()
+{
+    if (pending_) return *pending_;
+
+    Batch batch;
+    if (!freeBatches_.empty())
+    {
+        // the GPU is done with a retired batch, resetting the pool recycles its command buffer
+        batch = std::move(freeBatches_.back());
+        freeBatches_.pop_back();
+        batch.commandPool.reset();
+    }
+    else
+    {
+        vk::CommandPoolCreateInfo command_pool_create_info{
+            .flags = vk::CommandPoolCreateFlagBits::eTransient,
+            .queueFamilyIndex = context_.getQueueFamilyIndex(QueueType::eTransfer)
+        };
+        batch.commandPool = vk::raii::CommandPool(context_.getLogicalDevice(), command_pool_create_info);
+
+        vk::CommandBufferAllocateInfo command_buffer_allocate_info{
+            .commandPool = *batch.commandPool,
+            .level = vk::CommandBufferLevel::ePrimary,
+            .commandBufferCount = 1
+        };
+        batch.commandBuffer = std::move(context_.getLogicalDevice().allocateCommandBuffers(command_buffer_allocate_info).front());
+    }
+
+    batch.copyCount = 0;
+    batch.commandBuffer.begin({.flags = vk::CommandBufferUsageFlagBits::eOneTimeSubmit});
+
+    pending_ = std::move(batch);
+    return *pending_;
+}
+
+
+std::optional<vk::DeviceSize> UploadEngine::tryAllocateStaging(vk::DeviceSize size, vk::DeviceSize alignment)
+{
+    // nothing in flight and nothing recorded, start over at the beginning of the ring
+    bool ring_empty = inFlight_.empty() && (!pending_ || pending_->copyCount == 0);
+    if (ring_empty)
+    {
+        ringHead_ = 0;
+        pendingRingBegin_ = 0;
+    }
+
+    // the oldest byte still referenced by a batch, everything from the head up to it is free
+    vk::DeviceSize ring_tail = inFlight_.empty() ? pendingRingBegin_ : inFlight_.front().ringBegin;
+    vk::DeviceSize offset = alignUp(ringHead_, alignment);
+
+    if (ring_empty || ringHead_ > ring_tail)
+    {
+        // free space is [head, end) followed by [0, tail)
+        if (offset + size <= stagingSize_)
+        {
+            ringHead_ = offset + size;
+            return offset;
+        }
+        if (size <= ring_tail)
+        {
+            ringHead_ = size;  // wrapping, the bytes left at the end stay unused this lap
+            return 0;
+        }
+        return std::nullopt;
+    }
+
+    if (ringHead_ < ring_tail && offset + size <= ring_tail)
+    {
+        ringHead_ = offset + size;
+        return offset;
+    }
+
+    return std::nullopt;  // head caught up with the tail, the ring is full
+}
+
+
+vk::DeviceSize UploadEngine::allocateStaging(vk::DeviceSize size, vk::DeviceSize alignment)
+{
+    if (size > stagingSize_)
+    {
+        throw std::runtime_error("upload of " + std::to_string(size) + " bytes does not fit the staging ring");
+    }
+
+    while (true)
+    {
+        collectLocked();
+
+        std::optional<vk::DeviceSize> offset = tryAllocateStaging(size, alignment);
+        if (offset) return *offset;
+
+        // out of ring space: submit what we have and block until the oldest batch frees its range
+        flushLocked();
+        if (inFlight_.empty())
+        {
+            throw std::runtime_error("staging ring is full without any batch in flight");
+        }
+
+        uint64_t oldest_value = inFlight_.front().timelineValue;
+        vk::SemaphoreWaitInfo semaphore_wait_info{
+            .semaphoreCount = 1,
+            .pSemaphores = &*timelineSemaphore_,
+            .pValues = &oldest_value
+        };
+        (void)context_.getLogicalDevice().waitSemaphores(semaphore_wait_info, UINT64_MAX);
+    }
+}
+
+
+uint64_t UploadEngine::uploadBuffer(vk::Buffer dst_buffer, vk::DeviceSize dst_offset, const void* data, vk::DeviceSize size)
+{
+    std::lock_guard lock(mutex_);
+
+    vk::DeviceSize staging_offset = allocateStaging(size, copyOffsetAlignment_);
+    std::memcpy(static_cast<char*>(stagingAllocation_.mappedData) + staging_offset, data, size);  // coherent, no flush needed
+
+    Batch& batch = beginPendingBatch();
+    batch.commandBuffer.copyBuffer(
+        *stagingBuffer_,
+        dst_buffer,
+        vk::BufferCopy{
+            .srcOffset = staging_offset,
+            .dstOffset = dst_offset,
+            .size = size
+        }
+    );
+    batch.copyCount++;
+
+    return lastSubmittedValue_ + 1;  // the value the pending batch signals once flushed
+}
+
+
+uint64_t UploadEngine::uploadImage(
+    vk::Image dst_image,
+    vk::Extent3D extent,
+    const void* data,
+    vk::DeviceSize size,
+    vk::ImageLayout final_layout,
+    uint32_t mip_level,
+    uint32_t array_layer
+)
+{
+    std::lock_guard lock(mutex_);
+
+    vk::DeviceSize staging_offset = allocateStaging(size, copyOffsetAlignment_);
+    std::memcpy(static_cast<char*>(stagingAllocation_.mappedData) + staging_offset, data, size);
+
+    Batch& batch = beginPendingBatch();
+
+    vk::ImageSubresourceRange subresource_range{
+        .aspectMask = vk::ImageAspectFlagBits::eColor,
+        .baseMipLevel = mip_level,
+        .levelCount = 1,
+        .baseArrayLayer = array_layer,
+        .layerCount = 1
+    };
+
+    // the whole level is overwritten, its previous contents can be discarded
+    vk::ImageMemoryBarrier2 to_transfer_barrier{
+        .srcStageMask = vk::PipelineStageFlagBits2::eNone,
+        .srcAccessMask = {},
+        .dstStageMask = vk::PipelineStageFlagBits2::eTransfer,
+        .dstAccessMask = vk::AccessFlagBits2::eTransferWrite,
+        .oldLayout = vk::ImageLayout::eUndefined,
+        .newLayout = vk::ImageLayout::eTransferDstOptimal,
+        .srcQueueFamilyIndex = vk::QueueFamilyIgnored,
+        .dstQueueFamilyIndex = vk::QueueFamilyIgnored,
+        .image = dst_image,
+        .subresourceRange = subresource_range
+    };
+    batch.commandBuffer.pipelineBarrier2({.imageMemoryBarrierCount = 1, .pImageMemoryBarriers = &to_transfer_barrier});
+
+    batch.commandBuffer.copyBufferToImage(
+        *stagingBuffer_,
+        dst_image,
+        vk::ImageLayout::eTransferDstOptimal,
+        vk::BufferImageCopy{
+            .bufferOffset = staging_offset,
+            .bufferRowLength = 0,    // tightly packed
+            .bufferImageHeight = 0,
+            .imageSubresource = {
+                .aspectMask = vk::ImageAspectFlagBits::eColor,
+                .mipLevel = mip_level,
+                .baseArrayLayer = array_layer,
+                .layerCount = 1
+            },
+            .imageOffset = {0, 0, 0},
+            .imageExtent = extent
+        }
+    );
+
+    // no destination stage, the consumer waits on the timeline semaphore which makes the writes visible
+    vk::ImageMemoryBarrier2 to_final_barrier{
+        .srcStageMask = vk::PipelineStageFlagBits2::eTransfer,
+        .srcAccessMask = vk::AccessFlagBits2::eTransferWrite,
+        .dstStageMask = vk::PipelineStageFlagBits2::eNone,
+        .dstAccessMask = {},
+        .oldLayout = vk::ImageLayout::eTransferDstOptimal,
+        .newLayout = final_layout,
+        .srcQueueFamilyIndex = vk::QueueFamilyIgnored,
+        .dstQueueFamilyIndex = vk::QueueFamilyIgnored,
+        .image = dst_image,
+        .subresourceRange = subresource_range
+    };
+    batch.commandBuffer.pipelineBarrier2({.imageMemoryBarrierCount = 1, .pImageMemoryBarriers = &to_final_barrier});
+
+    batch.copyCount++;
+
+    return lastSubmittedValue_ + 1;
+}
+
+
+uint64_t UploadEngine::flush()
+{
+    std::lock_guard lock(mutex_);
+    return flushLocked();
+}
+
+
+uint64_t UploadEngine::flushLocked()
+{
+    TRACE_SCOPE("UploadEngine::flush");
+    if (!pending_ || pending_->copyCount == 0)
+    {
+        return lastSubmittedValue_;
+    }
+
+    Batch batch = std::move(*pending_);
+    pending_.reset();
+    batch.commandBuffer.end();
+
+    batch.timelineValue = ++lastSubmittedValue_;
+    batch.ringBegin = pendingRingBegin_;
+    batch.ringEnd = ringHead_;
+    pendingRingBegin_ = ringHead_;
+
+    vk::CommandBufferSubmitInfo command_buffer_submit_info{
+        .commandBuffer = *batch.commandBuffer
+    };
+
+    vk::SemaphoreSubmitInfo signal_semaphore_info{
+        .semaphore = *timelineSemaphore_,
+        .value = batch.timelineValue,
+        .stageMask = vk::PipelineStageFlagBits2::eAllCommands
+    };
+
+    vk::SubmitInfo2 submit_info{
+        .commandBufferInfoCount = 1,
+        .pCommandBufferInfos = &command_buffer_submit_info,
+        .signalSemaphoreInfoCount = 1,
+        .pSignalSemaphoreInfos = &signal_semaphore_info
+    };
+
+    {
+        auto queue_lock = context_.lockQueue(QueueType::eTransfer);
+        context_.getQueue(QueueType::eTransfer).submit2(submit_info);
+    }
+
+    inFlight_.push_back(std::move(batch));
+    return lastSubmittedValue_;
+}
+
+
+void UploadEngine::collectLocked()
+{
+    uint64_t completed_value = timelineSemaphore_.getCounterValue();
+
+    while (!inFlight_.empty() && inFlight_.front().timelineValue <= completed_value)
+    {
+        freeBatches_.push_back(std::move(inFlight_.front()));
+        inFlight_.pop_front();
+    }
+}
+
+
+bool UploadEngine::isComplete(uint64_t timeline_value) const
+{
+    return timelineSemaphore_.getCounterValue() >= timeline_value;
+}
+
+
+void UploadEngine::wait(uint64_t timeline_value)
+{
+    {
+        std::lock_guard lock(mutex_);
+        if (timeline_value > lastSubmittedValue_)
+        {
+            flushLocked();
+        }
+    }
+
+    vk::SemaphoreWaitInfo semaphore_wait_info{
+        .semaphoreCount = 1,
+        .pSemaphores = &*timelineSemaphore_,
+        .pValues = &timeline_value
+    };
+    (void)context_.getLogicalDevice().waitSemaphores(semaphore_wait_info, UINT64_MAX);
+}
+
+
+uint64_t UploadEngine::getCompletedValue() const
+{
+    return timelineSemaphore_.getCounterValue();
+}
+
+
+vk::SemaphoreSubmitInfo UploadEngine::getWaitInfo(uint64_t timeline_value, vk::PipelineStageFlags2 stage_mask)
+{
+    {
+        // waiting on a value nobody will ever signal would hang the GPU queue
+        std::lock_guard lock(mutex_);
+        if (timeline_value > lastSubmittedValue_)
+        {
+            flushLocked();
+        }
+    }
+
+    return vk::SemaphoreSubmitInfo{
+        .semaphore = *timelineSemaphore_,
+        .value = timeline_value,
+        .stageMask = stage_mask
+    };
+}
+
+
+const vk::raii::Semaphore& UploadEngine::getSemaphore() const
+{
+    return timelineSemaphore_;
+}
+
+
+std::vector<uint32_t> UploadEngine::getConcurrentQueueFamilies() const
+{
+    if (!context_.hasDedicatedTransferQueue())
+    {
+        return {};
+    }
+
+    return {
+        context_.getQueueFamilyIndex(QueueType::eGraphics),
+        context_.getQueueFamilyIndex(QueueType::eTransfer)
+    };
+}
@@ -0,0 +1,99 @@
+#pragma once
+
+#include <vulkan/vulkan_raii.hpp>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <optional>
+#include <vector>
+
+#include "core/MemoryAllocator.h"
+
+// forward declaring classes
+class VulkanContext;
+
+// Streams buffer and image data to the GPU through one persistently mapped staging ring buffer.
+// Copies are batched into one command buffer until flush(), which submits the batch to the transfer
+// queue (the graphics queue without a dedicated family) and signals the engine's timeline semaphore.
+// Every upload returns the timeline value it completes at, the renderer only waits on the values of
+// resources that frame actually uses. Ring space is recycled as the GPU retires batches.
+//
+// With a dedicated transfer family the destination resources must be created with eConcurrent sharing
+// across getConcurrentQueueFamilies(), we don't do queue family ownership transfers.
+// Thread safe.
+class UploadEngine
+{
+public:
+    explicit UploadEngine(const VulkanContext& context, vk::DeviceSize staging_size = DEFAULT_STAGING_SIZE);
+    ~UploadEngine();  // waits for every submitted batch, staging memory can't go away under the GPU
+
+    // deleting copy constructors
+    UploadEngine(const UploadEngine&) = delete;
+    UploadEngine& operator=(const UploadEngine&) = delete;
+
+    // copies data into the ring and records the copy into the pending batch, returns its timeline value
+    auto uploadBuffer(vk::Buffer dst_buffer, vk::DeviceSize dst_offset, const void* data, vk::DeviceSize size) -> uint64_t;
+
+    // whole mip level upload, the image ends up in final_layout
+    auto uploadImage(
+        vk::Image dst_image,
+        vk::Extent3D extent,
+        const void* data,
+        vk::DeviceSize size,
+        vk::ImageLayout final_layout,
+        uint32_t mip_level = 0,
+        uint32_t array_layer = 0
+    ) -> uint64_t;
+
+    // submits the pending batch, returns the value it signals (the last submitted value if nothing was pending)
+    auto flush() -> uint64_t;
+
+    bool isComplete(uint64_t timeline_value) const;
+    void wait(uint64_t timeline_value);  // flushes first when timeline_value is still pending
+    uint64_t getCompletedValue() const;
+
+    // wait info to chain into a vk::SubmitInfo2, flushes first when timeline_value is still pending
+    auto getWaitInfo(uint64_t timeline_value, vk::PipelineStageFlags2 stage_mask) -> vk::SemaphoreSubmitInfo;
+
+    auto getSemaphore() const -> const vk::raii::Semaphore&;
+    auto getConcurrentQueueFamilies() const -> std::vector<uint32_t>;  // empty when uploads run on the graphics queue
+
+    static constexpr vk::DeviceSize DEFAULT_STAGING_SIZE = 64ull << 20;  // 64 MiB
+
+private:
+    struct Batch
+    {
+        vk::raii::CommandPool commandPool = nullptr;
+        vk::raii::CommandBuffer commandBuffer = nullptr;
+        uint64_t timelineValue = 0;
+        vk::DeviceSize ringBegin = 0;
+        vk::DeviceSize ringEnd = 0;
+        uint32_t copyCount = 0;
+    };
+
+    void createStagingBuffer();
+    void createTimelineSemaphore();
+
+    // all of these expect mutex_ to be held
+    auto beginPendingBatch() -> Batch&;
+    auto allocateStaging(vk::DeviceSize size, vk::DeviceSize alignment) -> vk::DeviceSize;
+    auto tryAllocateStaging(vk::DeviceSize size, vk::DeviceSize alignment) -> std::optional<vk::DeviceSize>;
+    auto flushLocked() -> uint64_t;
+    void collectLocked();  // retires batches whose timeline value completed
+
+    const VulkanContext& context_;
+    vk::DeviceSize stagingSize_ = 0;
+    vk::DeviceSize copyOffsetAlignment_ = 4;
+
+    vk::raii::Buffer stagingBuffer_ = nullptr;
+    Allocation stagingAllocation_;
+    vk::raii::Semaphore timelineSemaphore_ = nullptr;
+
+    mutable std::mutex mutex_;
+    std::optional<Batch> pending_;
+    std::deque<Batch> inFlight_;       // oldest first
+    std::vector<Batch> freeBatches_;   // retired batches, command pools ready to reuse
+    uint64_t lastSubmittedValue_ = 0;
+    vk::DeviceSize ringHead_ = 0;      // next free byte
+    vk::DeviceSize pendingRingBegin_ = 0;
+};
@@ -0,0 +1,401 @@
+#include "AssetStreamer.h"
+#include "Mesh.h"
+#include "MeshConverter.h"
+#include "Ktx2File.h"
+#include "Texture.h"
+#include "TextureImporter.h"
+#include "core/VulkanContext.h"
+#include "renderer/UploadEngine.h"
+#include "utils/FileUtils.h"
+#include "utils/Trace.h"
+#include <algorithm>
+#include <iostream>
+#include <span>
+
+
+namespace
+{
+    // heap order, the request that should be served first ends up at the front
+    struct ServedAfter
+    {
+        template <typename T>
+        bool operator()(const T& a, const T& b) const
+        {
+            if (a.state->priority != b.state->priority) return a.state->priority > b.state->priority;
+            return a.sequence > b.sequence;
+        }
+    };
+}
+
+
+AssetStreamer::AssetStreamer(const VulkanContext& context, UploadEngine& upload_engine, vk::DeviceSize memory_budget, uint32_t worker_count)
+    : context_(context),
+      uploadEngine_(upload_engine),
+      memoryBudget_(memory_budget),
+      residentBytes_(std::make_shared<std::atomic<vk::DeviceSize>>(0)),
+      mipGenerator_(context),
+      workers_(worker_count)
+{
+    if (memoryBudget_ == 0)
+    {
+        vk::DeviceSize biggest_heap = 0;
+        for (const auto& heap : context_.getMemoryAllocator().getHeapStatistics())
+        {
+            if (heap.deviceLocal) biggest_heap = std::max(biggest_heap, heap.budget > 0 ? heap.budget : heap.heapSize);
+        }
+        memoryBudget_ = biggest_heap / 2;
+    }
+}
+
+
+AssetStreamer::~AssetStreamer()
+{
+    {
+        std::lock_guard lock(mutex_);
+        queue_.clear();
+        deferred_.clear();
+    }
+
+    // the jobs of dropped requests find an empty queue, only loads already running are finished
+    workers_.waitIdle();
+
+    // assets nobody holds anymore are released here, the GPU must be done copying into them first
+    uint64_t newest_value = 0;
+    uint64_t newest_mip_value = 0;
+    for (const auto& upload : uploading_)
+    {
+        newest_value = std::max(newest_value, upload.timelineValue);
+        newest_mip_value = std::max(newest_mip_value, upload.state->mipGenerationValue);
+    }
+    if (newest_value > 0) uploadEngine_.wait(newest_value);
+    if (newest_mip_value > 0) mipGenerator_.wait(newest_mip_value);
+    update();
+}
+
+
+AssetHandle<Mesh> AssetStreamer::requestMesh(const std::filesystem::path& path, StreamPriority priority)
+{
+    auto state = std::make_shared<AssetState>();
+    state->path = path;
+    state->priority = priority;
+
+    Loader load = [this](AssetState& state) -> std::shared_ptr<void>
+    {
+        // conversion is CPU only and happens once, it's not charged against the budget
+        std::filesystem::path mesh_path = state.path.extension() == ".obj" ? MeshConverter::ensureConverted(state.path) : state.path;
+        MappedFile file(mesh_path.string());
+
+        state.size = file.size();  // the buffers are the file minus its header, close enough to budget on
+        return reserveAndCreate<Mesh>(state, [&]() -> std::unique_ptr<Mesh>
+        {
+            file.prefetch();  // the actual disk reads, outside of the upload engine's lock
+            if (state.isCancelRequested.load(std::memory_order_relaxed)) return nullptr;
+            return std::make_unique<Mesh>(context_, uploadEngine_, file, mesh_path.string());
+        });
+    };
+
+    {
+        std::lock_guard lock(mutex_);
+        pushLocked(Request{.state = state, .load = std::move(load)});
+    }
+    workers_.submit([this]() { processNext(); });
+
+    return AssetHandle<Mesh>(state);
+}
+
+
+AssetHandle<Texture> AssetStreamer::requestTexture(const std::filesystem::path& path, StreamPriority priority, bool is_srgb)
+{
+    auto state = std::make_shared<AssetState>();
+    state->path = path;
+    state->priority = priority;
+
+    Loader load = [this, is_srgb](AssetState& state) { return loadTexture(state, is_srgb); };
+
+    {
+        std::lock_guard lock(mutex_);
+        pushLocked(Request{.state = state, .load = std::move(load)});
+    }
+    workers_.submit([this]() { processNext(); });
+
+    return AssetHandle<Texture>(state);
+}
+
+
+std::shared_ptr<void> AssetStreamer::loadTexture(AssetState& state, bool is_srgb)
+{
+    std::filesystem::path cache_path = TextureImporter::getCachePath(state.path);
+
+    auto from_levels = [&](vk::Format format, vk::Extent2D extent, const std::vector<std::span<const std::byte>>& levels)
+    {
+        state.size = 0;
+        for (const auto& level : levels) state.size += level.size();
+        return reserveAndCreate<Texture>(state, [&]() -> std::unique_ptr<Texture>
+        {
+            if (state.isCancelRequested.load(std::memory_order_relaxed)) return nullptr;
+            return std::make_unique<Texture>(context_, uploadEngine_, format, extent, levels);
+        });
+    };
+
+    // the fast path, no decoding and the levels are already in their final format.
+    // A cache built on a device with BC support is skipped (not rebuilt) on one without
+    if (TextureImporter::isCacheUpToDate(state.path, cache_path))
+    {
+        Ktx2File file(cache_path);
+        if (TextureImporter::isFormatSampleable(context_, file.getFormat()))
+        {
+            file.getFile().prefetch();
+
+            std::vector<std::span<const std::byte>> levels;
+            for (uint32_t level = 0; level < file.getLevelCount(); level++)
+            {
+                Ktx2File::Level data = file.getLevel(level);
+                levels.emplace_back(data.data, data.size);
+            }
+            return from_levels(file.getFormat(), file.getExtent(), levels);
+        }
+    }
+
+    TextureImporter::Image image = TextureImporter::decode(state.path);
+    if (state.isCancelRequested.load(std::memory_order_relaxed)) return nullptr;
+
+    vk::Format compressed_format = TextureImporter::selectCompressedFormat(context_, image.hasAlpha, is_srgb);
+    if (compressed_format != vk::Format::eUndefined)
+    {
+        std::vector<std::vector<uint8_t>> encoded_levels = TextureImporter::compress(
+            compressed_format,
+            image.extent,
+            TextureImporter::buildMipChain(image, is_srgb)
+        );
+
+        // a read only asset directory only costs the next run the compression again
+        try
+        {
+            TextureImporter::writeCache(state.path, cache_path, compressed_format, image.extent, encoded_levels);
+        }
+        catch (const std::exception& e)
+        {
+            std::cerr << "asset streamer: " << e.what() << "\n";
+        }
+
+        std::vector<std::span<const std::byte>> levels;
+        for (const auto& level : encoded_levels) levels.push_back(std::as_bytes(std::span(level)));
+        return from_levels(compressed_format, image.extent, levels);
+    }
+
+    vk::Format format = TextureImporter::getUncompressedFormat(is_srgb);
+    if (!mipGenerator_.supportsFormat(format))
+    {
+        std::vector<std::vector<uint8_t>> mip_levels = TextureImporter::buildMipChain(image, is_srgb);
+        std::vector<std::span<const std::byte>> levels;
+        for (const auto& level : mip_levels) levels.push_back(std::as_bytes(std::span(level)));
+        return from_levels(format, image.extent, levels);
+    }
+
+    // the chain adds a third on top of level 0
+    state.size = image.pixels.size() + image.pixels.size() / 3;
+    return reserveAndCreate<Texture>(state, [&]() -> std::unique_ptr<Texture>
+    {
+        auto texture = std::make_unique<Texture>(
+            context_,
+            uploadEngine_,
+            mipGenerator_,
+            format,
+            image.extent,
+            std::as_bytes(std::span(image.pixels))
+        );
+        state.mipGenerationValue = texture->getMipGenerationValue();
+        return texture;
+    });
+}
+
+
+void AssetStreamer::pushLocked(Request request)
+{
+    request.sequence = nextSequence_++;
+    queue_.push_back(std::move(request));
+    std::ranges::push_heap(queue_, ServedAfter{});
+}
+
+
+void AssetStreamer::processNext()
+{
+    Request request;
+    {
+        std::lock_guard lock(mutex_);
+        if (queue_.empty()) return;  // dropped by the destructor
+
+        // every job serves whatever is most important right now, not the request it was submitted for
+        std::ranges::pop_heap(queue_, ServedAfter{});
+        request = std::move(queue_.back());
+        queue_.pop_back();
+        loadingCount_++;
+    }
+
+    TRACE_SCOPE("AssetStreamer::load");
+    AssetState& state = *request.state;
+    AssetStatus status = AssetStatus::eCancelled;
+    std::shared_ptr<void> asset;
+
+    if (!isAbandoned(request.state))
+    {
+        state.status.store(AssetStatus::eLoading, std::memory_order_relaxed);
+
+        // exceptions can't cross the worker thread boundary, failures are reported through the status instead
+        try
+        {
+            asset = request.load(state);
+            if (asset) status = AssetStatus::eUploading;
+            else status = isAbandoned(request.state) ? AssetStatus::eCancelled : AssetStatus::eQueued;
+        }
+        catch (const std::exception& e)
+        {
+            std::cerr << "asset streamer: failed to load " << state.path.string() << ": " << e.what() << "\n";
+            status = AssetStatus::eFailed;
+        }
+    }
+
+    // submitting right away, waiting for the next flush would add a frame of latency to every asset
+    uint64_t timeline_value = status == AssetStatus::eUploading ? uploadEngine_.flush() : 0;
+
+    std::lock_guard lock(mutex_);
+    loadingCount_--;
+    if (status == AssetStatus::eUploading)
+    {
+        state.asset = std::move(asset);  // not visible to handles until update() publishes eReady
+        state.status.store(AssetStatus::eUploading, std::memory_order_relaxed);
+        uploading_.push_back(Upload{.state = std::move(request.state), .timelineValue = timeline_value});
+    }
+    else if (status == AssetStatus::eQueued)
+    {
+        state.status.store(AssetStatus::eQueued, std::memory_order_relaxed);
+        deferred_.push_back(std::move(request));
+    }
+    else
+    {
+        finish(state, status);
+    }
+}
+
+
+uint32_t AssetStreamer::update()
+{
+    uint32_t ready_count = 0;
+    uint32_t requeued_count = 0;
+    {
+        std::lock_guard lock(mutex_);
+
+        std::erase_if(uploading_, [this](const Upload& upload)
+        {
+            if (!uploadEngine_.isComplete(upload.timelineValue)) return false;
+            if (!mipGenerator_.isComplete(upload.state->mipGenerationValue)) return false;
+
+            // complete on the GPU, an abandoned asset can be released right away
+            bool is_abandoned = isAbandoned(upload.state);
+            finish(*upload.state, is_abandoned ? AssetStatus::eCancelled : AssetStatus::eReady);
+            if (!is_abandoned) ready_count++;
+            return true;
+        });
+
+        // deferred requests go back in line once released assets made room for them
+        std::vector<Request> still_deferred;
+        for (Request& request : deferred_)
+        {
+            vk::DeviceSize resident_bytes = residentBytes_->load();
+            if (isAbandoned(request.state))
+            {
+                finish(*request.state, AssetStatus::eCancelled);
+            }
+            else if (resident_bytes == 0 || resident_bytes + request.state->size <= memoryBudget_)
+            {
+                pushLocked(std::move(request));
+                requeued_count++;
+            }
+            else
+            {
+                still_deferred.push_back(std::move(request));
+            }
+        }
+        deferred_ = std::move(still_deferred);
+    }
+
+    for (uint32_t i = 0; i < requeued_count; i++)
+    {
+        workers_.submit([this]() { processNext(); });
+    }
+    return ready_count;
+}
+
+
+void AssetStreamer::waitIdle()
+{
+    while (true)
+    {
+        workers_.waitIdle();
+
+        uint64_t newest_value = 0;
+        uint64_t newest_mip_value = 0;
+        {
+            std::lock_guard lock(mutex_);
+            for (const auto& upload : uploading_)
+            {
+                newest_value = std::max(newest_value, upload.timelineValue);
+                newest_mip_value = std::max(newest_mip_value, upload.state->mipGenerationValue);
+            }
+        }
+        if (newest_value > 0) uploadEngine_.wait(newest_value);
+        if (newest_mip_value > 0) mipGenerator_.wait(newest_mip_value);
+
+        update();  // may requeue deferred requests, those need another round
+
+        std::lock_guard lock(mutex_);
+        if (queue_.empty() && uploading_.empty() && loadingCount_ == 0) return;
+    }
+}
+
+
+void AssetStreamer::finish(AssetState& state, AssetStatus status)
+{
+    if (status != AssetStatus::eReady) state.asset.reset();
+    state.status.store(status, std::memory_order_release);
+}
+
+
+bool AssetStreamer::tryReserve(vk::DeviceSize size)
+{
+    vk::DeviceSize resident_bytes = residentBytes_->load();
+    do
+    {
+        if (resident_bytes > 0 && resident_bytes + size > memoryBudget_) return false;
+    }
+    while (!residentBytes_->compare_exchange_weak(resident_bytes, resident_bytes + size));
+
+    return true;
+}
+
+
+bool AssetStreamer::isAbandoned(const std::shared_ptr<AssetState>& state)
+{
+    // the streamer's own reference is the only one left, nobody can ever look at the result
+    return state.use_count() == 1 || state->isCancelRequested.load(std::memory_order_relaxed);
+}
+
+
+// Accessor functions
+uint32_t AssetStreamer::getPendingCount() const
+{
+    std::lock_guard lock(mutex_);
+    return static_cast<uint32_t>(queue_.size() + deferred_.size() + uploading_.size()) + loadingCount_;
+}
+
+
+vk::DeviceSize AssetStreamer::getResidentBytes() const
+{
+    return residentBytes_->load();
+}
+
+
+vk::DeviceSize AssetStreamer::getMemoryBudget() const
+{
+    return memoryBudget_;
+}
@@ -0,0 +1,233 @@
+#pragma once
+
+#include <vulkan/vulkan_raii.hpp>
+#include <atomic>
+#include <cassert>
+#include <cstdint>
+#include <filesystem>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "renderer/MipGenerator.h"
+#include "utils/ThreadPool.h"
+
+// forward declaring classes
+class VulkanContext;
+class UploadEngine;
+class Mesh;
+class Texture;
+
+// Lower values are loaded first, requests of the same priority in the order they were made.
+enum class StreamPriority : uint8_t
+{
+    eCritical = 0,  // needed for the current frame, e.g. what's right in front of the camera
+    eHigh = 1,
+    eNormal = 2,
+    eLow = 3        // prefetching
+};
+
+
+enum class AssetStatus
+{
+    eQueued,      // waiting for a worker, or for the memory budget to make room
+    eLoading,     // on a worker, reading the file and recording its uploads
+    eUploading,   // copies (and mip blits) submitted, waiting for them to complete on the GPU
+    eReady,
+    eFailed,
+    eCancelled
+};
+
+
+// Shared state behind AssetHandle, type erased so the streamer's queues don't care about the asset type.
+struct AssetState
+{
+    std::filesystem::path path;
+    StreamPriority priority = StreamPriority::eNormal;
+    std::atomic<AssetStatus> status = AssetStatus::eQueued;
+    std::atomic<bool> isCancelRequested = false;
+    vk::DeviceSize size = 0;      // charged against the streamer's memory budget, set by the loader
+    uint64_t mipGenerationValue = 0;  // MipGenerator timeline value to wait for on top of the upload, 0 for none
+    std::shared_ptr<void> asset;  // written before status is published as eReady
+};
+
+
+// Shared handle to an asset that may still be streaming in. Dropping every handle cancels the request,
+// the streamer only keeps its own reference while the request is in flight.
+// isReady() never blocks, check it every frame and draw a fallback until then.
+template <typename T>
+class AssetHandle
+{
+public:
+    AssetHandle() = default;  // empty handle, isValid() returns false
+
+    bool isValid() const { return state_ != nullptr; }
+    bool isReady() const { return getStatus() == AssetStatus::eReady; }
+    bool hasFailed() const { return getStatus() == AssetStatus::eFailed; }
+
+    // acquire pairs with the release store in AssetStreamer::update(), the asset is visible once this reads eReady
+    AssetStatus getStatus() const
+    {
+        return state_ ? state_->status.load(std::memory_order_acquire) : AssetStatus::eCancelled;
+    }
+
+    // takes effect at the next step of the load, an asset that's already ready stays ready
+    void cancel() const
+    {
+        if (state_) state_->isCancelRequested.store(true, std::memory_order_relaxed);
+    }
+
+    auto getPath() const -> const std::filesystem::path&
+    {
+        assert(state_);
+        return state_->path;
+    }
+
+    // only valid once isReady() returns true
+    auto get() const -> const T&
+    {
+        assert(isReady());
+        return *static_cast<const T*>(state_->asset.get());
+    }
+
+private:
+    friend class AssetStreamer;
+
+    explicit AssetHandle(std::shared_ptr<AssetState> state): state_(std::move(state))
+    {
+    }
+
+    std::shared_ptr<AssetState> state_;
+};
+
+
+// Loads assets on a pool of I/O and decode workers and uploads them through the UploadEngine, so the frame
+// loop never waits on the disk. Requests are served by priority. An asset is only published (eReady) by
+// update() once its transfer completed on the GPU, a ready asset can be drawn without any extra wait.
+//
+// Streamed assets count against a memory budget (device bytes), requests that don't fit wait in the
+// queue until released assets make room. An asset that's bigger than the whole budget still loads once
+// nothing else is resident, rather than never.
+//
+// Call update() once per frame from the thread that owns the frame loop.
+// Must outlive every request still in flight, streamed assets may outlive it.
+// Thread safe.
+class AssetStreamer
+{
+public:
+    // memory_budget 0 takes half of the biggest device local heap (its VK_EXT_memory_budget budget when available)
+    AssetStreamer(const VulkanContext& context, UploadEngine& upload_engine, vk::DeviceSize memory_budget = 0, uint32_t worker_count = 0);
+    ~AssetStreamer();  // drops everything still queued and waits for the uploads of in flight assets
+
+    // deleting copy constructors
+    AssetStreamer(const AssetStreamer&) = delete;
+    AssetStreamer& operator=(const AssetStreamer&) = delete;
+
+    // .obj files go through MeshConverter::ensureConverted() on the worker first, anything else is read as a .mesh
+    auto requestMesh(const std::filesystem::path& path, StreamPriority priority = StreamPriority::eNormal) -> AssetHandle<Mesh>;
+
+    // images go through TextureImporter on the worker, from the KTX2 cache next to them when it's up to date.
+    // is_srgb for color data, false for normal maps, masks and the like
+    auto requestTexture(
+        const std::filesystem::path& path,
+        StreamPriority priority = StreamPriority::eNormal,
+        bool is_srgb = true
+    ) -> AssetHandle<Texture>;
+
+    // publishes assets whose uploads completed and requeues budget deferred requests, never blocks.
+    // returns how many became ready, an on demand frame loop redraws when that's not 0 (FrameLoop::markDirty())
+    uint32_t update();
+
+    // blocks until every request is ready, failed, cancelled or deferred on a budget that has no room left.
+    // For loading screens and tests, not the frame loop
+    void waitIdle();
+
+    uint32_t getPendingCount() const;  // queued, loading and uploading
+    vk::DeviceSize getResidentBytes() const;
+    vk::DeviceSize getMemoryBudget() const;
+
+private:
+    // creates the asset and records its uploads, returns null when the asset doesn't fit the budget (state.size)
+    // or the request was cancelled on the way
+    using Loader = std::function<std::shared_ptr<void>(AssetState& state)>;
+
+    struct Request
+    {
+        std::shared_ptr<AssetState> state;
+        Loader load;
+        uint64_t sequence = 0;  // ties within a priority go to the oldest request
+    };
+
+    struct Upload
+    {
+        std::shared_ptr<AssetState> state;
+        uint64_t timelineValue = 0;
+    };
+
+    // resident bytes live in their own shared block, asset deleters may run after the streamer is gone
+    using ResidentCounter = std::shared_ptr<std::atomic<vk::DeviceSize>>;
+
+    void pushLocked(Request request);  // into the heap, the caller submits one processNext() job per request
+    void processNext();  // one worker job, serves the highest priority request
+    static void finish(AssetState& state, AssetStatus status);
+
+    // reserves size bytes of the budget, false when they don't fit (and something else is resident)
+    bool tryReserve(vk::DeviceSize size);
+
+    // the asset releases its share of the budget when the last reference to it dies
+    template <typename T>
+    auto track(std::unique_ptr<T> asset, vk::DeviceSize size) -> std::shared_ptr<void>
+    {
+        return std::shared_ptr<T>(asset.release(), [resident_bytes = residentBytes_, size](T* released)
+        {
+            delete released;
+            resident_bytes->fetch_sub(size);
+        });
+    }
+
+    // reserves state.size, then creates the asset unless the request was cancelled in the meantime.
+    // Null when it doesn't fit or was cancelled, the reservation is given back on every path but success
+    template <typename T, typename Create>
+    auto reserveAndCreate(AssetState& state, Create&& create) -> std::shared_ptr<void>
+    {
+        if (!tryReserve(state.size)) return nullptr;
+
+        std::unique_ptr<T> asset;
+        try
+        {
+            asset = create();
+        }
+        catch (...)
+        {
+            residentBytes_->fetch_sub(state.size);
+            throw;
+        }
+
+        if (!asset)
+        {
+            residentBytes_->fetch_sub(state.size);
+            return nullptr;
+        }
+        return track(std::move(asset), state.size);
+    }
+
+    auto loadTexture(AssetState& state, bool is_srgb) -> std::shared_ptr<void>;
+
+    static bool isAbandoned(const std::shared_ptr<AssetState>& state);  // no handle left, or cancel() was called
+
+    const VulkanContext& context_;
+    UploadEngine& uploadEngine_;
+    vk::DeviceSize memoryBudget_ = 0;
+    ResidentCounter residentBytes_;
+
+    mutable std::mutex mutex_;
+    std::vector<Request> queue_;        // binary heap, highest priority at the front
+    std::vector<Request> deferred_;     // waiting for the budget
+    std::vector<Upload> uploading_;
+    uint64_t nextSequence_ = 0;
+    uint32_t loadingCount_ = 0;
+
+    MipGenerator mipGenerator_;  // textures without a cached mip chain
+    ThreadPool workers_;  // declared last, workers are joined before anything they use is destroyed
+};
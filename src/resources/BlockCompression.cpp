@@ -0,0 +1,192 @@
+#include "BlockCompression.h"
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+
+
+namespace
+{
+    struct Block
+    {
+        uint8_t texels[16][4];  // row major RGBA
+    };
+
+    Block loadBlock(const uint8_t* rgba, uint32_t width, uint32_t height, uint32_t block_x, uint32_t block_y)
+    {
+        Block block;
+        for (uint32_t y = 0; y < 4; y++)
+        {
+            for (uint32_t x = 0; x < 4; x++)
+            {
+                uint32_t source_x = std::min(block_x * 4 + x, width - 1);
+                uint32_t source_y = std::min(block_y * 4 + y, height - 1);
+                std::memcpy(block.texels[y * 4 + x], rgba + (static_cast<size_t>(source_y) * width + source_x) * 4, 4);
+            }
+        }
+        return block;
+    }
+
+    uint16_t packRgb565(const uint8_t* color)
+    {
+        uint32_t r = (color[0] * 31u + 127u) / 255u;
+        uint32_t g = (color[1] * 63u + 127u) / 255u;
+        uint32_t b = (color[2] * 31u + 127u) / 255u;
+        return static_cast<uint16_t>((r << 11) | (g << 5) | b);
+    }
+
+    void unpackRgb565(uint16_t packed, int* color)
+    {
+        int r = (packed >> 11) & 31;
+        int g = (packed >> 5) & 63;
+        int b = packed & 31;
+        color[0] = (r << 3) | (r >> 2);
+        color[1] = (g << 2) | (g >> 4);
+        color[2] = (b << 3) | (b >> 2);
+    }
+
+    void writeColorBlock(const Block& block, uint8_t* output)
+    {
+        uint8_t min_color[3] = {255, 255, 255};
+        uint8_t max_color[3] = {0, 0, 0};
+        for (const auto& texel : block.texels)
+        {
+            for (int channel = 0; channel < 3; channel++)
+            {
+                min_color[channel] = std::min(min_color[channel], texel[channel]);
+                max_color[channel] = std::max(max_color[channel], texel[channel]);
+            }
+        }
+
+        // pulling the endpoints in by 1/16 of the range, the bounding box corners are rarely the best fit
+        for (int channel = 0; channel < 3; channel++)
+        {
+            int inset = (max_color[channel] - min_color[channel]) >> 4;
+            min_color[channel] = static_cast<uint8_t>(std::min(255, min_color[channel] + inset));
+            max_color[channel] = static_cast<uint8_t>(std::max(0, max_color[channel] - inset));
+        }
+
+        uint16_t color0 = packRgb565(max_color);
+        uint16_t color1 = packRgb565(min_color);
+        uint32_t indices = 0;
+
+        // color0 > color1 selects the four color mode, equal endpoints leave every index at 0
+        if (color0 < color1) std::swap(color0, color1);
+        if (color0 != color1)
+        {
+            int palette[4][3];
+            unpackRgb565(color0, palette[0]);
+            unpackRgb565(color1, palette[1]);
+            for (int channel = 0; channel < 3; channel++)
+            {
+                palette[2][channel] = (2 * palette[0][channel] + palette[1][channel]) / 3;
+                palette[3][channel] = (palette[0][channel] + 2 * palette[1][channel]) / 3;
+            }
+
+            for (uint32_t i = 0; i < 16; i++)
+            {
+                uint32_t best_index = 0;
+                int best_distance = INT32_MAX;
+                for (uint32_t candidate = 0; candidate < 4; candidate++)
+                {
+                    int distance = 0;
+                    for (int channel = 0; channel < 3; channel++)
+                    {
+                        int delta = block.texels[i][channel] - palette[candidate][channel];
+                        distance += delta * delta;
+                    }
+                    if (distance < best_distance)
+                    {
+                        best_distance = distance;
+                        best_index = candidate;
+                    }
+                }
+                indices |= best_index << (i * 2);
+            }
+        }
+
+        // little endian on disk and on the GPU
+        output[0] = static_cast<uint8_t>(color0);
+        output[1] = static_cast<uint8_t>(color0 >> 8);
+        output[2] = static_cast<uint8_t>(color1);
+        output[3] = static_cast<uint8_t>(color1 >> 8);
+        for (int byte = 0; byte < 4; byte++) output[4 + byte] = static_cast<uint8_t>(indices >> (byte * 8));
+    }
+
+    void writeAlphaBlock(const Block& block, uint8_t* output)
+    {
+        uint8_t min_alpha = 255;
+        uint8_t max_alpha = 0;
+        for (const auto& texel : block.texels)
+        {
+            min_alpha = std::min(min_alpha, texel[3]);
+            max_alpha = std::max(max_alpha, texel[3]);
+        }
+
+        // alpha0 > alpha1 selects the eight value mode, the palette is interpolated in sevenths
+        int palette[8] = {max_alpha, min_alpha};
+        for (int i = 1; i < 7; i++) palette[i + 1] = ((7 - i) * max_alpha + i * min_alpha) / 7;
+
+        uint64_t indices = 0;
+        if (max_alpha != min_alpha)
+        {
+            for (uint32_t i = 0; i < 16; i++)
+            {
+                uint64_t best_index = 0;
+                int best_distance = INT32_MAX;
+                for (uint32_t candidate = 0; candidate < 8; candidate++)
+                {
+                    int distance = std::abs(block.texels[i][3] - palette[candidate]);
+                    if (distance < best_distance)
+                    {
+                        best_distance = distance;
+                        best_index = candidate;
+                    }
+                }
+                indices |= best_index << (i * 3);
+            }
+        }
+
+        output[0] = max_alpha;
+        output[1] = min_alpha;
+        for (int byte = 0; byte < 6; byte++) output[2 + byte] = static_cast<uint8_t>(indices >> (byte * 8));
+    }
+}
+
+
+std::vector<uint8_t> compressBc1(const uint8_t* rgba, uint32_t width, uint32_t height)
+{
+    uint32_t blocks_x = (width + 3) / 4;
+    uint32_t blocks_y = (height + 3) / 4;
+    std::vector<uint8_t> output(static_cast<size_t>(blocks_x) * blocks_y * 8);
+
+    for (uint32_t block_y = 0; block_y < blocks_y; block_y++)
+    {
+        for (uint32_t block_x = 0; block_x < blocks_x; block_x++)
+        {
+            Block block = loadBlock(rgba, width, height, block_x, block_y);
+            writeColorBlock(block, output.data() + (static_cast<size_t>(block_y) * blocks_x + block_x) * 8);
+        }
+    }
+    return output;
+}
+
+
+std::vector<uint8_t> compressBc3(const uint8_t* rgba, uint32_t width, uint32_t height)
+{
+    uint32_t blocks_x = (width + 3) / 4;
+    uint32_t blocks_y = (height + 3) / 4;
+    std::vector<uint8_t> output(static_cast<size_t>(blocks_x) * blocks_y * 16);
+
+    for (uint32_t block_y = 0; block_y < blocks_y; block_y++)
+    {
+        for (uint32_t block_x = 0; block_x < blocks_x; block_x++)
+        {
+            Block block = loadBlock(rgba, width, height, block_x, block_y);
+            uint8_t* block_output = output.data() + (static_cast<size_t>(block_y) * blocks_x + block_x) * 16;
+            writeAlphaBlock(block, block_output);
+            writeColorBlock(block, block_output + 8);
+        }
+    }
+    return output;
+}
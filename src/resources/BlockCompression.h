@@ -0,0 +1,14 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+// CPU block compression of RGBA8 images, used to build the texture cache. Endpoints come from the inset
+// bounding box of each 4x4 block (van Waveren, "Real-Time DXT Compression"), fast enough to run on first
+// load. Offline encoders search harder and look better. Sizes that aren't a multiple of 4 repeat the edge texels.
+
+// 8 bytes per block, alpha is ignored
+auto compressBc1(const uint8_t* rgba, uint32_t width, uint32_t height) -> std::vector<uint8_t>;
+
+// 16 bytes per block, interpolated alpha followed by a BC1 color block
+auto compressBc3(const uint8_t* rgba, uint32_t width, uint32_t height) -> std::vector<uint8_t>;
@@ -0,0 +1,369 @@
+#include "Ktx2File.h"
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+
+
+namespace
+{
+    constexpr std::array<uint8_t, 12> KTX2_IDENTIFIER = {0xAB, 'K', 'T', 'X', ' ', '2', '0', 0xBB, '\r', '\n', 0x1A, '\n'};
+
+    // everything after the identifier up to the level index, little endian like the rest of the file.
+    // The 64 bit fields sit at file offset 64 but struct offset 52, hence the packing
+#pragma pack(push, 4)
+    struct Ktx2Header
+    {
+        uint32_t vkFormat = 0;
+        uint32_t typeSize = 1;
+        uint32_t pixelWidth = 0;
+        uint32_t pixelHeight = 0;
+        uint32_t pixelDepth = 0;  // 0 for 2D images
+        uint32_t layerCount = 0;  // 0 when it's not an array
+        uint32_t faceCount = 1;
+        uint32_t levelCount = 0;
+        uint32_t supercompressionScheme = 0;
+        uint32_t dfdByteOffset = 0;
+        uint32_t dfdByteLength = 0;
+        uint32_t kvdByteOffset = 0;
+        uint32_t kvdByteLength = 0;
+        uint64_t sgdByteOffset = 0;
+        uint64_t sgdByteLength = 0;
+    };
+#pragma pack(pop)
+
+    static_assert(sizeof(Ktx2Header) == 68);
+
+    struct Ktx2LevelIndex
+    {
+        uint64_t byteOffset = 0;
+        uint64_t byteLength = 0;
+        uint64_t uncompressedByteLength = 0;
+    };
+
+    constexpr uint64_t LEVEL_INDEX_OFFSET = KTX2_IDENTIFIER.size() + sizeof(Ktx2Header);
+    constexpr uint32_t MAX_LEVEL_COUNT = 32;
+
+    // khr_df.h values, only the ones our formats need
+    constexpr uint8_t KHR_DF_MODEL_RGBSDA = 1;
+    constexpr uint8_t KHR_DF_MODEL_BC1A = 128;
+    constexpr uint8_t KHR_DF_MODEL_BC3 = 130;
+    constexpr uint8_t KHR_DF_PRIMARIES_BT709 = 1;
+    constexpr uint8_t KHR_DF_TRANSFER_LINEAR = 1;
+    constexpr uint8_t KHR_DF_TRANSFER_SRGB = 2;
+    constexpr uint8_t KHR_DF_CHANNEL_ALPHA = 15;
+    constexpr uint8_t KHR_DF_SAMPLE_DATATYPE_LINEAR = 0x10;
+
+    struct FormatInfo
+    {
+        uint32_t blockBytes = 0;   // bytes per texel, or per 4x4 block when compressed
+        bool isCompressed = false;
+        bool isSrgb = false;
+    };
+
+    FormatInfo getFormatInfo(vk::Format format)
+    {
+        switch (format)
+        {
+            case vk::Format::eR8G8B8A8Unorm: return {.blockBytes = 4, .isCompressed = false, .isSrgb = false};
+            case vk::Format::eR8G8B8A8Srgb: return {.blockBytes = 4, .isCompressed = false, .isSrgb = true};
+            case vk::Format::eBc1RgbUnormBlock: return {.blockBytes = 8, .isCompressed = true, .isSrgb = false};
+            case vk::Format::eBc1RgbSrgbBlock: return {.blockBytes = 8, .isCompressed = true, .isSrgb = true};
+            case vk::Format::eBc3UnormBlock: return {.blockBytes = 16, .isCompressed = true, .isSrgb = false};
+            case vk::Format::eBc3SrgbBlock: return {.blockBytes = 16, .isCompressed = true, .isSrgb = true};
+            default: return {};
+        }
+    }
+
+    uint64_t getLevelSize(const FormatInfo& info, vk::Extent2D extent, uint32_t level)
+    {
+        uint64_t width = std::max(1u, extent.width >> level);
+        uint64_t height = std::max(1u, extent.height >> level);
+        if (info.isCompressed) return ((width + 3) / 4) * ((height + 3) / 4) * info.blockBytes;
+        return width * height * info.blockBytes;
+    }
+
+    uint64_t alignUp(uint64_t value, uint64_t alignment)
+    {
+        return (value + alignment - 1) / alignment * alignment;  // block sizes aren't all powers of two in general
+    }
+
+    // one basic descriptor block, see the Khronos Data Format Specification
+    std::vector<uint32_t> buildDataFormatDescriptor(vk::Format format)
+    {
+        struct Sample
+        {
+            uint32_t bitOffset = 0;
+            uint32_t bitLength = 0;  // minus one, as stored
+            uint8_t channelType = 0;
+            uint32_t upper = 0;
+        };
+
+        FormatInfo info = getFormatInfo(format);
+        uint8_t alpha_channel = KHR_DF_CHANNEL_ALPHA | (info.isSrgb ? KHR_DF_SAMPLE_DATATYPE_LINEAR : 0);
+        uint8_t color_model = KHR_DF_MODEL_RGBSDA;
+        uint32_t block_dimensions = 0;  // each dimension minus one
+        std::vector<Sample> samples;
+
+        if (format == vk::Format::eBc1RgbUnormBlock || format == vk::Format::eBc1RgbSrgbBlock)
+        {
+            color_model = KHR_DF_MODEL_BC1A;
+            block_dimensions = 3 | (3 << 8);
+            samples = {{.bitOffset = 0, .bitLength = 63, .channelType = 0, .upper = UINT32_MAX}};
+        }
+        else if (format == vk::Format::eBc3UnormBlock || format == vk::Format::eBc3SrgbBlock)
+        {
+            color_model = KHR_DF_MODEL_BC3;
+            block_dimensions = 3 | (3 << 8);
+            samples = {
+                {.bitOffset = 0, .bitLength = 63, .channelType = alpha_channel, .upper = UINT32_MAX},
+                {.bitOffset = 64, .bitLength = 63, .channelType = 0, .upper = UINT32_MAX}
+            };
+        }
+        else
+        {
+            samples = {
+                {.bitOffset = 0, .bitLength = 7, .channelType = 0, .upper = 255},
+                {.bitOffset = 8, .bitLength = 7, .channelType = 1, .upper = 255},
+                {.bitOffset = 16, .bitLength = 7, .channelType = 2, .upper = 255},
+                {.bitOffset = 24, .bitLength = 7, .channelType = alpha_channel, .upper = 255}
+            };
+        }
+
+        uint32_t block_size = 24 + 16 * static_cast<uint32_t>(samples.size());
+        uint8_t transfer_function = info.isSrgb ? KHR_DF_TRANSFER_SRGB : KHR_DF_TRANSFER_LINEAR;
+
+        std::vector<uint32_t> words = {
+            4 + block_size,                 // dfdTotalSize
+            0,                              // vendorId 0 (Khronos), descriptorType 0 (basic)
+            2u | (block_size << 16),        // versionNumber 2
+            uint32_t{color_model} | (uint32_t{KHR_DF_PRIMARIES_BT709} << 8) | (uint32_t{transfer_function} << 16),  // flags 0, straight alpha
+            block_dimensions,
+            info.blockBytes,                // bytesPlane0
+            0                               // bytesPlane4-7
+        };
+        for (const auto& sample : samples)
+        {
+            words.push_back(sample.bitOffset | (sample.bitLength << 16) | (uint32_t{sample.channelType} << 24));
+            words.push_back(0);             // sample position
+            words.push_back(0);             // sampleLower
+            words.push_back(sample.upper);
+        }
+        return words;
+    }
+
+    std::vector<uint8_t> buildKeyValueData(std::vector<std::pair<std::string, std::string>> key_values)
+    {
+        std::ranges::sort(key_values);
+
+        std::vector<uint8_t> data;
+        for (const auto& [key, value] : key_values)
+        {
+            // key and value are both NUL terminated, every entry is padded to 4 bytes
+            uint32_t length = static_cast<uint32_t>(key.size() + 1 + value.size() + 1);
+            const auto* length_bytes = reinterpret_cast<const uint8_t*>(&length);
+            data.insert(data.end(), length_bytes, length_bytes + sizeof(length));
+            data.insert(data.end(), key.begin(), key.end());
+            data.push_back(0);
+            data.insert(data.end(), value.begin(), value.end());
+            data.push_back(0);
+            data.resize(alignUp(data.size(), 4), 0);
+        }
+        return data;
+    }
+}
+
+
+Ktx2File::Ktx2File(const std::filesystem::path& file_path): file_(file_path.string())
+{
+    const std::string name = file_path.string();
+    if (file_.size() < LEVEL_INDEX_OFFSET || std::memcmp(file_.data(), KTX2_IDENTIFIER.data(), KTX2_IDENTIFIER.size()) != 0)
+    {
+        throw std::runtime_error("not a KTX2 file: " + name);
+    }
+
+    // the mapping is page aligned but the header starts at byte 12, copying instead of casting
+    Ktx2Header header;
+    std::memcpy(&header, file_.data() + KTX2_IDENTIFIER.size(), sizeof(header));
+
+    format_ = static_cast<vk::Format>(header.vkFormat);
+    extent_ = vk::Extent2D{header.pixelWidth, header.pixelHeight};
+    bool is_supported = isFormatSupported(format_)
+        && header.pixelWidth > 0 && header.pixelHeight > 0 && header.pixelDepth == 0
+        && header.layerCount == 0 && header.faceCount == 1 && header.supercompressionScheme == 0
+        && header.levelCount > 0 && header.levelCount <= MAX_LEVEL_COUNT
+        && LEVEL_INDEX_OFFSET + header.levelCount * sizeof(Ktx2LevelIndex) <= file_.size();
+    if (!is_supported)
+    {
+        throw std::runtime_error("KTX2 file outside the supported subset (2D, unsupercompressed, full mip chain): " + name);
+    }
+
+    FormatInfo info = getFormatInfo(format_);
+    for (uint32_t level = 0; level < header.levelCount; level++)
+    {
+        Ktx2LevelIndex level_index;
+        std::memcpy(&level_index, file_.data() + LEVEL_INDEX_OFFSET + level * sizeof(level_index), sizeof(level_index));
+        // offset and length are checked on their own, their sum can wrap around on a corrupt file
+        bool is_in_file = level_index.byteOffset <= file_.size() && level_index.byteLength <= file_.size() - level_index.byteOffset;
+        if (!is_in_file || level_index.byteLength != getLevelSize(info, extent_, level))
+        {
+            throw std::runtime_error("KTX2 file is truncated or corrupt: " + name);
+        }
+        levels_.push_back(Level{.data = file_.data() + level_index.byteOffset, .size = level_index.byteLength});
+    }
+
+    // key/value data, entries that run past the end are ignored rather than trusted
+    if (uint64_t{header.kvdByteOffset} + header.kvdByteLength <= file_.size())
+    {
+        const std::byte* cursor = file_.data() + header.kvdByteOffset;
+        const std::byte* end = cursor + header.kvdByteLength;
+        while (cursor + sizeof(uint32_t) <= end)
+        {
+            uint32_t length = 0;
+            std::memcpy(&length, cursor, sizeof(length));
+            cursor += sizeof(length);
+            if (length > static_cast<size_t>(end - cursor)) break;
+
+            std::string entry(reinterpret_cast<const char*>(cursor), length);
+            size_t separator = entry.find('\0');
+            if (separator != std::string::npos)
+            {
+                std::string value = entry.substr(separator + 1);
+                if (!value.empty() && value.back() == '\0') value.pop_back();
+                keyValues_.emplace_back(entry.substr(0, separator), std::move(value));
+            }
+            cursor += alignUp(length, 4);
+        }
+    }
+}
+
+
+void Ktx2File::write(
+    const std::filesystem::path& file_path,
+    vk::Format format,
+    vk::Extent2D extent,
+    const std::vector<std::vector<uint8_t>>& levels,
+    std::vector<std::pair<std::string, std::string>> key_values
+)
+{
+    FormatInfo info = getFormatInfo(format);
+    if (!isFormatSupported(format) || levels.empty() || levels.size() > MAX_LEVEL_COUNT)
+    {
+        throw std::runtime_error("can't write " + vk::to_string(format) + " with " + std::to_string(levels.size()) + " levels to KTX2");
+    }
+
+    std::vector<uint32_t> data_format_descriptor = buildDataFormatDescriptor(format);
+    std::vector<uint8_t> key_value_data = buildKeyValueData(std::move(key_values));
+
+    auto level_count = static_cast<uint32_t>(levels.size());
+    Ktx2Header header{
+        .vkFormat = static_cast<uint32_t>(format),
+        .pixelWidth = extent.width,
+        .pixelHeight = extent.height,
+        .levelCount = level_count
+    };
+    header.dfdByteOffset = static_cast<uint32_t>(LEVEL_INDEX_OFFSET + level_count * sizeof(Ktx2LevelIndex));
+    header.dfdByteLength = static_cast<uint32_t>(data_format_descriptor.size() * sizeof(uint32_t));
+    header.kvdByteOffset = key_value_data.empty() ? 0 : header.dfdByteOffset + header.dfdByteLength;
+    header.kvdByteLength = static_cast<uint32_t>(key_value_data.size());
+
+    // the spec wants the smallest level first in the file, each aligned to lcm(4, block size)
+    uint64_t level_alignment = info.blockBytes % 4 == 0 ? info.blockBytes : 4;
+    uint64_t offset = uint64_t{header.dfdByteOffset} + header.dfdByteLength + header.kvdByteLength;
+    std::vector<Ktx2LevelIndex> level_indices(level_count);
+    for (uint32_t level = level_count; level-- > 0;)
+    {
+        if (levels[level].size() != getLevelSize(info, extent, level))
+        {
+            throw std::runtime_error("KTX2 level " + std::to_string(level) + " has the wrong size for its extent");
+        }
+
+        offset = alignUp(offset, level_alignment);
+        level_indices[level] = {.byteOffset = offset, .byteLength = levels[level].size(), .uncompressedByteLength = levels[level].size()};
+        offset += levels[level].size();
+    }
+
+    std::filesystem::path temporary_path = file_path;
+    temporary_path += ".tmp";
+
+    {
+        std::ofstream file(temporary_path, std::ios::binary | std::ios::trunc);
+        if (!file.is_open())
+        {
+            throw std::runtime_error("failed to open " + temporary_path.string() + " for writing");
+        }
+
+        auto write_bytes = [&file](const void* data, uint64_t size)
+        {
+            file.write(static_cast<const char*>(data), static_cast<std::streamsize>(size));
+        };
+
+        write_bytes(KTX2_IDENTIFIER.data(), KTX2_IDENTIFIER.size());
+        write_bytes(&header, sizeof(header));
+        write_bytes(level_indices.data(), level_indices.size() * sizeof(Ktx2LevelIndex));
+        write_bytes(data_format_descriptor.data(), header.dfdByteLength);
+        write_bytes(key_value_data.data(), key_value_data.size());
+
+        uint64_t written = uint64_t{header.dfdByteOffset} + header.dfdByteLength + header.kvdByteLength;
+        const uint8_t padding[16] = {};
+        for (uint32_t level = level_count; level-- > 0;)
+        {
+            write_bytes(padding, level_indices[level].byteOffset - written);
+            write_bytes(levels[level].data(), levels[level].size());
+            written = level_indices[level].byteOffset + levels[level].size();
+        }
+
+        if (!file)
+        {
+            throw std::runtime_error("failed to write " + temporary_path.string());
+        }
+    }  // closing the file before renaming it
+
+    // a reader never sees a half written file, rename replaces the destination in one step
+    std::filesystem::rename(temporary_path, file_path);
+}
+
+
+bool Ktx2File::isFormatSupported(vk::Format format)
+{
+    return getFormatInfo(format).blockBytes != 0;
+}
+
+
+// Accessor functions
+vk::Format Ktx2File::getFormat() const
+{
+    return format_;
+}
+
+
+vk::Extent2D Ktx2File::getExtent() const
+{
+    return extent_;
+}
+
+
+uint32_t Ktx2File::getLevelCount() const
+{
+    return static_cast<uint32_t>(levels_.size());
+}
+
+
+Ktx2File::Level Ktx2File::getLevel(uint32_t level) const
+{
+    return levels_.at(level);
+}
+
+
+std::string Ktx2File::getValue(const std::string& key) const
+{
+    auto it = std::ranges::find(keyValues_, key, &std::pair<std::string, std::string>::first);
+    return it != keyValues_.end() ? it->second : std::string();
+}
+
+
+const MappedFile& Ktx2File::getFile() const
+{
+    return file_;
+}
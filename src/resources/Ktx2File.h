@@ -0,0 +1,58 @@
+#pragma once
+
+#include <vulkan/vulkan_raii.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "utils/FileUtils.h"
+
+// Read side of the KTX2 subset the texture cache writes: one 2D image, no array layers, cube faces or
+// supercompression, every mip level stored. Level data can go to vkCmdCopyBufferToImage as is.
+// Throws std::runtime_error on files outside that subset.
+// Not thread safe.
+class Ktx2File
+{
+public:
+    struct Level
+    {
+        const std::byte* data = nullptr;  // points into the mapping
+        uint64_t size = 0;
+    };
+
+    explicit Ktx2File(const std::filesystem::path& file_path);
+
+    // deleting copy constructors
+    Ktx2File(const Ktx2File&) = delete;
+    Ktx2File& operator=(const Ktx2File&) = delete;
+
+    // levels[0] is the full resolution image, key_values end up in the key/value data sorted by key.
+    // Written next to file_path first and renamed over it, throws std::runtime_error on failure
+    static void write(
+        const std::filesystem::path& file_path,
+        vk::Format format,
+        vk::Extent2D extent,
+        const std::vector<std::vector<uint8_t>>& levels,
+        std::vector<std::pair<std::string, std::string>> key_values = {}
+    );
+
+    static bool isFormatSupported(vk::Format format);  // what write() can describe: RGBA8, BC1 RGB and BC3, unorm or srgb
+
+    // accessor functions
+    vk::Format getFormat() const;
+    vk::Extent2D getExtent() const;
+    uint32_t getLevelCount() const;
+    auto getLevel(uint32_t level) const -> Level;
+    auto getValue(const std::string& key) const -> std::string;  // empty when the key is missing
+    auto getFile() const -> const MappedFile&;
+
+private:
+    MappedFile file_;
+    vk::Format format_ = vk::Format::eUndefined;
+    vk::Extent2D extent_;
+    std::vector<Level> levels_;
+    std::vector<std::pair<std::string, std::string>> keyValues_;
+};
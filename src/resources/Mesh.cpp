@@ -0,0 +1,227 @@
+#include "Mesh.h"
+#include "MeshFormat.h"
+#include "core/VulkanContext.h"
+#include "renderer/UploadEngine.h"
+#include "utils/FileUtils.h"
+#include "utils/Trace.h"
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+
+namespace
+{
+    // shaders/mesh.slang fetches vertices through the bindless heap without a bounds check, an index past
+    // the last vertex would read outside the buffer
+    template <typename Index>
+    bool areIndicesInRange(const std::byte* data, uint32_t index_count, uint32_t vertex_count)
+    {
+        for (uint32_t i = 0; i < index_count; i++)
+        {
+            Index index;
+            std::memcpy(&index, data + uint64_t{i} * sizeof(Index), sizeof(Index));  // the offset isn't checked for alignment
+            if (index >= vertex_count) return false;
+        }
+        return true;
+    }
+}
+
+
+Mesh::Mesh(const VulkanContext& context, UploadEngine& upload_engine, const std::filesystem::path& mesh_path)
+    : Mesh(context, upload_engine, MappedFile(mesh_path.string()), mesh_path.string())
+{
+}
+
+
+Mesh::Mesh(const VulkanContext& context, UploadEngine& upload_engine, const MappedFile& file, const std::string& name)
+    : context_(context)
+{
+    TRACE_SCOPE("Mesh::load");
+
+    MeshFileHeader header{};
+    if (file.size() < sizeof(header))
+    {
+        throw std::runtime_error("mesh file is truncated: " + name);
+    }
+    std::memcpy(&header, file.data(), sizeof(header));
+
+    if (header.magic != MESH_FILE_MAGIC || header.version != MESH_FILE_VERSION)
+    {
+        throw std::runtime_error("not a version " + std::to_string(MESH_FILE_VERSION) + " mesh file: " + name);
+    }
+
+    uint64_t index_stride = header.indexType == MeshIndexType::eUint16 ? sizeof(uint16_t) : sizeof(uint32_t);
+    bool is_consistent = header.vertexSize == uint64_t{header.vertexCount} * sizeof(PackedVertex)
+        && header.indexSize == uint64_t{header.indexCount} * index_stride
+        && header.vertexOffset <= file.size() && header.vertexSize <= file.size() - header.vertexOffset
+        && header.indexOffset <= file.size() && header.indexSize <= file.size() - header.indexOffset
+        && header.vertexCount > 0 && header.indexCount > 0;
+    if (!is_consistent)
+    {
+        throw std::runtime_error("mesh file is truncated or corrupt: " + name);
+    }
+
+    // the only pass over the data before it's copied, the pages are faulted in for the upload anyway
+    const std::byte* index_data = file.data() + header.indexOffset;
+    bool are_indices_in_range = header.indexType == MeshIndexType::eUint16
+        ? areIndicesInRange<uint16_t>(index_data, header.indexCount, header.vertexCount)
+        : areIndicesInRange<uint32_t>(index_data, header.indexCount, header.vertexCount);
+    if (!are_indices_in_range)
+    {
+        throw std::runtime_error("mesh file has an index past its " + std::to_string(header.vertexCount) + " vertices: " + name);
+    }
+
+    indexType_ = header.indexType == MeshIndexType::eUint16 ? vk::IndexType::eUint16 : vk::IndexType::eUint32;
+    vertexCount_ = header.vertexCount;
+    indexCount_ = header.indexCount;
+    boundsMin_ = glm::vec3(header.boundsMin[0], header.boundsMin[1], header.boundsMin[2]);
+    boundsMax_ = glm::vec3(header.boundsMax[0], header.boundsMax[1], header.boundsMax[2]);
+
+    // storage usage as well, so compute passes can fetch the same buffers
+    vertexBuffer_ = createBuffer(
+        upload_engine,
+        header.vertexSize,
+        vk::BufferUsageFlagBits::eVertexBuffer | vk::BufferUsageFlagBits::eStorageBuffer,
+        vertexAllocation_
+    );
+    indexBuffer_ = createBuffer(
+        upload_engine,
+        header.indexSize,
+        vk::BufferUsageFlagBits::eIndexBuffer | vk::BufferUsageFlagBits::eStorageBuffer,
+        indexAllocation_
+    );
+
+    // straight from the mapping into the ring, the pages are only read once by the memcpy
+    auto stream = [&](vk::Buffer dst_buffer, uint64_t file_offset, uint64_t size)
+    {
+        for (uint64_t offset = 0; offset < size; offset += UPLOAD_CHUNK_SIZE)
+        {
+            uint64_t chunk_size = std::min<uint64_t>(UPLOAD_CHUNK_SIZE, size - offset);
+            uploadValue_ = upload_engine.uploadBuffer(dst_buffer, offset, file.data() + file_offset + offset, chunk_size);
+        }
+    };
+    stream(*vertexBuffer_, header.vertexOffset, header.vertexSize);
+    stream(*indexBuffer_, header.indexOffset, header.indexSize);
+
+    BindlessHeap& bindless_heap = context_.getBindlessHeap();
+    vertexBufferHandle_ = bindless_heap.registerStorageBuffer(*vertexBuffer_);
+    indexBufferHandle_ = bindless_heap.registerStorageBuffer(*indexBuffer_);
+}
+
+
+Mesh::~Mesh()
+{
+    BindlessHeap& bindless_heap = context_.getBindlessHeap();
+    bindless_heap.release(BindlessType::eStorageBuffer, vertexBufferHandle_, lastUseValue_.load());
+    bindless_heap.release(BindlessType::eStorageBuffer, indexBufferHandle_, lastUseValue_.load());
+
+    // buffers go before the memory they're bound to
+    vertexBuffer_.clear();
+    indexBuffer_.clear();
+    context_.getMemoryAllocator().free(vertexAllocation_);
+    context_.getMemoryAllocator().free(indexAllocation_);
+}
+
+
+vk::raii::Buffer Mesh::createBuffer(UploadEngine& upload_engine, vk::DeviceSize size, vk::BufferUsageFlags usage, Allocation& allocation)
+{
+    std::vector<uint32_t> queue_families = upload_engine.getConcurrentQueueFamilies();
+    vk::BufferCreateInfo buffer_create_info{
+        .size = size,
+        .usage = usage | vk::BufferUsageFlagBits::eTransferDst,
+        .sharingMode = queue_families.empty() ? vk::SharingMode::eExclusive : vk::SharingMode::eConcurrent,
+        .queueFamilyIndexCount = static_cast<uint32_t>(queue_families.size()),
+        .pQueueFamilyIndices = queue_families.data()
+    };
+
+    vk::raii::Buffer buffer = vk::raii::Buffer(context_.getLogicalDevice(), buffer_create_info);
+    allocation = context_.getMemoryAllocator().allocateForBuffer(buffer, MemoryUsage::eGpuOnly);
+    return buffer;
+}
+
+
+void Mesh::bind(const vk::raii::CommandBuffer& command_buffer) const
+{
+    vk::DeviceSize offset = 0;
+    command_buffer.bindVertexBuffers(0, *vertexBuffer_, offset);
+    command_buffer.bindIndexBuffer(*indexBuffer_, 0, indexType_);
+}
+
+
+void Mesh::markUsed(uint64_t timeline_value) const
+{
+    // frames are submitted in order, but a late caller must not move the release back
+    uint64_t last_use_value = lastUseValue_.load(std::memory_order_relaxed);
+    while (last_use_value < timeline_value && !lastUseValue_.compare_exchange_weak(last_use_value, timeline_value))
+    {
+    }
+}
+
+
+// Accessor functions
+const vk::raii::Buffer& Mesh::getVertexBuffer() const
+{
+    return vertexBuffer_;
+}
+
+
+const vk::raii::Buffer& Mesh::getIndexBuffer() const
+{
+    return indexBuffer_;
+}
+
+
+uint32_t Mesh::getVertexBufferHandle() const
+{
+    return vertexBufferHandle_;
+}
+
+
+uint32_t Mesh::getIndexBufferHandle() const
+{
+    return indexBufferHandle_;
+}
+
+
+vk::IndexType Mesh::getIndexType() const
+{
+    return indexType_;
+}
+
+
+uint32_t Mesh::getVertexCount() const
+{
+    return vertexCount_;
+}
+
+
+uint32_t Mesh::getIndexCount() const
+{
+    return indexCount_;
+}
+
+
+glm::vec3 Mesh::getBoundsMin() const
+{
+    return boundsMin_;
+}
+
+
+glm::vec3 Mesh::getBoundsMax() const
+{
+    return boundsMax_;
+}
+
+
+uint64_t Mesh::getUploadValue() const
+{
+    return uploadValue_;
+}
+
+
+vk::DeviceSize Mesh::getMemorySize() const
+{
+    return vertexAllocation_.size + indexAllocation_.size;
+}
@@ -0,0 +1,80 @@
+#pragma once
+
+#include <vulkan/vulkan_raii.hpp>
+#include <glm/glm.hpp>
+#include <atomic>
+#include <cstdint>
+#include <filesystem>
+#include <string>
+
+#include "core/MemoryAllocator.h"
+
+// forward declaring classes
+class VulkanContext;
+class UploadEngine;
+class MappedFile;
+
+// A converted mesh (resources/MeshFormat.h) in device local vertex and index buffers.
+// The file is memory mapped and copied from the mapping into the upload engine's staging ring as is,
+// there's no parsing or per vertex work on load, only a bounds check of the indices. The copies are
+// recorded but not flushed, draws must wait for getUploadValue() (UploadEngine::getWaitInfo()).
+// Vertices use PackedVertex::getBindingDescription() / getAttributeDescriptions() and need the bounds
+// to dequantize positions.
+// Both buffers are registered in the bindless heap as storage buffers too, so shaders can fetch vertices
+// themselves (ScenePass pulls them through getVertexBufferHandle()).
+// Draws report their graphics timeline value with markUsed(), the destructor releases the handles at
+// the newest one.
+// Not thread safe, except markUsed().
+class Mesh
+{
+public:
+    // throws std::runtime_error when the file is missing, truncated, from another MESH_FILE_VERSION or has
+    // an index past the last vertex
+    Mesh(const VulkanContext& context, UploadEngine& upload_engine, const std::filesystem::path& mesh_path);
+
+    // from a file that's already mapped (AssetStreamer prefetches on its I/O workers), name is only for errors
+    Mesh(const VulkanContext& context, UploadEngine& upload_engine, const MappedFile& file, const std::string& name);
+    ~Mesh();  // the GPU must be done with the buffers
+
+    // deleting copy constructors
+    Mesh(const Mesh&) = delete;
+    Mesh& operator=(const Mesh&) = delete;
+
+    void bind(const vk::raii::CommandBuffer& command_buffer) const;  // vertex buffer at binding 0 plus the index buffer
+
+    // timeline_value: the graphics submit (Renderer::getFrameScheduler()) of a frame drawing the mesh
+    void markUsed(uint64_t timeline_value) const;
+
+    // accessor functions
+    auto getVertexBuffer() const -> const vk::raii::Buffer&;
+    auto getIndexBuffer() const -> const vk::raii::Buffer&;
+    uint32_t getVertexBufferHandle() const;  // bindless storage buffer of PackedVertex
+    uint32_t getIndexBufferHandle() const;   // bindless storage buffer of getIndexType() indices
+    vk::IndexType getIndexType() const;
+    uint32_t getVertexCount() const;
+    uint32_t getIndexCount() const;
+    glm::vec3 getBoundsMin() const;
+    glm::vec3 getBoundsMax() const;
+    uint64_t getUploadValue() const;  // upload engine timeline value both buffers are complete at
+    vk::DeviceSize getMemorySize() const;  // device memory of both buffers
+
+    static constexpr vk::DeviceSize UPLOAD_CHUNK_SIZE = 4ull << 20;  // 4 MiB, big meshes stream through the ring
+
+private:
+    auto createBuffer(UploadEngine& upload_engine, vk::DeviceSize size, vk::BufferUsageFlags usage, Allocation& allocation) -> vk::raii::Buffer;
+
+    const VulkanContext& context_;
+    vk::raii::Buffer vertexBuffer_ = nullptr;
+    vk::raii::Buffer indexBuffer_ = nullptr;
+    Allocation vertexAllocation_;
+    Allocation indexAllocation_;
+    vk::IndexType indexType_ = vk::IndexType::eUint32;
+    uint32_t vertexCount_ = 0;
+    uint32_t indexCount_ = 0;
+    glm::vec3 boundsMin_ = glm::vec3(0.0f);
+    glm::vec3 boundsMax_ = glm::vec3(0.0f);
+    uint64_t uploadValue_ = 0;
+    uint32_t vertexBufferHandle_ = UINT32_MAX;
+    uint32_t indexBufferHandle_ = UINT32_MAX;
+    mutable std::atomic<uint64_t> lastUseValue_ = 0;
+};
@@ -0,0 +1,455 @@
+#include "MeshConverter.h"
+#include "MeshFormat.h"
+#include "utils/Trace.h"
+#include <glm/glm.hpp>
+#include <glm/gtc/packing.hpp>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <limits>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// the one translation unit that compiles tinyobjloader
+#define TINYOBJLOADER_IMPLEMENTATION
+#include <tiny_obj_loader.h>
+
+
+namespace
+{
+    uint64_t alignUp(uint64_t value, uint64_t alignment)
+    {
+        return (value + alignment - 1) & ~(alignment - 1);
+    }
+
+    struct PackedVertexHash
+    {
+        size_t operator()(const PackedVertex& vertex) const
+        {
+            uint64_t words[2];
+            std::memcpy(words, &vertex, sizeof(words));
+            uint64_t hash = words[0] * 0x9E3779B97F4A7C15ull;
+            hash ^= words[1] + 0x9E3779B97F4A7C15ull + (hash << 6) + (hash >> 2);
+            return static_cast<size_t>(hash);
+        }
+    };
+
+    static_assert(sizeof(PackedVertex) == 2 * sizeof(uint64_t));
+
+    struct SourceStamp
+    {
+        uint64_t size = 0;
+        int64_t writeTime = 0;
+    };
+
+    SourceStamp getSourceStamp(const std::filesystem::path& file_path)
+    {
+        return {
+            .size = static_cast<uint64_t>(std::filesystem::file_size(file_path)),
+            .writeTime = static_cast<int64_t>(std::filesystem::last_write_time(file_path).time_since_epoch().count())
+        };
+    }
+
+    uint16_t quantizeUnorm16(float value)
+    {
+        return static_cast<uint16_t>(std::lround(std::clamp(value, 0.0f, 1.0f) * 65535.0f));
+    }
+
+    int16_t quantizeSnorm16(float value)
+    {
+        return static_cast<int16_t>(std::lround(std::clamp(value, -1.0f, 1.0f) * 32767.0f));
+    }
+
+    // maps the unit sphere onto the [-1, 1] square, far less error than storing xyz at the same size
+    glm::vec2 encodeOctahedral(glm::vec3 normal)
+    {
+        float length = std::abs(normal.x) + std::abs(normal.y) + std::abs(normal.z);
+        if (length == 0.0f) return glm::vec2(0.0f);  // degenerate, decodes to +z
+
+        normal /= length;
+        glm::vec2 encoded(normal.x, normal.y);
+        if (normal.z < 0.0f)
+        {
+            glm::vec2 sign(encoded.x >= 0.0f ? 1.0f : -1.0f, encoded.y >= 0.0f ? 1.0f : -1.0f);
+            encoded = (1.0f - glm::abs(glm::vec2(encoded.y, encoded.x))) * sign;
+        }
+        return encoded;
+    }
+
+    // Tipsify (Sander, Nehab, Barczak 2007): fans around a vertex, then moves on to the neighbour most likely
+    // to still be in a FIFO cache of cache_size entries. Linear time, within a few percent of the slower
+    // greedy optimizers on our meshes.
+    std::vector<uint32_t> optimizeVertexCache(const std::vector<uint32_t>& indices, uint32_t vertex_count, uint32_t cache_size)
+    {
+        size_t triangle_count = indices.size() / 3;
+
+        // vertex -> triangles adjacency, live counts the triangles of each vertex that weren't emitted yet
+        std::vector<uint32_t> live(vertex_count, 0);
+        for (uint32_t index : indices) live[index]++;
+
+        std::vector<uint32_t> adjacency_offsets(vertex_count + 1, 0);
+        for (uint32_t v = 0; v < vertex_count; v++) adjacency_offsets[v + 1] = adjacency_offsets[v] + live[v];
+
+        std::vector<uint32_t> adjacency(indices.size());
+        std::vector<uint32_t> adjacency_cursor(adjacency_offsets.begin(), adjacency_offsets.end() - 1);
+        for (size_t t = 0; t < triangle_count; t++)
+        {
+            for (size_t corner = 0; corner < 3; corner++)
+            {
+                adjacency[adjacency_cursor[indices[t * 3 + corner]]++] = static_cast<uint32_t>(t);
+            }
+        }
+
+        std::vector<uint32_t> cache_time(vertex_count, 0);
+        std::vector<bool> is_emitted(triangle_count, false);
+        std::vector<uint32_t> dead_end;    // recently emitted vertices, the fallback when no candidate is left
+        std::vector<uint32_t> candidates;
+        std::vector<uint32_t> output;
+        output.reserve(indices.size());
+
+        uint32_t time = cache_size + 1;
+        uint32_t next_vertex = 0;          // scan cursor for the last resort, only ever moves forward
+        int64_t fanning_vertex = vertex_count > 0 ? 0 : -1;
+
+        while (fanning_vertex >= 0)
+        {
+            candidates.clear();
+            uint32_t fan_begin = adjacency_offsets[fanning_vertex];
+            uint32_t fan_end = adjacency_offsets[fanning_vertex + 1];
+            for (uint32_t i = fan_begin; i < fan_end; i++)
+            {
+                uint32_t t = adjacency[i];
+                if (is_emitted[t]) continue;
+
+                for (size_t corner = 0; corner < 3; corner++)
+                {
+                    uint32_t v = indices[t * 3 + corner];
+                    output.push_back(v);
+                    dead_end.push_back(v);
+                    candidates.push_back(v);
+                    live[v]--;
+                    if (time - cache_time[v] > cache_size)  // a miss, the vertex enters the cache
+                    {
+                        cache_time[v] = time++;
+                    }
+                }
+                is_emitted[t] = true;
+            }
+
+            // the candidate that stays in the cache the longest while its remaining fan is emitted
+            int64_t best_vertex = -1;
+            int64_t best_priority = -1;
+            for (uint32_t v : candidates)
+            {
+                if (live[v] == 0) continue;
+
+                int64_t priority = 0;
+                if (time - cache_time[v] + 2 * live[v] <= cache_size) priority = time - cache_time[v];
+                if (priority > best_priority)
+                {
+                    best_vertex = v;
+                    best_priority = priority;
+                }
+            }
+
+            // dead end: the most recently used vertex with triangles left, then whatever comes next in order
+            while (best_vertex < 0 && !dead_end.empty())
+            {
+                uint32_t v = dead_end.back();
+                dead_end.pop_back();
+                if (live[v] > 0) best_vertex = v;
+            }
+            while (best_vertex < 0 && next_vertex < vertex_count)
+            {
+                if (live[next_vertex] > 0) best_vertex = next_vertex;
+                else next_vertex++;
+            }
+
+            fanning_vertex = best_vertex;
+        }
+
+        return output;
+    }
+
+    // renumbers vertices in the order the index buffer first touches them, so vertex fetch walks memory forward
+    void optimizeVertexFetch(std::vector<PackedVertex>& vertices, std::vector<uint32_t>& indices)
+    {
+        constexpr uint32_t UNASSIGNED = std::numeric_limits<uint32_t>::max();
+        std::vector<uint32_t> remap(vertices.size(), UNASSIGNED);
+        std::vector<PackedVertex> reordered(vertices.size());
+
+        uint32_t next_index = 0;
+        for (uint32_t& index : indices)
+        {
+            if (remap[index] == UNASSIGNED)
+            {
+                remap[index] = next_index;
+                reordered[next_index] = vertices[index];
+                next_index++;
+            }
+            index = remap[index];
+        }
+
+        reordered.resize(next_index);  // drops vertices only degenerate triangles referenced
+        vertices = std::move(reordered);
+    }
+
+    // average cache miss ratio of a FIFO cache, misses per triangle: 3 is no reuse, 0.5 is the limit for big grids
+    double getAverageCacheMissRatio(const std::vector<uint32_t>& indices, uint32_t vertex_count, uint32_t cache_size)
+    {
+        if (indices.empty()) return 0.0;
+
+        std::vector<uint32_t> cache_time(vertex_count, 0);
+        uint32_t time = cache_size + 1;
+        uint32_t miss_count = 0;
+        for (uint32_t index : indices)
+        {
+            if (time - cache_time[index] > cache_size)
+            {
+                cache_time[index] = time++;
+                miss_count++;
+            }
+        }
+        return static_cast<double>(miss_count) / static_cast<double>(indices.size() / 3);
+    }
+
+    void writeMeshFile(
+        const std::filesystem::path& mesh_path,
+        MeshFileHeader header,
+        const std::vector<PackedVertex>& vertices,
+        const std::vector<uint32_t>& indices
+    )
+    {
+        // Mesh refuses to load anything else, shaders fetch vertices without a bounds check
+        for (uint32_t index : indices)
+        {
+            if (index >= vertices.size())
+            {
+                throw std::runtime_error("mesh converter: index " + std::to_string(index) + " past " + std::to_string(vertices.size()) + " vertices");
+            }
+        }
+
+        std::vector<uint16_t> short_indices;
+        const void* index_data = indices.data();
+        uint64_t index_stride = sizeof(uint32_t);
+        if (vertices.size() <= std::numeric_limits<uint16_t>::max())
+        {
+            short_indices.assign(indices.begin(), indices.end());
+            index_data = short_indices.data();
+            index_stride = sizeof(uint16_t);
+            header.indexType = MeshIndexType::eUint16;
+        }
+
+        header.vertexCount = static_cast<uint32_t>(vertices.size());
+        header.indexCount = static_cast<uint32_t>(indices.size());
+        header.vertexOffset = alignUp(sizeof(MeshFileHeader), 16);
+        header.vertexSize = vertices.size() * sizeof(PackedVertex);
+        header.indexOffset = alignUp(header.vertexOffset + header.vertexSize, 16);
+        header.indexSize = indices.size() * index_stride;
+
+        std::filesystem::path temporary_path = mesh_path;
+        temporary_path += ".tmp";
+
+        {
+            std::ofstream file(temporary_path, std::ios::binary | std::ios::trunc);
+            if (!file.is_open())
+            {
+                throw std::runtime_error("failed to open " + temporary_path.string() + " for writing");
+            }
+
+            const char padding[16] = {};
+            file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+            file.write(padding, static_cast<std::streamsize>(header.vertexOffset - sizeof(header)));
+            file.write(reinterpret_cast<const char*>(vertices.data()), static_cast<std::streamsize>(header.vertexSize));
+            file.write(padding, static_cast<std::streamsize>(header.indexOffset - header.vertexOffset - header.vertexSize));
+            file.write(static_cast<const char*>(index_data), static_cast<std::streamsize>(header.indexSize));
+            if (!file)
+            {
+                throw std::runtime_error("failed to write " + temporary_path.string());
+            }
+        }  // closing the file before renaming it
+
+        // a reader never sees a half written mesh, rename replaces the destination in one step
+        std::filesystem::rename(temporary_path, mesh_path);
+    }
+}
+
+
+void MeshConverter::convert(const std::filesystem::path& obj_path, const std::filesystem::path& mesh_path)
+{
+    TRACE_FUNCTION();
+    auto start_time = std::chrono::steady_clock::now();
+
+    // stamped before parsing, an edit during the conversion makes the result stale instead of wrongly current
+    SourceStamp source_stamp = getSourceStamp(obj_path);
+
+    tinyobj::ObjReaderConfig reader_config;
+    reader_config.triangulate = true;
+    reader_config.vertex_color = false;
+    reader_config.mtl_search_path = obj_path.parent_path().string();
+
+    tinyobj::ObjReader reader;
+    if (!reader.ParseFromFile(obj_path.string(), reader_config))
+    {
+        throw std::runtime_error("failed to parse " + obj_path.string() + ": " + reader.Error());
+    }
+
+    const tinyobj::attrib_t& attrib = reader.GetAttrib();
+    std::vector<tinyobj::index_t> corners;
+    for (const auto& shape : reader.GetShapes())
+    {
+        corners.insert(corners.end(), shape.mesh.indices.begin(), shape.mesh.indices.end());
+    }
+    if (corners.empty())
+    {
+        throw std::runtime_error(obj_path.string() + " has no triangles");
+    }
+
+    // tinyobj passes references past the end of the attribute arrays through
+    auto position_count = static_cast<int>(attrib.vertices.size() / 3);
+    auto normal_count = static_cast<int>(attrib.normals.size() / 3);
+    auto texcoord_count = static_cast<int>(attrib.texcoords.size() / 2);
+    for (const auto& corner : corners)
+    {
+        bool is_in_range = corner.vertex_index >= 0 && corner.vertex_index < position_count
+            && corner.normal_index < normal_count && corner.texcoord_index < texcoord_count;
+        if (!is_in_range)
+        {
+            throw std::runtime_error(obj_path.string() + " references a vertex attribute that doesn't exist");
+        }
+    }
+
+    auto get_position = [&attrib](int index)
+    {
+        return glm::vec3(attrib.vertices[3 * index + 0], attrib.vertices[3 * index + 1], attrib.vertices[3 * index + 2]);
+    };
+
+    glm::vec3 bounds_min(std::numeric_limits<float>::max());
+    glm::vec3 bounds_max(std::numeric_limits<float>::lowest());
+    bool is_missing_normals = false;
+    for (const auto& corner : corners)
+    {
+        glm::vec3 position = get_position(corner.vertex_index);
+        bounds_min = glm::min(bounds_min, position);
+        bounds_max = glm::max(bounds_max, position);
+        is_missing_normals |= corner.normal_index < 0;
+    }
+
+    // smooth normals per position, the face cross products are already weighted by area
+    std::vector<glm::vec3> generated_normals;
+    if (is_missing_normals)
+    {
+        generated_normals.assign(attrib.vertices.size() / 3, glm::vec3(0.0f));
+        for (size_t i = 0; i + 2 < corners.size(); i += 3)
+        {
+            glm::vec3 p0 = get_position(corners[i + 0].vertex_index);
+            glm::vec3 p1 = get_position(corners[i + 1].vertex_index);
+            glm::vec3 p2 = get_position(corners[i + 2].vertex_index);
+            glm::vec3 face_normal = glm::cross(p1 - p0, p2 - p0);
+            for (size_t corner = 0; corner < 3; corner++)
+            {
+                generated_normals[corners[i + corner].vertex_index] += face_normal;
+            }
+        }
+    }
+
+    glm::vec3 bounds_extent = bounds_max - bounds_min;
+    glm::vec3 inverse_extent(
+        bounds_extent.x > 0.0f ? 1.0f / bounds_extent.x : 0.0f,
+        bounds_extent.y > 0.0f ? 1.0f / bounds_extent.y : 0.0f,
+        bounds_extent.z > 0.0f ? 1.0f / bounds_extent.z : 0.0f
+    );
+
+    // deduplicating after quantization, corners that only differ below the stored precision merge as well
+    std::unordered_map<PackedVertex, uint32_t, PackedVertexHash> unique_vertices;
+    unique_vertices.reserve(corners.size());
+    std::vector<PackedVertex> vertices;
+    std::vector<uint32_t> indices;
+    indices.reserve(corners.size());
+
+    for (size_t i = 0; i + 2 < corners.size(); i += 3)
+    {
+        uint32_t triangle[3];
+        for (size_t corner = 0; corner < 3; corner++)
+        {
+            const tinyobj::index_t& source = corners[i + corner];
+            glm::vec3 position = (get_position(source.vertex_index) - bounds_min) * inverse_extent;
+            glm::vec3 normal = source.normal_index >= 0
+                ? glm::vec3(attrib.normals[3 * source.normal_index + 0], attrib.normals[3 * source.normal_index + 1], attrib.normals[3 * source.normal_index + 2])
+                : generated_normals[source.vertex_index];
+            glm::vec2 uv = source.texcoord_index >= 0
+                ? glm::vec2(attrib.texcoords[2 * source.texcoord_index + 0], 1.0f - attrib.texcoords[2 * source.texcoord_index + 1])
+                : glm::vec2(0.0f);
+            glm::vec2 octahedral = encodeOctahedral(normal);
+
+            PackedVertex vertex{
+                .position = {quantizeUnorm16(position.x), quantizeUnorm16(position.y), quantizeUnorm16(position.z), 0},
+                .normal = {quantizeSnorm16(octahedral.x), quantizeSnorm16(octahedral.y)},
+                .uv = {glm::packHalf1x16(uv.x), glm::packHalf1x16(uv.y)}
+            };
+
+            auto [it, is_new] = unique_vertices.try_emplace(vertex, static_cast<uint32_t>(vertices.size()));
+            if (is_new) vertices.push_back(vertex);
+            triangle[corner] = it->second;
+        }
+
+        // quantization can collapse slivers, they'd only cost vertex shader invocations
+        if (triangle[0] == triangle[1] || triangle[1] == triangle[2] || triangle[0] == triangle[2]) continue;
+        indices.insert(indices.end(), std::begin(triangle), std::end(triangle));
+    }
+
+    auto vertex_count = static_cast<uint32_t>(vertices.size());
+    double input_miss_ratio = getAverageCacheMissRatio(indices, vertex_count, VERTEX_CACHE_SIZE);
+    indices = optimizeVertexCache(indices, vertex_count, VERTEX_CACHE_SIZE);
+    double output_miss_ratio = getAverageCacheMissRatio(indices, vertex_count, VERTEX_CACHE_SIZE);
+    optimizeVertexFetch(vertices, indices);
+
+    MeshFileHeader header{
+        .boundsMin = {bounds_min.x, bounds_min.y, bounds_min.z},
+        .boundsMax = {bounds_max.x, bounds_max.y, bounds_max.z},
+        .sourceSize = source_stamp.size,
+        .sourceWriteTime = source_stamp.writeTime
+    };
+    writeMeshFile(mesh_path, header, vertices, indices);
+
+    double elapsed_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start_time).count();
+    std::cout << "mesh converter: " << obj_path.string() << " -> " << mesh_path.string() << ", "
+              << corners.size() << " corners -> " << vertices.size() << " vertices, " << indices.size() / 3 << " triangles, "
+              << "ACMR " << input_miss_ratio << " -> " << output_miss_ratio << ", " << elapsed_ms << " ms\n";
+}
+
+
+std::filesystem::path MeshConverter::ensureConverted(const std::filesystem::path& obj_path)
+{
+    std::filesystem::path mesh_path = obj_path;
+    mesh_path.replace_extension(".mesh");
+
+    if (!isUpToDate(obj_path, mesh_path))
+    {
+        convert(obj_path, mesh_path);
+    }
+    return mesh_path;
+}
+
+
+bool MeshConverter::isUpToDate(const std::filesystem::path& obj_path, const std::filesystem::path& mesh_path)
+{
+    std::ifstream file(mesh_path, std::ios::binary);
+    if (!file.is_open()) return false;
+
+    MeshFileHeader header{};
+    file.read(reinterpret_cast<char*>(&header), sizeof(header));
+    if (!file || header.magic != MESH_FILE_MAGIC || header.version != MESH_FILE_VERSION) return false;
+
+    // shipped builds can leave the OBJ out, a converted file without its source is as current as it gets
+    std::error_code error;
+    if (!std::filesystem::exists(obj_path, error)) return true;
+
+    SourceStamp source_stamp = getSourceStamp(obj_path);
+    return header.sourceSize == source_stamp.size && header.sourceWriteTime == source_stamp.writeTime;
+}
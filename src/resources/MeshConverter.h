@@ -0,0 +1,26 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+
+// Turns a Wavefront OBJ into the binary .mesh format (resources/MeshFormat.h), offline or on first run.
+//     parse (tinyobjloader, triangulated) -> quantize -> deduplicate the packed vertices by hash
+//     -> reorder triangles for the post transform vertex cache (Tipsify) -> reorder vertices by first use
+// Every shape of the OBJ ends up in one vertex and index stream, materials are ignored.
+// Missing normals are generated (area weighted, per position), missing uvs are zero.
+// Thread safe, different threads must not convert to the same output path.
+class MeshConverter
+{
+public:
+    // throws std::runtime_error when the OBJ can't be parsed or the output can't be written
+    static void convert(const std::filesystem::path& obj_path, const std::filesystem::path& mesh_path);
+
+    // converts obj_path next to itself (same name, .mesh extension) unless an up to date conversion already
+    // exists, returns the .mesh path. Same errors as convert()
+    static auto ensureConverted(const std::filesystem::path& obj_path) -> std::filesystem::path;
+
+    // false when mesh_path is missing, from an older MESH_FILE_VERSION or was converted before obj_path last changed
+    static bool isUpToDate(const std::filesystem::path& obj_path, const std::filesystem::path& mesh_path);
+
+    static constexpr uint32_t VERTEX_CACHE_SIZE = 16;  // what Tipsify optimizes for, fine for every GPU we target
+};
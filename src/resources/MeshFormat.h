@@ -0,0 +1,77 @@
+#pragma once
+
+#include <vulkan/vulkan_raii.hpp>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+// On disk layout of a converted mesh (.mesh), written by MeshConverter and mapped by Mesh.
+//     MeshFileHeader | padding | vertices (PackedVertex[vertexCount]) | indices (uint16 or uint32)
+// Everything is little endian and already in the layout the GPU reads, loading is a straight copy.
+// Bump MESH_FILE_VERSION whenever any of these structs or the converter's output changes, stale
+// files are converted again on the next run.
+
+static constexpr uint32_t MESH_FILE_MAGIC = 0x48534D56;  // "VMSH"
+static constexpr uint32_t MESH_FILE_VERSION = 1;
+
+
+// 16 bytes per vertex, the shader dequantizes.
+//     position: unorm16 inside the mesh bounds, position = boundsMin + q * (boundsMax - boundsMin), w unused
+//     normal:   octahedral encoding, snorm16
+//     uv:       half floats, v already flipped for Vulkan
+struct PackedVertex
+{
+    uint16_t position[4];
+    int16_t normal[2];
+    uint16_t uv[2];
+
+    bool operator==(const PackedVertex& other) const = default;
+
+    static auto getBindingDescription() -> vk::VertexInputBindingDescription
+    {
+        return {.binding = 0, .stride = sizeof(PackedVertex), .inputRate = vk::VertexInputRate::eVertex};
+    }
+
+    static auto getAttributeDescriptions() -> std::array<vk::VertexInputAttributeDescription, 3>
+    {
+        return {{
+            {.location = 0, .binding = 0, .format = vk::Format::eR16G16B16A16Unorm, .offset = offsetof(PackedVertex, position)},
+            {.location = 1, .binding = 0, .format = vk::Format::eR16G16Snorm, .offset = offsetof(PackedVertex, normal)},
+            {.location = 2, .binding = 0, .format = vk::Format::eR16G16Sfloat, .offset = offsetof(PackedVertex, uv)}
+        }};
+    }
+};
+
+static_assert(sizeof(PackedVertex) == 16);
+
+
+enum class MeshIndexType : uint32_t
+{
+    eUint16 = 0,  // meshes with at most 65535 vertices
+    eUint32 = 1
+};
+
+
+struct MeshFileHeader
+{
+    uint32_t magic = MESH_FILE_MAGIC;
+    uint32_t version = MESH_FILE_VERSION;
+    uint32_t vertexCount = 0;
+    uint32_t indexCount = 0;
+    MeshIndexType indexType = MeshIndexType::eUint32;
+    uint32_t reserved = 0;
+    float boundsMin[3] = {};
+    float boundsMax[3] = {};
+
+    // byte offsets from the start of the file
+    uint64_t vertexOffset = 0;
+    uint64_t vertexSize = 0;
+    uint64_t indexOffset = 0;
+    uint64_t indexSize = 0;
+
+    // the source file this was converted from, a mismatch means the conversion is stale
+    uint64_t sourceSize = 0;
+    int64_t sourceWriteTime = 0;  // std::filesystem::file_time_type ticks
+};
+
+static_assert(sizeof(MeshFileHeader) == 96);
@@ -0,0 +1,188 @@
+#include "Texture.h"
+#include "core/VulkanContext.h"
+#include "renderer/MipGenerator.h"
+#include "renderer/UploadEngine.h"
+#include "utils/Trace.h"
+#include <algorithm>
+#include <stdexcept>
+
+
+Texture::Texture(
+    const VulkanContext& context,
+    UploadEngine& upload_engine,
+    vk::Format format,
+    vk::Extent2D extent,
+    const std::vector<std::span<const std::byte>>& levels
+): context_(context), format_(format), extent_(extent), mipLevelCount_(static_cast<uint32_t>(levels.size()))
+{
+    TRACE_SCOPE("Texture::upload");
+    if (levels.empty())
+    {
+        throw std::runtime_error("texture needs at least one mip level");
+    }
+
+    createImage(upload_engine, vk::ImageUsageFlagBits::eSampled | vk::ImageUsageFlagBits::eTransferDst);
+
+    for (uint32_t level = 0; level < mipLevelCount_; level++)
+    {
+        vk::Extent3D level_extent{std::max(1u, extent_.width >> level), std::max(1u, extent_.height >> level), 1};
+        uploadValue_ = upload_engine.uploadImage(
+            *image_,
+            level_extent,
+            levels[level].data(),
+            levels[level].size(),
+            vk::ImageLayout::eShaderReadOnlyOptimal,
+            level
+        );
+    }
+}
+
+
+Texture::Texture(
+    const VulkanContext& context,
+    UploadEngine& upload_engine,
+    MipGenerator& mip_generator,
+    vk::Format format,
+    vk::Extent2D extent,
+    std::span<const std::byte> level_0
+): context_(context), format_(format), extent_(extent), mipLevelCount_(MipGenerator::getMipLevelCount(extent))
+{
+    TRACE_SCOPE("Texture::upload");
+    createImage(
+        upload_engine,
+        vk::ImageUsageFlagBits::eSampled | vk::ImageUsageFlagBits::eTransferDst | vk::ImageUsageFlagBits::eTransferSrc
+    );
+
+    // level 0 stays a blit source, the generator moves every level to shader read once the chain is built
+    uploadValue_ = upload_engine.uploadImage(
+        *image_,
+        vk::Extent3D{extent_.width, extent_.height, 1},
+        level_0.data(),
+        level_0.size(),
+        vk::ImageLayout::eTransferSrcOptimal
+    );
+
+    mipGenerationValue_ = mip_generator.generate(
+        *image_,
+        extent_,
+        mipLevelCount_,
+        vk::ImageLayout::eShaderReadOnlyOptimal,
+        upload_engine.getWaitInfo(uploadValue_, vk::PipelineStageFlagBits2::eBlit)
+    );
+}
+
+
+Texture::~Texture()
+{
+    context_.getBindlessHeap().release(BindlessType::eSampledImage, imageHandle_, lastUseValue_.load());
+
+    // the view and image go before the memory they're bound to
+    imageView_.clear();
+    image_.clear();
+    context_.getMemoryAllocator().free(allocation_);
+}
+
+
+void Texture::createImage(UploadEngine& upload_engine, vk::ImageUsageFlags usage)
+{
+    std::vector<uint32_t> queue_families = upload_engine.getConcurrentQueueFamilies();
+    vk::ImageCreateInfo image_create_info{
+        .imageType = vk::ImageType::e2D,
+        .format = format_,
+        .extent = {extent_.width, extent_.height, 1},
+        .mipLevels = mipLevelCount_,
+        .arrayLayers = 1,
+        .samples = vk::SampleCountFlagBits::e1,
+        .tiling = vk::ImageTiling::eOptimal,
+        .usage = usage,
+        .sharingMode = queue_families.empty() ? vk::SharingMode::eExclusive : vk::SharingMode::eConcurrent,
+        .queueFamilyIndexCount = static_cast<uint32_t>(queue_families.size()),
+        .pQueueFamilyIndices = queue_families.data(),
+        .initialLayout = vk::ImageLayout::eUndefined
+    };
+
+    image_ = vk::raii::Image(context_.getLogicalDevice(), image_create_info);
+    allocation_ = context_.getMemoryAllocator().allocateForImage(image_, MemoryUsage::eGpuOnly);
+
+    vk::ImageViewCreateInfo image_view_create_info{
+        .image = *image_,
+        .viewType = vk::ImageViewType::e2D,
+        .format = format_,
+        .subresourceRange = {
+            .aspectMask = vk::ImageAspectFlagBits::eColor,
+            .baseMipLevel = 0,
+            .levelCount = mipLevelCount_,
+            .baseArrayLayer = 0,
+            .layerCount = 1
+        }
+    };
+    imageView_ = vk::raii::ImageView(context_.getLogicalDevice(), image_view_create_info);
+
+    // written now, shaders only sample it once the uploads the draw waits for left it in shader read layout
+    imageHandle_ = context_.getBindlessHeap().registerSampledImage(*imageView_);
+}
+
+
+void Texture::markUsed(uint64_t timeline_value) const
+{
+    // frames are submitted in order, but a late caller must not move the release back
+    uint64_t last_use_value = lastUseValue_.load(std::memory_order_relaxed);
+    while (last_use_value < timeline_value && !lastUseValue_.compare_exchange_weak(last_use_value, timeline_value))
+    {
+    }
+}
+
+
+// Accessor functions
+const vk::raii::Image& Texture::getImage() const
+{
+    return image_;
+}
+
+
+const vk::raii::ImageView& Texture::getImageView() const
+{
+    return imageView_;
+}
+
+
+uint32_t Texture::getImageHandle() const
+{
+    return imageHandle_;
+}
+
+
+vk::Format Texture::getFormat() const
+{
+    return format_;
+}
+
+
+vk::Extent2D Texture::getExtent() const
+{
+    return extent_;
+}
+
+
+uint32_t Texture::getMipLevelCount() const
+{
+    return mipLevelCount_;
+}
+
+
+uint64_t Texture::getUploadValue() const
+{
+    return uploadValue_;
+}
+
+
+uint64_t Texture::getMipGenerationValue() const
+{
+    return mipGenerationValue_;
+}
+
+
+vk::DeviceSize Texture::getMemorySize() const
+{
+    return allocation_.size;
+}
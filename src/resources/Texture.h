@@ -0,0 +1,80 @@
+#pragma once
+
+#include <vulkan/vulkan_raii.hpp>
+#include <atomic>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+#include "core/MemoryAllocator.h"
+
+// forward declaring classes
+class VulkanContext;
+class UploadEngine;
+class MipGenerator;
+
+// A sampled 2D image with its full mip chain, in eShaderReadOnlyOptimal once its uploads complete.
+// Either every level comes from the CPU (a KTX2 cache file, a CPU built chain) and only needs the upload
+// engine, or only level 0 does and the MipGenerator blits the rest on the graphics queue. Draws must wait
+// for getUploadValue() on the upload engine and getMipGenerationValue() on the generator (0: nothing to
+// wait for), the AssetStreamer does that before it publishes a texture.
+// The view is registered in the bindless heap (getImageHandle()). Draws sampling it report their graphics
+// timeline value with markUsed(), the destructor releases the handle at the newest one.
+// Not thread safe, except markUsed().
+class Texture
+{
+public:
+    // levels[0] is the full resolution, tightly packed, as many levels as the image gets
+    Texture(
+        const VulkanContext& context,
+        UploadEngine& upload_engine,
+        vk::Format format,
+        vk::Extent2D extent,
+        const std::vector<std::span<const std::byte>>& levels
+    );
+
+    // level 0 only, the format must pass MipGenerator::supportsFormat()
+    Texture(
+        const VulkanContext& context,
+        UploadEngine& upload_engine,
+        MipGenerator& mip_generator,
+        vk::Format format,
+        vk::Extent2D extent,
+        std::span<const std::byte> level_0
+    );
+
+    ~Texture();  // the GPU must be done with the image
+
+    // deleting copy constructors
+    Texture(const Texture&) = delete;
+    Texture& operator=(const Texture&) = delete;
+
+    // timeline_value: the graphics submit (Renderer::getFrameScheduler()) of a frame sampling the texture
+    void markUsed(uint64_t timeline_value) const;
+
+    // accessor functions
+    auto getImage() const -> const vk::raii::Image&;
+    auto getImageView() const -> const vk::raii::ImageView&;
+    uint32_t getImageHandle() const;  // bindless sampled image, in eShaderReadOnlyOptimal
+    vk::Format getFormat() const;
+    vk::Extent2D getExtent() const;
+    uint32_t getMipLevelCount() const;
+    uint64_t getUploadValue() const;
+    uint64_t getMipGenerationValue() const;
+    vk::DeviceSize getMemorySize() const;
+
+private:
+    void createImage(UploadEngine& upload_engine, vk::ImageUsageFlags usage);
+
+    const VulkanContext& context_;
+    vk::raii::Image image_ = nullptr;
+    vk::raii::ImageView imageView_ = nullptr;
+    Allocation allocation_;
+    vk::Format format_ = vk::Format::eUndefined;
+    vk::Extent2D extent_;
+    uint32_t mipLevelCount_ = 1;
+    uint64_t uploadValue_ = 0;
+    uint64_t mipGenerationValue_ = 0;
+    uint32_t imageHandle_ = UINT32_MAX;
+    mutable std::atomic<uint64_t> lastUseValue_ = 0;
+};
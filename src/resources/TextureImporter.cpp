@@ -0,0 +1,245 @@
+#include "TextureImporter.h"
+#include "BlockCompression.h"
+#include "Ktx2File.h"
+#include "core/VulkanContext.h"
+#include "utils/Trace.h"
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <stdexcept>
+
+#define STB_IMAGE_IMPLEMENTATION
+#include <stb_image.h>
+
+
+namespace
+{
+    constexpr const char* SOURCE_STAMP_KEY = "VkTutorialSource";
+
+    auto srgbToLinearTable() -> const std::array<float, 256>&
+    {
+        static const std::array<float, 256> table = []()
+        {
+            std::array<float, 256> values{};
+            for (uint32_t i = 0; i < 256; i++)
+            {
+                float c = static_cast<float>(i) / 255.0f;
+                values[i] = c <= 0.04045f ? c / 12.92f : std::pow((c + 0.055f) / 1.055f, 2.4f);
+            }
+            return values;
+        }();
+        return table;
+    }
+
+    uint8_t linearToSrgb(float c)
+    {
+        c = std::clamp(c, 0.0f, 1.0f);
+        float encoded = c <= 0.0031308f ? c * 12.92f : 1.055f * std::pow(c, 1.0f / 2.4f) - 0.055f;
+        return static_cast<uint8_t>(encoded * 255.0f + 0.5f);
+    }
+
+
+    // 2x2 box filter, odd sizes clamp to the last row or column
+    auto downsample(const std::vector<uint8_t>& source, uint32_t width, uint32_t height, bool is_srgb) -> std::vector<uint8_t>
+    {
+        const std::array<float, 256>& to_linear = srgbToLinearTable();
+        uint32_t dst_width = std::max(1u, width / 2);
+        uint32_t dst_height = std::max(1u, height / 2);
+        std::vector<uint8_t> result(static_cast<size_t>(dst_width) * dst_height * 4);
+
+        for (uint32_t y = 0; y < dst_height; y++)
+        {
+            uint32_t y0 = std::min(y * 2, height - 1);
+            uint32_t y1 = std::min(y * 2 + 1, height - 1);
+            for (uint32_t x = 0; x < dst_width; x++)
+            {
+                uint32_t x0 = std::min(x * 2, width - 1);
+                uint32_t x1 = std::min(x * 2 + 1, width - 1);
+                const std::array<const uint8_t*, 4> texels = {
+                    &source[(static_cast<size_t>(y0) * width + x0) * 4],
+                    &source[(static_cast<size_t>(y0) * width + x1) * 4],
+                    &source[(static_cast<size_t>(y1) * width + x0) * 4],
+                    &source[(static_cast<size_t>(y1) * width + x1) * 4]
+                };
+
+                uint8_t* out = &result[(static_cast<size_t>(y) * dst_width + x) * 4];
+                for (uint32_t c = 0; c < 4; c++)
+                {
+                    // alpha is always linear
+                    if (is_srgb && c < 3)
+                    {
+                        float sum = 0.0f;
+                        for (const uint8_t* texel : texels) sum += to_linear[texel[c]];
+                        out[c] = linearToSrgb(sum * 0.25f);
+                    }
+                    else
+                    {
+                        uint32_t sum = 0;
+                        for (const uint8_t* texel : texels) sum += texel[c];
+                        out[c] = static_cast<uint8_t>((sum + 2) / 4);
+                    }
+                }
+            }
+        }
+        return result;
+    }
+}
+
+
+TextureImporter::Image TextureImporter::decode(const std::filesystem::path& file_path)
+{
+    TRACE_FUNCTION();
+    int width = 0;
+    int height = 0;
+    int channels = 0;
+    stbi_uc* pixels = stbi_load(file_path.string().c_str(), &width, &height, &channels, STBI_rgb_alpha);
+    if (!pixels)
+    {
+        throw std::runtime_error("failed to load texture image " + file_path.string() + ": " + stbi_failure_reason());
+    }
+
+    Image image;
+    image.extent = vk::Extent2D{static_cast<uint32_t>(width), static_cast<uint32_t>(height)};
+    image.pixels.assign(pixels, pixels + static_cast<size_t>(width) * height * 4);
+    stbi_image_free(pixels);
+
+    // an alpha channel that's fully opaque still gets the 8 byte blocks
+    for (size_t i = 3; i < image.pixels.size(); i += 4)
+    {
+        if (image.pixels[i] != 255)
+        {
+            image.hasAlpha = true;
+            break;
+        }
+    }
+    return image;
+}
+
+
+std::vector<std::vector<uint8_t>> TextureImporter::buildMipChain(const Image& image, bool is_srgb)
+{
+    TRACE_FUNCTION();
+    std::vector<std::vector<uint8_t>> levels;
+    levels.push_back(image.pixels);
+
+    uint32_t width = image.extent.width;
+    uint32_t height = image.extent.height;
+    while (width > 1 || height > 1)
+    {
+        levels.push_back(downsample(levels.back(), width, height, is_srgb));
+        width = std::max(1u, width / 2);
+        height = std::max(1u, height / 2);
+    }
+    return levels;
+}
+
+
+vk::Format TextureImporter::selectCompressedFormat(const VulkanContext& context, bool has_alpha, bool is_srgb)
+{
+    if (!context.isTextureCompressionBcEnabled()) return vk::Format::eUndefined;
+
+    vk::Format format;
+    if (has_alpha) format = is_srgb ? vk::Format::eBc3SrgbBlock : vk::Format::eBc3UnormBlock;
+    else format = is_srgb ? vk::Format::eBc1RgbSrgbBlock : vk::Format::eBc1RgbUnormBlock;
+
+    return isFormatSampleable(context, format) ? format : vk::Format::eUndefined;
+}
+
+
+vk::Format TextureImporter::getUncompressedFormat(bool is_srgb)
+{
+    return is_srgb ? vk::Format::eR8G8B8A8Srgb : vk::Format::eR8G8B8A8Unorm;
+}
+
+
+bool TextureImporter::isFormatSampleable(const VulkanContext& context, vk::Format format)
+{
+    vk::FormatFeatureFlags features = context.getPhysicalDevice().getFormatProperties(format).optimalTilingFeatures;
+    vk::FormatFeatureFlags required = vk::FormatFeatureFlagBits::eSampledImage | vk::FormatFeatureFlagBits::eSampledImageFilterLinear;
+    return (features & required) == required;
+}
+
+
+std::vector<std::vector<uint8_t>> TextureImporter::compress(
+    vk::Format format,
+    vk::Extent2D extent,
+    const std::vector<std::vector<uint8_t>>& levels
+)
+{
+    TRACE_FUNCTION();
+    std::vector<std::vector<uint8_t>> encoded_levels;
+    encoded_levels.reserve(levels.size());
+    for (uint32_t level = 0; level < levels.size(); level++)
+    {
+        uint32_t width = std::max(1u, extent.width >> level);
+        uint32_t height = std::max(1u, extent.height >> level);
+        switch (format)
+        {
+            case vk::Format::eBc1RgbUnormBlock:
+            case vk::Format::eBc1RgbSrgbBlock:
+                encoded_levels.push_back(compressBc1(levels[level].data(), width, height));
+                break;
+            case vk::Format::eBc3UnormBlock:
+            case vk::Format::eBc3SrgbBlock:
+                encoded_levels.push_back(compressBc3(levels[level].data(), width, height));
+                break;
+            default:
+                throw std::runtime_error("texture importer: no encoder for format " + vk::to_string(format));
+        }
+    }
+    return encoded_levels;
+}
+
+
+void TextureImporter::writeCache(
+    const std::filesystem::path& source_path,
+    const std::filesystem::path& cache_path,
+    vk::Format format,
+    vk::Extent2D extent,
+    const std::vector<std::vector<uint8_t>>& levels
+)
+{
+    TRACE_FUNCTION();
+    Ktx2File::write(cache_path, format, extent, levels, {
+        {"KTXwriter", "vk_tutorial TextureImporter"},
+        {SOURCE_STAMP_KEY, getSourceStamp(source_path)}
+    });
+}
+
+
+std::filesystem::path TextureImporter::getCachePath(const std::filesystem::path& source_path)
+{
+    std::filesystem::path cache_path = source_path;
+    cache_path += ".ktx2";
+    return cache_path;
+}
+
+
+bool TextureImporter::isCacheUpToDate(const std::filesystem::path& source_path, const std::filesystem::path& cache_path)
+{
+    std::error_code error;
+    if (!std::filesystem::exists(cache_path, error)) return false;
+
+    std::string cached_stamp;
+    try
+    {
+        Ktx2File file(cache_path);
+        cached_stamp = file.getValue(SOURCE_STAMP_KEY);
+    }
+    catch (const std::exception&)
+    {
+        return false;  // truncated or from somewhere else, rebuilt from the source
+    }
+
+    // same as the mesh cache, shipped builds can leave the sources out
+    if (!std::filesystem::exists(source_path, error)) return true;
+    return cached_stamp == getSourceStamp(source_path);
+}
+
+
+std::string TextureImporter::getSourceStamp(const std::filesystem::path& source_path)
+{
+    uintmax_t size = std::filesystem::file_size(source_path);
+    int64_t write_time = static_cast<int64_t>(std::filesystem::last_write_time(source_path).time_since_epoch().count());
+    return std::to_string(size) + " " + std::to_string(write_time);
+}
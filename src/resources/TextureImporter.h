@@ -0,0 +1,61 @@
+#pragma once
+
+#include <vulkan/vulkan_raii.hpp>
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+// forward declaring classes
+class VulkanContext;
+
+// Source images (PNG, JPEG, TGA, ... through stb_image) to what a Texture uploads, and the KTX2 cache
+// that lets later runs skip decoding and compression:
+//     decode to RGBA8 -> box filtered mip chain (in linear space for sRGB) -> BC1, or BC3 with alpha
+//     -> <source>.ktx2, stamped with the source's size and write time
+// Devices without BC support get RGBA8 and their mips from the MipGenerator instead, nothing is cached.
+// Thread safe, different threads must not write the same cache path.
+class TextureImporter
+{
+public:
+    struct Image
+    {
+        std::vector<uint8_t> pixels;  // RGBA8, tightly packed rows
+        vk::Extent2D extent;
+        bool hasAlpha = false;        // any texel with alpha below 255
+    };
+
+    // throws std::runtime_error when the file can't be read or decoded
+    static auto decode(const std::filesystem::path& file_path) -> Image;
+
+    // full chain down to 1x1, levels[0] is image itself. sRGB texels are averaged as linear values
+    static auto buildMipChain(const Image& image, bool is_srgb) -> std::vector<std::vector<uint8_t>>;
+
+    // the BCn format the cache would store, eUndefined when the device can't sample any
+    static vk::Format selectCompressedFormat(const VulkanContext& context, bool has_alpha, bool is_srgb);
+    static vk::Format getUncompressedFormat(bool is_srgb);
+
+    // optimal tiling sampling with linear filtering
+    static bool isFormatSampleable(const VulkanContext& context, vk::Format format);
+
+    // every level to format (BC1 or BC3), same layout as buildMipChain()
+    static auto compress(vk::Format format, vk::Extent2D extent, const std::vector<std::vector<uint8_t>>& levels)
+        -> std::vector<std::vector<uint8_t>>;
+
+    // writes already compressed levels as the stamped cache, throws std::runtime_error on failure
+    static void writeCache(
+        const std::filesystem::path& source_path,
+        const std::filesystem::path& cache_path,
+        vk::Format format,
+        vk::Extent2D extent,
+        const std::vector<std::vector<uint8_t>>& levels
+    );
+
+    static auto getCachePath(const std::filesystem::path& source_path) -> std::filesystem::path;  // next to the source, .ktx2 appended
+
+    // false when cache_path is missing, unreadable or older than source_path. A cache without its source is current
+    static bool isCacheUpToDate(const std::filesystem::path& source_path, const std::filesystem::path& cache_path);
+
+private:
+    static auto getSourceStamp(const std::filesystem::path& source_path) -> std::string;
+};
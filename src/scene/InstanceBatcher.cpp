@@ -0,0 +1,149 @@
+#include "InstanceBatcher.h"
+#include "Scene.h"
+#include "core/VulkanContext.h"
+#include "renderer/FrameScheduler.h"
+#include "utils/Trace.h"
+#include <algorithm>
+#include <numeric>
+
+
+InstanceBatcher::InstanceBatcher(const VulkanContext& context, const FrameScheduler& scheduler, uint32_t frame_count, uint32_t initial_capacity)
+    : context_(context), scheduler_(scheduler), frames_(frame_count), initialCapacity_(std::max(1u, initial_capacity))
+{
+    for (auto& frame : frames_)
+    {
+        ensureCapacity(frame, initialCapacity_);
+    }
+}
+
+
+InstanceBatcher::~InstanceBatcher()
+{
+    // every frame drawing with the buffers was submitted by now, the last reserved value covers them all
+    uint64_t release_value = scheduler_.getLastReservedValue();
+    for (auto& frame : frames_)
+    {
+        context_.getBindlessHeap().release(BindlessType::eStorageBuffer, frame.handle, release_value);
+        frame.buffer.clear();
+        context_.getMemoryAllocator().free(frame.allocation);
+    }
+}
+
+
+std::span<const DrawBatch> InstanceBatcher::build(const Scene& scene, uint32_t frame_index)
+{
+    TRACE_FUNCTION();
+    if (sortedVersion_ != scene.getStructureVersion())
+    {
+        sortObjects(scene);
+        sortedVersion_ = scene.getStructureVersion();
+    }
+
+    FrameBuffer& frame = frames_[frame_index];
+    uint32_t instance_count = static_cast<uint32_t>(sortedObjects_.size());
+    ensureCapacity(frame, instance_count);
+
+    // a straight stream of writes into (usually write combined) memory, never read back
+    std::span<const glm::mat4> world_matrices = scene.getWorldMatrices();
+    std::span<const uint32_t> material_ids = scene.getMaterialIds();
+    InstanceData* instances = static_cast<InstanceData*>(frame.allocation.mappedData);
+    for (uint32_t i = 0; i < instance_count; i++)
+    {
+        uint32_t object_index = sortedObjects_[i];
+        instances[i] = InstanceData{
+            .world = world_matrices[object_index],
+            .materialId = material_ids[object_index],
+            .objectIndex = object_index
+        };
+    }
+
+    return batches_;
+}
+
+
+void InstanceBatcher::sortObjects(const Scene& scene)
+{
+    TRACE_FUNCTION();
+    std::span<const uint32_t> pipeline_ids = scene.getPipelineIds();
+    std::span<const uint32_t> mesh_ids = scene.getMeshIds();
+
+    // pipeline first, a pipeline change costs more than a mesh change
+    auto batch_key = [&](uint32_t object_index)
+    {
+        return (static_cast<uint64_t>(pipeline_ids[object_index]) << 32) | mesh_ids[object_index];
+    };
+
+    sortedObjects_.resize(scene.getObjectCount());
+    std::iota(sortedObjects_.begin(), sortedObjects_.end(), 0u);
+    std::ranges::sort(sortedObjects_, [&](uint32_t a, uint32_t b) { return batch_key(a) < batch_key(b); });
+
+    batches_.clear();
+    for (uint32_t i = 0; i < sortedObjects_.size(); i++)
+    {
+        uint32_t object_index = sortedObjects_[i];
+        if (batches_.empty() || batches_.back().pipelineId != pipeline_ids[object_index] || batches_.back().meshId != mesh_ids[object_index])
+        {
+            batches_.push_back(DrawBatch{
+                .pipelineId = pipeline_ids[object_index],
+                .meshId = mesh_ids[object_index],
+                .firstInstance = i
+            });
+        }
+        batches_.back().instanceCount++;
+    }
+}
+
+
+void InstanceBatcher::ensureCapacity(FrameBuffer& frame, uint32_t instance_count)
+{
+    if (instance_count <= frame.capacity) return;
+
+    // the slot's previous frame completed, the old buffer can go right away. Its handle is released at the
+    // newest submit, which is at least as late as that frame
+    BindlessHeap& bindless_heap = context_.getBindlessHeap();
+    if (frame.capacity > 0)
+    {
+        bindless_heap.release(BindlessType::eStorageBuffer, frame.handle, scheduler_.getLastReservedValue());
+        frame.buffer.clear();
+        context_.getMemoryAllocator().free(frame.allocation);
+    }
+
+    // grows by half again at least, a scene that keeps growing doesn't reallocate every frame
+    uint32_t capacity = std::max(instance_count, frame.capacity + frame.capacity / 2);
+    capacity = std::max(capacity, initialCapacity_);
+
+    vk::BufferCreateInfo buffer_create_info{
+        .size = sizeof(InstanceData) * capacity,
+        .usage = vk::BufferUsageFlagBits::eStorageBuffer,
+        .sharingMode = vk::SharingMode::eExclusive
+    };
+    frame.buffer = vk::raii::Buffer(context_.getLogicalDevice(), buffer_create_info);
+    frame.allocation = context_.getMemoryAllocator().allocateForBuffer(frame.buffer, MemoryUsage::eDynamic);
+    frame.handle = bindless_heap.registerStorageBuffer(*frame.buffer);
+    frame.capacity = capacity;
+}
+
+
+// Accessor functions
+std::span<const DrawBatch> InstanceBatcher::getBatches() const
+{
+    return batches_;
+}
+
+
+std::span<const uint32_t> InstanceBatcher::getInstanceObjects() const
+{
+    return sortedObjects_;
+}
+
+
+uint32_t InstanceBatcher::getInstanceBufferHandle(uint32_t frame_index) const
+{
+    return frames_[frame_index].handle;
+}
+
+
+uint32_t InstanceBatcher::getInstanceCount() const
+{
+    return static_cast<uint32_t>(sortedObjects_.size());
+}
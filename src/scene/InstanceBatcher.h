@@ -0,0 +1,88 @@
+#pragma once
+
+#include <vulkan/vulkan_raii.hpp>
+#include <glm/glm.hpp>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+#include "core/MemoryAllocator.h"
+
+// forward declaring classes
+class VulkanContext;
+class FrameScheduler;
+class Scene;
+
+// Per instance data the batched draws read, 80 bytes. Shaders fetch it through the bindless heap
+// (getInstanceBufferHandle()) at SV_VulkanInstanceID, which already includes the batch's firstInstance.
+struct InstanceData
+{
+    glm::mat4 world = glm::mat4(1.0f);
+    uint32_t materialId = 0;
+    uint32_t objectIndex = 0;  // dense index in the scene
+    uint32_t padding[2] = {};
+};
+static_assert(sizeof(InstanceData) == 80, "InstanceData must match the shader layout");
+
+
+// Objects sharing a pipeline and a mesh, drawn with one instanced draw
+struct DrawBatch
+{
+    uint32_t pipelineId = 0;
+    uint32_t meshId = 0;
+    uint32_t firstInstance = 0;
+    uint32_t instanceCount = 0;
+};
+
+
+// Groups a Scene into instanced draws: objects are sorted by (pipeline, mesh) once per structural change
+// of the scene, and every frame their world matrices are streamed into a persistently mapped instance
+// buffer owned by that frame slot. Recording a frame is then one bind and one draw per batch:
+//     for (const DrawBatch& batch : batcher.build(scene, frame_index))
+//         bind pipeline batch.pipelineId and mesh batch.meshId,
+//         drawIndexed(index_count, batch.instanceCount, 0, 0, batch.firstInstance)
+// Not thread safe.
+class InstanceBatcher
+{
+public:
+    // scheduler is the graphics timeline the batched draws are submitted on, it must outlive the batcher
+    InstanceBatcher(const VulkanContext& context, const FrameScheduler& scheduler, uint32_t frame_count, uint32_t initial_capacity = 1024);
+    ~InstanceBatcher();  // the GPU must be done with every frame slot
+
+    // deleting copy constructors
+    InstanceBatcher(const InstanceBatcher&) = delete;
+    InstanceBatcher& operator=(const InstanceBatcher&) = delete;
+
+    // writes the frame slot's instance buffer, the slot's previous submit must have completed (it has
+    // once Renderer::drawFrame waited for the frame). Scene::updateTransforms() must have run.
+    // The batches stay valid until the next build()
+    auto build(const Scene& scene, uint32_t frame_index) -> std::span<const DrawBatch>;
+
+    // accessor functions
+    auto getBatches() const -> std::span<const DrawBatch>;
+    auto getInstanceObjects() const -> std::span<const uint32_t>;  // dense index of every instance, batch by batch
+    uint32_t getInstanceBufferHandle(uint32_t frame_index) const;  // bindless storage buffer of InstanceData
+    uint32_t getInstanceCount() const;
+
+private:
+    struct FrameBuffer
+    {
+        vk::raii::Buffer buffer = nullptr;
+        Allocation allocation;  // eDynamic, mapped for its whole lifetime
+        uint32_t handle = UINT32_MAX;
+        uint32_t capacity = 0;
+    };
+
+    void sortObjects(const Scene& scene);
+    void ensureCapacity(FrameBuffer& frame, uint32_t instance_count);
+
+    const VulkanContext& context_;
+    const FrameScheduler& scheduler_;
+    std::vector<FrameBuffer> frames_;
+    uint32_t initialCapacity_ = 0;
+
+    // cached until the scene's structure version changes
+    std::vector<uint32_t> sortedObjects_;  // dense indices, batch by batch
+    std::vector<DrawBatch> batches_;
+    uint64_t sortedVersion_ = UINT64_MAX;
+};
@@ -0,0 +1,449 @@
+#include "Scene.h"
+#include "utils/Trace.h"
+#include <stdexcept>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#define SCENE_USE_SSE 1
+#include <immintrin.h>
+#endif
+
+
+SceneObjectId Scene::createObject(const SceneObjectDesc& desc)
+{
+    uint32_t slot_index;
+    if (!freeSlots_.empty())
+    {
+        slot_index = freeSlots_.back();
+        freeSlots_.pop_back();
+    }
+    else
+    {
+        slot_index = static_cast<uint32_t>(slots_.size());
+        slots_.emplace_back();
+    }
+
+    uint32_t dense_index = getObjectCount();
+    Slot& slot = slots_[slot_index];
+    slot.denseIndex = dense_index;
+    slot.isAlive = true;
+
+    denseToSlot_.push_back(slot_index);
+    positionX_.push_back(desc.position.x);
+    positionY_.push_back(desc.position.y);
+    positionZ_.push_back(desc.position.z);
+    rotationX_.push_back(desc.rotation.x);
+    rotationY_.push_back(desc.rotation.y);
+    rotationZ_.push_back(desc.rotation.z);
+    rotationW_.push_back(desc.rotation.w);
+    scaleX_.push_back(desc.scale.x);
+    scaleY_.push_back(desc.scale.y);
+    scaleZ_.push_back(desc.scale.z);
+    worldMatrices_.push_back(compose(desc.position, desc.rotation, desc.scale));  // valid before the first update
+    boundingSpheres_.push_back(desc.boundingSphere);
+    meshIds_.push_back(desc.meshId);
+    materialIds_.push_back(desc.materialId);
+    pipelineIds_.push_back(desc.pipelineId);
+
+    if (dense_index % GROUP_SIZE == 0) isGroupDirty_.push_back(0);
+    structureVersion_++;
+
+    return SceneObjectId{.index = slot_index, .generation = slot.generation};
+}
+
+
+void Scene::destroyObject(SceneObjectId id)
+{
+    if (!isAlive(id)) return;
+
+    Slot& slot = slots_[id.index];
+    uint32_t dense_index = slot.denseIndex;
+    uint32_t last_index = getObjectCount() - 1;
+    if (dense_index != last_index)
+    {
+        moveObject(last_index, dense_index);
+        slots_[denseToSlot_[dense_index]].denseIndex = dense_index;
+    }
+    popObject();
+
+    slot.isAlive = false;
+    slot.generation++;  // outstanding ids of this slot stop resolving
+    freeSlots_.push_back(id.index);
+    structureVersion_++;
+}
+
+
+bool Scene::isAlive(SceneObjectId id) const
+{
+    return id.index < slots_.size() && slots_[id.index].isAlive && slots_[id.index].generation == id.generation;
+}
+
+
+void Scene::clear()
+{
+    for (uint32_t slot_index : denseToSlot_)
+    {
+        slots_[slot_index].isAlive = false;
+        slots_[slot_index].generation++;
+        freeSlots_.push_back(slot_index);
+    }
+
+    denseToSlot_.clear();
+    positionX_.clear();
+    positionY_.clear();
+    positionZ_.clear();
+    rotationX_.clear();
+    rotationY_.clear();
+    rotationZ_.clear();
+    rotationW_.clear();
+    scaleX_.clear();
+    scaleY_.clear();
+    scaleZ_.clear();
+    worldMatrices_.clear();
+    boundingSpheres_.clear();
+    meshIds_.clear();
+    materialIds_.clear();
+    pipelineIds_.clear();
+    isGroupDirty_.clear();
+    dirtyGroups_.clear();
+    structureVersion_++;
+}
+
+
+void Scene::reserve(uint32_t object_count)
+{
+    slots_.reserve(object_count);
+    denseToSlot_.reserve(object_count);
+    for (auto* pool : {&positionX_, &positionY_, &positionZ_, &rotationX_, &rotationY_, &rotationZ_, &rotationW_, &scaleX_, &scaleY_, &scaleZ_})
+    {
+        pool->reserve(object_count);
+    }
+    worldMatrices_.reserve(object_count);
+    boundingSpheres_.reserve(object_count);
+    meshIds_.reserve(object_count);
+    materialIds_.reserve(object_count);
+    pipelineIds_.reserve(object_count);
+    isGroupDirty_.reserve((object_count + GROUP_SIZE - 1) / GROUP_SIZE);
+}
+
+
+void Scene::setPosition(SceneObjectId id, glm::vec3 position)
+{
+    uint32_t dense_index = resolve(id);
+    positionX_[dense_index] = position.x;
+    positionY_[dense_index] = position.y;
+    positionZ_[dense_index] = position.z;
+    markDirty(dense_index);
+}
+
+
+void Scene::setRotation(SceneObjectId id, glm::quat rotation)
+{
+    uint32_t dense_index = resolve(id);
+    rotationX_[dense_index] = rotation.x;
+    rotationY_[dense_index] = rotation.y;
+    rotationZ_[dense_index] = rotation.z;
+    rotationW_[dense_index] = rotation.w;
+    markDirty(dense_index);
+}
+
+
+void Scene::setScale(SceneObjectId id, glm::vec3 scale)
+{
+    uint32_t dense_index = resolve(id);
+    scaleX_[dense_index] = scale.x;
+    scaleY_[dense_index] = scale.y;
+    scaleZ_[dense_index] = scale.z;
+    markDirty(dense_index);
+}
+
+
+void Scene::setTransform(SceneObjectId id, glm::vec3 position, glm::quat rotation, glm::vec3 scale)
+{
+    setPosition(id, position);
+    setRotation(id, rotation);
+    setScale(id, scale);
+}
+
+
+void Scene::setMesh(SceneObjectId id, uint32_t mesh_id)
+{
+    meshIds_[resolve(id)] = mesh_id;
+    structureVersion_++;
+}
+
+
+void Scene::setMaterial(SceneObjectId id, uint32_t material_id)
+{
+    materialIds_[resolve(id)] = material_id;
+    structureVersion_++;
+}
+
+
+void Scene::setPipeline(SceneObjectId id, uint32_t pipeline_id)
+{
+    pipelineIds_[resolve(id)] = pipeline_id;
+    structureVersion_++;
+}
+
+
+void Scene::setBoundingSphere(SceneObjectId id, glm::vec4 bounding_sphere)
+{
+    boundingSpheres_[resolve(id)] = bounding_sphere;
+}
+
+
+void Scene::updateTransforms()
+{
+    TRACE_FUNCTION();
+    uint32_t object_count = getObjectCount();
+    for (uint32_t group : dirtyGroups_)
+    {
+        isGroupDirty_[group] = 0;
+
+        uint32_t first = group * GROUP_SIZE;
+        if (first + GROUP_SIZE <= object_count)
+        {
+            composeGroup(
+                &positionX_[first], &positionY_[first], &positionZ_[first],
+                &rotationX_[first], &rotationY_[first], &rotationZ_[first], &rotationW_[first],
+                &scaleX_[first], &scaleY_[first], &scaleZ_[first],
+                &worldMatrices_[first]
+            );
+            continue;
+        }
+
+        // the last, partially filled group
+        for (uint32_t i = first; i < object_count; i++)
+        {
+            worldMatrices_[i] = compose(
+                glm::vec3(positionX_[i], positionY_[i], positionZ_[i]),
+                glm::quat(rotationW_[i], rotationX_[i], rotationY_[i], rotationZ_[i]),
+                glm::vec3(scaleX_[i], scaleY_[i], scaleZ_[i])
+            );
+        }
+    }
+    dirtyGroups_.clear();
+}
+
+
+uint32_t Scene::resolve(SceneObjectId id) const
+{
+    if (!isAlive(id)) throw std::out_of_range("scene object id is not alive");
+    return slots_[id.index].denseIndex;
+}
+
+
+void Scene::markDirty(uint32_t dense_index)
+{
+    uint32_t group = dense_index / GROUP_SIZE;
+    if (isGroupDirty_[group]) return;
+
+    isGroupDirty_[group] = 1;
+    dirtyGroups_.push_back(group);
+}
+
+
+void Scene::moveObject(uint32_t from, uint32_t to)
+{
+    denseToSlot_[to] = denseToSlot_[from];
+    positionX_[to] = positionX_[from];
+    positionY_[to] = positionY_[from];
+    positionZ_[to] = positionZ_[from];
+    rotationX_[to] = rotationX_[from];
+    rotationY_[to] = rotationY_[from];
+    rotationZ_[to] = rotationZ_[from];
+    rotationW_[to] = rotationW_[from];
+    scaleX_[to] = scaleX_[from];
+    scaleY_[to] = scaleY_[from];
+    scaleZ_[to] = scaleZ_[from];
+    worldMatrices_[to] = worldMatrices_[from];
+    boundingSpheres_[to] = boundingSpheres_[from];
+    meshIds_[to] = meshIds_[from];
+    materialIds_[to] = materialIds_[from];
+    pipelineIds_[to] = pipelineIds_[from];
+
+    // a pending change of the moved object has to be applied in its new group
+    if (isGroupDirty_[from / GROUP_SIZE]) markDirty(to);
+}
+
+
+void Scene::popObject()
+{
+    denseToSlot_.pop_back();
+    positionX_.pop_back();
+    positionY_.pop_back();
+    positionZ_.pop_back();
+    rotationX_.pop_back();
+    rotationY_.pop_back();
+    rotationZ_.pop_back();
+    rotationW_.pop_back();
+    scaleX_.pop_back();
+    scaleY_.pop_back();
+    scaleZ_.pop_back();
+    worldMatrices_.pop_back();
+    boundingSpheres_.pop_back();
+    meshIds_.pop_back();
+    materialIds_.pop_back();
+    pipelineIds_.pop_back();
+
+    // a group that just emptied can't stay listed, updateTransforms() would read past the pools
+    uint32_t object_count = getObjectCount();
+    if (object_count % GROUP_SIZE == 0)
+    {
+        uint32_t group = object_count / GROUP_SIZE;
+        if (isGroupDirty_[group]) std::erase(dirtyGroups_, group);
+        isGroupDirty_.pop_back();
+    }
+}
+
+
+void Scene::composeGroup(const float* px, const float* py, const float* pz,
+                         const float* qx, const float* qy, const float* qz, const float* qw,
+                         const float* sx, const float* sy, const float* sz,
+                         glm::mat4* world)
+{
+#if SCENE_USE_SSE
+    // one lane per object, the same formula as compose()
+    __m128 x = _mm_loadu_ps(qx);
+    __m128 y = _mm_loadu_ps(qy);
+    __m128 z = _mm_loadu_ps(qz);
+    __m128 w = _mm_loadu_ps(qw);
+    __m128 one = _mm_set1_ps(1.0f);
+    __m128 two = _mm_set1_ps(2.0f);
+
+    __m128 xx = _mm_mul_ps(x, x), yy = _mm_mul_ps(y, y), zz = _mm_mul_ps(z, z);
+    __m128 xy = _mm_mul_ps(x, y), xz = _mm_mul_ps(x, z), yz = _mm_mul_ps(y, z);
+    __m128 wx = _mm_mul_ps(w, x), wy = _mm_mul_ps(w, y), wz = _mm_mul_ps(w, z);
+
+    __m128 scale_x = _mm_loadu_ps(sx);
+    __m128 scale_y = _mm_loadu_ps(sy);
+    __m128 scale_z = _mm_loadu_ps(sz);
+
+    // columns of rotation * scale, components split across registers
+    __m128 c0x = _mm_mul_ps(_mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(yy, zz))), scale_x);
+    __m128 c0y = _mm_mul_ps(_mm_mul_ps(two, _mm_add_ps(xy, wz)), scale_x);
+    __m128 c0z = _mm_mul_ps(_mm_mul_ps(two, _mm_sub_ps(xz, wy)), scale_x);
+    __m128 c0w = _mm_setzero_ps();
+
+    __m128 c1x = _mm_mul_ps(_mm_mul_ps(two, _mm_sub_ps(xy, wz)), scale_y);
+    __m128 c1y = _mm_mul_ps(_mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(xx, zz))), scale_y);
+    __m128 c1z = _mm_mul_ps(_mm_mul_ps(two, _mm_add_ps(yz, wx)), scale_y);
+    __m128 c1w = _mm_setzero_ps();
+
+    __m128 c2x = _mm_mul_ps(_mm_mul_ps(two, _mm_add_ps(xz, wy)), scale_z);
+    __m128 c2y = _mm_mul_ps(_mm_mul_ps(two, _mm_sub_ps(yz, wx)), scale_z);
+    __m128 c2z = _mm_mul_ps(_mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(xx, yy))), scale_z);
+    __m128 c2w = _mm_setzero_ps();
+
+    __m128 c3x = _mm_loadu_ps(px);
+    __m128 c3y = _mm_loadu_ps(py);
+    __m128 c3z = _mm_loadu_ps(pz);
+    __m128 c3w = one;
+
+    // after the transpose register i holds the column of object i
+    _MM_TRANSPOSE4_PS(c0x, c0y, c0z, c0w);
+    _MM_TRANSPOSE4_PS(c1x, c1y, c1z, c1w);
+    _MM_TRANSPOSE4_PS(c2x, c2y, c2z, c2w);
+    _MM_TRANSPOSE4_PS(c3x, c3y, c3z, c3w);
+
+    const __m128 columns[4][4] = {
+        {c0x, c1x, c2x, c3x},
+        {c0y, c1y, c2y, c3y},
+        {c0z, c1z, c2z, c3z},
+        {c0w, c1w, c2w, c3w}
+    };
+    for (uint32_t lane = 0; lane < GROUP_SIZE; lane++)
+    {
+        for (int column = 0; column < 4; column++)
+        {
+            _mm_storeu_ps(&world[lane][column][0], columns[lane][column]);
+        }
+    }
+#else
+    for (uint32_t lane = 0; lane < GROUP_SIZE; lane++)
+    {
+        world[lane] = compose(
+            glm::vec3(px[lane], py[lane], pz[lane]),
+            glm::quat(qw[lane], qx[lane], qy[lane], qz[lane]),
+            glm::vec3(sx[lane], sy[lane], sz[lane])
+        );
+    }
+#endif
+}
+
+
+glm::mat4 Scene::compose(glm::vec3 position, glm::quat rotation, glm::vec3 scale)
+{
+    // translate * rotate * scale without the matrix products, the rotation is expected to be normalized
+    float xx = rotation.x * rotation.x, yy = rotation.y * rotation.y, zz = rotation.z * rotation.z;
+    float xy = rotation.x * rotation.y, xz = rotation.x * rotation.z, yz = rotation.y * rotation.z;
+    float wx = rotation.w * rotation.x, wy = rotation.w * rotation.y, wz = rotation.w * rotation.z;
+
+    glm::mat4 world;
+    world[0] = glm::vec4(1.0f - 2.0f * (yy + zz), 2.0f * (xy + wz), 2.0f * (xz - wy), 0.0f) * scale.x;
+    world[1] = glm::vec4(2.0f * (xy - wz), 1.0f - 2.0f * (xx + zz), 2.0f * (yz + wx), 0.0f) * scale.y;
+    world[2] = glm::vec4(2.0f * (xz + wy), 2.0f * (yz - wx), 1.0f - 2.0f * (xx + yy), 0.0f) * scale.z;
+    world[3] = glm::vec4(position, 1.0f);
+    return world;
+}
+
+
+// Accessor functions
+uint32_t Scene::getObjectCount() const
+{
+    return static_cast<uint32_t>(denseToSlot_.size());
+}
+
+
+uint32_t Scene::getDenseIndex(SceneObjectId id) const
+{
+    return resolve(id);
+}
+
+
+const glm::mat4& Scene::getWorldMatrix(SceneObjectId id) const
+{
+    return worldMatrices_[resolve(id)];
+}
+
+
+std::span<const glm::mat4> Scene::getWorldMatrices() const
+{
+    return worldMatrices_;
+}
+
+
+std::span<const glm::vec4> Scene::getBoundingSpheres() const
+{
+    return boundingSpheres_;
+}
+
+
+std::span<const uint32_t> Scene::getMeshIds() const
+{
+    return meshIds_;
+}
+
+
+std::span<const uint32_t> Scene::getMaterialIds() const
+{
+    return materialIds_;
+}
+
+
+std::span<const uint32_t> Scene::getPipelineIds() const
+{
+    return pipelineIds_;
+}
+
+
+uint64_t Scene::getStructureVersion() const
+{
+    return structureVersion_;
+}
+
+
+uint32_t Scene::getDirtyGroupCount() const
+{
+    return static_cast<uint32_t>(dirtyGroups_.size());
+}
@@ -0,0 +1,124 @@
+#pragma once
+
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+// Stable handle to a scene object. Objects move around inside the pools when others are destroyed,
+// the id stays the same, and the generation catches ids of destroyed objects whose slot was reused.
+struct SceneObjectId
+{
+    uint32_t index = UINT32_MAX;
+    uint32_t generation = 0;
+
+    bool isValid() const { return index != UINT32_MAX; }
+    bool operator==(const SceneObjectId&) const = default;
+};
+
+
+// What a new object starts with. Ids are the application's, the scene only groups by them
+struct SceneObjectDesc
+{
+    glm::vec3 position = glm::vec3(0.0f);
+    glm::quat rotation = glm::quat(1.0f, 0.0f, 0.0f, 0.0f);
+    glm::vec3 scale = glm::vec3(1.0f);
+    glm::vec4 boundingSphere = glm::vec4(0.0f, 0.0f, 0.0f, 1.0f);  // object space center in xyz, radius in w
+    uint32_t meshId = 0;
+    uint32_t materialId = 0;
+    uint32_t pipelineId = 0;
+};
+
+
+// Flat scene storage for a lot of objects: every attribute lives in its own contiguous pool (one float
+// array per component for the transforms), indexed by a dense index that is always [0, getObjectCount()).
+// Destroying swaps the last object into the hole, so the pools never have gaps to skip.
+//
+// World matrices are only recomputed for objects whose transform changed since the last
+// updateTransforms(), four at a time with SSE where available. Dirty state is tracked per group of four
+// dense indices, a group is recomputed as a whole.
+// Not thread safe.
+class Scene
+{
+public:
+    Scene() = default;
+
+    // deleting copy constructors
+    Scene(const Scene&) = delete;
+    Scene& operator=(const Scene&) = delete;
+
+    auto createObject(const SceneObjectDesc& desc) -> SceneObjectId;
+    void destroyObject(SceneObjectId id);  // ignores ids that are no longer alive
+    bool isAlive(SceneObjectId id) const;
+    void clear();
+    void reserve(uint32_t object_count);
+
+    // transform changes are picked up by the next updateTransforms()
+    void setPosition(SceneObjectId id, glm::vec3 position);
+    void setRotation(SceneObjectId id, glm::quat rotation);
+    void setScale(SceneObjectId id, glm::vec3 scale);
+    void setTransform(SceneObjectId id, glm::vec3 position, glm::quat rotation, glm::vec3 scale);
+
+    // changes of these regroup the draw batches (getStructureVersion())
+    void setMesh(SceneObjectId id, uint32_t mesh_id);
+    void setMaterial(SceneObjectId id, uint32_t material_id);
+    void setPipeline(SceneObjectId id, uint32_t pipeline_id);
+    void setBoundingSphere(SceneObjectId id, glm::vec4 bounding_sphere);
+
+    void updateTransforms();  // once per frame before anything reads world matrices
+
+    // accessor functions, the spans are indexed by dense index and invalidated by create and destroy
+    uint32_t getObjectCount() const;
+    uint32_t getDenseIndex(SceneObjectId id) const;  // id must be alive
+    auto getWorldMatrix(SceneObjectId id) const -> const glm::mat4&;
+    auto getWorldMatrices() const -> std::span<const glm::mat4>;
+    auto getBoundingSpheres() const -> std::span<const glm::vec4>;
+    auto getMeshIds() const -> std::span<const uint32_t>;
+    auto getMaterialIds() const -> std::span<const uint32_t>;
+    auto getPipelineIds() const -> std::span<const uint32_t>;
+    uint64_t getStructureVersion() const;  // bumped by create, destroy and mesh, material or pipeline changes
+    uint32_t getDirtyGroupCount() const;   // groups the next updateTransforms() recomputes
+
+    static constexpr uint32_t GROUP_SIZE = 4;  // SSE lanes
+
+private:
+    struct Slot
+    {
+        uint32_t denseIndex = 0;
+        uint32_t generation = 0;
+        bool isAlive = false;
+    };
+
+    auto resolve(SceneObjectId id) const -> uint32_t;  // dense index, throws std::out_of_range for dead ids
+    void markDirty(uint32_t dense_index);
+    void moveObject(uint32_t from, uint32_t to);  // every pool, from is left for pop_back
+    void popObject();
+
+    static void composeGroup(const float* px, const float* py, const float* pz,
+                             const float* qx, const float* qy, const float* qz, const float* qw,
+                             const float* sx, const float* sy, const float* sz,
+                             glm::mat4* world);  // GROUP_SIZE objects
+    static auto compose(glm::vec3 position, glm::quat rotation, glm::vec3 scale) -> glm::mat4;
+
+    // sparse side, indexed by SceneObjectId::index
+    std::vector<Slot> slots_;
+    std::vector<uint32_t> freeSlots_;
+
+    // dense pools, all getObjectCount() long
+    std::vector<uint32_t> denseToSlot_;
+    std::vector<float> positionX_, positionY_, positionZ_;
+    std::vector<float> rotationX_, rotationY_, rotationZ_, rotationW_;
+    std::vector<float> scaleX_, scaleY_, scaleZ_;
+    std::vector<glm::mat4> worldMatrices_;
+    std::vector<glm::vec4> boundingSpheres_;
+    std::vector<uint32_t> meshIds_;
+    std::vector<uint32_t> materialIds_;
+    std::vector<uint32_t> pipelineIds_;
+
+    // dirty groups, the flags avoid listing a group twice
+    std::vector<uint8_t> isGroupDirty_;
+    std::vector<uint32_t> dirtyGroups_;
+
+    uint64_t structureVersion_ = 0;
+};
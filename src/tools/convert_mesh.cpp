@@ -0,0 +1,35 @@
+// offline mesh conversion, so shipped builds never parse OBJ at startup
+//     ConvertMesh <input.obj> [output.mesh]
+// without an output path the mesh goes next to the input, where MeshConverter::ensureConverted() looks for it
+
+#include <cstdlib>
+#include <exception>
+#include <filesystem>
+#include <iostream>
+
+#include "resources/MeshConverter.h"
+
+
+int main(int argc, char** argv)
+{
+    if (argc < 2 || argc > 3)
+    {
+        std::cerr << "usage: ConvertMesh <input.obj> [output.mesh]\n";
+        return EXIT_FAILURE;
+    }
+
+    std::filesystem::path obj_path = argv[1];
+    std::filesystem::path mesh_path = argc == 3 ? std::filesystem::path(argv[2]) : std::filesystem::path(obj_path).replace_extension(".mesh");
+
+    try
+    {
+        MeshConverter::convert(obj_path, mesh_path);
+    }
+    catch (const std::exception& e)
+    {
+        std::cerr << "mesh converter: " << e.what() << "\n";
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
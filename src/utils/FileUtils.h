@@ -0,0 +1,187 @@
+#pragma once
+
+#include <vector>
+#include <string>
+#include <cstdint>
+#include <cstddef>
+#include <fstream>
+#include <stdexcept>
+#include <utility>
+
+#ifdef _WIN32
+    #ifndef NOMINMAX
+        #define NOMINMAX
+    #endif
+    #ifndef WIN32_LEAN_AND_MEAN
+        #define WIN32_LEAN_AND_MEAN
+    #endif
+    #include <windows.h>
+#else
+    #include <fcntl.h>
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+    #include <unistd.h>
+#endif
+
+
+// Reads a SPIR-V binary file and returns its contents as uint32_t words.
+// Throws std::runtime_error if the file cannot be opened or is not a whole number of words.
+inline auto readSpirv(const std::string& file_path) -> std::vector<uint32_t>
+{
+    // opening at the end (ate) so tellg() gives the file size straight away
+    std::ifstream file(file_path, std::ios::binary | std::ios::ate);
+    if (!file.is_open())
+    {
+        throw std::runtime_error("failed to open SPIR-V file: " + file_path);
+    }
+
+    const std::streamsize file_size = file.tellg();
+    if (file_size % sizeof(uint32_t) != 0)  // SPIR-V is a stream of 32 bit words
+    {
+        throw std::runtime_error("SPIR-V file size is not a multiple of 4: " + file_path);
+    }
+
+    std::vector<uint32_t> words(static_cast<size_t>(file_size) / sizeof(uint32_t));
+    file.seekg(0);
+    file.read(reinterpret_cast<char*>(words.data()), file_size);
+
+    return words;
+}
+
+
+// Read only memory mapping of a whole file, the pages are loaded on first access and shared with the OS file cache.
+// Move only, the mapping is released on destruction. Throws std::runtime_error if the file cannot be mapped.
+class MappedFile
+{
+public:
+    MappedFile() = default;
+
+    explicit MappedFile(const std::string& file_path)
+    {
+#ifdef _WIN32
+        file_ = CreateFileA(file_path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+        if (file_ == INVALID_HANDLE_VALUE)
+        {
+            throw std::runtime_error("failed to open file for mapping: " + file_path);
+        }
+
+        LARGE_INTEGER file_size = {};
+        GetFileSizeEx(file_, &file_size);
+        size_ = static_cast<size_t>(file_size.QuadPart);
+        if (size_ == 0) return;  // empty files can't be mapped, data() stays null
+
+        mapping_ = CreateFileMappingA(file_, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        data_ = mapping_ ? MapViewOfFile(mapping_, FILE_MAP_READ, 0, 0, 0) : nullptr;
+#else
+        int file_descriptor = open(file_path.c_str(), O_RDONLY);
+        if (file_descriptor < 0)
+        {
+            throw std::runtime_error("failed to open file for mapping: " + file_path);
+        }
+
+        struct stat file_stat = {};
+        fstat(file_descriptor, &file_stat);
+        size_ = static_cast<size_t>(file_stat.st_size);
+        if (size_ > 0)
+        {
+            void* mapped = mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, file_descriptor, 0);
+            data_ = mapped == MAP_FAILED ? nullptr : mapped;
+        }
+        close(file_descriptor);  // the mapping keeps its own reference to the file
+
+        if (size_ == 0) return;
+#endif
+        if (data_ == nullptr)
+        {
+            release();
+            throw std::runtime_error("failed to map file: " + file_path);
+        }
+    }
+
+    ~MappedFile()
+    {
+        release();
+    }
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    MappedFile(MappedFile&& other) noexcept
+    {
+        *this = std::move(other);
+    }
+
+    MappedFile& operator=(MappedFile&& other) noexcept
+    {
+        if (this != &other)
+        {
+            release();
+            data_ = std::exchange(other.data_, nullptr);
+            size_ = std::exchange(other.size_, 0);
+#ifdef _WIN32
+            file_ = std::exchange(other.file_, INVALID_HANDLE_VALUE);
+            mapping_ = std::exchange(other.mapping_, nullptr);
+#endif
+        }
+        return *this;
+    }
+
+    // page aligned, so it can be read as any fundamental type
+    const std::byte* data() const { return static_cast<const std::byte*>(data_); }
+    size_t size() const { return size_; }
+
+    template <typename T>
+    const T* as() const { return static_cast<const T*>(data_); }
+
+    // faults every page in on the calling thread, so later reads (memcpy under a lock) don't wait on the disk
+    void prefetch() const
+    {
+        if (data_ == nullptr) return;
+#ifndef _WIN32
+        posix_madvise(data_, size_, POSIX_MADV_WILLNEED);  // start the readahead for the whole range at once
+#endif
+        constexpr size_t PREFETCH_STRIDE = 4096;  // the smallest page size we run on, bigger pages are touched more than once
+        const volatile std::byte* bytes = static_cast<const std::byte*>(data_);
+        for (size_t offset = 0; offset < size_; offset += PREFETCH_STRIDE)
+        {
+            (void)bytes[offset];
+        }
+    }
+
+private:
+    void release()
+    {
+#ifdef _WIN32
+        if (data_) UnmapViewOfFile(data_);
+        if (mapping_) CloseHandle(mapping_);
+        if (file_ != INVALID_HANDLE_VALUE) CloseHandle(file_);
+        file_ = INVALID_HANDLE_VALUE;
+        mapping_ = nullptr;
+#else
+        if (data_) munmap(data_, size_);
+#endif
+        data_ = nullptr;
+        size_ = 0;
+    }
+
+    void* data_ = nullptr;
+    size_t size_ = 0;
+#ifdef _WIN32
+    HANDLE file_ = INVALID_HANDLE_VALUE;
+    HANDLE mapping_ = nullptr;
+#endif
+};
+
+
+// Maps a SPIR-V binary, the words can go straight into vk::ShaderModuleCreateInfo without a copy.
+// Throws std::runtime_error if the file cannot be mapped or is not a whole number of words.
+inline auto mapSpirv(const std::string& file_path) -> MappedFile
+{
+    MappedFile file(file_path);
+    if (file.size() == 0 || file.size() % sizeof(uint32_t) != 0)
+    {
+        throw std::runtime_error("SPIR-V file size is not a multiple of 4: " + file_path);
+    }
+
+    return file;
+}
@@ -0,0 +1,117 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <iomanip>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// Wall clock durations of the startup stages (instance, window, device, caches, swap chain, first
+// frame), printed as a single report. Unlike the trace scopes these are always compiled in, startup is
+// the one thing the short lived command line tools are measured by.
+//     StartupStage stage("create instance");   // times the rest of the enclosing block
+//     StartupTimer::get().print();              // once the first frame is out
+// Stages running on other threads overlap the ones on the main thread, the report lists each stage's
+// start next to its duration so the overlap shows. Names must outlive the report, only the pointer is
+// stored.
+// Thread safe.
+class StartupTimer
+{
+public:
+    struct Stage
+    {
+        const char* name = nullptr;
+        uint64_t beginNs = 0;  // since the timer was created, the first get() call
+        uint64_t endNs = 0;
+    };
+
+    static auto get() -> StartupTimer&
+    {
+        static StartupTimer startup_timer;
+        return startup_timer;
+    }
+
+    // deleting copy and move semantics, there's only the one instance
+    StartupTimer(const StartupTimer&) = delete;
+    StartupTimer& operator=(const StartupTimer&) = delete;
+    StartupTimer(StartupTimer&&) = delete;
+    StartupTimer& operator=(StartupTimer&&) = delete;
+
+    uint64_t now() const
+    {
+        return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - epoch_).count());
+    }
+
+    void record(const char* name, uint64_t begin_ns, uint64_t end_ns)
+    {
+        std::lock_guard lock(mutex_);
+        stages_.push_back(Stage{.name = name, .beginNs = begin_ns, .endNs = end_ns});
+    }
+
+    // sorted by start, stages still running are not included
+    auto getStages() const -> std::vector<Stage>
+    {
+        std::vector<Stage> stages;
+        {
+            std::lock_guard lock(mutex_);
+            stages = stages_;
+        }
+        std::ranges::sort(stages, [](const Stage& a, const Stage& b) { return a.beginNs < b.beginNs; });
+        return stages;
+    }
+
+    // total is the time from the first get() call to now, only printed once
+    void print()
+    {
+        if (isPrinted_.exchange(true)) return;
+
+        uint64_t total_ns = now();
+        std::cout << "startup: " << std::fixed << std::setprecision(1) << total_ns / 1.0e6 << " ms\n";
+        for (const Stage& stage : getStages())
+        {
+            std::cout << "\t" << std::left << std::setw(24) << stage.name << std::right
+                      << " at " << std::setw(7) << stage.beginNs / 1.0e6 << " ms, "
+                      << std::setw(7) << (stage.endNs - stage.beginNs) / 1.0e6 << " ms\n";
+        }
+        std::cout << std::defaultfloat;
+    }
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    StartupTimer(): epoch_(Clock::now())
+    {
+    }
+
+    Clock::time_point epoch_;
+    mutable std::mutex mutex_;  // guards stages_
+    std::vector<Stage> stages_;
+    std::atomic<bool> isPrinted_ = false;
+};
+
+
+// times its own lifetime into the StartupTimer
+class StartupStage
+{
+public:
+    explicit StartupStage(const char* name): name_(name), beginNs_(StartupTimer::get().now())
+    {
+    }
+
+    ~StartupStage()
+    {
+        StartupTimer::get().record(name_, beginNs_, StartupTimer::get().now());
+    }
+
+    // deleting copy constructors
+    StartupStage(const StartupStage&) = delete;
+    StartupStage& operator=(const StartupStage&) = delete;
+
+private:
+    const char* name_;
+    uint64_t beginNs_;
+};
@@ -0,0 +1,116 @@
+#pragma once
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "Trace.h"
+
+// Fixed size pool of worker threads pulling jobs from a FIFO queue.
+// Jobs still queued when the pool is destroyed are dropped, the job running on each worker is finished.
+class ThreadPool
+{
+public:
+    using Job = std::function<void()>;
+
+    // 0 picks one worker per hardware thread minus one, leaving a core for the main loop
+    explicit ThreadPool(uint32_t worker_count = 0)
+    {
+        if (worker_count == 0)
+        {
+            worker_count = std::max(1u, std::thread::hardware_concurrency() - 1);
+        }
+
+        workers_.reserve(worker_count);
+        for (uint32_t i = 0; i < worker_count; i++)
+        {
+            workers_.emplace_back([this](std::stop_token stop_token) { workerLoop(stop_token); });
+        }
+    }
+
+    ~ThreadPool()
+    {
+        {
+            // requesting under the lock so a worker can't miss the wake up between its predicate check and wait
+            std::lock_guard lock(mutex_);
+            for (auto& worker : workers_)
+            {
+                worker.request_stop();
+            }
+        }
+        condition_.notify_all();
+        // std::jthread joins on destruction
+    }
+
+    // deleting copy and move semantics, workers capture this
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+    ThreadPool(ThreadPool&&) = delete;
+    ThreadPool& operator=(ThreadPool&&) = delete;
+
+    void submit(Job job)
+    {
+        {
+            std::lock_guard lock(mutex_);
+            jobs_.push_back(std::move(job));
+        }
+        condition_.notify_one();
+    }
+
+    // blocks until the queue is empty and no worker is busy
+    void waitIdle()
+    {
+        std::unique_lock lock(mutex_);
+        idleCondition_.wait(lock, [this]() { return jobs_.empty() && activeJobs_ == 0; });
+    }
+
+    uint32_t getWorkerCount() const
+    {
+        return static_cast<uint32_t>(workers_.size());
+    }
+
+    uint32_t getPendingCount() const
+    {
+        std::lock_guard lock(mutex_);
+        return static_cast<uint32_t>(jobs_.size()) + activeJobs_;
+    }
+
+private:
+    void workerLoop(std::stop_token stop_token)
+    {
+        TRACE_THREAD_NAME("worker");
+        while (true)
+        {
+            Job job;
+            {
+                std::unique_lock lock(mutex_);
+                condition_.wait(lock, [&]() { return stop_token.stop_requested() || !jobs_.empty(); });
+                if (stop_token.stop_requested()) return;
+
+                job = std::move(jobs_.front());
+                jobs_.pop_front();
+                activeJobs_++;
+            }
+
+            job();
+
+            {
+                std::lock_guard lock(mutex_);
+                activeJobs_--;
+            }
+            idleCondition_.notify_all();
+        }
+    }
+
+    mutable std::mutex mutex_;
+    std::condition_variable condition_;
+    std::condition_variable idleCondition_;
+    std::deque<Job> jobs_;
+    uint32_t activeJobs_ = 0;
+    std::vector<std::jthread> workers_;  // declared last so workers stop before the queue is destroyed
+};
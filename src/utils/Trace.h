@@ -0,0 +1,201 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+// CPU trace scopes, compiled out unless the build defines VK_TUTORIAL_TRACING (CMake option of the same name).
+//     TRACE_SCOPE("acquire");   // times the rest of the enclosing block
+//     TRACE_FUNCTION();         // same, named after the function
+//     TRACE_THREAD_NAME("worker");
+// Names must be string literals (or otherwise live until the trace is written), only the pointer is stored.
+// One scope per line, the variable is named after __LINE__.
+#ifdef VK_TUTORIAL_TRACING
+    #define TRACE_CONCAT_INNER(a, b) a##b
+    #define TRACE_CONCAT(a, b) TRACE_CONCAT_INNER(a, b)
+    #define TRACE_SCOPE(name) TraceScope TRACE_CONCAT(trace_scope_, __LINE__)(name)
+    #define TRACE_FUNCTION() TRACE_SCOPE(__func__)
+    #define TRACE_THREAD_NAME(name) Tracer::get().setThreadName(name)
+#else
+    #define TRACE_SCOPE(name) ((void)0)
+    #define TRACE_FUNCTION() ((void)0)
+    #define TRACE_THREAD_NAME(name) ((void)0)
+#endif
+
+
+struct TraceEvent
+{
+    const char* name = nullptr;
+    uint64_t beginNs = 0;  // since the tracer was created
+    uint64_t endNs = 0;
+};
+
+// Process wide sink for TRACE_SCOPE. Every thread writes into its own ring of EVENTS_PER_THREAD events
+// without locking (one relaxed load and one release store per event), the oldest events are overwritten.
+// The mutex is only taken the first time a thread records and when the trace is written.
+// writeChromeTrace() output loads in chrome://tracing and Perfetto, and Tracy's import-chrome converts it.
+// Thread safe, the export should run while the traced threads are quiet or their newest events may be torn.
+class Tracer
+{
+public:
+#ifdef VK_TUTORIAL_TRACING
+    static constexpr bool ENABLED = true;
+#else
+    static constexpr bool ENABLED = false;
+#endif
+
+    static constexpr uint32_t EVENTS_PER_THREAD = 1u << 14;  // power of two, 384 KiB per thread
+
+    static auto get() -> Tracer&
+    {
+        static Tracer tracer;
+        return tracer;
+    }
+
+    // deleting copy and move semantics, there's only the one instance
+    Tracer(const Tracer&) = delete;
+    Tracer& operator=(const Tracer&) = delete;
+    Tracer(Tracer&&) = delete;
+    Tracer& operator=(Tracer&&) = delete;
+
+    uint64_t now() const
+    {
+        return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - epoch_).count());
+    }
+
+    void record(const char* name, uint64_t begin_ns, uint64_t end_ns)
+    {
+        ThreadBuffer& buffer = getThreadBuffer();
+        uint64_t write_count = buffer.writeCount.load(std::memory_order_relaxed);  // only this thread writes it
+        buffer.events[write_count & (EVENTS_PER_THREAD - 1)] = TraceEvent{.name = name, .beginNs = begin_ns, .endNs = end_ns};
+        buffer.writeCount.store(write_count + 1, std::memory_order_release);
+    }
+
+    void setThreadName(const char* thread_name)
+    {
+        ThreadBuffer& buffer = getThreadBuffer();
+        std::lock_guard lock(mutex_);
+        buffer.threadName = thread_name;
+    }
+
+    // chrome trace event format, complete ("X") events in microseconds, throws std::runtime_error on failure
+    void writeChromeTrace(const std::filesystem::path& file_path) const
+    {
+        std::ofstream file(file_path, std::ios::trunc);
+        if (!file.is_open())
+        {
+            throw std::runtime_error("failed to open " + file_path.string() + " for writing");
+        }
+
+        std::lock_guard lock(mutex_);
+        file << "{\"traceEvents\":[\n";
+        bool is_first = true;
+        auto separator = [&file, &is_first]() -> std::ofstream&
+        {
+            if (!is_first) file << ",\n";
+            is_first = false;
+            return file;
+        };
+
+        for (const auto& buffer : threads_)
+        {
+            separator() << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << buffer->threadId
+                        << ",\"args\":{\"name\":\"" << escape(buffer->threadName) << "\"}}";
+
+            uint64_t write_count = buffer->writeCount.load(std::memory_order_acquire);
+            uint64_t first = write_count > EVENTS_PER_THREAD ? write_count - EVENTS_PER_THREAD : 0;
+            for (uint64_t i = first; i < write_count; i++)
+            {
+                const TraceEvent& event = buffer->events[i & (EVENTS_PER_THREAD - 1)];
+                separator() << "{\"name\":\"" << escape(event.name) << "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << buffer->threadId
+                            << ",\"ts\":" << event.beginNs / 1000.0 << ",\"dur\":" << (event.endNs - event.beginNs) / 1000.0 << "}";
+            }
+        }
+        file << "\n]}\n";
+
+        if (!file)
+        {
+            throw std::runtime_error("failed to write " + file_path.string());
+        }
+    }
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    struct ThreadBuffer
+    {
+        uint32_t threadId = 0;
+        std::string threadName;
+        std::unique_ptr<TraceEvent[]> events;
+        std::atomic<uint64_t> writeCount = 0;
+    };
+
+    Tracer(): epoch_(Clock::now())
+    {
+    }
+
+    auto getThreadBuffer() -> ThreadBuffer&
+    {
+        // owned by the tracer, not the thread: pool workers are gone by the time the trace is written
+        thread_local ThreadBuffer* thread_buffer = nullptr;
+        if (!thread_buffer)
+        {
+            auto buffer = std::make_unique<ThreadBuffer>();
+            buffer->events = std::make_unique<TraceEvent[]>(EVENTS_PER_THREAD);
+
+            std::lock_guard lock(mutex_);
+            buffer->threadId = static_cast<uint32_t>(threads_.size());
+            buffer->threadName = "thread " + std::to_string(buffer->threadId);  // until TRACE_THREAD_NAME
+            thread_buffer = buffer.get();
+            threads_.push_back(std::move(buffer));
+        }
+
+        return *thread_buffer;
+    }
+
+    static auto escape(const std::string& text) -> std::string
+    {
+        std::string escaped;
+        escaped.reserve(text.size());
+        for (char character : text)
+        {
+            if (character == '"' || character == '\\') escaped += '\\';
+            escaped += character;
+        }
+        return escaped;
+    }
+
+    Clock::time_point epoch_;
+    mutable std::mutex mutex_;  // guards threads_ and the thread names
+    std::vector<std::unique_ptr<ThreadBuffer>> threads_;
+};
+
+
+// times its own lifetime, use through TRACE_SCOPE
+class TraceScope
+{
+public:
+    explicit TraceScope(const char* name): name_(name), beginNs_(Tracer::get().now())
+    {
+    }
+
+    ~TraceScope()
+    {
+        Tracer::get().record(name_, beginNs_, Tracer::get().now());
+    }
+
+    // deleting copy constructors
+    TraceScope(const TraceScope&) = delete;
+    TraceScope& operator=(const TraceScope&) = delete;
+
+private:
+    const char* name_;
+    uint64_t beginNs_;
+};